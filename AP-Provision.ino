@@ -5,11 +5,182 @@
 #include <esp_wifi.h>
 #include <esp_event.h>
 #include <nvs_flash.h>
+#include <esp_now.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <esp_timer.h>
+#include <esp_netif.h>
+#include <lwip/sockets.h>
+#if ESP_IDF_VERSION_MAJOR >= 5
+#include <driver/i2s_std.h>
+#include <esp_adc/adc_continuous.h>
+#else
+#include <driver/i2s.h>
+#include <driver/adc.h>
+#endif
+#include <lwip/udp.h>
+#include <lwip/pbuf.h>
+#include <lwip/tcpip.h>
+#include <mbedtls/sha256.h>
+#include <mbedtls/base64.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/ssl_ticket.h>
+#include <mbedtls/ssl_cache.h>
+#include <mbedtls/net_sockets.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/x509_crt.h>
+#include <mbedtls/pk.h>
+#include "src/espnow_relay.h"
+#include "src/discovery_proto.h"
+#include "src/delta_patch.h"
+#include "src/audio_source.h"
+#include "src/decimator.h"
+#include "src/g711.h"
+#include "src/rtp.h"
+#include "src/srtp.h"
+#include "src/jwt.h"
+#include "src/mqtt.h"
+#include "src/vad.h"
+#include "src/mfcc.h"
+#include "src/classifier.h"
+#include "src/envelope.h"
+#include "src/clip_ring.h"
+#include "src/wav_header.h"
+#include "src/byte_fifo.h"
+#include "src/asset_store.h"
+
+#define FW_VERSION_MAJOR 1
+#define FW_VERSION_MINOR 1
+#define FW_VERSION_PATCH 0
 
 #define CONNECT_TIMEOUT_MS 15000
 #define RETRY_CONNECT_MS    5000
+#define WIFI_SETTLE_TIMEOUT_MS 1000  // AP/STA start or stop; normally well under 100 ms
+#define PHASE_MAX          16        // boot/transition timeline entries kept
 #define DNS_PORT 53
 
+// -------- JSON provisioning API --------
+#define PROV_WAIT_MAX_MS   20000  // cap for GET /api/provision?wait=
+#define PROV_WAITERS       2      // long-polls parked at once; more are answered at once
+#define PROV_AP_LINGER_MS  30000  // keep AP up after success so the app can read the result
+#define REPROV_PORTAL_MS   (10UL * 60 * 1000)  // hitless reprov portal closes if unused this long
+
+// -------- Provisioning AP admission (stations.ino) --------
+#define AP_MAX_STATIONS      4       // concurrent clients on the open AP
+#define AP_NONINTERACTIVE_MS 45000   // probe-only clients are evicted after this when nearly full
+#define AP_IDLE_MS           (10UL * 60 * 1000)
+#define AP_EVICT_BAN_MS      120000
+#define AP_BANNED_SLOTS      8
+
+// -------- RFC 8908 captive portal API (capport.ino) --------
+#define CAPPORT_API_PATH     "/captive-portal/api"
+#define CAPPORT_SCHEME       "https"     // API and user-portal URIs; RFC 8908 requires HTTPS
+
+// -------- UDP fleet discovery (STA mode) --------
+#ifndef DISCOVERY_ENABLE
+#define DISCOVERY_ENABLE 1
+#endif
+#define DISCOVERY_PORT   48555
+#define DISCOVERY_GROUP  "239.255.48.55"
+#define DISCOVERY_PENDING 4        // queriers answered per spread window
+
+// -------- INMP441 I2S microphone (audio.ino) --------
+#ifndef AUDIO_ENABLE
+#define AUDIO_ENABLE        1
+#endif
+#define MIC_I2S_PORT        I2S_NUM_1   // I2S0 is the only one that can carry ADC DMA (sensor.ino)
+#define MIC_PIN_BCK         26
+#define MIC_PIN_WS          25
+#define MIC_PIN_SD          33
+#define AUDIO_RATE          48000
+#define AUDIO_PERIOD_FRAMES 480     // 10 ms; also the DMA buffer length (max 1024)
+#define AUDIO_RING_PERIODS  8       // power of two
+#define AUDIO_DMA_BUFS      4
+#ifndef AUDIO_OUT_RATE
+#define AUDIO_OUT_RATE      16000   // after decimation: 16000 or 8000
+#endif
+#define AUDIO_DECIM         (AUDIO_RATE / AUDIO_OUT_RATE)
+#define AUDIO_OUT_FRAMES    (AUDIO_PERIOD_FRAMES / AUDIO_DECIM)
+#define G711_RATE           8000    // G.711 branch (RTP etc.)
+#define G711_FRAMES         (AUDIO_PERIOD_FRAMES * G711_RATE / AUDIO_RATE)
+#define AUDIO_G711_LAW      G711_ALAW
+#ifndef VAD_ENABLE
+#define VAD_ENABLE          1       // silence suppression on the G.711 branch
+#endif
+#define VAD_HANGOVER_MS     300
+#ifndef MFCC_ENABLE
+#define MFCC_ENABLE         1       // MFCC features on the AUDIO_OUT_RATE branch
+#endif
+#define MFCC_BUDGET_US      2000    // per 10 ms frame; skipped while the ring backs up
+#ifndef CLS_ENABLE
+#define CLS_ENABLE          1       // sound classifier on MFCC windows (needs MFCC_ENABLE)
+#endif
+#define CLS_ARENA_BYTES     4096    // activation arena; the model must fit
+#define CLS_CORE            0       // inference runs beside Wi-Fi, away from capture
+#define CLS_TASK_PRIO       3
+
+// -------- RTP sender (rtp.ino, STA mode) --------
+#define RTP_DEFAULT_PORT    5004
+#define RTP_PTIME_MS        20
+#define RTP_PAYLOAD_MAX     (RTP_PTIME_MS * G711_RATE / 1000)
+#define RTP_POOL            4       // pre-allocated packet buffers
+#define RTP_BUF_LEN         (RTP_HDR_LEN + RTP_PAYLOAD_MAX + SRTP_TAG_LEN)
+#define RTP_CN_INTERVAL_MS  250     // comfort-noise refresh during silence
+
+// -------- Event clips (clip.ino) --------
+#ifndef CLIP_PRE_MS
+#define CLIP_PRE_MS         3000    // audio kept from before the trigger
+#endif
+#ifndef CLIP_POST_MS
+#define CLIP_POST_MS        2000    // recorded after it; RAM = (pre + post) * 8 bytes/ms
+#endif
+#define CLIP_HOLD_MS        (5UL * 60 * 1000)
+#define CLIP_LEVEL_DBFS     -20.0f  // level trigger (rising edge); > 0 disables
+#define CLIP_TRIG_LEVEL     1
+#define CLIP_TRIG_EXTERNAL  2
+#define CLIP_TRIG_SENSOR    3
+
+// -------- KY-038 sound sensor (sensor.ino) --------
+#ifndef SENSOR_ENABLE
+#define SENSOR_ENABLE       1
+#endif
+#define SENSOR_ADC_CHANNEL  6       // ADC1 channel 6 = GPIO34, KY-038 AO (ADC2 is unusable with Wi-Fi)
+#define SENSOR_RATE         20000   // lowest rate the ESP32 ADC DMA runs at
+#define SENSOR_BLOCK        1000    // samples per wake-up: 50 ms
+#define SENSOR_ON_LEVEL     60      // envelope thresholds, ADC counts of mean deviation
+#define SENSOR_OFF_LEVEL    40
+#define SENSOR_ATTACK_MS    10
+#define SENSOR_RELEASE_MS   300
+#define SENSOR_MIN_EVENT_MS 200
+
+// -------- Live /stream (stream.ino) --------
+#define STREAM_MAX_LISTENERS 3
+#define STREAM_FIFO_BYTES   8192    // per listener: 1 s of G.711, 256 ms of 16 kHz PCM
+#define STREAM_CHUNK        1024
+#define STREAM_FMT_G711     0
+#define STREAM_FMT_PCM      1
+
+// -------- JWT bearer auth (jwt_auth.ino) --------
+#define JWT_SECRET_MIN      16      // shortest HS256 secret 'jwt key' accepts
+#define JWT_TOKEN_TTL_S     86400   // default lifetime of 'jwt token'
+#define JWT_NTP_SERVER      "pool.ntp.org"   // exp/nbf need wall-clock time
+
+// -------- MQTT publisher (mqtt.ino, STA mode) --------
+#ifndef MQTT_ENABLE
+#define MQTT_ENABLE         1       // runs only once 'mqtt <host>' has been set
+#endif
+#define MQTT_DEFAULT_PORT   1883
+#define MQTT_KEEPALIVE_S    60
+#define MQTT_TIMEOUT_MS     3000    // connect and PUBACK
+#define MQTT_QUEUE_BYTES    8192    // offline queue; oldest batch dropped when full
+#define MQTT_BATCH_BYTES    1024    // one publish carries at most this much JSON
+#define MQTT_EVENT_BATCH_MS 1000    // events wait at most this long for company
+#define MQTT_TELEMETRY_MS   10000   // telemetry sample period
+#define MQTT_TELEMETRY_BATCH_MS 60000
+#define MQTT_BACKOFF_MIN_MS 1000
+#define MQTT_BACKOFF_MAX_MS 60000
+
 // -------- Pins --------
 #define HEARTBEAT_GPIO 2     // set -1 to disable; many DevKitC use GPIO2 LED
 #define BOOT_BTN_GPIO  0     // BOOT button (IO0), active-low
@@ -33,8 +204,23 @@
 #define LOGE(fmt, ...) Serial.printf("[E %8lu] " fmt "\n", TS(), ##__VA_ARGS__)
 
 // ------------ Globals ------------
+// WebServer keeps its copy of the request's socket after the handler; if
+// that copy still looks connected, the core may wait up to
+// HTTP_MAX_CLOSE_WAIT for the peer to close and take no other request
+// meanwhile. Handlers that answer later (parked long-polls, /stream) take
+// the socket with detachClient() and leave WebServer an empty client.
+class PortalServer : public WebServer {
+public:
+  PortalServer(int port) : WebServer(port) {}
+  WiFiClient detachClient() {
+    WiFiClient c = _currentClient;
+    _currentClient = WiFiClient();
+    return c;
+  }
+};
+
 Preferences prefs;
-WebServer server(80);
+PortalServer server(80);
 DNSServer dnsServer;
 
 String apSSID;
@@ -46,6 +232,28 @@ bool serverStarted = false;
 // HB/diag
 uint32_t tHeartbeat = 0;
 
+// Wi-Fi interface state as level bits, kept by onWiFiEvent(). Each UP/DOWN
+// pair is exclusive, so a wait returns at once when the interface is already
+// where we want it (WiFi.mode() posts nothing when the mode is unchanged).
+#define WIFI_AP_UP     (1 << 0)
+#define WIFI_AP_DOWN   (1 << 1)
+#define WIFI_STA_UP    (1 << 2)
+#define WIFI_STA_DOWN  (1 << 3)
+#define WIFI_STA_IP    (1 << 4)
+EventGroupHandle_t wifiEvents = nullptr;
+
+// Boot timeline and mode-switch timing ('timing', /diag)
+struct PhaseMark { const char* name; uint32_t ms; };
+struct PhaseTiming {
+  PhaseMark marks[PHASE_MAX];
+  uint8_t   count;
+  uint32_t  portalMs, staMs;       // boot -> first portal / first STA services, 0 = not yet
+  uint32_t  apSwitchMs, staSwitchMs; // last startCaptiveAP() / enterSTAOnly()
+  uint32_t  apSwitches, staSwitches;
+  uint32_t  waits, waitMs, waitTimeouts;
+};
+PhaseTiming phaseTiming = {};
+
 // Serial console
 char cmdBuf[96];
 size_t cmdLen = 0;
@@ -55,7 +263,47 @@ bool    btnPrev = true;       // true=not pressed (pull-up)
 uint32_t btnPressT0 = 0;
 bool    btnArmed = false;
 
+// Provisioning job (POST /api/provision). One job at a time; the token lets
+// the app find its result again after the AP channel moves on STA connect.
+enum ProvState : uint8_t { PROV_IDLE, PROV_CONNECTING, PROV_CONNECTED, PROV_FAILED };
+struct ProvJob {
+  ProvState state = PROV_IDLE;
+  char      token[9] = "";
+  String    ssid, pass, host;
+  IPAddress ip, gw, mask, dns;
+  uint8_t   reason = 0;        // last STA disconnect reason while connecting
+  uint32_t  t0 = 0, tDone = 0;
+  bool      resultRead = false;
+};
+ProvJob provJob;
+
+// GET /api/provision?wait= long-polls are parked here and answered from
+// provJobPoll(), so loop() keeps running while the app waits. The socket
+// is detached from WebServer, which goes straight on to the next request.
+struct ProvWaiter {
+  WiFiClient client;
+  uint32_t   deadline = 0;
+  bool       used = false;
+};
+ProvWaiter provWaiters[PROV_WAITERS];
+
+// Hitless re-provisioning ('reprov', BOOT short press): the portal runs in
+// AP+STA beside the current link, and the link only moves once the new
+// network has been seen in a scan. A failed switch reconnects the old one.
+struct Reprov {
+  bool     live = false;           // portal up next to a working STA link
+  bool     verifying = false;      // job waiting for its scan
+  uint32_t t0 = 0;                 // portal opened
+  uint32_t switchT0 = 0;           // old link dropped for the new network, 0 = not yet
+  uint32_t restoreT0 = 0;          // rolling back to the saved network, 0 = not
+  uint32_t lastGapMs = 0;          // STA offline time of the last switch
+  uint32_t switches = 0, rejected = 0, rollbacks = 0;
+};
+Reprov reprov;
+
 // --------- HTML ----------
+// Fallback for units without a valid 'assets' partition (assets.ino); the
+// portal UI itself lives in assets/.
 const char PROGMEM HTML_INDEX[] = R"HTML(
 <!doctype html><html><head><meta name=viewport content="width=device-width,initial-scale=1">
 <title>ESP32 Provisioning</title>
@@ -75,7 +323,7 @@ small{color:#666}
 </form>
 <p><small>If SSID is hidden, type it exactly (case-sensitive).</small></p>
 </div>
-<p><a href="/scan">Scan networks</a> • <a href="/diag">Diagnostics</a></p>
+<p><a href="/scan">Scan networks</a> • <a href="/diag">Diagnostics</a> • <a href="/update">Firmware</a></p>
 </body></html>
 )HTML";
 
@@ -106,43 +354,378 @@ String htmlScan(const int n) {
   return h;
 }
 
+// Static IP is optional; 0.0.0.0 means DHCP (turned back on if an earlier
+// network on this boot had a static address).
+void applyStaticIP(const IPAddress& ip, const IPAddress& gw, const IPAddress& mask, const IPAddress& dns) {
+  static bool isStatic = false;
+  if (ip == IPAddress(0,0,0,0)) {
+    if (isStatic && WiFi.config(ip, ip, ip)) isStatic = false;
+    return;
+  }
+  LOGI("Static IP %s gw=%s mask=%s dns=%s", ip.toString().c_str(), gw.toString().c_str(),
+       mask.toString().c_str(), dns.toString().c_str());
+  if (!WiFi.config(ip, gw, mask, dns)) LOGW("WiFi.config failed; falling back to DHCP");
+  else isStatic = true;
+}
+
+// ------------- JSON helpers -------------
+// Minimal extraction of a top-level string member; enough for the flat
+// objects the provisioning app sends. Returns false if the key is absent.
+bool jsonGetString(const String& body, const char* key, String& out) {
+  String pat = String('"') + key + '"';
+  int i = 0;
+  for (;;) {                      // a match not followed by ':' is a value; keep looking
+    int k = body.indexOf(pat, i);
+    if (k < 0) return false;
+    i = k + pat.length();
+    while (i < (int)body.length() && (body[i]==' ' || body[i]=='\t' || body[i]=='\n' || body[i]=='\r')) i++;
+    if (i < (int)body.length() && body[i] == ':') break;
+    i = k + 1;
+  }
+  i++;
+  while (i < (int)body.length() && (body[i]==' ' || body[i]=='\t' || body[i]=='\n' || body[i]=='\r')) i++;
+  if (i >= (int)body.length()) return false;
+  out = "";
+  if (body[i] != '"') {           // bare number/bool: take up to the delimiter
+    int j = i;
+    while (j < (int)body.length() && body[j]!=',' && body[j]!='}' && body[j]!=' ') j++;
+    out = body.substring(i, j);
+    return true;
+  }
+  for (i++; i < (int)body.length(); i++) {
+    char c = body[i];
+    if (c == '"') return true;
+    if (c == '\\' && i+1 < (int)body.length()) {
+      c = body[++i];
+      switch (c) {
+        case 'n': out += '\n'; break;
+        case 't': out += '\t'; break;
+        case 'r': out += '\r'; break;
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'u': {
+          if (i+4 >= (int)body.length()) return false;
+          uint32_t cp = strtoul(body.substring(i+1, i+5).c_str(), nullptr, 16);
+          i += 4;
+          if (cp < 0x80) out += (char)cp;             // UTF-8 encode BMP code point
+          else if (cp < 0x800) { out += (char)(0xC0 | (cp>>6)); out += (char)(0x80 | (cp&0x3F)); }
+          else { out += (char)(0xE0 | (cp>>12)); out += (char)(0x80 | ((cp>>6)&0x3F)); out += (char)(0x80 | (cp&0x3F)); }
+          break;
+        }
+        default: out += c; break;  // \" \\ \/
+      }
+    } else {
+      out += c;
+    }
+  }
+  return false;  // unterminated string
+}
+
+String jsonEscape(const String& in) {
+  String o;
+  o.reserve(in.length() + 2);
+  for (size_t i = 0; i < in.length(); i++) {
+    char c = in[i];
+    if (c == '"' || c == '\\') { o += '\\'; o += c; }
+    else if ((uint8_t)c < 0x20) { char b[7]; snprintf(b, sizeof(b), "\\u%04x", c); o += b; }
+    else o += c;
+  }
+  return o;
+}
+
+// ------------- Provisioning job -------------
+const char* provStateName(ProvState st) {
+  switch (st) {
+    case PROV_CONNECTING: return "connecting";
+    case PROV_CONNECTED:  return "connected";
+    case PROV_FAILED:     return "failed";
+    default:              return "idle";
+  }
+}
+
+String provJobJSON() {
+  String j = "{\"token\":\"" + String(provJob.token) + "\",\"state\":\"" + provStateName(provJob.state) + "\"";
+  j += ",\"ssid\":\"" + jsonEscape(provJob.ssid) + "\"";
+  uint32_t el = (provJob.state == PROV_CONNECTING ? millis() : provJob.tDone) - provJob.t0;
+  j += ",\"elapsed_ms\":" + String(el);
+  if (provJob.state == PROV_CONNECTED) {
+    j += ",\"ip\":\"" + WiFi.localIP().toString() + "\"";
+    j += ",\"rssi\":" + String(WiFi.RSSI());
+  }
+  if (provJob.state == PROV_FAILED) j += ",\"reason\":" + String(provJob.reason);
+  j += "}";
+  return j;
+}
+
+void provWaitAnswer(WiFiClient& c) {
+  String j = provJobJSON();
+  if (provJob.state != PROV_CONNECTING) provJob.resultRead = true;
+  c.printf("HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %u\r\n"
+           "Cache-Control: no-store\r\nConnection: close\r\n\r\n", (unsigned)j.length());
+  c.print(j);
+  c.stop();
+}
+
+// Parks the current request for up to wait ms. False if every slot is
+// taken; the caller then answers with the state as it is.
+bool provWaitPark(uint32_t wait) {
+  for (auto& w : provWaiters) {
+    if (w.used) continue;
+    w.client = server.detachClient();
+    w.deadline = millis() + wait;
+    w.used = true;
+    return true;
+  }
+  return false;
+}
+
+void provWaitPoll() {
+  uint32_t now = millis();
+  for (auto& w : provWaiters) {
+    if (!w.used) continue;
+    bool gone = !w.client.connected();
+    if (!gone && provJob.state == PROV_CONNECTING && (int32_t)(now - w.deadline) < 0) continue;
+    if (!gone) provWaitAnswer(w.client);
+    w.client = WiFiClient();
+    w.used = false;
+  }
+}
+
+// Connect in AP+STA so the portal (and the app's connection to it) survives
+// the attempt. Credentials are only persisted once the connect succeeds.
+void provJobStart() {
+  uint32_t r = esp_random();
+  snprintf(provJob.token, sizeof(provJob.token), "%08x", (unsigned)r);
+  provJob.state = PROV_CONNECTING;
+  provJob.reason = 0;
+  provJob.resultRead = false;
+  provJob.t0 = millis();
+  wantReconnect = false;
+
+  LOGI("API provision job %s: SSID='%s' (len pass=%u)%s", provJob.token, provJob.ssid.c_str(),
+       (unsigned)provJob.pass.length(), provJob.ip == IPAddress(0,0,0,0) ? "" : " static");
+  if (reprov.live && WiFi.status() == WL_CONNECTED) {
+    // The current link stays up while we look for the new network.
+    reprov.verifying = true;
+    WiFi.scanNetworks(true, false);
+    return;
+  }
+  provJobConnect();
+}
+
+void provJobConnect() {
+  provJob.t0 = millis();                           // the timeout covers the connect, not the scan
+  if (reprov.live) reprov.switchT0 = provJob.t0;
+  WiFi.disconnect(false, false);
+  if (provJob.host.length()) WiFi.setHostname(provJob.host.c_str());
+  radioMode(inAP ? WIFI_AP_STA : WIFI_STA, "provision");
+  applyStaticIP(provJob.ip, provJob.gw, provJob.mask, provJob.dns);
+  xEventGroupClearBits(wifiEvents, WIFI_STA_IP);   // WiFi.status() lags the old link's drop
+  WiFi.begin(provJob.ssid.c_str(), provJob.pass.c_str());
+}
+
+void provJobFinish(ProvState st) {
+  provJob.state = st;
+  provJob.tDone = millis();
+  if (st == PROV_CONNECTED) {
+    LOGI("API provision job %s connected in %lums: IP=%s", provJob.token,
+         provJob.tDone - provJob.t0, WiFi.localIP().toString().c_str());
+    prefs.begin("net", false);
+    prefs.putString("ssid", provJob.ssid);
+    prefs.putString("pass", provJob.pass);
+    prefs.putString("host", provJob.host);
+    prefs.putString("ip",   provJob.ip == IPAddress(0,0,0,0) ? "" : provJob.ip.toString());
+    prefs.putString("gw",   provJob.ip == IPAddress(0,0,0,0) ? "" : provJob.gw.toString());
+    prefs.putString("mask", provJob.ip == IPAddress(0,0,0,0) ? "" : provJob.mask.toString());
+    prefs.putString("dns",  provJob.ip == IPAddress(0,0,0,0) ? "" : provJob.dns.toString());
+    prefs.end();
+    if (reprov.switchT0) {
+      reprov.lastGapMs = provJob.tDone - reprov.switchT0;
+      reprov.switches++;
+      reprov.switchT0 = 0;
+      LOGI("Reprov: moved to '%s', STA offline for %lums", provJob.ssid.c_str(), reprov.lastGapMs);
+    }
+  } else {
+    LOGW("API provision job %s failed after %lums (reason=%u)", provJob.token,
+         provJob.tDone - provJob.t0, provJob.reason);
+    if (reprov.live) { reprovRestore(); return; }
+    WiFi.disconnect(false, false);
+    if (inAP) radioMode(WIFI_AP, "provision failed");
+  }
+}
+
+// Called from loop(): advances the job, answers parked long-polls, and
+// drops the AP once the app has seen the result (or the linger window
+// expires).
+void provJobPoll() {
+  uint32_t now = millis();
+  if (reprov.restoreT0) reprovRestorePoll(now);
+  if (provJob.state == PROV_CONNECTING && reprov.verifying) {
+    reprovVerifyPoll();
+  } else if (provJob.state == PROV_CONNECTING) {
+    wl_status_t st = WiFi.status();
+    if (st == WL_CONNECTED && (xEventGroupGetBits(wifiEvents) & WIFI_STA_IP)) provJobFinish(PROV_CONNECTED);
+    else if (st == WL_CONNECT_FAILED || st == WL_NO_SSID_AVAIL ||
+             now - provJob.t0 >= CONNECT_TIMEOUT_MS) provJobFinish(PROV_FAILED);
+  } else if (provJob.state == PROV_CONNECTED && inAP) {
+    // Give the HTTP response a moment to flush before the AP goes away.
+    if ((provJob.resultRead && now - provJob.tDone >= 2000) || now - provJob.tDone >= PROV_AP_LINGER_MS) {
+      LOGI("API provision job %s: result %s; leaving AP", provJob.token, provJob.resultRead ? "delivered" : "not read");
+      enterSTAOnly();
+      relayStartDonor();
+    }
+  } else if (reprov.live && provJob.state != PROV_CONNECTED && now - reprov.t0 >= REPROV_PORTAL_MS &&
+             WiFi.softAPgetStationNum() == 0 && WiFi.status() == WL_CONNECTED) {
+    LOGI("Reprov: no new network in %lu s; closing the portal", REPROV_PORTAL_MS / 1000);
+    enterSTAOnly();
+  }
+  provWaitPoll();
+}
+
+// ------------- Hitless re-provisioning -------------
+void reprovBegin(const char* why) {
+  if (inAP) { LOGI("Reprov (%s): portal is already up", why); return; }
+  if (WiFi.status() != WL_CONNECTED) {
+    LOGI("Reprov (%s): no STA link to keep; plain provisioning AP", why);
+    WiFi.disconnect(false, true);
+    startCaptiveAP();
+    return;
+  }
+  reprov.live = true;
+  reprov.verifying = false;
+  reprov.switchT0 = 0;
+  reprov.t0 = millis();
+  LOGI("Reprov (%s): portal beside the link to '%s' (channel %d)", why, WiFi.SSID().c_str(), WiFi.channel());
+  startCaptiveAP();
+}
+
+// Scan result for a job started while the old link is up. Only a network
+// that is actually in range gets the link; anything else fails the job
+// with the old link untouched.
+void reprovVerifyPoll() {
+  int n = WiFi.scanComplete();
+  if (n == WIFI_SCAN_RUNNING) return;
+  int found = -1;
+  for (int i = 0; i < n; i++) {
+    if (WiFi.SSID(i) == provJob.ssid) { found = i; break; }
+  }
+  bool secured = found >= 0 && WiFi.encryptionType(found) != WIFI_AUTH_OPEN;
+  WiFi.scanDelete();
+  reprov.verifying = false;
+  if (found < 0 || (secured && provJob.pass.length() < 8)) {
+    reprov.rejected++;
+    provJob.reason = found < 0 ? WIFI_REASON_NO_AP_FOUND : WIFI_REASON_AUTH_FAIL;
+    LOGW("Reprov: '%s' %s; staying on '%s'", provJob.ssid.c_str(),
+         found < 0 ? (n < 0 ? "scan failed" : "not in range") : "needs a password of 8+ characters",
+         WiFi.SSID().c_str());
+    provJobFinish(PROV_FAILED);
+    return;
+  }
+  LOGI("Reprov: '%s' seen (RSSI %d); switching", provJob.ssid.c_str(), WiFi.RSSI(found));
+  provJobConnect();
+}
+
+// The new network did not take: go back to the saved one, portal still up.
+void reprovRestore() {
+  if (!reprov.switchT0) return;             // rejected before the switch; old link never left
+  reprov.switchT0 = 0;
+  reprov.rollbacks++;
+  prefs.begin("net", true);
+  String ssid = prefs.getString("ssid", "");
+  String pass = prefs.getString("pass", "");
+  IPAddress ip, gw, mask, dns;
+  ip.fromString(prefs.getString("ip", ""));
+  gw.fromString(prefs.getString("gw", ""));
+  mask.fromString(prefs.getString("mask", ""));
+  dns.fromString(prefs.getString("dns", ""));
+  prefs.end();
+  LOGW("Reprov: switch failed; back to '%s'", ssid.c_str());
+  reprov.restoreT0 = millis();              // holds off wantReconnect's blocking retry meanwhile
+  wantReconnect = false;
+  WiFi.disconnect(false, false);
+  applyStaticIP(ip, gw, mask, dns);
+  xEventGroupClearBits(wifiEvents, WIFI_STA_IP);
+  WiFi.begin(ssid.c_str(), pass.c_str());
+}
+
+// The rollback's own connect; if the saved network does not come back in
+// time, the normal reconnect loop takes over.
+void reprovRestorePoll(uint32_t now) {
+  if (xEventGroupGetBits(wifiEvents) & WIFI_STA_IP) {
+    LOGI("Reprov: back on '%s' after %lums", WiFi.SSID().c_str(), now - reprov.restoreT0);
+    reprov.restoreT0 = 0;
+  } else if (now - reprov.restoreT0 >= CONNECT_TIMEOUT_MS) {
+    LOGW("Reprov: saved network not back in %u s; retrying", CONNECT_TIMEOUT_MS / 1000);
+    reprov.restoreT0 = 0;
+    wantReconnect = true;
+  }
+}
+
+String reprovStatsLine() {
+  char b[140];
+  snprintf(b, sizeof(b), "Reprov: %s switches=%lu last gap=%lums rejected=%lu rollbacks=%lu",
+           reprov.live ? "portal up beside STA" : "idle", (unsigned long)reprov.switches,
+           (unsigned long)reprov.lastGapMs, (unsigned long)reprov.rejected, (unsigned long)reprov.rollbacks);
+  return String(b);
+}
+
 bool tryConnectFromPrefs(uint32_t timeoutMs) {
   prefs.begin("net", true);
   String ssid = prefs.getString("ssid", "");
   String pass = prefs.getString("pass", "");
+  String host = prefs.getString("host", "");
+  IPAddress ip, gw, mask, dns;
+  ip.fromString(prefs.getString("ip", ""));
+  gw.fromString(prefs.getString("gw", ""));
+  mask.fromString(prefs.getString("mask", ""));
+  dns.fromString(prefs.getString("dns", ""));
   prefs.end();
 
   if (ssid.isEmpty()) { LOGI("No stored credentials."); return false; }
 
   LOGI("Attempting STA connect to SSID='%s' (timeout %u ms)", ssid.c_str(), timeoutMs);
-  WiFi.mode(WIFI_STA);
+  if (host.length()) WiFi.setHostname(host.c_str());  // must precede STA start
+  radioMode(inAP ? WIFI_AP_STA : WIFI_STA, "connect");  // the portal stays up while we try
+  applyStaticIP(ip, gw, mask, dns);
+  xEventGroupClearBits(wifiEvents, WIFI_STA_IP);
   WiFi.begin(ssid.c_str(), pass.c_str());
 
+  // Woken by GOT_IP; the 250 ms slices only pace the progress dots.
   uint32_t t0 = millis();
   while (WiFi.status() != WL_CONNECTED && (millis() - t0) < timeoutMs) {
-    delay(250);
+    if (xEventGroupWaitBits(wifiEvents, WIFI_STA_IP, pdFALSE, pdTRUE, pdMS_TO_TICKS(250)) & WIFI_STA_IP) continue;
     Serial.print('.');
   }
   Serial.println();
 
   if (WiFi.status() == WL_CONNECTED) {
-    LOGI("STA connected: IP=%s RSSI=%d dBm", WiFi.localIP().toString().c_str(), WiFi.RSSI());
+    LOGI("STA connected in %lu ms: IP=%s RSSI=%d dBm", (unsigned long)(millis() - t0),
+         WiFi.localIP().toString().c_str(), WiFi.RSSI());
+    phaseMark("sta-connected");
     printNetDiag();
     return true;
   }
   LOGW("STA connect failed.");
+  phaseMark("sta-failed");
   return false;
 }
 
 void bindRoutes() {
+  // WebServer only keeps headers it was told to collect.
+  static const char* hdrKeys[] = { "Content-Length", "Content-Range", "X-Image-SHA256", "Authorization",
+                                   "If-None-Match" };
+  server.collectHeaders(hdrKeys, sizeof(hdrKeys) / sizeof(hdrKeys[0]));
+  stationsBindTap();  // must be the first handler: it sees every request
+
   server.on("/", HTTP_GET, [](){
     LOGD("HTTP /  (client=%s)", server.client().remoteIP().toString().c_str());
+    if (assetServe("/")) return;
     server.send_P(200, "text/html", HTML_INDEX);
   });
 
   server.on("/scan", HTTP_GET, [](){
     LOGD("HTTP /scan");
-    if (inAP) WiFi.mode(WIFI_AP_STA); // allow scan while AP up
+    radioEnable(WIFI_STA, true, "scan");  // no-op after the first scan
     int n = WiFi.scanNetworks(false,true);
     server.send(200, "text/html", htmlScan(n));
     WiFi.scanDelete();
@@ -157,12 +740,25 @@ void bindRoutes() {
     s += "Chip: " + String(ESP.getChipModel()) + " rev " + String(ESP.getChipRevision()) + "\n";
     s += "Mode: " + String((m==WIFI_MODE_AP)?"AP":(m==WIFI_MODE_STA)?"STA":"AP+STA") + "\n";
     s += "Status: " + String(WiFi.status()) + "\n";
+    s += "FW: " + String(FW_VERSION_MAJOR) + "." + String(FW_VERSION_MINOR) + "." + String(FW_VERSION_PATCH) + "\n";
     s += "AP SSID: " + apSSID + "  IP: " + apIP.toString() + "\n";
     if (WiFi.status()==WL_CONNECTED) {
       s += "STA SSID: " + WiFi.SSID() + "\n";
       s += "STA IP: " + WiFi.localIP().toString() + "\n";
       s += "RSSI: " + String(WiFi.RSSI()) + " dBm\n";
     }
+    s += tlsStatsLine() + "\n";
+    s += audioStatsLine() + "\n";
+    s += clsStatsLine() + "\n";
+    s += sensorStatsLine() + "\n";
+    s += rtpStatsLine() + "\n";
+    s += streamStatsLine() + "\n";
+    s += jwtStatsLine() + "\n";
+    s += mqttStatsLine() + "\n";
+    s += phaseStatsLine() + "\n";
+    s += radioStatsLine() + "\n";
+    s += reprovStatsLine() + "\n";
+    s += assetStatsLine() + "\n";
     s += "</pre><p><a href='/'>Back</a></p>";
     LOGD("HTTP /diag");
     server.send(200, "text/html", s);
@@ -174,6 +770,18 @@ void bindRoutes() {
     String ssid = server.arg("s");
     String pass = server.hasArg("p") ? server.arg("p") : "";
 
+    if (reprov.live && provJob.state != PROV_CONNECTING) {
+      // Verified switch; credentials are saved only once it connects.
+      provJob.ssid = ssid;
+      provJob.pass = pass;
+      provJob.host = "";
+      provJob.ip = provJob.gw = provJob.mask = provJob.dns = IPAddress(0,0,0,0);
+      provJobStart();
+      server.send(200, "text/html",
+        "<html><body><h3>Checking " + ssid + " ...</h3><p>The current network stays up until it connects.</p>"
+        "<meta http-equiv='refresh' content='5; url=/status'></body></html>");
+      return;
+    }
     LOGI("Saving credentials: SSID='%s' (len pass=%u)", ssid.c_str(), (unsigned)pass.length());
     prefs.begin("net", false);
     prefs.putString("ssid", ssid);
@@ -202,6 +810,78 @@ void bindRoutes() {
     server.send(200, "text/html", body);
   });
 
+  // One-round-trip provisioning for the mobile app: POST JSON, get a token,
+  // then GET with ?wait= to long-poll for the connect result.
+  server.on("/api/provision", HTTP_POST, [](){
+    if (!jwtAuthorize()) return;
+    String body = server.arg("plain");
+    LOGD("HTTP POST /api/provision  len=%u", (unsigned)body.length());
+    if (provJob.state == PROV_CONNECTING) {
+      server.send(409, "application/json", provJobJSON());
+      return;
+    }
+    String ssid, pass, ip, gw, mask, dns, host;
+    if (!jsonGetString(body, "ssid", ssid) || ssid.isEmpty() || ssid.length() > 32) {
+      server.send(400, "application/json", "{\"error\":\"ssid required (1-32 chars)\"}");
+      return;
+    }
+    jsonGetString(body, "password", pass);
+    if (pass.length() && (pass.length() < 8 || pass.length() > 63)) {
+      server.send(400, "application/json", "{\"error\":\"password must be 8-63 chars\"}");
+      return;
+    }
+    jsonGetString(body, "hostname", host);
+    if (host.length() > 32) {
+      server.send(400, "application/json", "{\"error\":\"hostname too long\"}");
+      return;
+    }
+    provJob.ip = provJob.gw = provJob.mask = provJob.dns = IPAddress(0,0,0,0);
+    if (jsonGetString(body, "ip", ip) && ip.length()) {
+      jsonGetString(body, "gateway", gw);
+      jsonGetString(body, "netmask", mask);
+      jsonGetString(body, "dns", dns);
+      if (!provJob.ip.fromString(ip) || !provJob.gw.fromString(gw)) {
+        server.send(400, "application/json", "{\"error\":\"static ip requires valid ip and gateway\"}");
+        return;
+      }
+      if (!provJob.mask.fromString(mask.length() ? mask : String("255.255.255.0")) ||
+          !provJob.dns.fromString(dns.length() ? dns : gw)) {
+        server.send(400, "application/json", "{\"error\":\"invalid netmask or dns\"}");
+        return;
+      }
+    }
+    provJob.ssid = ssid;
+    provJob.pass = pass;
+    provJob.host = host;
+    provJobStart();
+    server.send(202, "application/json", provJobJSON());
+  });
+
+  server.on("/api/provision", HTTP_GET, [](){
+    if (!jwtAuthorize()) return;
+    String tok = server.arg("token");
+    if (provJob.state == PROV_IDLE || tok != provJob.token) {
+      server.send(404, "application/json", "{\"error\":\"unknown token\"}");
+      return;
+    }
+    uint32_t wait = min((uint32_t)server.arg("wait").toInt(), (uint32_t)PROV_WAIT_MAX_MS);
+    LOGD("HTTP GET /api/provision  state=%s wait=%lu", provStateName(provJob.state), (unsigned long)wait);
+    if (provJob.state == PROV_CONNECTING && wait && provWaitPark(wait)) return;
+    if (provJob.state != PROV_CONNECTING) provJob.resultRead = true;
+    server.send(200, "application/json", provJobJSON());
+  });
+
+  server.on("/api/stations", HTTP_GET, [](){
+    if (!jwtAuthorize()) return;
+    server.send(200, "application/json", stationsJSON());
+  });
+
+  capportBindRoutes();
+  clipBindRoutes();
+  server.on("/stream", HTTP_GET, streamHandle);
+  otaBindRoutes();
+  assetBindRoutes();
+
   server.onNotFound([&](){
     String host = server.hostHeader();
     String uri  = server.uri();
@@ -211,22 +891,31 @@ void bindRoutes() {
       LOGD("Captive redirect host='%s' -> %s", host.c_str(), apIP.toString().c_str());
       server.sendHeader("Location", String("http://") + apIP.toString() + "/");
       server.send(302, "text/plain", "");
-    } else {
+    } else if (!(server.method() == HTTP_GET && assetServe(uri))) {
       server.send(404, "text/plain", "Not found");
     }
   });
 }
 
 void startCaptiveAP() {
+  uint32_t t0 = millis();
   uint32_t r = esp_random();
   apSSID = "Aniviza-" + String((r >> 16) & 0xFFFF, HEX);
   apSSID.toUpperCase();
 
-  LOGI("Starting AP '%s' on %s", apSSID.c_str(), apIP.toString().c_str());
-  WiFi.mode(WIFI_AP);
+  bool keepSta = reprov.live;       // hitless reprov: STA and its services stay up
+  LOGI("Starting AP '%s' on %s%s", apSSID.c_str(), apIP.toString().c_str(), keepSta ? " beside STA" : "");
+  if (!keepSta) {
+    discoveryStop();
+    rtpStop();
+    mqttStop();
+  }
+  // Returns with the AP netif up, as DNS needs. Beside STA the AP has to
+  // share the STA channel.
+  radioMode(keepSta ? WIFI_AP_STA : WIFI_AP, keepSta ? "reprov" : "portal");
   WiFi.softAPConfig(apIP, apIP, netMsk);
-  WiFi.softAP(apSSID.c_str()); // open AP for provisioning
-  delay(150);
+  WiFi.softAP(apSSID.c_str(), nullptr, keepSta ? WiFi.channel() : 1, 0, AP_MAX_STATIONS); // open AP for provisioning
+  capportAdvertise();
   inAP = true;
 
   dnsServer.start(DNS_PORT, "*", apIP);
@@ -234,20 +923,25 @@ void startCaptiveAP() {
 
   if (!serverStarted) { bindRoutes(); server.begin(); serverStarted = true; }
 
+  if (!keepSta) relayStartRequester();   // channel hopping would drop the STA link
+  phaseSwitched(true, t0);
   printNetDiag();
 }
 
 void enterSTAOnly() {
+  uint32_t t0 = millis();
   LOGI("Switching to STA-only mode");
   dnsServer.stop();
-  WiFi.softAPdisconnect(true);   // stop AP
-  delay(50);
-  WiFi.mode(WIFI_STA);
-  delay(150);
+  radioMode(WIFI_STA, "sta-only");   // stops the AP
   inAP = false;
+  reprov.live = false;
 
   if (!serverStarted) { bindRoutes(); server.begin(); serverStarted = true; }
 
+  discoveryBegin();
+  rtpBegin();
+  mqttBegin();
+  phaseSwitched(false, t0);
   printNetDiag();
 }
 
@@ -273,19 +967,95 @@ void flushNVS() {
 }
 
 // ----------- Wi-Fi events -----------
+void wifiSetState(EventBits_t set, EventBits_t clear) {
+  xEventGroupClearBits(wifiEvents, clear);
+  xEventGroupSetBits(wifiEvents, set);
+}
+
+// Replaces the fixed delay() settles: returns as soon as the event has been
+// seen (or the state already holds), false after WIFI_SETTLE_TIMEOUT_MS.
+bool wifiWait(EventBits_t bits, const char* what) {
+  uint32_t t0 = millis();
+  EventBits_t got = xEventGroupWaitBits(wifiEvents, bits, pdFALSE, pdTRUE, pdMS_TO_TICKS(WIFI_SETTLE_TIMEOUT_MS));
+  uint32_t ms = millis() - t0;
+  phaseTiming.waits++;
+  phaseTiming.waitMs += ms;
+  if ((got & bits) == bits) {
+    LOGD("%s after %lu ms", what, (unsigned long)ms);
+    return true;
+  }
+  phaseTiming.waitTimeouts++;
+  LOGW("%s not seen within %u ms", what, WIFI_SETTLE_TIMEOUT_MS);
+  return false;
+}
+
+void phaseMark(const char* name) {
+  uint32_t now = millis();
+  if (phaseTiming.count < PHASE_MAX) phaseTiming.marks[phaseTiming.count++] = { name, now };
+  LOGD("Phase %s at %lu ms", name, (unsigned long)now);
+}
+
+// Portal up (ap) or STA services up (sta); t0 is when the switch began.
+void phaseSwitched(bool ap, uint32_t t0) {
+  uint32_t now = millis();
+  if (ap) {
+    phaseTiming.apSwitchMs = now - t0;
+    phaseTiming.apSwitches++;
+    if (!phaseTiming.portalMs) phaseTiming.portalMs = now;
+  } else {
+    phaseTiming.staSwitchMs = now - t0;
+    phaseTiming.staSwitches++;
+    if (!phaseTiming.staMs) phaseTiming.staMs = now;
+  }
+  phaseMark(ap ? "portal-ready" : "sta-ready");
+  LOGI("%s in %lu ms", ap ? "Portal up" : "STA services up", (unsigned long)(now - t0));
+}
+
+String phaseStatsLine() {
+  const PhaseTiming& t = phaseTiming;
+  char b[200];
+  snprintf(b, sizeof(b), "Timing: portal@%lums sta@%lums last ap=%lums (x%lu) sta=%lums (x%lu) waits=%lu avg=%lums timeouts=%lu",
+           (unsigned long)t.portalMs, (unsigned long)t.staMs, (unsigned long)t.apSwitchMs,
+           (unsigned long)t.apSwitches, (unsigned long)t.staSwitchMs, (unsigned long)t.staSwitches,
+           (unsigned long)t.waits, (unsigned long)(t.waits ? t.waitMs / t.waits : 0), (unsigned long)t.waitTimeouts);
+  return String(b);
+}
+
+void phasePrint() {
+  LOGI("%s", phaseStatsLine().c_str());
+  for (uint8_t i = 0; i < phaseTiming.count; i++) {
+    Serial.printf("  %8lu ms  %s\n", (unsigned long)phaseTiming.marks[i].ms, phaseTiming.marks[i].name);
+  }
+}
+
 void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info) {
   switch(event) {
     case ARDUINO_EVENT_WIFI_READY:                 LOGI("WiFi READY"); break;
-    case ARDUINO_EVENT_WIFI_STA_START:             LOGI("STA START"); break;
+    case ARDUINO_EVENT_WIFI_STA_START:             wifiSetState(WIFI_STA_UP, WIFI_STA_DOWN); LOGI("STA START"); break;
+    case ARDUINO_EVENT_WIFI_STA_STOP:              wifiSetState(WIFI_STA_DOWN, WIFI_STA_UP | WIFI_STA_IP); LOGI("STA STOP"); break;
     case ARDUINO_EVENT_WIFI_STA_CONNECTED:         LOGI("STA CONNECTED to '%s'", WiFi.SSID().c_str()); break;
-    case ARDUINO_EVENT_WIFI_STA_GOT_IP:            LOGI("STA GOT IP: %s", WiFi.localIP().toString().c_str()); printNetDiag(); break;
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+      wifiSetState(WIFI_STA_IP, 0);
+      LOGI("STA GOT IP: %s", WiFi.localIP().toString().c_str());
+      printNetDiag();
+      break;
+    case ARDUINO_EVENT_WIFI_STA_LOST_IP:           wifiSetState(0, WIFI_STA_IP); LOGW("STA LOST IP"); break;
     case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+      wifiSetState(0, WIFI_STA_IP);
       LOGW("STA DISCONNECTED, reason=%d", info.wifi_sta_disconnected.reason);
-      wantReconnect = true;
+      if (provJob.state == PROV_CONNECTING) provJob.reason = info.wifi_sta_disconnected.reason;
+      else if (!reprov.restoreT0) wantReconnect = true;   // a rollback reconnects on its own
+      break;
+    case ARDUINO_EVENT_WIFI_AP_START:              wifiSetState(WIFI_AP_UP, WIFI_AP_DOWN); LOGI("AP START '%s'", apSSID.c_str()); break;
+    case ARDUINO_EVENT_WIFI_AP_STOP:               wifiSetState(WIFI_AP_DOWN, WIFI_AP_UP); LOGI("AP STOP"); break;
+    case ARDUINO_EVENT_WIFI_AP_STACONNECTED:
+      LOGI("AP client JOIN: " MACSTR, MAC2STR(info.wifi_ap_staconnected.mac));
+      stationOnJoin(info.wifi_ap_staconnected.mac, info.wifi_ap_staconnected.aid);
+      break;
+    case ARDUINO_EVENT_WIFI_AP_STADISCONNECTED:
+      LOGI("AP client LEAVE: " MACSTR, MAC2STR(info.wifi_ap_stadisconnected.mac));
+      stationOnLeave(info.wifi_ap_stadisconnected.mac);
       break;
-    case ARDUINO_EVENT_WIFI_AP_START:              LOGI("AP START '%s'", apSSID.c_str()); break;
-    case ARDUINO_EVENT_WIFI_AP_STACONNECTED:       LOGI("AP client JOIN: " MACSTR, MAC2STR(info.wifi_ap_staconnected.mac)); break;
-    case ARDUINO_EVENT_WIFI_AP_STADISCONNECTED:    LOGI("AP client LEAVE: " MACSTR, MAC2STR(info.wifi_ap_stadisconnected.mac)); break;
     default:                                       LOGD("WiFi event %d", event); break;
   }
 }
@@ -299,7 +1069,23 @@ void processCommand(const String& cmd) {
       "  status     - print Wi-Fi/network status\n"
       "  clear-net  - clear only saved SSID/password (Preferences 'net')\n"
       "  flush-nvs  - erase entire NVS partition (all namespaces)\n"
-      "  reprov     - clear-net and start provisioning AP now\n"
+      "  reprov [off] - provisioning portal beside the current link; off closes it\n"
+      "  relay      - ESP-NOW credential relay status ('relay start' to donate, 'relay stop')\n"
+      "  relay-key <hex32> - set fleet key for credential relay\n"
+      "  tls        - HTTPS handshake statistics (full vs resumed)\n"
+      "  stations   - provisioning AP clients and request counts\n"
+      "  audio      - microphone capture statistics\n"
+      "  cls        - sound classifier latency, dropped frames, duty cycle\n"
+      "  sensor     - KY-038 level, events and CPU use\n"
+      "  rtp [<ip> [port]|off] - G.711 RTP stream status / target (STA mode)\n"
+      "  rtp srtp on|off|bench - SRTP key (prints a=crypto line) / protect timing\n"
+      "  clip [trigger|release] - event clip status / fire a trigger / re-arm\n"
+      "  stream     - /stream listeners, queue depth and drops\n"
+      "  jwt [key <secret>|off|token [sub] [ttl_s]] - bearer auth for API/stream/upload routes\n"
+      "  mqtt [<host> [port] [user pass]|off] - event/telemetry publisher (STA)\n"
+      "  timing     - boot timeline, time to portal/STA, mode-switch times\n"
+      "  radio      - Wi-Fi mode transitions: counts and times per from->to\n"
+      "  assets     - portal UI image in the 'assets' partition\n"
       "  reboot     - restart MCU\n");
   } else if (cmd == "status") {
     printNetDiag();
@@ -308,9 +1094,38 @@ void processCommand(const String& cmd) {
   } else if (cmd == "flush-nvs") {
     flushNVS();
   } else if (cmd == "reprov") {
-    clearNet();
-    WiFi.disconnect(true, true);
-    startCaptiveAP();
+    reprovBegin("console");
+  } else if (cmd == "reprov off") {
+    if (reprov.live) enterSTAOnly();
+    else Serial.println("reprov: no hitless portal is up");
+  } else if (cmd == "stations") {
+    Serial.println(stationsJSON());
+  } else if (cmd == "tls") {
+    LOGI("%s", tlsStatsLine().c_str());
+  } else if (cmd == "audio") {
+    LOGI("%s", audioStatsLine().c_str());
+  } else if (cmd == "cls") {
+    LOGI("%s", clsStatsLine().c_str());
+  } else if (cmd == "sensor") {
+    LOGI("%s", sensorStatsLine().c_str());
+  } else if (cmd == "rtp" || cmd.startsWith("rtp ")) {
+    rtpCommand(cmd);
+  } else if (cmd == "clip" || cmd.startsWith("clip ")) {
+    clipCommand(cmd);
+  } else if (cmd == "stream") {
+    LOGI("%s", streamStatsLine().c_str());
+  } else if (cmd == "jwt" || cmd.startsWith("jwt ")) {
+    jwtCommand(cmd);
+  } else if (cmd == "mqtt" || cmd.startsWith("mqtt ")) {
+    mqttCommand(cmd);
+  } else if (cmd == "timing") {
+    phasePrint();
+  } else if (cmd == "radio") {
+    radioPrint();
+  } else if (cmd == "assets") {
+    assetPrint();
+  } else if (cmd == "relay" || cmd.startsWith("relay ") || cmd.startsWith("relay-key ")) {
+    relayCommand(cmd);
   } else if (cmd == "reboot") {
     Serial.println("Rebooting...");
     delay(100);
@@ -352,12 +1167,12 @@ void handleButton() {
       } else if (held >= BTN_LONG_MS) {
         LOGI("BOOT long press (%lums): clear-net + start provisioning AP", held);
         clearNet();
-        WiFi.disconnect(true, true);
+        reprov.live = false;
+        WiFi.disconnect(false, true);   // radio stays on: STA -> AP is one switch
         startCaptiveAP();
       } else if (held >= BTN_SHORT_MS) {
-        LOGI("BOOT short press (%lums): start provisioning AP (keep other NVS)", held);
-        WiFi.disconnect(true, true);
-        startCaptiveAP();
+        LOGI("BOOT short press (%lums): provisioning portal beside the current link", held);
+        reprovBegin("button");
       } else {
         LOGD("BOOT tap ignored (%lums)", held);
       }
@@ -380,7 +1195,6 @@ void handleButton() {
 // ----------- Setup/Loop -----------
 void setup() {
   Serial.begin(115200);
-  delay(150);
   Serial.println();
   Serial.printf("ESP32 boot. SDK=%s, Chip=%s rev%d, Flash=%uMB\n",
                 ESP.getSdkVersion(), ESP.getChipModel(), ESP.getChipRevision(),
@@ -393,9 +1207,13 @@ void setup() {
 #endif
   pinMode(BOOT_BTN_GPIO, INPUT_PULLUP);
 
+  wifiEvents = xEventGroupCreate();
+  xEventGroupSetBits(wifiEvents, WIFI_AP_DOWN | WIFI_STA_DOWN);
   WiFi.onEvent(onWiFiEvent);
   Serial.setDebugOutput(false);
+  phaseMark("setup");
 
+  assetBegin();
   bindRoutes();
 
   if (tryConnectFromPrefs(CONNECT_TIMEOUT_MS)) {
@@ -403,10 +1221,19 @@ void setup() {
     LOGI("Starting in STA mode");
     // No captive DNS in STA-only
     if (!serverStarted) { server.begin(); serverStarted = true; }
+    discoveryBegin();
+    rtpBegin();
+    mqttBegin();
+    phaseSwitched(false, 0);
     printNetDiag();
   } else {
     startCaptiveAP();
   }
+  tlsBegin();
+  jwtBegin();
+  audioBegin();
+  sensorBegin();
+  phaseMark("setup-done");
 }
 
 void loop() {
@@ -425,22 +1252,37 @@ void loop() {
 
   if (serverStarted) server.handleClient();
   if (inAP) dnsServer.processNextRequest();
+  provJobPoll();
+  relayLoop();
+  discoveryLoop();
+  otaLoop();
+  stationsLoop();
+  clipLoop();
+  streamLoop();
+  mqttLoop();
+  sensorLoop();
 
   static uint32_t lastTry = 0;
   if (wantReconnect && (now - lastTry > RETRY_CONNECT_MS)) {
     lastTry = now;
     LOGI("Reconnect attempt triggered.");
+    bool wasAP = inAP;
     if (tryConnectFromPrefs(CONNECT_TIMEOUT_MS)) {
-      LOGI("Reconnect success; switching to STA-only");
-      // Cleanly drop AP (if any) and continue in STA
-      dnsServer.stop();
-      WiFi.softAPdisconnect(true);
-      delay(50);
-      WiFi.mode(WIFI_STA);
-      inAP = false;
+      // Cleanly drop AP (if any) and continue in STA; a reprov portal stays.
+      if (!reprov.live) {
+        LOGI("Reconnect success; switching to STA-only");
+        dnsServer.stop();
+        radioMode(WIFI_STA, "reconnect");
+        inAP = false;
+      }
       if (!serverStarted) { server.begin(); serverStarted = true; }
+      discoveryBegin();
+      rtpBegin();
+      mqttBegin();
+      phaseSwitched(false, now);
       wantReconnect = false;
       printNetDiag();
+      if (wasAP) relayStartDonor();
     } else {
       LOGW("Reconnect attempt failed; will retry in %u ms", RETRY_CONNECT_MS);
     }
@@ -0,0 +1,182 @@
+// ----------- Portal UI from the 'assets' flash partition -----------
+// The portal pages come from an image built by tools/mkassets.py out of
+// assets/ and written to the 'assets' partition (partitions.csv). The
+// partition is memory-mapped once; responses are written to the socket
+// straight from mapped flash, so a page costs no heap however large it is.
+// Hash-named files are sent as immutable and HTML with an ETag.
+// Without a valid image, '/' falls back to the built-in HTML_INDEX.
+//
+// PUT /update/assets replaces the image without touching the firmware.
+// With a JWT secret set it needs a bearer token (jwt_auth.ino); without
+// one it is refused while the open provisioning AP is up, since anyone in
+// range could otherwise replace the portal.
+// The partition holds one image and is erased as the new one is written,
+// so there is no rollback: the portal uses the built-in page from the start
+// of the upload until the new image has been written and its SHA-256
+// checked. A failed or dropped upload leaves it there until a good image
+// is uploaded.
+
+#if ESP_IDF_VERSION_MAJOR >= 5
+typedef esp_partition_mmap_handle_t AssetMapHandle;
+#define ASSET_MMAP_DATA ESP_PARTITION_MMAP_DATA
+#define assetMunmap     esp_partition_munmap
+#else
+typedef spi_flash_mmap_handle_t AssetMapHandle;
+#define ASSET_MMAP_DATA SPI_FLASH_MMAP_DATA
+#define assetMunmap     spi_flash_munmap
+#endif
+
+struct AssetUpload {
+  bool     active;
+  uint32_t total, written, erased;
+  int      reqStatus;
+  String   err;
+};
+
+AssetStore             assetStore;
+const esp_partition_t* assetPart = nullptr;
+AssetMapHandle         assetMap = 0;
+bool                   assetMapped = false;
+AssetUpload            assetUp = {};
+uint32_t               assetServed = 0, assetNotModified = 0, assetBytes = 0;
+
+void assetSha256(const uint8_t* p, size_t n, uint8_t out[32]) {
+  mbedtls_sha256(p, n, out, 0);
+}
+
+void assetUnmap() {
+  assetStore.close();
+  if (assetMapped) assetMunmap(assetMap);
+  assetMapped = false;
+}
+
+// Maps the partition and checks the image; false leaves the fallback page.
+bool assetMount() {
+  assetUnmap();
+  if (!assetPart) return false;
+  const void* p = nullptr;
+  if (esp_partition_mmap(assetPart, 0, assetPart->size, ASSET_MMAP_DATA, &p, &assetMap) != ESP_OK) {
+    LOGE("Assets: mmap of '%s' failed", assetPart->label);
+    return false;
+  }
+  assetMapped = true;
+  uint32_t t0 = micros();
+  AssetResult r = assetStore.open((const uint8_t*)p, assetPart->size, assetSha256);
+  if (r != ASSET_OK) {
+    LOGW("Assets: partition '%s' %s; serving the built-in page", assetPart->label, assetResultName(r));
+    assetUnmap();
+    return false;
+  }
+  LOGI("Assets: %u files, %u bytes, id %08lx (checked in %lu us)", (unsigned)assetStore.count(),
+       (unsigned)assetStore.size(), (unsigned long)assetStore.id(), (unsigned long)(micros() - t0));
+  return true;
+}
+
+void assetBegin() {
+  assetPart = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "assets");
+  if (!assetPart) { LOGI("Assets: no 'assets' partition; serving the built-in page"); return; }
+  assetMount();
+}
+
+// GET handler helper: true if uri was answered from the store.
+bool assetServe(const String& uri) {
+  AssetEntry e;
+  if (!assetStore.ready() || !assetStore.find(uri == "/" ? "/index.html" : uri.c_str(), &e)) return false;
+  char etag[12];
+  snprintf(etag, sizeof(etag), "\"%08lx\"", (unsigned long)e.etag);
+  server.sendHeader("ETag", etag);
+  server.sendHeader("Cache-Control", (e.flags & ASSET_IMMUTABLE) ? "public, max-age=31536000, immutable" : "no-cache");
+  if (server.header("If-None-Match") == etag) {
+    assetNotModified++;
+    server.send(304);
+    return true;
+  }
+  assetServed++;
+  assetBytes += e.length;
+  server.send_P(200, e.type, (PGM_P)e.data, e.length);
+  return true;
+}
+
+void assetRaw() {
+  HTTPRaw& raw = server.raw();
+  if (raw.status == RAW_START) {
+    assetUp.reqStatus = 0;
+    assetUp.err = "";
+    if (!jwtAuthorize()) { assetUp.reqStatus = 401; return; }   // 401 sent; body is dropped
+    if (inAP && !jwtActive()) {
+      assetUp.reqStatus = 403; assetUp.err = "open AP is up: set a JWT secret first"; return;
+    }
+    assetUp.total = (uint32_t)server.header("Content-Length").toInt();
+    assetUp.written = assetUp.erased = 0;
+    if (!assetPart) { assetUp.reqStatus = 404; assetUp.err = "no assets partition"; return; }
+    if (!assetUp.total || assetUp.total > assetPart->size) {
+      assetUp.reqStatus = 413; assetUp.err = "image does not fit the partition"; return;
+    }
+    assetUnmap();
+    assetUp.active = true;
+    LOGI("Assets: receiving %u bytes into '%s'", (unsigned)assetUp.total, assetPart->label);
+  } else if (raw.status == RAW_WRITE) {
+    if (assetUp.reqStatus || !assetUp.active) return;
+    uint32_t end = assetUp.written + raw.currentSize;
+    if (end > assetUp.total) { assetUp.reqStatus = 400; assetUp.err = "more data than declared"; return; }
+    // Erase just ahead of the data, one sector at a time, so no single
+    // call holds the loop for the whole partition.
+    while (assetUp.erased < end) {
+      if (esp_partition_erase_range(assetPart, assetUp.erased, SPI_FLASH_SEC_SIZE) != ESP_OK) {
+        assetUp.reqStatus = 500; assetUp.err = "erase failed"; return;
+      }
+      assetUp.erased += SPI_FLASH_SEC_SIZE;
+    }
+    if (esp_partition_write(assetPart, assetUp.written, raw.buf, raw.currentSize) != ESP_OK) {
+      assetUp.reqStatus = 500; assetUp.err = "flash write failed"; return;
+    }
+    assetUp.written = end;
+  } else if (raw.status == RAW_END) {
+    assetUp.active = false;
+    if (assetUp.reqStatus) return;
+    if (assetUp.written != assetUp.total) { assetUp.reqStatus = 400; assetUp.err = "short body"; return; }
+    if (!assetMount()) { assetUp.reqStatus = 400; assetUp.err = "image rejected"; }
+  } else if (raw.status == RAW_ABORTED) {
+    assetUp.active = false;
+    LOGW("Assets: upload dropped at %u/%u bytes", (unsigned)assetUp.written, (unsigned)assetUp.total);
+  }
+}
+
+void assetDone() {
+  if (assetUp.reqStatus == 401) return;           // answered by jwtAuthorize()
+  int code = assetUp.reqStatus ? assetUp.reqStatus : 200;
+  if (code != 200) LOGW("Assets: upload failed: %s", assetUp.err.c_str());
+  String j = "{\"ok\":" + String(code == 200 ? "true" : "false");
+  if (code == 200) {
+    char id[9];
+    snprintf(id, sizeof(id), "%08lx", (unsigned long)assetStore.id());
+    j += ",\"files\":" + String(assetStore.count()) + ",\"bytes\":" + String(assetStore.size()) + ",\"id\":\"" + id + "\"";
+  } else {
+    j += ",\"error\":\"" + assetUp.err + "\"";
+  }
+  server.send(code, "application/json", j + "}");
+}
+
+void assetBindRoutes() {
+  server.on("/update/assets", HTTP_PUT, assetDone, assetRaw);
+  server.on("/update/assets", HTTP_POST, assetDone, assetRaw);
+}
+
+String assetStatsLine() {
+  if (!assetStore.ready()) return assetPart ? "Assets: no valid image (built-in page)" : "Assets: no partition (built-in page)";
+  char b[160];
+  snprintf(b, sizeof(b), "Assets: id %08lx %u files %u/%u bytes, served=%lu (%lu bytes) not-modified=%lu",
+           (unsigned long)assetStore.id(), (unsigned)assetStore.count(), (unsigned)assetStore.size(),
+           (unsigned)assetPart->size, (unsigned long)assetServed, (unsigned long)assetBytes,
+           (unsigned long)assetNotModified);
+  return String(b);
+}
+
+void assetPrint() {
+  LOGI("%s", assetStatsLine().c_str());
+  AssetEntry e;
+  for (uint32_t i = 0; assetStore.at(i, &e); i++) {
+    Serial.printf("  %-40s %6lu  %s%s\n", e.path, (unsigned long)e.length, e.type,
+                  (e.flags & ASSET_IMMUTABLE) ? ", immutable" : "");
+  }
+}
@@ -0,0 +1,265 @@
+// ----------- INMP441 capture (I2S DMA -> AudioRing) -----------
+// The capture task blocks in the I2S read and lands each period directly in
+// a ring slot; the processing task drains the ring and runs the per-period
+// stages in audioProcess(). Both run on the app core next to loop(), the
+// capture task at a higher priority so DMA is always serviced first.
+
+// INMP441 sends 24-bit samples left-justified in 32-bit I2S slots.
+// IDF 5 replaced the legacy driver with the channel API (driver/i2s_std.h).
+class I2sMicSource : public AudioSource {
+public:
+#if ESP_IDF_VERSION_MAJOR >= 5
+  bool begin() {
+    i2s_chan_config_t cc = I2S_CHANNEL_DEFAULT_CONFIG(MIC_I2S_PORT, I2S_ROLE_MASTER);
+    cc.dma_desc_num = AUDIO_DMA_BUFS;
+    cc.dma_frame_num = AUDIO_PERIOD_FRAMES;
+    i2s_std_config_t sc = {
+      .clk_cfg  = I2S_STD_CLK_DEFAULT_CONFIG(AUDIO_RATE),
+      .slot_cfg = I2S_STD_PHILIPS_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_32BIT, I2S_SLOT_MODE_MONO),
+      .gpio_cfg = {
+        .mclk = I2S_GPIO_UNUSED,
+        .bclk = (gpio_num_t)MIC_PIN_BCK,
+        .ws   = (gpio_num_t)MIC_PIN_WS,
+        .dout = I2S_GPIO_UNUSED,
+        .din  = (gpio_num_t)MIC_PIN_SD,
+        .invert_flags = {},
+      },
+    };
+    sc.slot_cfg.slot_mask = I2S_STD_SLOT_LEFT;           // L/R pin tied to GND
+    sc.clk_cfg.clk_src = I2S_CLK_SRC_APLL;               // exact 48 kHz clocks
+    esp_err_t err = i2s_new_channel(&cc, nullptr, &_rx);
+    if (err == ESP_OK) err = i2s_channel_init_std_mode(_rx, &sc);
+    if (err == ESP_OK) err = i2s_channel_enable(_rx);
+    if (err != ESP_OK) { LOGE("I2S init failed: %s", esp_err_to_name(err)); return false; }
+    return true;
+  }
+#else
+  bool begin() {
+    i2s_config_t cfg = {};
+    cfg.mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX);
+    cfg.sample_rate = AUDIO_RATE;
+    cfg.bits_per_sample = I2S_BITS_PER_SAMPLE_32BIT;
+    cfg.channel_format = I2S_CHANNEL_FMT_ONLY_LEFT;      // L/R pin tied to GND
+    cfg.communication_format = I2S_COMM_FORMAT_STAND_I2S;
+    cfg.intr_alloc_flags = ESP_INTR_FLAG_LEVEL1;
+    cfg.dma_buf_count = AUDIO_DMA_BUFS;
+    cfg.dma_buf_len = AUDIO_PERIOD_FRAMES;
+    cfg.use_apll = true;                                  // exact 48 kHz clocks
+    i2s_pin_config_t pins = {};
+    pins.mck_io_num = I2S_PIN_NO_CHANGE;
+    pins.bck_io_num = MIC_PIN_BCK;
+    pins.ws_io_num = MIC_PIN_WS;
+    pins.data_out_num = I2S_PIN_NO_CHANGE;
+    pins.data_in_num = MIC_PIN_SD;
+    esp_err_t err = i2s_driver_install(MIC_I2S_PORT, &cfg, 0, nullptr);
+    if (err == ESP_OK) err = i2s_set_pin(MIC_I2S_PORT, &pins);
+    if (err != ESP_OK) { LOGE("I2S init failed: %s", esp_err_to_name(err)); return false; }
+    i2s_zero_dma_buffer(MIC_I2S_PORT);
+    return true;
+  }
+#endif
+  uint32_t rate() const override { return AUDIO_RATE; }
+  size_t read(int32_t* out, size_t frames) override {
+    size_t bytes = 0;
+#if ESP_IDF_VERSION_MAJOR >= 5
+    if (i2s_channel_read(_rx, out, frames * sizeof(int32_t), &bytes, portMAX_DELAY) != ESP_OK) return 0;
+#else
+    if (i2s_read(MIC_I2S_PORT, out, frames * sizeof(int32_t), &bytes, portMAX_DELAY) != ESP_OK) return 0;
+#endif
+    size_t n = bytes / sizeof(int32_t);
+    for (size_t i = 0; i < n; i++) out[i] >>= 8;          // arithmetic shift keeps the sign
+    return n;
+  }
+#if ESP_IDF_VERSION_MAJOR >= 5
+private:
+  i2s_chan_handle_t _rx = nullptr;
+#endif
+};
+
+static_assert(AUDIO_RATE % AUDIO_OUT_RATE == 0 && AUDIO_PERIOD_FRAMES % AUDIO_DECIM == 0,
+              "output rate must divide the capture rate and period");
+
+struct AudioStats {
+  uint32_t shortReads;
+  uint64_t procUs, decimUs;     // time spent in audioProcess / the decimator
+  uint32_t procPeriods;
+  int32_t  peak;                // last period, absolute
+  float    rmsDb;               // last period, dBFS
+  uint32_t maxLevel;            // ring high-water mark (periods)
+  bool     loud;                // above CLIP_LEVEL_DBFS last period
+  uint64_t mfccUs;              // MFCC compute time, total
+  uint32_t mfccFrames, mfccMaxUs, mfccOver, mfccSkipped;
+};
+
+I2sMicSource audioMic;
+AudioRing    audioRing;
+Decimator    audioDecim;
+int16_t      audioPcm[AUDIO_OUT_FRAMES];   // current period at AUDIO_OUT_RATE
+#if AUDIO_OUT_RATE != G711_RATE
+Decimator    audioDecim8;                  // AUDIO_OUT_RATE -> G711_RATE
+int32_t      audioWide[AUDIO_OUT_FRAMES];
+int16_t      audioPcm8[G711_FRAMES];
+#endif
+uint8_t      audioG711[G711_FRAMES];       // encoded period when no RTP buffer takes it
+Vad          audioVad;                     // on the G.711 branch
+Mfcc         audioMfcc;                    // on the AUDIO_OUT_RATE branch, one frame per period
+int16_t      audioFeat[MFCC_COEFFS];       // latest MFCC vector, Q(MFCC_Q)
+bool         audioMfccOn = false;
+AudioStats   audioStats;
+TaskHandle_t audioProcHandle = nullptr;
+bool         audioStarted = false;
+
+// Per-period processing, called in capture order from the processing task.
+void audioProcess(const int32_t* pcm, size_t frames, uint32_t startFrame) {
+  int64_t t0 = esp_timer_get_time();
+  int32_t peak = 0;
+  int64_t sumSq = 0;
+  for (size_t i = 0; i < frames; i++) {
+    int32_t s = pcm[i];
+    int32_t a = s < 0 ? -s : s;
+    if (a > peak) peak = a;
+    sumSq += (int64_t)s * s;
+  }
+  audioStats.peak = peak;
+  float ms = (float)sumSq / frames / ((float)AUDIO_FULL_SCALE * AUDIO_FULL_SCALE);
+  audioStats.rmsDb = ms > 1e-12f ? 10.0f * log10f(ms) : -120.0f;
+  bool loud = audioStats.rmsDb > CLIP_LEVEL_DBFS;
+  if (loud && !audioStats.loud) clipTrigger(CLIP_TRIG_LEVEL);
+  audioStats.loud = loud;
+
+  int64_t t1 = esp_timer_get_time();
+  audioDecim.process(pcm, frames, audioPcm);
+#if AUDIO_OUT_RATE != G711_RATE
+  for (size_t i = 0; i < AUDIO_OUT_FRAMES; i++) audioWide[i] = (int32_t)audioPcm[i] << 8;
+  audioDecim8.process(audioWide, AUDIO_OUT_FRAMES, audioPcm8);
+  const int16_t* pcm8 = audioPcm8;
+#else
+  const int16_t* pcm8 = audioPcm;
+#endif
+  int64_t t2 = esp_timer_get_time();
+
+  // G.711 is encoded once, straight into the outgoing RTP packet when one
+  // is being filled. Other consumers of enc must run before rtpCommit().
+  // Silent periods are not sent over RTP; they are still encoded for the
+  // clip ring (unless it is holding a clip) and /stream listeners.
+  uint32_t ts8 = startFrame / (AUDIO_RATE / G711_RATE);
+  bool voice = audioVad.process(pcm8, G711_FRAMES) || !VAD_ENABLE;
+  if (!voice) rtpSilence(ts8, audioVad.noiseDbov());
+  uint8_t* enc = voice ? rtpPayloadSlot(G711_FRAMES, ts8) : nullptr;
+  bool toRtp = enc != nullptr;
+  if (!enc) enc = audioG711;
+  bool forClip = clipWanted(), forStream = streamWants(STREAM_FMT_G711);
+  if (voice || forClip || forStream) g711Encode(AUDIO_G711_LAW, pcm8, enc, G711_FRAMES);
+  if (forClip) clipWrite(enc, G711_FRAMES);
+  if (forStream) streamFeed(STREAM_FMT_G711, enc, G711_FRAMES);
+  if (streamWants(STREAM_FMT_PCM)) streamFeed(STREAM_FMT_PCM, (const uint8_t*)audioPcm, sizeof(audioPcm));
+  if (toRtp) rtpCommit(G711_FRAMES);
+
+  if (audioMfccOn) audioFeatures();
+
+  audioStats.decimUs += t2 - t1;
+  audioStats.procUs += esp_timer_get_time() - t0;
+  audioStats.procPeriods++;
+}
+
+// MFCC on the current period. The history always advances; the FFT and
+// the rest are skipped while the ring is more than half full, so feature
+// extraction gives way to capture instead of causing overruns.
+void audioFeatures() {
+  if (!audioMfcc.push(audioPcm)) return;
+  if (audioRing.level() > AUDIO_RING_PERIODS / 2) {
+    audioStats.mfccSkipped++;
+    clsGap();
+    return;
+  }
+  int64_t t0 = esp_timer_get_time();
+  audioMfcc.compute(audioFeat);
+  uint32_t us = esp_timer_get_time() - t0;
+  clsFeed(audioFeat);
+  audioStats.mfccUs += us;
+  audioStats.mfccFrames++;
+  if (us > audioStats.mfccMaxUs) audioStats.mfccMaxUs = us;
+  if (us > MFCC_BUDGET_US) audioStats.mfccOver++;
+}
+
+// Share of real time spent in a stage, in percent.
+float audioCpuPct(uint64_t us) {
+  uint32_t n = audioStats.procPeriods;
+  return n ? 100.0f * us / ((float)n * AUDIO_PERIOD_FRAMES * 1e6f / AUDIO_RATE) : 0;
+}
+
+void audioCaptureTask(void*) {
+  static int32_t scratch[AUDIO_PERIOD_FRAMES];
+  uint32_t clock = 0;
+  for (;;) {
+    if (audioPump(audioMic, audioRing, scratch, clock) < AUDIO_PERIOD_FRAMES) audioStats.shortReads++;
+    xTaskNotifyGive(audioProcHandle);
+  }
+}
+
+void audioProcTask(void*) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+    uint32_t lvl = audioRing.level();
+    if (lvl > audioStats.maxLevel) audioStats.maxLevel = lvl;
+    uint32_t startFrame;
+    while (const int32_t* p = audioRing.peek(&startFrame)) {
+      audioProcess(p, AUDIO_PERIOD_FRAMES, startFrame);
+      audioRing.release();
+    }
+  }
+}
+
+void audioBegin() {
+#if AUDIO_ENABLE
+  if (audioStarted) return;
+  if (!audioRing.begin(AUDIO_PERIOD_FRAMES, AUDIO_RING_PERIODS) || !audioDecim.design(AUDIO_DECIM)
+#if AUDIO_OUT_RATE != G711_RATE
+      || !audioDecim8.design(AUDIO_OUT_RATE / G711_RATE)
+#endif
+     ) {
+    LOGE("Audio alloc failed");
+    return;
+  }
+  if (!audioMic.begin()) return;
+  clipBegin();
+  audioVad.begin(VAD_HANGOVER_MS * AUDIO_RATE / 1000 / AUDIO_PERIOD_FRAMES);
+#if MFCC_ENABLE
+  audioMfccOn = audioMfcc.begin(AUDIO_OUT_RATE) && audioMfcc.hopSize() == AUDIO_OUT_FRAMES;
+  if (!audioMfccOn) LOGE("MFCC disabled (alloc failed or hop %u != period %u)", (unsigned)audioMfcc.hopSize(),
+                         (unsigned)AUDIO_OUT_FRAMES);
+  if (audioMfccOn) clsBegin();
+#endif
+  audioStarted = true;
+  xTaskCreatePinnedToCore(audioProcTask, "audio-proc", 4096, nullptr, 5, &audioProcHandle, 1);
+  xTaskCreatePinnedToCore(audioCaptureTask, "audio-cap", 3072, nullptr, 12, nullptr, 1);
+  LOGI("Audio capture: %d Hz, %d-frame periods x %d -> %d Hz (%u taps)", AUDIO_RATE, AUDIO_PERIOD_FRAMES,
+       AUDIO_RING_PERIODS, AUDIO_OUT_RATE, (unsigned)audioDecim.taps());
+#endif
+}
+
+bool audioRunning() {
+  return audioStarted;
+}
+
+String audioStatsLine() {
+  if (!audioStarted) return "Audio: off";
+  const VadStats& v = audioVad.stats();
+  char b[288];
+  snprintf(b, sizeof(b), "Audio: %d->%d Hz periods=%lu overruns=%lu short=%lu ring=%u/%u (max %lu) level=%.1f dBFS peak=%ld"
+           " cpu=%.1f%% (decim %.1f%%) vad=%s active=%.0f%% spurts=%lu floor=-%udBov",
+           AUDIO_RATE, AUDIO_OUT_RATE, (unsigned long)audioRing.committed(), (unsigned long)audioRing.overruns(),
+           (unsigned long)audioStats.shortReads, (unsigned)audioRing.level(), (unsigned)audioRing.periods(),
+           (unsigned long)audioStats.maxLevel, audioStats.rmsDb, (long)audioStats.peak,
+           audioCpuPct(audioStats.procUs), audioCpuPct(audioStats.decimUs), audioVad.active() ? "voice" : "silence",
+           v.frames ? 100.0f * v.active / v.frames : 0.0f, (unsigned long)v.onsets, audioVad.noiseDbov());
+  String l(b);
+  if (audioMfccOn) {
+    snprintf(b, sizeof(b), " mfcc avg=%luus max=%luus over=%lu skipped=%lu c0=%.2f",
+             (unsigned long)(audioStats.mfccFrames ? audioStats.mfccUs / audioStats.mfccFrames : 0),
+             (unsigned long)audioStats.mfccMaxUs, (unsigned long)audioStats.mfccOver,
+             (unsigned long)audioStats.mfccSkipped, audioFeat[0] / (float)(1 << MFCC_Q));
+    l += b;
+  }
+  return l;
+}
@@ -0,0 +1,44 @@
+// ----------- RFC 8908 captive portal API / RFC 8910 DHCP option 114 -----------
+// Clients that understand option 114 fetch the API URI straight after
+// DHCP and learn they are captive (and where the portal is) without the
+// probe -> onNotFound -> 302 round trips. RFC 8908 requires the API and
+// the user-portal URL to be HTTPS, so both point at the TLS front end.
+//
+// A client only uses them if it trusts the unit's certificate. The
+// certificate is self-signed and per unit (tls_proxy.ino), so stock phones
+// and laptops reject the API and fall back to probing; the fast path needs
+// that certificate installed as trusted on the client (managed devices).
+// /api/stations shows which path each client actually took.
+
+String capportURI(const char* path) {
+  return String(CAPPORT_SCHEME "://") + apIP.toString() + path;
+}
+
+String capportApiURI() { return capportURI(CAPPORT_API_PATH); }
+
+// Must run after softAP() has brought the AP netif up.
+void capportAdvertise() {
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0)
+  esp_netif_t* ap = esp_netif_get_handle_from_ifkey("WIFI_AP_DEF");
+  if (!ap) return;
+  String uri = capportApiURI();
+  esp_netif_dhcps_stop(ap);
+  esp_err_t err = esp_netif_dhcps_option(ap, ESP_NETIF_OP_SET, ESP_NETIF_CAPTIVEPORTAL_URI,
+                                         (void*)uri.c_str(), uri.length());
+  esp_netif_dhcps_start(ap);
+  if (err == ESP_OK) LOGI("DHCP option 114 -> %s", uri.c_str());
+  else LOGW("DHCP option 114 not set: %s", esp_err_to_name(err));
+#else
+  LOGD("DHCP option 114 needs ESP-IDF >= 5.1; clients will use probes");
+#endif
+}
+
+void capportBindRoutes() {
+  server.on(CAPPORT_API_PATH, HTTP_GET, [](){
+    String j = "{\"captive\":" + String(inAP ? "true" : "false");
+    if (inAP) j += ",\"user-portal-url\":\"" + capportURI("/") + "\"";
+    j += "}";
+    server.sendHeader("Cache-Control", "private, no-store");
+    server.send(200, "application/captive+json", j);
+  });
+}
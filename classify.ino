@@ -0,0 +1,83 @@
+// ----------- Sound classifier (inference on core 0) -----------
+// audio.ino hands each MFCC frame to clsFeed(). Every CLS_STRIDE frames,
+// FeatureWindows hands the last CLS_FRAMES to the inference task on core
+// 0, while capture and MFCC keep running on core 1. A window that comes
+// due while inference still holds the previous one is dropped and counted.
+// The audio task never waits. The model's activations live in a static
+// arena of CLS_ARENA_BYTES; clsBegin() fails instead of allocating if the
+// model does not fit.
+
+struct ClsStats {
+  uint32_t runs;
+  uint64_t busyUs;
+  uint32_t lastUs, maxUs;
+  int64_t  startUs;
+  int      last;                       // class of the latest window
+  int32_t  logits[CLS_CLASSES];
+  uint32_t hits[CLS_CLASSES];
+};
+
+FeatureWindows clsWin;
+SoundModel     clsModel;
+alignas(4) uint8_t clsArena[CLS_ARENA_BYTES];
+ClsStats       clsStats;
+TaskHandle_t   clsTaskHandle = nullptr;
+
+// Audio task: one feature frame, or a hop the extractor skipped.
+void clsFeed(const int16_t* feat) {
+  if (clsTaskHandle && clsWin.push(feat)) xTaskNotifyGive(clsTaskHandle);
+}
+
+void clsGap() {
+  if (clsTaskHandle && clsWin.gap()) xTaskNotifyGive(clsTaskHandle);
+}
+
+void clsTask(void*) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    const int16_t* w = clsWin.take();
+    if (!w) continue;
+    int64_t t0 = esp_timer_get_time();
+    int32_t logits[CLS_CLASSES];
+    int c = clsModel.run(w, logits);
+    clsWin.done();
+    uint32_t us = esp_timer_get_time() - t0;
+    clsStats.busyUs += us;
+    clsStats.lastUs = us;
+    if (us > clsStats.maxUs) clsStats.maxUs = us;
+    memcpy(clsStats.logits, logits, sizeof(logits));
+    clsStats.last = c;
+    clsStats.hits[c]++;
+    clsStats.runs++;
+  }
+}
+
+void clsBegin() {
+#if CLS_ENABLE
+  if (clsTaskHandle) return;
+  const ClsModel& m = clsReferenceModel();
+  if (!clsModel.begin(m, clsArena, sizeof(clsArena))) {
+    LOGE("Classifier: model needs %u arena bytes, have %u", (unsigned)SoundModel::arenaBytes(m), (unsigned)CLS_ARENA_BYTES);
+    return;
+  }
+  memset(&clsStats, 0, sizeof(clsStats));
+  clsStats.startUs = esp_timer_get_time();
+  xTaskCreatePinnedToCore(clsTask, "classify", 3072, nullptr, CLS_TASK_PRIO, &clsTaskHandle, CLS_CORE);
+  LOGI("Classifier: %d-frame windows every %d frames on core %d, arena %u/%u bytes", CLS_FRAMES, CLS_STRIDE,
+       CLS_CORE, (unsigned)SoundModel::arenaBytes(m), (unsigned)CLS_ARENA_BYTES);
+#endif
+}
+
+String clsStatsLine() {
+  if (!clsTaskHandle) return "Classifier: off";
+  float wallUs = (float)(esp_timer_get_time() - clsStats.startUs);
+  char b[200];
+  snprintf(b, sizeof(b), "Classifier: windows=%lu runs=%lu latency last=%luus avg=%luus max=%luus dropped=%lu frames"
+           " duty=%.1f%% class=%d (logits %ld/%ld, hits %lu/%lu)",
+           (unsigned long)clsWin.windows(), (unsigned long)clsStats.runs, (unsigned long)clsStats.lastUs,
+           (unsigned long)(clsStats.runs ? clsStats.busyUs / clsStats.runs : 0), (unsigned long)clsStats.maxUs,
+           (unsigned long)clsWin.dropped(), wallUs > 0 ? 100.0f * clsStats.busyUs / wallUs : 0.0f, clsStats.last,
+           (long)clsStats.logits[0], (long)clsStats.logits[1], (unsigned long)clsStats.hits[0],
+           (unsigned long)clsStats.hits[1]);
+  return String(b);
+}
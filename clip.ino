@@ -0,0 +1,127 @@
+// ----------- Event clips (pre-trigger ring) -----------
+// The G.711 branch feeds a ClipRing holding CLIP_PRE_MS of history. A
+// trigger (level threshold in audio.ino, a KY-038 event in sensor.ino,
+// POST /clip/trigger, 'clip trigger') records CLIP_POST_MS more and
+// freezes the clip in place; GET /clip serves it as one WAV file. The
+// clip is held until DELETE /clip or CLIP_HOLD_MS, then the ring resumes.
+// At 8 KB/s the defaults use 40 KB of heap.
+
+#define CLIP_BYTES_PER_MS (G711_RATE / 1000)
+
+ClipRing clipRing;
+bool     clipOn = false;
+uint32_t clipTrigMs = 0, clipFrozenMs = 0;
+
+const char* clipReasonName(uint8_t r) {
+  switch (r) {
+    case CLIP_TRIG_LEVEL:    return "level";
+    case CLIP_TRIG_EXTERNAL: return "external";
+    case CLIP_TRIG_SENSOR:   return "sensor";
+    default:                 return "?";
+  }
+}
+
+void clipBegin() {
+  if (clipOn) return;
+  clipOn = clipRing.begin(CLIP_PRE_MS * CLIP_BYTES_PER_MS, CLIP_POST_MS * CLIP_BYTES_PER_MS, G711_FRAMES);
+  if (clipOn) LOGI("Clip ring: %u ms pre + %u ms post (%u bytes)", CLIP_PRE_MS, CLIP_POST_MS, (unsigned)clipRing.capacity());
+  else LOGE("Clip ring alloc failed (%u bytes); clips disabled", (CLIP_PRE_MS + CLIP_POST_MS) * CLIP_BYTES_PER_MS);
+}
+
+// Audio task: true while the ring wants encoded audio.
+bool clipWanted() {
+  return clipOn && clipRing.state() != CLIP_FROZEN;
+}
+
+void clipWrite(const uint8_t* enc, size_t n) {
+  if (clipOn) clipRing.write(enc, n);
+}
+
+bool clipTrigger(uint8_t reason) {
+  if (!clipOn || !clipRing.trigger(reason)) return false;
+  clipTrigMs = millis();
+  return true;
+}
+
+String clipStatusJSON() {
+  ClipState st = clipOn ? clipRing.state() : CLIP_RECORDING;
+  String j = "{\"enabled\":" + String(clipOn ? "true" : "false");
+  j += ",\"state\":\"" + String(st == CLIP_FROZEN ? "ready" : st == CLIP_POST ? "capturing" : "armed") + "\"";
+  j += ",\"pre_ms\":" + String(CLIP_PRE_MS) + ",\"post_ms\":" + String(CLIP_POST_MS);
+  j += ",\"clips\":" + String(clipRing.clips()) + ",\"missed\":" + String(clipRing.missed());
+  if (st != CLIP_RECORDING) {
+    j += ",\"reason\":\"" + String(clipReasonName(clipRing.reason())) + "\"";
+    j += ",\"age_ms\":" + String(millis() - clipTrigMs);
+  }
+  if (st == CLIP_FROZEN) {
+    j += ",\"bytes\":" + String(clipRing.clipLength());
+    j += ",\"trigger_offset_ms\":" + String(clipRing.preLength() / CLIP_BYTES_PER_MS);
+  }
+  j += "}";
+  return j;
+}
+
+void clipServe() {
+  if (!jwtAuthorize()) return;
+  if (!clipOn || clipRing.state() != CLIP_FROZEN) {
+    server.send(404, "application/json", clipStatusJSON());
+    return;
+  }
+  size_t len = clipRing.clipLength();
+  uint8_t hdr[WAV_HDR_MAX];
+  size_t hl = wavHeader(hdr, AUDIO_G711_LAW == G711_ALAW ? WAV_FMT_ALAW : WAV_FMT_MULAW, G711_RATE, 8, len);
+  server.setContentLength(hl + len);
+  server.sendHeader("Content-Disposition", "attachment; filename=\"clip-" + String(clipRing.clips()) + ".wav\"");
+  server.sendHeader("Cache-Control", "no-store");
+  server.send(200, "audio/wav", "");
+  server.sendContent((const char*)hdr, hl);
+  uint8_t buf[1024];
+  for (size_t off = 0; off < len; ) {
+    size_t n = clipRing.read(off, buf, sizeof(buf));
+    if (!n) break;
+    server.sendContent((const char*)buf, n);
+    off += n;
+  }
+}
+
+void clipBindRoutes() {
+  server.on("/clip", HTTP_GET, clipServe);
+  server.on("/clip", HTTP_DELETE, [](){
+    if (!jwtAuthorize()) return;
+    clipRing.release();
+    server.send(200, "application/json", "{\"released\":true}");
+  });
+  server.on("/clip/status", HTTP_GET, [](){
+    if (!jwtAuthorize()) return;
+    server.send(200, "application/json", clipStatusJSON());
+  });
+  server.on("/clip/trigger", HTTP_POST, [](){
+    if (!jwtAuthorize()) return;
+    bool ok = clipTrigger(CLIP_TRIG_EXTERNAL);
+    server.send(ok ? 202 : 409, "application/json", clipStatusJSON());
+  });
+}
+
+void clipLoop() {
+  if (!clipOn) return;
+  if (clipRing.state() != CLIP_FROZEN) { clipFrozenMs = 0; return; }
+  if (!clipFrozenMs) {
+    clipFrozenMs = millis();
+    LOGI("Clip ready: %u ms (%s trigger), GET /clip", (unsigned)(clipRing.clipLength() / CLIP_BYTES_PER_MS),
+         clipReasonName(clipRing.reason()));
+    char j[96];
+    snprintf(j, sizeof(j), "{\"t\":%lu,\"ev\":\"clip\",\"n\":%lu,\"ms\":%u,\"trigger\":\"%s\"}",
+             (unsigned long)millis(), (unsigned long)clipRing.clips(),
+             (unsigned)(clipRing.clipLength() / CLIP_BYTES_PER_MS), clipReasonName(clipRing.reason()));
+    mqttEvent(j);
+  } else if (millis() - clipFrozenMs > CLIP_HOLD_MS) {
+    clipRing.release();
+  }
+}
+
+// clip | clip trigger | clip release
+void clipCommand(const String& cmd) {
+  if (cmd == "clip trigger") LOGI("Clip trigger %s", clipTrigger(CLIP_TRIG_EXTERNAL) ? "accepted" : "ignored (busy)");
+  else if (cmd == "clip release") clipRing.release();
+  Serial.println(clipStatusJSON());
+}
@@ -0,0 +1,91 @@
+// ----------- UDP fleet discovery -----------
+// STA-mode responder: one query (broadcast or multicast) gets one compact
+// datagram back per unit; see src/discovery_proto.h for the format.
+
+WiFiUDP  discUdp;
+bool     discUp = false;
+// Replies waiting out their spread delay, one per querier; several tools
+// may ask within one window.
+struct DiscPending {
+  bool      used;
+  uint32_t  due;
+  IPAddress peer;
+  uint16_t  port, nonce;
+};
+DiscPending discPending[DISCOVERY_PENDING];
+uint32_t    discQueries = 0, discReplies = 0, discDropped = 0;
+
+void discoveryBegin() {
+#if DISCOVERY_ENABLE
+  if (discUp) return;
+  IPAddress group;
+  group.fromString(DISCOVERY_GROUP);
+  discUp = discUdp.beginMulticast(group, DISCOVERY_PORT);  // also receives broadcast/unicast
+  if (discUp) LOGI("Discovery responder on UDP %d (group %s)", DISCOVERY_PORT, DISCOVERY_GROUP);
+  else LOGW("Discovery responder failed to bind UDP %d", DISCOVERY_PORT);
+#endif
+}
+
+void discoveryStop() {
+  if (!discUp) return;
+  discUdp.stop();
+  discUp = false;
+  for (auto& p : discPending) p.used = false;
+}
+
+void discoverySend(const IPAddress& peer, uint16_t port, uint16_t nonce) {
+  DiscReply r = {};
+  r.flags = (inAP ? DISC_RF_AP : 0) | (relayDonating() ? DISC_RF_RELAY : 0);
+  r.nonce = nonce;
+  uint64_t mac = ESP.getEfuseMac();
+  for (int i = 0; i < 6; i++) r.mac[i] = mac >> (8 * i);
+  r.fw[0] = FW_VERSION_MAJOR; r.fw[1] = FW_VERSION_MINOR; r.fw[2] = FW_VERSION_PATCH;
+  r.rssi = WiFi.RSSI();
+  IPAddress ip = WiFi.localIP();
+  for (int i = 0; i < 4; i++) r.ip[i] = ip[i];
+  r.uptimeS = millis() / 1000;
+  r.freeHeap = ESP.getFreeHeap();
+  uint8_t buf[DISC_REPLY_LEN];
+  discEncodeReply(r, buf);
+  discUdp.beginPacket(peer, port);
+  discUdp.write(buf, sizeof(buf));
+  if (discUdp.endPacket()) discReplies++;
+}
+
+void discoveryLoop() {
+  if (!discUp) return;
+  if (discUdp.parsePacket() > 0) {
+    uint8_t q[DISC_QUERY_LEN];
+    int n = discUdp.read(q, sizeof(q));
+    uint8_t flags; uint16_t nonce;
+    if (n > 0 && discParseQuery(q, n, flags, nonce)) {
+      discQueries++;
+      IPAddress peer = discUdp.remoteIP();
+      uint16_t port = discUdp.remotePort();
+      // A repeat from the same querier replaces its entry; otherwise take a free one.
+      DiscPending* slot = nullptr;
+      for (auto& p : discPending) if (p.used && p.peer == peer && p.port == port) slot = &p;
+      for (auto& p : discPending) if (!p.used && !slot) slot = &p;
+      // Spread by MAC so hundreds of units don't answer in the same millisecond.
+      uint32_t spread = (flags & DISC_QF_SPREAD) ? (uint32_t)(ESP.getEfuseMac() >> 24) % DISC_SPREAD_MS : 0;
+      if (slot) {
+        slot->used = true;
+        slot->due = millis() + spread;
+        slot->peer = peer;
+        slot->port = port;
+        slot->nonce = nonce;
+        LOGD("Discovery query from %s:%u (reply in %lums)", peer.toString().c_str(), port, spread);
+      } else {
+        discDropped++;
+        LOGD("Discovery query from %s:%u dropped; %d replies pending", peer.toString().c_str(), port, DISCOVERY_PENDING);
+      }
+    }
+    discUdp.flush();
+  }
+  uint32_t now = millis();
+  for (auto& p : discPending) {
+    if (!p.used || (int32_t)(now - p.due) < 0) continue;
+    p.used = false;
+    discoverySend(p.peer, p.port, p.nonce);
+  }
+}
@@ -0,0 +1,176 @@
+// ----------- ESP-NOW credential relay -----------
+// Glue between CredRelay (src/espnow_relay.*) and the ESP-NOW driver.
+// A unit that was just provisioned donates its credentials for
+// RELAY_WINDOW_MS; units in captive-AP mode listen for them.
+
+#define RELAY_WINDOW_MS  (10UL * 60 * 1000)
+#define RELAY_HOPS       2       // donated credentials may be relayed this many more times
+
+struct RelayRxItem {
+  uint8_t mac[6];
+  uint8_t len;
+  uint8_t data[RELAY_FRAME_MAX];
+};
+
+class EspNowRadio : public RelayRadio {
+public:
+  bool send(const uint8_t dst[6], const uint8_t* data, size_t len) override {
+    return esp_now_send(dst, data, len) == ESP_OK;
+  }
+  bool setChannel(uint8_t ch) override {
+    return esp_wifi_set_channel(ch, WIFI_SECOND_CHAN_NONE) == ESP_OK;
+  }
+  bool canHop() override {
+    // Moving the AP channel would drop a phone that is using the portal.
+    return inAP && WiFi.softAPgetStationNum() == 0 && provJob.state != PROV_CONNECTING;
+  }
+  void random(uint8_t* out, size_t len) override { esp_fill_random(out, len); }
+};
+
+EspNowRadio   relayRadio;
+CredRelay     relay(relayRadio);
+QueueHandle_t relayRxQ = nullptr;
+bool          relayUp = false;
+uint8_t       relayHops = RELAY_HOPS;   // hops to hand out when we become a donor
+
+void relayEnqueue(const uint8_t* mac, const uint8_t* data, int len) {
+  if (!relayRxQ || len <= 0 || len > RELAY_FRAME_MAX) return;
+  RelayRxItem it;
+  memcpy(it.mac, mac, 6);
+  it.len = len;
+  memcpy(it.data, data, len);
+  xQueueSend(relayRxQ, &it, 0);          // WiFi task: never block
+}
+
+bool relayLoadKey() {
+  uint8_t key[RELAY_KEY_LEN] = {0};
+  prefs.begin("relay", true);
+  prefs.getBytes("psk", key, sizeof(key));
+  prefs.end();
+  relay.setKey(key);
+  memset(key, 0, sizeof(key));
+  return relay.hasKey();
+}
+
+// (Re)bind ESP-NOW to whichever interface is up; the broadcast peer must
+// name the AP interface in captive mode and the STA interface afterwards.
+bool relayAttach() {
+  if (!relayUp) {
+    if (esp_now_init() != ESP_OK) { LOGE("ESP-NOW init failed"); return false; }
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+    esp_now_register_recv_cb([](const esp_now_recv_info_t* info, const uint8_t* data, int len) {
+      relayEnqueue(info->src_addr, data, len);
+    });
+#else
+    esp_now_register_recv_cb([](const uint8_t* mac, const uint8_t* data, int len) {
+      relayEnqueue(mac, data, len);
+    });
+#endif
+    if (!relayRxQ) relayRxQ = xQueueCreate(8, sizeof(RelayRxItem));
+    relayUp = true;
+  }
+  esp_now_peer_info_t peer = {};
+  memset(peer.peer_addr, 0xFF, 6);
+  peer.channel = 0;                       // follow the interface's current channel
+  peer.ifidx = inAP ? WIFI_IF_AP : WIFI_IF_STA;
+  peer.encrypt = false;                   // broadcast; payload is CCM-sealed by CredRelay
+  esp_err_t err = esp_now_is_peer_exist(peer.peer_addr) ? esp_now_mod_peer(&peer) : esp_now_add_peer(&peer);
+  if (err != ESP_OK) { LOGE("ESP-NOW peer setup failed: %d", (int)err); return false; }
+  return true;
+}
+
+void relayOnCreds(const RelayCreds& c, void*) {
+  LOGI("Relay: received credentials for SSID='%s' (hops=%u)", c.ssid, c.hops);
+  prefs.begin("net", false);
+  prefs.clear();                          // static IP/hostname are per-unit; don't inherit
+  prefs.putString("ssid", c.ssid);
+  prefs.putString("pass", c.pass);
+  prefs.end();
+  relayHops = c.hops;
+  wantReconnect = true;
+}
+
+void relayStartRequester() {
+  if (!relayLoadKey()) { LOGD("Relay: no fleet key; not listening"); return; }
+  if (!relayAttach()) return;
+  relay.startRequester(millis(), relayOnCreds, nullptr);
+  LOGI("Relay: listening for credential offers (channel hopping while portal idle)");
+}
+
+// Called once we have left captive mode with working credentials.
+void relayStartDonor() {
+  if (relay.role() == RELAY_REQUESTER) relay.stop();
+  if (!relayHops || !relayLoadKey()) return;
+  RelayCreds c = {};
+  prefs.begin("net", true);
+  strlcpy(c.ssid, prefs.getString("ssid", "").c_str(), sizeof(c.ssid));
+  strlcpy(c.pass, prefs.getString("pass", "").c_str(), sizeof(c.pass));
+  prefs.end();
+  c.hops = relayHops - 1;
+  if (!relayAttach()) return;
+  if (relay.startDonor(c, millis(), RELAY_WINDOW_MS)) {
+    WiFi.setSleep(false);                 // modem sleep would miss ACKs
+    LOGI("Relay: offering credentials for %lu s on channel %d", RELAY_WINDOW_MS / 1000, WiFi.channel());
+  }
+  memset(&c, 0, sizeof(c));
+}
+
+void relayLoop() {
+  if (relay.role() == RELAY_IDLE) return;
+  RelayRxItem it;
+  while (relayRxQ && xQueueReceive(relayRxQ, &it, 0) == pdTRUE) {
+    uint32_t before = relay.stats().unitsAcked;
+    relay.onFrame(it.mac, it.data, it.len, millis());
+    if (relay.stats().unitsAcked != before) LOGI("Relay: unit " MACSTR " acknowledged (%u total)", MAC2STR(it.mac), relay.stats().unitsAcked);
+  }
+  RelayRole was = relay.role();
+  relay.tick(millis());
+  if (was == RELAY_DONOR && relay.role() == RELAY_IDLE) {
+    WiFi.setSleep(true);
+    LOGI("Relay: window closed; %u unit(s) provisioned", relay.stats().unitsAcked);
+  }
+}
+
+bool relayDonating() { return relay.role() == RELAY_DONOR; }
+
+void relayPrintStatus() {
+  const RelayStats& s = relay.stats();
+  LOGI("Relay: role=%s key=%s chan=%u", relay.role()==RELAY_DONOR ? "donor" : relay.role()==RELAY_REQUESTER ? "requester" : "idle",
+       relayLoadKey() ? "set" : "unset", relay.channel());
+  LOGI("Relay: offers sent=%u recv=%u bad=%u  acks sent=%u recv=%u bad=%u  units=%u  hops=%u",
+       s.offersSent, s.offersRecv, s.offersBad, s.acksSent, s.acksRecv, s.acksBad, s.unitsAcked, s.channelHops);
+}
+
+// relay-key <32 hex chars>: fleet pre-shared key, same on every unit.
+void relaySetKey(const String& hex) {
+  uint8_t key[RELAY_KEY_LEN];
+  if (hex.length() != RELAY_KEY_LEN * 2) { Serial.println("relay-key needs 32 hex chars"); return; }
+  for (int i = 0; i < RELAY_KEY_LEN; i++) {
+    char b[3] = { hex[2*i], hex[2*i+1], 0 };
+    char* end;
+    key[i] = (uint8_t)strtoul(b, &end, 16);
+    if (*end) { Serial.println("relay-key: not hex"); return; }
+  }
+  prefs.begin("relay", false);
+  prefs.putBytes("psk", key, sizeof(key));
+  prefs.end();
+  memset(key, 0, sizeof(key));
+  LOGI("Relay: fleet key stored");
+}
+
+void relayCommand(const String& cmd) {
+  if (cmd == "relay") {
+    relayPrintStatus();
+  } else if (cmd == "relay start") {
+    if (inAP || WiFi.status() != WL_CONNECTED) { Serial.println("relay start needs an STA connection"); return; }
+    relayHops = RELAY_HOPS;
+    relayStartDonor();
+  } else if (cmd == "relay stop") {
+    relay.stop();
+    LOGI("Relay stopped");
+  } else if (cmd.startsWith("relay-key ")) {
+    relaySetKey(cmd.substring(10));
+  } else {
+    Serial.printf("Unknown command: '%s' (type 'help')\n", cmd.c_str());
+  }
+}
@@ -0,0 +1,125 @@
+// ----------- JWT bearer auth (HS256) -----------
+// With a secret set ('jwt key <secret>', Preferences "jwt"), the /api,
+// /stream and /clip routes and the /update uploads need an HS256 token,
+// sent either as "Authorization: Bearer <token>" or as ?access_token=<token>
+// (for <audio src> and other clients that cannot set headers). The portal
+// pages stay open, so a browser can still provision the unit. With no secret
+// set, every route is open as before.
+//
+// src/jwt.h keeps the HMAC pad states and a table of recently verified
+// tokens. An app repeating one token then costs one table lookup per
+// request instead of the SHA-256 work. exp/nbf are checked against SNTP time;
+// until the clock is set, only tokens without them are accepted.
+
+struct JwtTiming {
+  uint32_t requests;
+  uint64_t sumUs;
+  uint32_t maxUs;
+};
+
+JwtVerifier jwtAuth;
+JwtTiming   jwtTiming = {};
+
+uint32_t jwtNow() {
+  time_t t = time(nullptr);
+  return t > 1600000000 ? (uint32_t)t : 0;    // before 2020: not synced yet
+}
+
+void jwtBegin() {
+  uint8_t key[JWT_KEY_MAX];
+  prefs.begin("jwt", true);
+  size_t n = prefs.getBytesLength("key");
+  if (n && n <= sizeof(key)) n = prefs.getBytes("key", key, n);
+  else n = 0;
+  prefs.end();
+  memset(&jwtTiming, 0, sizeof(jwtTiming));
+  if (!n) { jwtAuth.end(); return; }
+  jwtAuth.begin(key, n);
+  memset(key, 0, sizeof(key));
+  configTime(0, 0, JWT_NTP_SERVER);
+  LOGI("JWT: bearer tokens required on API, stream and upload routes");
+}
+
+// For tabs before this one, which cannot see jwtAuth.
+bool jwtActive() { return jwtAuth.active(); }
+
+// Call first in a protected handler; on false the 401 has been sent.
+bool jwtAuthorize() {
+  if (!jwtAuth.active()) return true;
+  String tok = server.header("Authorization");
+  if (tok.length() > 7 && tok.substring(0, 7).equalsIgnoreCase("Bearer ")) tok = tok.substring(7);
+  else tok = server.arg("access_token");
+  tok.trim();
+
+  int64_t t0 = esp_timer_get_time();
+  JwtResult r = jwtAuth.verify(tok.c_str(), tok.length(), jwtNow());
+  uint32_t us = (uint32_t)(esp_timer_get_time() - t0);
+  jwtTiming.requests++;
+  jwtTiming.sumUs += us;
+  if (us > jwtTiming.maxUs) jwtTiming.maxUs = us;
+  if (r == JWT_OK) return true;
+
+  LOGD("JWT: %s %s rejected: %s", server.method() == HTTP_GET ? "GET" : "POST", server.uri().c_str(),
+       tok.length() ? jwtResultName(r) : "no token");
+  server.sendHeader("WWW-Authenticate", tok.length() ? "Bearer error=\"invalid_token\"" : "Bearer");
+  server.send(401, "application/json",
+              String("{\"error\":\"") + (tok.length() ? jwtResultName(r) : "token required") + "\"}");
+  return false;
+}
+
+String jwtStatsLine() {
+  if (!jwtAuth.active()) return "JWT: off (routes open)";
+  const JwtStats& s = jwtAuth.stats();
+  char b[200];
+  snprintf(b, sizeof(b), "JWT: verified=%lu cached=%lu rejected=%lu (sig=%lu exp=%lu) avg=%luus max=%luus slots=%u/%d clock=%s",
+           (unsigned long)s.verified, (unsigned long)s.cacheHits, (unsigned long)s.rejected,
+           (unsigned long)s.badSig, (unsigned long)s.expired,
+           (unsigned long)(jwtTiming.requests ? jwtTiming.sumUs / jwtTiming.requests : 0),
+           (unsigned long)jwtTiming.maxUs, jwtAuth.cached(), JWT_CACHE_SLOTS, jwtNow() ? "set" : "unset");
+  return String(b);
+}
+
+// jwt | jwt key <secret> | jwt off | jwt token [sub] [ttl_s]
+void jwtCommand(const String& cmd) {
+  String arg = cmd.length() > 3 ? cmd.substring(4) : "";
+  arg.trim();
+  if (!arg.length()) { LOGI("%s", jwtStatsLine().c_str()); return; }
+  if (arg.startsWith("key ")) {
+    String secret = arg.substring(4);
+    secret.trim();
+    if (secret.length() < JWT_SECRET_MIN || secret.length() > JWT_KEY_MAX) {
+      Serial.printf("jwt: secret must be %d-%d characters\n", JWT_SECRET_MIN, JWT_KEY_MAX);
+      return;
+    }
+    prefs.begin("jwt", false);
+    prefs.putBytes("key", secret.c_str(), secret.length());
+    prefs.end();
+    jwtBegin();
+  } else if (arg == "off") {
+    prefs.begin("jwt", false);
+    prefs.remove("key");
+    prefs.end();
+    jwtBegin();
+    LOGI("JWT: off, API, stream and upload routes are open");
+  } else if (arg == "token" || arg.startsWith("token ")) {
+    if (!jwtAuth.active()) { Serial.println("jwt: set a key first"); return; }
+    String rest = arg.substring(5);
+    rest.trim();
+    int sp = rest.indexOf(' ');
+    String sub = sp < 0 ? rest : rest.substring(0, sp);
+    long ttl = sp < 0 ? JWT_TOKEN_TTL_S : rest.substring(sp + 1).toInt();
+    if (!sub.length()) sub = "console";
+    char claims[128], tok[JWT_MAX_LEN + 1];
+    uint32_t now = jwtNow();
+    if (now && ttl > 0) {
+      snprintf(claims, sizeof(claims), "{\"sub\":\"%s\",\"iat\":%lu,\"exp\":%lu}", sub.c_str(),
+               (unsigned long)now, (unsigned long)(now + ttl));
+    } else {
+      snprintf(claims, sizeof(claims), "{\"sub\":\"%s\"}", sub.c_str());
+      if (ttl > 0) Serial.println("jwt: clock not set, token has no expiry");
+    }
+    if (jwtAuth.sign(claims, tok, sizeof(tok))) Serial.println(tok);
+  } else {
+    Serial.println("jwt: jwt [key <secret>|off|token [sub] [ttl_s]]");
+  }
+}
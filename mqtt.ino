@@ -0,0 +1,199 @@
+// ----------- MQTT events and telemetry (STA mode) -----------
+// Publishes sound events and periodic telemetry to the broker set with
+// 'mqtt <host> [port] [user pass]' (Preferences "mqtt"), through
+// src/mqtt.h on its own task on core 0. Events are batched for up to
+// MQTT_EVENT_BATCH_MS and go out at QoS 1 on <prefix>/events; telemetry
+// samples every MQTT_TELEMETRY_MS are batched for MQTT_TELEMETRY_BATCH_MS
+// and go out at QoS 0 on <prefix>/telemetry. <prefix>/status is a
+// retained "online"/"offline" (the last will). Prefix is aniviza/<mac>.
+//
+// While the broker is unreachable, batches wait in a MQTT_QUEUE_BYTES
+// queue (oldest dropped first). Reconnects back off from
+// MQTT_BACKOFF_MIN_MS to MQTT_BACKOFF_MAX_MS. Producers (loop context)
+// only take the queue mutex, never wait on the network.
+
+class WifiMqttTransport : public MqttTransport {
+public:
+  bool open(const char* host, uint16_t port, uint32_t timeoutMs) override {
+    if (!_c.connect(host, port, (int32_t)timeoutMs)) return false;
+    _c.setNoDelay(true);
+    return true;
+  }
+  void close() override { _c.stop(); }
+  bool write(const uint8_t* p, size_t n) override { return _c.write(p, n) == n; }
+  int read(uint8_t* p, size_t n, uint32_t timeoutMs) override {
+    uint32_t t0 = millis();
+    for (;;) {
+      int a = _c.available();
+      if (a > 0) return _c.read(p, n < (size_t)a ? n : (size_t)a);
+      if (!_c.connected()) return -1;
+      if (millis() - t0 >= timeoutMs) return 0;
+      vTaskDelay(pdMS_TO_TICKS(5));
+    }
+  }
+
+private:
+  WiFiClient _c;
+};
+
+// The mutex is created once by mqttBegin(), before any producer or the
+// task can reach the client; until then there is nobody to lock against.
+class RtosMqttLock : public MqttLock {
+public:
+  bool begin() {
+    if (!_m) _m = xSemaphoreCreateMutex();
+    return _m != nullptr;
+  }
+  void lock() override { if (_m) xSemaphoreTake(_m, portMAX_DELAY); }
+  void unlock() override { if (_m) xSemaphoreGive(_m); }
+
+private:
+  SemaphoreHandle_t _m = nullptr;
+};
+
+WifiMqttTransport mqttNet;
+RtosMqttLock      mqttLock;
+MqttClient        mqttClient(mqttNet, &mqttLock);
+TaskHandle_t      mqttTaskHandle = nullptr;
+volatile bool     mqttStopReq = false;
+bool              mqttRestartReq = false;   // mqttBegin() while the old task was still stopping
+String            mqttHost, mqttUser, mqttPass, mqttPrefix, mqttId;
+uint16_t          mqttPort = MQTT_DEFAULT_PORT;
+uint32_t          mqttTelemetryMs = 0;
+
+void mqttTelemetry(uint32_t now) {
+  char j[160];
+  snprintf(j, sizeof(j), "{\"up\":%lu,\"heap\":%lu,\"heap_min\":%lu,\"rssi\":%d,\"db\":%.1f,\"snd\":%lu,\"clips\":%lu}",
+           (unsigned long)(now / 1000), (unsigned long)ESP.getFreeHeap(), (unsigned long)ESP.getMinFreeHeap(),
+           WiFi.RSSI(), audioStats.rmsDb, (unsigned long)sensorEvents(), (unsigned long)clipRing.clips());
+  mqttClient.add(MQTT_TELEMETRY, j, now);
+}
+
+void mqttTask(void*) {
+  mqttTelemetryMs = millis();
+  while (!mqttStopReq) {
+    uint32_t now = millis();
+    if (now - mqttTelemetryMs >= MQTT_TELEMETRY_MS) {
+      mqttTelemetryMs = now;
+      mqttTelemetry(now);
+    }
+    uint32_t wait = mqttClient.step(now);
+    uint32_t tele = MQTT_TELEMETRY_MS - (millis() - mqttTelemetryMs);
+    if (tele < wait) wait = tele;
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait ? wait : 1));
+  }
+  mqttClient.end();                      // retained "offline", then DISCONNECT
+  LOGI("MQTT: stopped");
+  mqttTaskHandle = nullptr;
+  vTaskDelete(nullptr);
+}
+
+// A sound/clip event as a JSON object; batched, so cheap to call often.
+void mqttEvent(const char* json) {
+  if (mqttTaskHandle) mqttClient.add(MQTT_EVENTS, json, millis());
+}
+
+void mqttBegin() {
+#if MQTT_ENABLE
+  if (mqttTaskHandle) {
+    if (mqttStopReq) mqttRestartReq = true;   // mqttLoop() starts again once it is gone
+    return;
+  }
+  prefs.begin("mqtt", true);
+  mqttHost = prefs.getString("host", "");
+  mqttPort = prefs.getUShort("port", MQTT_DEFAULT_PORT);
+  mqttUser = prefs.getString("user", "");
+  mqttPass = prefs.getString("pass", "");
+  prefs.end();
+  if (!mqttHost.length()) return;
+  char mac[13];
+  uint64_t m = ESP.getEfuseMac();
+  snprintf(mac, sizeof(mac), "%02x%02x%02x%02x%02x%02x", (uint8_t)m, (uint8_t)(m >> 8), (uint8_t)(m >> 16),
+           (uint8_t)(m >> 24), (uint8_t)(m >> 32), (uint8_t)(m >> 40));
+  mqttPrefix = String("aniviza/") + mac;
+  mqttId = String("aniviza-") + mac;
+
+  MqttConfig c = {};
+  c.host = mqttHost.c_str();
+  c.port = mqttPort;
+  c.clientId = mqttId.c_str();
+  c.user = mqttUser.c_str();
+  c.pass = mqttPass.c_str();
+  c.prefix = mqttPrefix.c_str();
+  c.keepaliveS = MQTT_KEEPALIVE_S;
+  c.connectTimeoutMs = MQTT_TIMEOUT_MS;
+  c.ackTimeoutMs = MQTT_TIMEOUT_MS;
+  c.backoffMinMs = MQTT_BACKOFF_MIN_MS;
+  c.backoffMaxMs = MQTT_BACKOFF_MAX_MS;
+  const MqttBatchConfig batch[MQTT_STREAMS] = {
+    { MQTT_BATCH_BYTES, MQTT_EVENT_BATCH_MS, 1 },
+    { MQTT_BATCH_BYTES, MQTT_TELEMETRY_BATCH_MS, 0 },
+  };
+  if (!mqttLock.begin() || !mqttClient.begin(c, batch, MQTT_QUEUE_BYTES)) { LOGE("MQTT: setup failed"); return; }
+  mqttStopReq = false;
+  xTaskCreatePinnedToCore(mqttTask, "mqtt", 4096, nullptr, 1, &mqttTaskHandle, 0);
+  LOGI("MQTT: %s:%u as %s, topics %s/{events,telemetry,status}, %u bytes", mqttHost.c_str(), mqttPort,
+       mqttId.c_str(), mqttPrefix.c_str(), (unsigned)mqttClient.memoryBytes());
+#endif
+}
+
+// Asks the task to stop and returns at once. The task may be inside a
+// connect or waiting for a PUBACK (up to MQTT_TIMEOUT_MS each); it sends
+// "offline" and DISCONNECT and deletes itself when it gets there.
+void mqttStop() {
+  mqttRestartReq = false;
+  TaskHandle_t t = mqttTaskHandle;
+  if (!t || mqttStopReq) return;
+  mqttStopReq = true;
+  xTaskNotifyGive(t);
+  LOGI("MQTT: stopping");
+}
+
+// Called from loop(): a start requested while the old task was stopping.
+void mqttLoop() {
+  if (mqttRestartReq && !mqttTaskHandle) {
+    mqttRestartReq = false;
+    mqttBegin();
+  }
+}
+
+String mqttStatsLine() {
+  if (!mqttClient.started()) return "MQTT: off";
+  MqttStats s = mqttClient.stats();
+  char b[260];
+  snprintf(b, sizeof(b), "MQTT: %s:%u %s items=%lu publishes=%lu (%.1f/pub) dropped=%lu queue=%lu/%lu hi=%lu"
+           " connects=%lu fails=%lu backoff=%lums mem=%u",
+           mqttHost.c_str(), mqttPort, mqttClient.connected() ? "up" : "DOWN", (unsigned long)s.items,
+           (unsigned long)s.published, s.published ? (float)s.publishedItems / s.published : 0.0f,
+           (unsigned long)s.droppedItems, (unsigned long)s.queueBytes, (unsigned long)s.queueCap,
+           (unsigned long)s.queueHigh, (unsigned long)s.connects, (unsigned long)s.connectFails,
+           (unsigned long)s.lastBackoffMs, (unsigned)mqttClient.memoryBytes());
+  return String(b);
+}
+
+// mqtt | mqtt <host> [port] [user pass] | mqtt off
+void mqttCommand(const String& cmd) {
+  String arg = cmd.length() > 4 ? cmd.substring(5) : "";
+  arg.trim();
+  if (!arg.length()) { LOGI("%s", mqttStatsLine().c_str()); return; }
+  mqttStop();
+  prefs.begin("mqtt", false);
+  if (arg == "off") {
+    prefs.remove("host");
+  } else {
+    String f[4];
+    int n = 0;
+    while (arg.length() && n < 4) {
+      int sp = arg.indexOf(' ');
+      f[n++] = sp < 0 ? arg : arg.substring(0, sp);
+      arg = sp < 0 ? "" : arg.substring(sp + 1);
+      arg.trim();
+    }
+    prefs.putString("host", f[0]);
+    prefs.putUShort("port", f[1].length() ? (uint16_t)f[1].toInt() : MQTT_DEFAULT_PORT);
+    prefs.putString("user", f[2]);
+    prefs.putString("pass", f[3]);
+  }
+  prefs.end();
+  if (!inAP && WiFi.status() == WL_CONNECTED) mqttBegin();
+}
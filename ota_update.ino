@@ -0,0 +1,301 @@
+// ----------- Streaming OTA (/update) -----------
+// PUT the raw image (application/octet-stream). WebServer hands the body
+// over in HTTP_RAW_BUFLEN (one TCP MSS) pieces which go straight into the
+// inactive OTA partition while SHA-256 is updated incrementally; nothing
+// bigger than one piece is ever buffered.
+//
+// Resume: send "Content-Range: bytes <start>-<end>/<total>". The session
+// (OTA handle + hash state) survives a dropped connection, so a retry that
+// starts at GET /update/status's "offset" continues where it stopped.
+// Once all bytes are in, the partition is read back and hashed, checked
+// against X-Image-SHA256 if given, validated by esp_ota_end(), and only
+// then made the boot partition.
+//
+// PUT /update/delta takes an ADLT patch (tools/mkdelta.py) instead of a
+// full image. It is applied on the fly against the running partition with
+// the same session, resume and verification path; "offset"/"total" then
+// count patch bytes.
+//
+// With a JWT secret set, the upload routes need a token like the API does;
+// the page forwards ?access_token= from its own URL.
+
+#define OTA_SESSION_IDLE_MS (10UL * 60 * 1000)   // abandon an incomplete upload
+
+enum OtaState : uint8_t { OTA_IDLE, OTA_RECEIVING, OTA_VERIFYING, OTA_DONE, OTA_FAILED };
+
+struct OtaSession {
+  OtaState               state = OTA_IDLE;
+  const esp_partition_t* part = nullptr;
+  esp_ota_handle_t       handle = 0;
+  bool                   delta = false;
+  size_t                 offset = 0, total = 0;   // request-body bytes
+  size_t                 written = 0;             // image bytes in flash
+  mbedtls_sha256_context sha;
+  uint8_t                digest[32];
+  uint8_t                expect[32];
+  bool                   haveExpect = false;
+  uint32_t               tLast = 0, t0 = 0;
+  // Per-request outcome, consumed by the completion handler.
+  int                    reqStatus = 0;
+  String                 err;
+};
+
+OtaSession   ota;
+DeltaPatcher otaPatch;
+uint32_t     otaRebootAt = 0;
+
+const char PROGMEM HTML_UPDATE[] = R"HTML(
+<!doctype html><html><head><meta name=viewport content="width=device-width,initial-scale=1">
+<title>Firmware Update</title>
+<style>body{font-family:system-ui,Arial;margin:24px;max-width:560px}input,button{font-size:16px;margin:6px 0;width:100%}</style>
+</head><body><h2>Firmware Update</h2>
+<input type=file id=f accept=".bin"><button onclick="go()">Upload</button>
+<p id=s></p><p><a href="/">Back</a></p>
+<script>
+  const C=65536,s=t=>document.getElementById('s').textContent=t;
+  const q=location.search;   // carries ?access_token= when JWT auth is on
+  async function st(){return (await fetch('/update/status')).json()}
+  async function go(){
+    const f=document.getElementById('f').files[0]; if(!f) return;
+    let o=0,tries=0; const j=await st(); if(j.state=='receiving'&&j.total==f.size) o=j.offset;
+    while(o<f.size){
+      const e=Math.min(o+C,f.size);
+      try{
+        const r=await fetch('/update'+q,{method:'PUT',headers:{'Content-Type':'application/octet-stream',
+          'Content-Range':'bytes '+o+'-'+(e-1)+'/'+f.size},body:f.slice(o,e)});
+        const k=await r.json(); if(r.status>=400&&r.status!=416) return s('Error: '+k.error);
+        o=k.offset; tries=0; s('Uploaded '+Math.floor(100*o/f.size)+'%');
+      }catch(x){ if(++tries>5) return s('Connection lost'); await new Promise(r=>setTimeout(r,1000)); o=(await st()).offset; }
+    }
+    s('Verified, rebooting...');
+  }
+</script></body></html>
+)HTML";
+
+bool otaParseHex32(const String& hex, uint8_t out[32]) {
+  if (hex.length() != 64) return false;
+  for (int i = 0; i < 32; i++) {
+    char b[3] = { hex[2*i], hex[2*i+1], 0 };
+    char* end;
+    out[i] = (uint8_t)strtoul(b, &end, 16);
+    if (*end) return false;
+  }
+  return true;
+}
+
+String otaHex(const uint8_t* d, size_t n) {
+  String h;
+  char b[3];
+  for (size_t i = 0; i < n; i++) { snprintf(b, sizeof(b), "%02x", d[i]); h += b; }
+  return h;
+}
+
+const char* otaStateName() {
+  switch (ota.state) {
+    case OTA_RECEIVING: return "receiving";
+    case OTA_VERIFYING: return "verifying";
+    case OTA_DONE:      return "done";
+    case OTA_FAILED:    return "failed";
+    default:            return "idle";
+  }
+}
+
+String otaStatusJSON() {
+  // "offset" is where the next chunk must start; a failed session restarts at 0.
+  size_t next = (ota.state == OTA_RECEIVING || ota.state == OTA_DONE) ? ota.offset : 0;
+  String j = "{\"state\":\"" + String(otaStateName()) + "\",\"offset\":" + String((uint32_t)next) +
+             ",\"total\":" + String((uint32_t)ota.total);
+  if (ota.part) j += ",\"partition\":\"" + String(ota.part->label) + "\"";
+  if (ota.delta) j += ",\"delta\":true,\"written\":" + String((uint32_t)ota.written);
+  if (ota.state == OTA_DONE) j += ",\"sha256\":\"" + otaHex(ota.digest, 32) + "\"";
+  if (ota.err.length()) j += ",\"error\":\"" + jsonEscape(ota.err) + "\"";
+  j += "}";
+  return j;
+}
+
+void otaAbort(const char* why) {
+  if (ota.state == OTA_RECEIVING || ota.state == OTA_VERIFYING) esp_ota_abort(ota.handle);
+  mbedtls_sha256_free(&ota.sha);
+  ota.state = OTA_FAILED;
+  ota.err = why;
+  LOGW("OTA aborted at %u/%u: %s", (unsigned)ota.offset, (unsigned)ota.total, why);
+}
+
+bool otaWriteImage(const uint8_t* buf, size_t len) {
+  if (ota.written + len > ota.part->size || esp_ota_write(ota.handle, buf, len) != ESP_OK) return false;
+  mbedtls_sha256_update(&ota.sha, buf, len);
+  ota.written += len;
+  return true;
+}
+
+// DeltaPatcher callbacks: source is the running image, sink is the OTA slot.
+bool otaDeltaRead(void*, uint32_t off, uint8_t* buf, size_t len) {
+  return esp_partition_read(esp_ota_get_running_partition(), off, buf, len) == ESP_OK;
+}
+
+bool otaDeltaWrite(void*, const uint8_t* buf, size_t len) { return otaWriteImage(buf, len); }
+
+// A patch only makes sense against the exact image it was built from.
+bool otaDeltaCheck(void*, const DeltaHeader& h) {
+  const esp_partition_t* run = esp_ota_get_running_partition();
+  if (h.srcSize > run->size || h.dstSize > ota.part->size) { ota.err = "patch sizes exceed partitions"; return false; }
+  mbedtls_sha256_context c;
+  mbedtls_sha256_init(&c);
+  mbedtls_sha256_starts(&c, 0);
+  uint8_t buf[512], d[32];
+  bool ok = true;
+  for (uint32_t off = 0; ok && off < h.srcSize; off += sizeof(buf)) {
+    size_t n = min((uint32_t)sizeof(buf), h.srcSize - off);
+    ok = esp_partition_read(run, off, buf, n) == ESP_OK;
+    if (ok) mbedtls_sha256_update(&c, buf, n);
+  }
+  mbedtls_sha256_finish(&c, d);
+  mbedtls_sha256_free(&c);
+  if (!ok || memcmp(d, h.srcSha, 32) != 0) { ota.err = "patch was built for a different base image"; return false; }
+  memcpy(ota.expect, h.dstSha, 32);           // the result hash is always known for a delta
+  ota.haveExpect = true;
+  LOGI("OTA delta: base image matches; rebuilding %u bytes", (unsigned)h.dstSize);
+  return true;
+}
+
+bool otaBegin(size_t total, bool delta) {
+  if (ota.state == OTA_RECEIVING) otaAbort("restarted");
+  ota = OtaSession();
+  ota.delta = delta;
+  ota.part = esp_ota_get_next_update_partition(nullptr);
+  if (!ota.part) { ota.state = OTA_FAILED; ota.err = "no OTA partition"; return false; }
+  if (!delta && total > ota.part->size) { ota.state = OTA_FAILED; ota.err = "image larger than partition"; return false; }
+#ifdef OTA_WITH_SEQUENTIAL_WRITES
+  esp_err_t err = esp_ota_begin(ota.part, OTA_WITH_SEQUENTIAL_WRITES, &ota.handle);  // erase as we go
+#else
+  // A patch's size says nothing about the image it builds: erase it all.
+  esp_err_t err = esp_ota_begin(ota.part, delta ? OTA_SIZE_UNKNOWN : total, &ota.handle);
+#endif
+  if (err != ESP_OK) { ota.state = OTA_FAILED; ota.err = "esp_ota_begin failed"; return false; }
+  mbedtls_sha256_init(&ota.sha);
+  mbedtls_sha256_starts(&ota.sha, 0);
+  ota.total = total;
+  ota.state = OTA_RECEIVING;
+  ota.t0 = ota.tLast = millis();
+  ota.haveExpect = !delta && otaParseHex32(server.header("X-Image-SHA256"), ota.expect);
+  if (delta) otaPatch.begin(otaDeltaRead, otaDeltaWrite, otaDeltaCheck, nullptr);
+  LOGI("OTA begin: %u %s bytes -> partition '%s' @0x%x%s", (unsigned)total, delta ? "patch" : "image",
+       ota.part->label, (unsigned)ota.part->address, ota.haveExpect ? " (sha256 given)" : "");
+  return true;
+}
+
+// Read the written image back from flash and hash it, so a bad flash write
+// can't slip through on the strength of the streamed hash alone.
+void otaFinish() {
+  if (ota.delta && !otaPatch.done()) { otaAbort("patch ended early"); return; }
+  ota.state = OTA_VERIFYING;
+  mbedtls_sha256_finish(&ota.sha, ota.digest);
+  mbedtls_sha256_free(&ota.sha);
+
+  esp_err_t err = esp_ota_end(ota.handle);       // validates image header/checksum
+  if (err != ESP_OK) { ota.state = OTA_FAILED; ota.err = String("image invalid: ") + esp_err_to_name(err); LOGW("OTA %s", ota.err.c_str()); return; }
+
+  mbedtls_sha256_context rb;
+  mbedtls_sha256_init(&rb);
+  mbedtls_sha256_starts(&rb, 0);
+  uint8_t buf[512];
+  for (size_t off = 0; off < ota.written; off += sizeof(buf)) {
+    size_t n = min(sizeof(buf), ota.written - off);
+    if (esp_partition_read(ota.part, off, buf, n) != ESP_OK) { mbedtls_sha256_free(&rb); ota.state = OTA_FAILED; ota.err = "readback failed"; return; }
+    mbedtls_sha256_update(&rb, buf, n);
+  }
+  uint8_t back[32];
+  mbedtls_sha256_finish(&rb, back);
+  mbedtls_sha256_free(&rb);
+
+  if (memcmp(back, ota.digest, 32) != 0) { ota.state = OTA_FAILED; ota.err = "readback hash mismatch"; LOGW("OTA %s", ota.err.c_str()); return; }
+  if (ota.haveExpect && memcmp(ota.expect, ota.digest, 32) != 0) { ota.state = OTA_FAILED; ota.err = "sha256 mismatch"; LOGW("OTA %s", ota.err.c_str()); return; }
+  if (esp_ota_set_boot_partition(ota.part) != ESP_OK) { ota.state = OTA_FAILED; ota.err = "set boot partition failed"; return; }
+
+  ota.state = OTA_DONE;
+  otaRebootAt = millis() + 1500;                 // let the response go out first
+  LOGI("OTA complete: %u bytes in %lums, sha256=%s; rebooting into '%s'", (unsigned)ota.written,
+       millis() - ota.t0, otaHex(ota.digest, 32).c_str(), ota.part->label);
+}
+
+// Parses "bytes a-b/total"; without the header the body is the whole image.
+bool otaParseRange(size_t& start, size_t& total) {
+  String cr = server.header("Content-Range");
+  if (!cr.length()) {
+    start = 0;
+    total = (size_t)server.header("Content-Length").toInt();
+    return total > 0;
+  }
+  unsigned long a, b, t;
+  if (sscanf(cr.c_str(), "bytes %lu-%lu/%lu", &a, &b, &t) != 3 || b < a || b >= t) return false;
+  start = a; total = t;
+  return true;
+}
+
+void otaRaw(bool delta) {
+  HTTPRaw& raw = server.raw();
+  if (raw.status == RAW_START) {
+    ota.reqStatus = 0;
+    if (!jwtAuthorize()) { ota.reqStatus = 401; return; }   // 401 sent; body is drained and dropped
+    size_t start, total;
+    if (!otaParseRange(start, total)) { ota.reqStatus = 400; ota.err = "bad Content-Range"; return; }
+    if (start == 0 && !(ota.state == OTA_RECEIVING && ota.offset == 0 && ota.total == total && ota.delta == delta)) {
+      if (!otaBegin(total, delta)) { ota.reqStatus = 500; return; }
+    } else if (ota.state != OTA_RECEIVING || start != ota.offset || total != ota.total || ota.delta != delta) {
+      ota.reqStatus = 416;                      // client must re-sync from /update/status
+      return;
+    }
+    ota.err = "";
+    LOGD("OTA chunk @%u", (unsigned)start);
+  } else if (raw.status == RAW_WRITE) {
+    if (ota.reqStatus || ota.state != OTA_RECEIVING) return;
+    if (ota.offset + raw.currentSize > ota.total) { ota.reqStatus = 400; otaAbort("more data than declared"); return; }
+    if (ota.delta) {
+      DeltaResult r = otaPatch.feed(raw.buf, raw.currentSize);
+      if (r != DELTA_OK && r != DELTA_DONE) {
+        ota.reqStatus = r == DELTA_ERR_SOURCE ? 409 : r == DELTA_ERR_FORMAT ? 400 : 500;
+        String why = ota.err.length() ? ota.err : String(r == DELTA_ERR_FORMAT ? "malformed patch" : "patch apply failed");
+        otaAbort(why.c_str());
+        return;
+      }
+    } else if (!otaWriteImage(raw.buf, raw.currentSize)) {
+      ota.reqStatus = 500; otaAbort("flash write failed"); return;
+    }
+    ota.offset += raw.currentSize;
+    ota.tLast = millis();
+  } else if (raw.status == RAW_END) {
+    if (!ota.reqStatus && ota.state == OTA_RECEIVING && ota.offset == ota.total) otaFinish();
+  } else if (raw.status == RAW_ABORTED) {
+    LOGW("OTA connection dropped at %u/%u; resumable", (unsigned)ota.offset, (unsigned)ota.total);
+  }
+}
+
+void otaDone() {
+  int code = ota.reqStatus;
+  if (code == 401) return;                      // answered by jwtAuthorize()
+  if (!code) {
+    if (ota.state == OTA_DONE) code = 200;
+    else if (ota.state == OTA_RECEIVING) {
+      code = 202;                               // chunk stored; more expected
+      if (ota.offset) server.sendHeader("Range", "bytes=0-" + String((uint32_t)ota.offset - 1));
+    } else code = 500;
+  }
+  server.send(code, "application/json", otaStatusJSON());
+}
+
+void otaBindRoutes() {
+  server.on("/update", HTTP_GET, [](){ server.send_P(200, "text/html", HTML_UPDATE); });
+  server.on("/update/status", HTTP_GET, [](){ server.send(200, "application/json", otaStatusJSON()); });
+  server.on("/update", HTTP_PUT, otaDone, [](){ otaRaw(false); });
+  server.on("/update", HTTP_POST, otaDone, [](){ otaRaw(false); });
+  server.on("/update/delta", HTTP_PUT, otaDone, [](){ otaRaw(true); });
+  server.on("/update/delta", HTTP_POST, otaDone, [](){ otaRaw(true); });
+}
+
+void otaLoop() {
+  if (ota.state == OTA_RECEIVING && millis() - ota.tLast > OTA_SESSION_IDLE_MS) otaAbort("idle timeout");
+  if (otaRebootAt && (int32_t)(millis() - otaRebootAt) >= 0) {
+    LOGI("Rebooting into new firmware");
+    ESP.restart();
+  }
+}
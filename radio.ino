@@ -0,0 +1,88 @@
+// ----------- Radio mode manager -----------
+// Every Wi-Fi mode change goes through radioMode(). It compares the wanted
+// mode with the one the driver is in and does nothing when they match, so
+// callers can state the mode they need (portal, scan, connect) without
+// knowing what ran before. A real change is timed from the call until the
+// matching AP/STA start and stop events have all arrived (see wifiWait()),
+// and counted per from->to pair. 'radio' on the console prints the table.
+
+struct RadioTransition {
+  uint32_t count, sumMs, maxMs;
+};
+
+RadioTransition radioTable[4][4] = {};      // [from][to], wifi_mode_t 0..3
+uint32_t radioSkipped = 0, radioFailed = 0;
+uint32_t radioLastMs = 0;
+wifi_mode_t radioLastFrom = WIFI_OFF, radioLastTo = WIFI_OFF;
+
+const char* radioModeName(wifi_mode_t m) {
+  switch (m) {
+    case WIFI_OFF:    return "OFF";
+    case WIFI_STA:    return "STA";
+    case WIFI_AP:     return "AP";
+    case WIFI_AP_STA: return "AP+STA";
+    default:          return "?";
+  }
+}
+
+// Puts the radio in `want`; `why` names the caller in the log. Returns
+// false if the driver refused or an interface did not start/stop in time.
+bool radioMode(wifi_mode_t want, const char* why) {
+  wifi_mode_t cur = WiFi.getMode();
+  if (cur == want) {
+    radioSkipped++;
+    LOGD("Radio: %s already %s", why, radioModeName(want));
+    return true;
+  }
+  uint32_t t0 = millis();
+  bool ok = WiFi.mode(want);
+  if (ok) {
+    EventBits_t bits = ((want & WIFI_AP) ? WIFI_AP_UP : WIFI_AP_DOWN) | ((want & WIFI_STA) ? WIFI_STA_UP : WIFI_STA_DOWN);
+    ok = wifiWait(bits, radioModeName(want));
+  }
+  uint32_t ms = millis() - t0;
+  if (!ok) radioFailed++;
+  if (cur <= WIFI_AP_STA && want <= WIFI_AP_STA) {
+    RadioTransition& t = radioTable[cur][want];
+    t.count++;
+    t.sumMs += ms;
+    if (ms > t.maxMs) t.maxMs = ms;
+  }
+  radioLastFrom = cur;
+  radioLastTo = want;
+  radioLastMs = ms;
+  LOGI("Radio: %s -> %s for %s in %lu ms%s", radioModeName(cur), radioModeName(want), why, (unsigned long)ms,
+       ok ? "" : " (FAILED)");
+  return ok;
+}
+
+// Adds or removes one interface and keeps the other as it is.
+bool radioEnable(wifi_mode_t iface, bool on, const char* why) {
+  wifi_mode_t cur = WiFi.getMode();
+  return radioMode((wifi_mode_t)(on ? (cur | iface) : (cur & ~iface)), why);
+}
+
+String radioStatsLine() {
+  uint32_t n = 0, ms = 0;
+  for (int f = 0; f < 4; f++)
+    for (int t = 0; t < 4; t++) { n += radioTable[f][t].count; ms += radioTable[f][t].sumMs; }
+  char b[160];
+  snprintf(b, sizeof(b), "Radio: mode=%s transitions=%lu (%lu ms total) skipped=%lu failed=%lu last=%s->%s %lums",
+           radioModeName(WiFi.getMode()), (unsigned long)n, (unsigned long)ms, (unsigned long)radioSkipped,
+           (unsigned long)radioFailed, radioModeName(radioLastFrom), radioModeName(radioLastTo),
+           (unsigned long)radioLastMs);
+  return String(b);
+}
+
+void radioPrint() {
+  LOGI("%s", radioStatsLine().c_str());
+  for (int f = 0; f < 4; f++) {
+    for (int t = 0; t < 4; t++) {
+      const RadioTransition& r = radioTable[f][t];
+      if (!r.count) continue;
+      Serial.printf("  %-6s -> %-6s  x%-4lu avg %4lu ms  max %4lu ms\n", radioModeName((wifi_mode_t)f),
+                    radioModeName((wifi_mode_t)t), (unsigned long)r.count, (unsigned long)(r.sumMs / r.count),
+                    (unsigned long)r.maxMs);
+    }
+  }
+}
@@ -0,0 +1,345 @@
+// ----------- RTP audio sender (STA mode) -----------
+// G.711 at 8 kHz, RTP_PTIME_MS per packet, to a unicast/multicast target
+// set with the 'rtp' console command (saved in Preferences "rtp").
+//
+// Packets are lwIP pbufs allocated once with room for the UDP/IP/link
+// headers in front. The audio task encodes directly into the payload area
+// (rtpPayloadSlot), the RTP header is filled into the 12 bytes before it,
+// and the pbuf goes to udp_sendto() as is: no copies on our side or in
+// lwIP. A buffer is reused only once lwIP has dropped its reference (ARP
+// queueing may hold one); if none is free the packet is dropped and
+// counted. Sends happen as the capture clock completes each packet, so
+// pacing and timestamps follow the microphone, not a timer.
+//
+// During silence (audio.ino's VAD) no media is sent; a one-byte RFC 3389
+// comfort-noise packet goes out when silence starts and every
+// RTP_CN_INTERVAL_MS after, and the next talkspurt carries the marker bit.
+//
+// With an SRTP master key set ('rtp srtp on', Preferences "rtp"/"srtp")
+// every packet, CN included, is protected with AES_CM_128_HMAC_SHA1_80
+// (src/srtp.h) in place, the tag going into SRTP_TAG_LEN spare bytes at
+// the end of each pool buffer. Right after each send the keystream for the
+// next sequence number is computed, so at the packet boundary protect()
+// only XORs and runs the HMAC. The AES and SHA work is done by the crypto
+// peripherals through mbedtls.
+
+struct RtpBuf {
+  struct pbuf* p;
+  void*        base;            // payload pointer at allocation (RTP header)
+};
+
+struct RtpSendCall {
+  struct tcpip_api_call_data call;   // must be first
+  struct pbuf* p;
+};
+
+struct RtpStats {
+  uint32_t sent, bytes, dropped, sendErr, gaps;
+  uint32_t suppressed, cnSent;  // silent periods not sent / comfort-noise packets
+  int64_t  lastSendUs;
+  uint64_t jitterSumUs;         // |interval - ptime|
+  uint32_t jitterMaxUs, intervals;
+  uint32_t ppsWinStart, ppsWinCount;
+  float    pps;
+};
+
+RtpBuf           rtpPool[RTP_POOL];
+struct udp_pcb*  rtpPcb = nullptr;
+ip_addr_t        rtpDest;
+uint16_t         rtpPort = RTP_DEFAULT_PORT;
+RtpPacketizer    rtpPkt;
+RtpStats         rtpStats;
+SemaphoreHandle_t rtpLock = nullptr;
+RtpBuf*          rtpCur = nullptr;  // packet being filled
+size_t           rtpFill = 0;
+uint32_t         rtpTs = 0, rtpNextTs = 0;
+bool             rtpSilent = false;
+uint32_t         rtpCnTs = 0;       // timestamp of the last comfort-noise packet
+SrtpSession      rtpSrtp;           // active when a master key is set
+
+err_t rtpOpenFn(struct tcpip_api_call_data*) {
+  rtpPcb = udp_new();
+  return rtpPcb ? ERR_OK : ERR_MEM;
+}
+
+err_t rtpCloseFn(struct tcpip_api_call_data*) {
+  if (rtpPcb) udp_remove(rtpPcb);
+  rtpPcb = nullptr;
+  return ERR_OK;
+}
+
+err_t rtpSendFn(struct tcpip_api_call_data* c) {
+  return udp_sendto(rtpPcb, ((RtpSendCall*)c)->p, &rtpDest, rtpPort);
+}
+
+bool rtpAllocPool() {
+  for (int i = 0; i < RTP_POOL; i++) {
+    if (rtpPool[i].p) continue;
+    // PBUF_TRANSPORT reserves UDP + IP + link header space in front of payload;
+    // RTP_BUF_LEN leaves room for the SRTP tag behind it.
+    struct pbuf* p = pbuf_alloc(PBUF_TRANSPORT, RTP_BUF_LEN, PBUF_RAM);
+    if (!p) return false;
+    rtpPool[i].p = p;
+    rtpPool[i].base = p->payload;
+  }
+  return true;
+}
+
+// Index of a pool buffer lwIP no longer references, reset to its original
+// layout; -1 if all are still in flight.
+int rtpTakeBuf() {
+  for (int i = 0; i < RTP_POOL; i++) {
+    RtpBuf& b = rtpPool[i];
+    if (&b == rtpCur || !b.p || b.p->ref != 1) continue;
+    b.p->payload = b.base;               // the stack moved it back over its headers
+    b.p->len = b.p->tot_len = RTP_BUF_LEN;
+    return i;
+  }
+  return -1;
+}
+
+bool rtpTransmit(struct pbuf* p, size_t len) {
+  if (rtpSrtp.active()) len = rtpSrtp.protect((uint8_t*)p->payload, len);
+  p->len = p->tot_len = len;
+  RtpSendCall c;
+  c.p = p;
+  err_t err = tcpip_api_call(rtpSendFn, &c.call);
+  // Next packet's keystream while the audio task waits for its samples.
+  if (rtpSrtp.active()) rtpSrtp.precompute(rtpPkt.ssrc(), rtpPkt.seq(), RTP_PAYLOAD_MAX);
+  if (err != ERR_OK) { rtpStats.sendErr++; return false; }
+  rtpStats.bytes += len;
+  return true;
+}
+
+void rtpSendCur() {
+  RtpBuf* b = rtpCur;
+  rtpCur = nullptr;
+  if (!b || !rtpFill) return;
+  size_t len = rtpPkt.finish((uint8_t*)b->base, rtpTs, rtpFill);
+  rtpFill = 0;
+  if (!rtpTransmit(b->p, len)) return;
+
+  int64_t now = esp_timer_get_time();
+  if (rtpStats.lastSendUs) {
+    int64_t dev = now - rtpStats.lastSendUs - RTP_PTIME_MS * 1000;
+    uint32_t d = dev < 0 ? -dev : dev;
+    rtpStats.jitterSumUs += d;
+    if (d > rtpStats.jitterMaxUs) rtpStats.jitterMaxUs = d;
+    rtpStats.intervals++;
+  }
+  rtpStats.lastSendUs = now;
+  rtpStats.sent++;
+  uint32_t ms = millis();
+  rtpStats.ppsWinCount++;
+  if (ms - rtpStats.ppsWinStart >= 1000) {
+    rtpStats.pps = rtpStats.ppsWinCount * 1000.0f / (ms - rtpStats.ppsWinStart);
+    rtpStats.ppsWinStart = ms;
+    rtpStats.ppsWinCount = 0;
+  }
+}
+
+// Where the audio task should encode the next n samples (timestamp ts at
+// 8 kHz), or nullptr when not streaming / no buffer is free.
+uint8_t* rtpPayloadSlot(size_t n, uint32_t ts) {
+  if (!rtpPcb || xSemaphoreTake(rtpLock, 0) != pdTRUE) return nullptr;
+  if (!rtpPcb) { xSemaphoreGive(rtpLock); return nullptr; }
+  rtpSilent = false;
+  if (rtpCur && ts != rtpNextTs) {       // capture overrun: ship what we have, mark the gap
+    rtpSendCur();
+    rtpStats.gaps++;
+    rtpPkt.discontinuity();
+  }
+  if (!rtpCur) {
+    int i = rtpTakeBuf();
+    if (i < 0) {
+      rtpStats.dropped++;
+      rtpPkt.discontinuity();
+      xSemaphoreGive(rtpLock);
+      return nullptr;
+    }
+    rtpCur = &rtpPool[i];
+    rtpTs = ts;
+  }
+  return (uint8_t*)rtpCur->base + RTP_HDR_LEN + rtpFill;    // lock held until rtpCommit
+}
+
+void rtpCommit(size_t n) {
+  rtpFill += n;
+  rtpNextTs = rtpTs + rtpFill;
+  if (rtpFill >= RTP_PAYLOAD_MAX) rtpSendCur();
+  xSemaphoreGive(rtpLock);
+}
+
+// The audio task's VAD says this period (timestamp ts) is silence.
+void rtpSilence(uint32_t ts, uint8_t noiseDbov) {
+  if (!rtpPcb || xSemaphoreTake(rtpLock, 0) != pdTRUE) return;
+  if (rtpPcb) {
+    if (rtpCur) rtpSendCur();            // end of the talkspurt
+    rtpStats.suppressed++;
+    if (!rtpSilent || ts - rtpCnTs >= RTP_CN_INTERVAL_MS * (G711_RATE / 1000)) {
+      int i = rtpTakeBuf();
+      if (i < 0) {
+        rtpStats.dropped++;
+      } else {
+        uint8_t* pkt = (uint8_t*)rtpPool[i].base;
+        pkt[RTP_HDR_LEN] = noiseDbov;
+        if (rtpTransmit(rtpPool[i].p, rtpPkt.finish(pkt, ts, 1, RTP_PT_CN))) rtpStats.cnSent++;
+        rtpCnTs = ts;
+      }
+    }
+    rtpSilent = true;
+    rtpPkt.discontinuity();
+    rtpStats.lastSendUs = 0;             // jitter is measured within talkspurts
+  }
+  xSemaphoreGive(rtpLock);
+}
+
+static_assert(RTP_PAYLOAD_MAX % G711_FRAMES == 0, "RTP packets must hold whole capture periods");
+static_assert(RTP_PAYLOAD_MAX <= SRTP_KS_MAX, "SRTP precomputes one whole packet of keystream");
+
+void rtpBegin() {
+  if (!rtpLock) rtpLock = xSemaphoreCreateMutex();
+  if (rtpPcb) return;
+  prefs.begin("rtp", true);
+  String host = prefs.getString("host", "");
+  rtpPort = prefs.getUShort("port", RTP_DEFAULT_PORT);
+  uint8_t master[SRTP_MASTER_LEN];
+  bool secure = prefs.getBytes("srtp", master, sizeof(master)) == sizeof(master);
+  prefs.end();
+  if (!host.length() || !ipaddr_aton(host.c_str(), &rtpDest)) { memset(master, 0, sizeof(master)); return; }
+  if (!rtpAllocPool()) { LOGE("RTP: pbuf pool alloc failed"); memset(master, 0, sizeof(master)); return; }
+  xSemaphoreTake(rtpLock, portMAX_DELAY);
+  rtpPkt.begin(AUDIO_G711_LAW, esp_random(), esp_random(), esp_random());
+  if (secure && rtpSrtp.begin(master)) {
+    rtpSrtp.precompute(rtpPkt.ssrc(), rtpPkt.seq(), RTP_PAYLOAD_MAX);
+  } else {
+    if (secure) LOGE("RTP: SRTP key setup failed, sending plain RTP");
+    rtpSrtp.end();
+  }
+  memset(master, 0, sizeof(master));
+  rtpCur = nullptr;
+  rtpFill = 0;
+  rtpSilent = false;
+  memset(&rtpStats, 0, sizeof(rtpStats));
+  rtpStats.ppsWinStart = millis();
+  RtpSendCall c;
+  tcpip_api_call(rtpOpenFn, &c.call);
+  xSemaphoreGive(rtpLock);
+  if (rtpPcb) LOGI("RTP: %s to %s:%u, %d ms packets%s", AUDIO_G711_LAW == G711_ALAW ? "PCMA" : "PCMU",
+                   host.c_str(), rtpPort, RTP_PTIME_MS, rtpSrtp.active() ? ", SRTP" : "");
+}
+
+void rtpStop() {
+  if (!rtpPcb) return;
+  xSemaphoreTake(rtpLock, portMAX_DELAY);
+  rtpCur = nullptr;
+  rtpFill = 0;
+  RtpSendCall c;
+  tcpip_api_call(rtpCloseFn, &c.call);
+  rtpSrtp.end();
+  xSemaphoreGive(rtpLock);
+  LOGI("RTP: stopped");
+}
+
+String rtpStatsLine() {
+  if (!rtpPcb) return "RTP: off";
+  char b[300];
+  int n = snprintf(b, sizeof(b), "RTP: to %s:%u seq=%u sent=%lu (%.1f pps) suppressed=%lu cn=%lu dropped=%lu gaps=%lu err=%lu"
+           " jitter avg=%luus max=%luus",
+           ipaddr_ntoa(&rtpDest), rtpPort, rtpPkt.seq(), (unsigned long)rtpStats.sent, rtpStats.pps,
+           (unsigned long)rtpStats.suppressed, (unsigned long)rtpStats.cnSent, (unsigned long)rtpStats.dropped, (unsigned long)rtpStats.gaps, (unsigned long)rtpStats.sendErr,
+           (unsigned long)(rtpStats.intervals ? rtpStats.jitterSumUs / rtpStats.intervals : 0),
+           (unsigned long)rtpStats.jitterMaxUs);
+  if (rtpSrtp.active() && n > 0 && n < (int)sizeof(b)) {
+    const SrtpStats& st = rtpSrtp.stats();
+    snprintf(b + n, sizeof(b) - n, " srtp=%lu pre=%lu/%lu", (unsigned long)st.protectedPkts,
+             (unsigned long)st.preHits, (unsigned long)(st.preHits + st.preMisses));
+  }
+  return String(b);
+}
+
+// Protect cost on this chip for a full packet, with and without the
+// keystream precomputed. Uses its own session and a throwaway key.
+void rtpSrtpBench() {
+  static SrtpSession s;
+  static uint8_t pkt[RTP_BUF_LEN];
+  uint8_t master[SRTP_MASTER_LEN];
+  esp_fill_random(master, sizeof(master));
+  if (!s.begin(master)) { Serial.println("rtp: SRTP setup failed"); return; }
+  RtpPacketizer pk;
+  pk.begin(AUDIO_G711_LAW, 0x12345678, 0);
+  const int N = 500;
+  int64_t pre = 0, prot = 0, inl = 0;
+  for (int i = 0; i < N; i++) {
+    size_t len = pk.finish(pkt, 0, RTP_PAYLOAD_MAX);
+    int64_t t0 = esp_timer_get_time();
+    s.precompute(pk.ssrc(), i, RTP_PAYLOAD_MAX);
+    int64_t t1 = esp_timer_get_time();
+    s.protect(pkt, len);
+    int64_t t2 = esp_timer_get_time();
+    pre += t1 - t0;
+    prot += t2 - t1;
+  }
+  for (int i = 0; i < N; i++) {
+    size_t len = pk.finish(pkt, 0, RTP_PAYLOAD_MAX);
+    int64_t t0 = esp_timer_get_time();
+    s.protect(pkt, len);
+    inl += esp_timer_get_time() - t0;
+  }
+  s.end();
+  memset(master, 0, sizeof(master));
+  Serial.printf("SRTP %u-byte packets: protect %.1f us (%.0f pps) with keystream ready, precompute %.1f us,"
+                " inline %.1f us (%.0f pps)\n", RTP_HDR_LEN + RTP_PAYLOAD_MAX,
+                (float)prot / N, prot ? 1e6f * N / prot : 0.0f, (float)pre / N,
+                (float)inl / N, inl ? 1e6f * N / inl : 0.0f);
+}
+
+// rtp srtp on: new random master key, printed as an SDP crypto attribute.
+void rtpSrtpCommand(const String& arg) {
+  if (arg == "bench") { rtpSrtpBench(); return; }
+  if (arg != "on" && arg != "off") { Serial.println("rtp: srtp on|off|bench"); return; }
+  rtpStop();
+  prefs.begin("rtp", false);
+  if (arg == "on") {
+    uint8_t master[SRTP_MASTER_LEN];
+    unsigned char b64[48];
+    size_t olen = 0;
+    esp_fill_random(master, sizeof(master));
+    prefs.putBytes("srtp", master, sizeof(master));
+    mbedtls_base64_encode(b64, sizeof(b64), &olen, master, sizeof(master));
+    memset(master, 0, sizeof(master));
+    Serial.printf("a=crypto:1 AES_CM_128_HMAC_SHA1_80 inline:%.*s\n", (int)olen, (const char*)b64);
+    memset(b64, 0, sizeof(b64));
+  } else {
+    prefs.remove("srtp");
+  }
+  prefs.end();
+  if (!inAP && WiFi.status() == WL_CONNECTED) rtpBegin();
+}
+
+// rtp | rtp <ip> [port] | rtp off | rtp srtp on|off|bench
+void rtpCommand(const String& cmd) {
+  String arg = cmd.length() > 3 ? cmd.substring(4) : "";
+  arg.trim();
+  if (!arg.length()) { LOGI("%s", rtpStatsLine().c_str()); return; }
+  if (arg.startsWith("srtp")) {
+    String sub = arg.substring(4);
+    sub.trim();
+    rtpSrtpCommand(sub);
+    return;
+  }
+  rtpStop();
+  prefs.begin("rtp", false);
+  if (arg == "off") {
+    prefs.remove("host");
+  } else {
+    int sp = arg.indexOf(' ');
+    String host = sp < 0 ? arg : arg.substring(0, sp);
+    ip_addr_t tmp;
+    if (!ipaddr_aton(host.c_str(), &tmp)) { prefs.end(); Serial.println("rtp: bad address"); return; }
+    prefs.putString("host", host);
+    prefs.putUShort("port", sp < 0 ? RTP_DEFAULT_PORT : (uint16_t)arg.substring(sp + 1).toInt());
+  }
+  prefs.end();
+  if (!inAP && WiFi.status() == WL_CONNECTED) rtpBegin();
+}
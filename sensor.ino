@@ -0,0 +1,137 @@
+// ----------- KY-038 sound sensor (ADC DMA, envelope events) -----------
+// The module's analog output is sampled continuously by the ADC through
+// DMA: the I2S0 built-in ADC mode on IDF 4.4, the continuous ADC driver on
+// IDF 5. A task on core 0 blocks until SENSOR_BLOCK samples have landed
+// (20 wake-ups per second) and runs EnvelopeDetector over them: one add and
+// one abs per sample, nothing else until a threshold is crossed. An onset
+// fires a clip trigger; loop() logs onsets and releases.
+
+struct SensorStats {
+  uint32_t blocks, readErr;
+  uint64_t procUs;
+  int64_t  startUs;
+};
+
+EnvelopeDetector sensorEnv;
+SensorStats      sensorStats;
+TaskHandle_t     sensorTaskHandle = nullptr;
+volatile bool    sensorOnsetPending = false, sensorReleasePending = false;
+#if ESP_IDF_VERSION_MAJOR >= 5
+adc_continuous_handle_t sensorAdc = nullptr;
+#endif
+
+bool sensorAdcBegin() {
+#if ESP_IDF_VERSION_MAJOR >= 5
+  adc_continuous_handle_cfg_t hc = {};
+  hc.max_store_buf_size = SENSOR_BLOCK * SOC_ADC_DIGI_RESULT_BYTES * 4;
+  hc.conv_frame_size = SENSOR_BLOCK * SOC_ADC_DIGI_RESULT_BYTES;
+  adc_digi_pattern_config_t pat = {};
+  pat.atten = ADC_ATTEN_DB_12;
+  pat.channel = SENSOR_ADC_CHANNEL;
+  pat.unit = ADC_UNIT_1;
+  pat.bit_width = ADC_BITWIDTH_12;
+  adc_continuous_config_t cc = {};
+  cc.pattern_num = 1;
+  cc.adc_pattern = &pat;
+  cc.sample_freq_hz = SENSOR_RATE;
+  cc.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+  cc.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;     // 12-bit value, channel in the top 4 bits
+  esp_err_t err = adc_continuous_new_handle(&hc, &sensorAdc);
+  if (err == ESP_OK) err = adc_continuous_config(sensorAdc, &cc);
+  if (err == ESP_OK) err = adc_continuous_start(sensorAdc);
+#else
+  i2s_config_t cfg = {};
+  cfg.mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX | I2S_MODE_ADC_BUILT_IN);
+  cfg.sample_rate = SENSOR_RATE;
+  cfg.bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT;
+  cfg.channel_format = I2S_CHANNEL_FMT_ONLY_LEFT;
+  cfg.communication_format = I2S_COMM_FORMAT_STAND_MSB;
+  cfg.intr_alloc_flags = ESP_INTR_FLAG_LEVEL1;
+  cfg.dma_buf_count = 4;
+  cfg.dma_buf_len = SENSOR_BLOCK;
+  esp_err_t err = i2s_driver_install(I2S_NUM_0, &cfg, 0, nullptr);
+  if (err == ESP_OK) err = i2s_set_adc_mode(ADC_UNIT_1, (adc1_channel_t)SENSOR_ADC_CHANNEL);
+  if (err == ESP_OK) err = adc1_config_channel_atten((adc1_channel_t)SENSOR_ADC_CHANNEL, ADC_ATTEN_DB_11);
+  if (err == ESP_OK) err = i2s_adc_enable(I2S_NUM_0);
+#endif
+  if (err != ESP_OK) LOGE("Sensor ADC DMA init failed: %s", esp_err_to_name(err));
+  return err == ESP_OK;
+}
+
+// Blocks until a DMA block is in; returns samples read.
+size_t sensorRead(uint16_t* buf, size_t n) {
+  size_t bytes = 0;
+#if ESP_IDF_VERSION_MAJOR >= 5
+  uint32_t got = 0;
+  if (adc_continuous_read(sensorAdc, (uint8_t*)buf, n * sizeof(uint16_t), &got, 1000) != ESP_OK) return 0;
+  bytes = got;
+#else
+  if (i2s_read(I2S_NUM_0, buf, n * sizeof(uint16_t), &bytes, portMAX_DELAY) != ESP_OK) return 0;
+#endif
+  return bytes / sizeof(uint16_t);
+}
+
+void sensorTask(void*) {
+  static uint16_t buf[SENSOR_BLOCK];
+  for (;;) {
+    size_t n = sensorRead(buf, SENSOR_BLOCK);
+    if (!n) { sensorStats.readErr++; vTaskDelay(pdMS_TO_TICKS(50)); continue; }
+    int64_t t0 = esp_timer_get_time();
+    EnvEvent e = sensorEnv.process(buf, n);
+    sensorStats.procUs += esp_timer_get_time() - t0;
+    sensorStats.blocks++;
+    if (e == ENV_ONSET) {
+      clipTrigger(CLIP_TRIG_SENSOR);
+      sensorOnsetPending = true;
+    } else if (e == ENV_RELEASE) {
+      sensorReleasePending = true;
+    }
+  }
+}
+
+void sensorBegin() {
+#if SENSOR_ENABLE
+  if (sensorTaskHandle) return;
+  EnvConfig cfg = { SENSOR_RATE, SENSOR_BLOCK, SENSOR_ATTACK_MS, SENSOR_RELEASE_MS,
+                    SENSOR_ON_LEVEL, SENSOR_OFF_LEVEL, SENSOR_MIN_EVENT_MS };
+  if (!sensorEnv.begin(cfg) || !sensorAdcBegin()) return;
+  memset(&sensorStats, 0, sizeof(sensorStats));
+  sensorStats.startUs = esp_timer_get_time();
+  xTaskCreatePinnedToCore(sensorTask, "ky038", 2560, nullptr, 4, &sensorTaskHandle, 0);
+  LOGI("KY-038: ADC1 ch%d at %d Hz via DMA, %d-sample blocks, on/off %d/%d", SENSOR_ADC_CHANNEL, SENSOR_RATE,
+       SENSOR_BLOCK, SENSOR_ON_LEVEL, SENSOR_OFF_LEVEL);
+#endif
+}
+
+void sensorLoop() {
+  if (sensorOnsetPending) {
+    sensorOnsetPending = false;
+    LOGI("KY-038: sound event #%lu, level %u (dc %u)", (unsigned long)sensorEnv.events(), sensorEnv.level(),
+         sensorEnv.dc());
+    char j[80];
+    snprintf(j, sizeof(j), "{\"t\":%lu,\"ev\":\"sound\",\"n\":%lu,\"level\":%u}", (unsigned long)millis(),
+             (unsigned long)sensorEnv.events(), sensorEnv.level());
+    mqttEvent(j);
+  }
+  if (sensorReleasePending) {
+    sensorReleasePending = false;
+    LOGI("KY-038: event over after %lu ms, peak %u", (unsigned long)sensorEnv.eventMs(), sensorEnv.peak());
+    char j[80];
+    snprintf(j, sizeof(j), "{\"t\":%lu,\"ev\":\"sound_end\",\"ms\":%lu,\"peak\":%u}", (unsigned long)millis(),
+             (unsigned long)sensorEnv.eventMs(), sensorEnv.peak());
+    mqttEvent(j);
+  }
+}
+
+uint32_t sensorEvents() { return sensorEnv.events(); }
+
+String sensorStatsLine() {
+  if (!sensorTaskHandle) return "Sensor: off";
+  float wallUs = (float)(esp_timer_get_time() - sensorStats.startUs);
+  char b[160];
+  snprintf(b, sizeof(b), "Sensor: KY-038 level=%u dc=%u %s events=%lu blocks=%lu err=%lu cpu=%.3f%%",
+           sensorEnv.level(), sensorEnv.dc(), sensorEnv.active() ? "ACTIVE" : "quiet",
+           (unsigned long)sensorEnv.events(), (unsigned long)sensorStats.blocks, (unsigned long)sensorStats.readErr,
+           wallUs > 0 ? 100.0f * sensorStats.procUs / wallUs : 0.0f);
+  return String(b);
+}
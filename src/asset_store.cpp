@@ -0,0 +1,76 @@
+#include "asset_store.h"
+#include <string.h>
+
+static uint32_t le32(const uint8_t* p) { return p[0] | (p[1]<<8) | (p[2]<<16) | ((uint32_t)p[3]<<24); }
+
+// Field compare against a NUL-padded fixed-width name.
+static int cmpName(const char* key, const uint8_t* field, size_t width) {
+  size_t i = 0;
+  for (; i < width; i++) {
+    unsigned char a = (unsigned char)key[i], b = field[i];
+    if (a != b || !a) return (int)a - (int)b;
+  }
+  return key[i] ? 1 : 0;
+}
+
+AssetResult AssetStore::open(const uint8_t* img, size_t cap, HashFn sha256) {
+  close();
+  if (cap < ASSET_HDR_LEN) return ASSET_ERR_FORMAT;
+  if (le32(img) == 0xFFFFFFFF) return ASSET_ERR_EMPTY;          // erased flash
+  if (memcmp(img, "AAST", 4) != 0 || img[4] != ASSET_VERSION) return ASSET_ERR_FORMAT;
+  uint32_t count = le32(img + 8), size = le32(img + 12);
+  if (size > cap || count > (size - ASSET_HDR_LEN) / ASSET_ENTRY_LEN) return ASSET_ERR_FORMAT;
+  uint32_t dataStart = ASSET_HDR_LEN + count * ASSET_ENTRY_LEN;
+
+  for (uint32_t i = 0; i < count; i++) {
+    const uint8_t* e = img + ASSET_HDR_LEN + i * ASSET_ENTRY_LEN;
+    uint32_t off = le32(e + 80), len = le32(e + 84);
+    if (off < dataStart || off > size || len > size - off) return ASSET_ERR_FORMAT;
+    if (e[0] != '/' || e[ASSET_PATH_MAX - 1] || e[ASSET_PATH_MAX + ASSET_TYPE_MAX - 1]) return ASSET_ERR_FORMAT;
+    if (i && cmpName((const char*)e, e - ASSET_ENTRY_LEN, ASSET_PATH_MAX) <= 0) return ASSET_ERR_FORMAT;
+  }
+  if (sha256) {
+    uint8_t d[32];
+    sha256(img + ASSET_HDR_LEN, size - ASSET_HDR_LEN, d);
+    if (memcmp(d, img + 16, 32) != 0) return ASSET_ERR_HASH;
+  }
+  _img = img;
+  _count = count;
+  _size = size;
+  _id = le32(img + 16);
+  return ASSET_OK;
+}
+
+bool AssetStore::at(uint32_t i, AssetEntry* out) const {
+  if (i >= _count) return false;
+  const uint8_t* e = _img + ASSET_HDR_LEN + i * ASSET_ENTRY_LEN;
+  out->path = (const char*)e;
+  out->type = (const char*)e + ASSET_PATH_MAX;
+  out->data = _img + le32(e + 80);
+  out->length = le32(e + 84);
+  out->flags = le32(e + 88);
+  out->etag = le32(e + 92);
+  return true;
+}
+
+bool AssetStore::find(const char* path, AssetEntry* out) const {
+  uint32_t lo = 0, hi = _count;
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    int c = cmpName(path, _img + ASSET_HDR_LEN + mid * ASSET_ENTRY_LEN, ASSET_PATH_MAX);
+    if (!c) return at(mid, out);
+    if (c < 0) hi = mid;
+    else lo = mid + 1;
+  }
+  return false;
+}
+
+const char* assetResultName(AssetResult r) {
+  switch (r) {
+    case ASSET_OK:         return "ok";
+    case ASSET_ERR_EMPTY:  return "empty";
+    case ASSET_ERR_FORMAT: return "bad format";
+    case ASSET_ERR_HASH:   return "hash mismatch";
+    default:               return "?";
+  }
+}
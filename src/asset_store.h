@@ -0,0 +1,58 @@
+// Read-only web asset store kept in its own flash partition (see
+// tools/mkassets.py), read in place from memory-mapped flash.
+//
+// Image (little-endian):
+//   header  48 bytes   "AAST" ver(1) reserved(3) count(4) size(4) sha256(32)
+//   entries count x 96 path[48] type[32] offset(4) length(4) flags(4) etag(4)
+//   data               file bytes; offsets count from the start of the image
+// size is the whole image, header included; sha256 covers everything after
+// the header, so a half-written partition is rejected as a whole. Entries
+// are sorted by path (strcmp order) for binary search. Paths and types are
+// NUL-padded.
+//
+// Every asset except the entry pages carries a content hash in its name
+// (app.3f9a1c2e.css) and ASSET_IMMUTABLE, so it can be cached forever; the
+// etag (first 4 bytes of the file's SHA-256) revalidates the rest.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#define ASSET_HDR_LEN     48
+#define ASSET_ENTRY_LEN   96
+#define ASSET_PATH_MAX    48
+#define ASSET_TYPE_MAX    32
+#define ASSET_VERSION     1
+#define ASSET_IMMUTABLE   0x01
+
+enum AssetResult : uint8_t { ASSET_OK, ASSET_ERR_EMPTY, ASSET_ERR_FORMAT, ASSET_ERR_HASH };
+
+struct AssetEntry {
+  const char*    path;       // NUL-terminated, pointing into the image
+  const char*    type;
+  const uint8_t* data;
+  uint32_t       length, flags, etag;
+};
+
+class AssetStore {
+public:
+  typedef void (*HashFn)(const uint8_t* p, size_t n, uint8_t out[32]);
+
+  // image/cap: the mapped partition. sha256 == nullptr skips the check.
+  AssetResult open(const uint8_t* image, size_t cap, HashFn sha256);
+  void close() { _img = nullptr; _count = 0; _size = 0; }
+
+  bool find(const char* path, AssetEntry* out) const;
+  bool at(uint32_t i, AssetEntry* out) const;
+
+  bool     ready() const { return _img != nullptr; }
+  uint32_t count() const { return _count; }
+  uint32_t size() const { return _size; }
+  // Identifies the image (first 4 bytes of its sha256) for logs and /diag.
+  uint32_t id() const { return _id; }
+
+private:
+  const uint8_t* _img = nullptr;
+  uint32_t       _count = 0, _size = 0, _id = 0;
+};
+
+const char* assetResultName(AssetResult r);
@@ -0,0 +1,71 @@
+// Lock-free single-producer/single-consumer ring of fixed-size audio periods.
+//
+// Samples are 24-bit signed values sign-extended into int32_t, mono. The
+// capture task fills a period in place (acquire -> commit) straight from
+// DMA; the processing task drains it in place (peek -> release). Each
+// index is written by one side only, so no locks are needed. When the ring
+// is full the producer gets nullptr and an overrun is counted: a slow
+// consumer loses whole periods but never stalls capture.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <atomic>
+
+class AudioRing {
+public:
+  AudioRing() {}
+  ~AudioRing() { free(_buf); free(_stamp); }
+
+  // periods must be a power of two (>= 2).
+  bool begin(size_t periodFrames, size_t periods) {
+    if (_buf || periodFrames == 0 || periods < 2 || (periods & (periods - 1))) return false;
+    _buf = (int32_t*)malloc(periodFrames * periods * sizeof(int32_t));
+    _stamp = (uint32_t*)malloc(periods * sizeof(uint32_t));
+    if (!_buf || !_stamp) { free(_buf); free(_stamp); _buf = nullptr; _stamp = nullptr; return false; }
+    _frames = periodFrames;
+    _mask = periods - 1;
+    return true;
+  }
+
+  size_t periodFrames() const { return _frames; }
+  size_t periods() const { return _mask + 1; }
+  size_t level() const { return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire); }
+  uint32_t overruns() const { return _overruns.load(std::memory_order_relaxed); }
+  uint32_t committed() const { return _head.load(std::memory_order_relaxed); }
+
+  // Producer side.
+  int32_t* acquire() {
+    uint32_t h = _head.load(std::memory_order_relaxed);
+    if (h - _tail.load(std::memory_order_acquire) > _mask) {
+      _overruns.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    return _buf + (h & _mask) * _frames;
+  }
+  // startFrame: capture clock (frame count) of the period's first sample.
+  void commit(uint32_t startFrame) {
+    uint32_t h = _head.load(std::memory_order_relaxed);
+    _stamp[h & _mask] = startFrame;
+    _head.store(h + 1, std::memory_order_release);
+  }
+
+  // Consumer side.
+  const int32_t* peek(uint32_t* startFrame = nullptr) const {
+    uint32_t t = _tail.load(std::memory_order_relaxed);
+    if (t == _head.load(std::memory_order_acquire)) return nullptr;
+    if (startFrame) *startFrame = _stamp[t & _mask];
+    return _buf + (t & _mask) * _frames;
+  }
+  void release() { _tail.store(_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+private:
+  AudioRing(const AudioRing&) = delete;
+  AudioRing& operator=(const AudioRing&) = delete;
+
+  int32_t*  _buf = nullptr;
+  uint32_t* _stamp = nullptr;
+  size_t    _frames = 0;
+  uint32_t  _mask = 0;
+  std::atomic<uint32_t> _head{0}, _tail{0}, _overruns{0};
+};
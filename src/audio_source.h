@@ -0,0 +1,38 @@
+// Audio capture source interface and the producer step shared by the
+// device (I2S microphone) and host (WAV file) builds.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "audio_ring.h"
+
+#define AUDIO_SAMPLE_BITS  24
+#define AUDIO_FULL_SCALE   (1L << 23)
+
+class AudioSource {
+public:
+  virtual ~AudioSource() {}
+  virtual uint32_t rate() const = 0;
+  // Blocks until up to `frames` mono 24-bit samples (sign-extended into
+  // int32_t) are in out, paced at the source's real-time rate. Returns the
+  // number read; 0 means end of stream or error.
+  virtual size_t read(int32_t* out, size_t frames) = 0;
+};
+
+// Move one period from src into ring. When the ring is full the period is
+// read into scratch (periodFrames samples) and discarded so the source keeps
+// draining; the ring counts the overrun. clock advances by every frame read,
+// dropped or not, so downstream timestamps stay on the capture timeline.
+// Returns frames read (0 = source finished).
+static inline size_t audioPump(AudioSource& src, AudioRing& ring, int32_t* scratch, uint32_t& clock) {
+  int32_t* slot = ring.acquire();
+  int32_t* dst = slot ? slot : scratch;
+  size_t want = ring.periodFrames(), got = 0;
+  while (got < want) {
+    size_t n = src.read(dst + got, want - got);
+    if (!n) break;
+    got += n;
+  }
+  if (slot && got == want) ring.commit(clock);
+  clock += got;
+  return got;
+}
@@ -0,0 +1,57 @@
+// Lock-free single-producer/single-consumer byte FIFO.
+//
+// push() is all-or-nothing, so a producer that must never block (the audio
+// task) either queues a whole block or drops it, and sample framing is
+// preserved. The consumer reads in place through peek()/consume().
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+
+class ByteFifo {
+public:
+  ~ByteFifo() { free(_buf); }
+
+  // size must be a power of two. Keeps an existing buffer of the same size.
+  bool begin(size_t size) {
+    if (size & (size - 1)) return false;
+    if (_buf && _size == size) { reset(); return true; }
+    free(_buf);
+    _buf = (uint8_t*)malloc(size);
+    _size = _buf ? size : 0;
+    reset();
+    return _buf != nullptr;
+  }
+  // Only while neither side is running.
+  void reset() { _head.store(0); _tail.store(0); }
+
+  size_t used() const { return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire); }
+  size_t capacity() const { return _size; }
+
+  bool push(const uint8_t* d, size_t n) {
+    uint32_t h = _head.load(std::memory_order_relaxed);
+    if (!_buf || n > _size - (h - _tail.load(std::memory_order_acquire))) return false;
+    size_t pos = h & (_size - 1), first = n < _size - pos ? n : _size - pos;
+    memcpy(_buf + pos, d, first);
+    if (n > first) memcpy(_buf, d + first, n - first);
+    _head.store(h + n, std::memory_order_release);
+    return true;
+  }
+
+  // Contiguous readable span (may be shorter than used() at the wrap).
+  size_t peek(const uint8_t** p) const {
+    uint32_t t = _tail.load(std::memory_order_relaxed);
+    size_t avail = _head.load(std::memory_order_acquire) - t, pos = t & (_size - 1);
+    if (avail > _size - pos) avail = _size - pos;
+    *p = _buf + pos;
+    return avail;
+  }
+  void consume(size_t n) { _tail.store(_tail.load(std::memory_order_relaxed) + n, std::memory_order_release); }
+
+private:
+  uint8_t* _buf = nullptr;
+  size_t   _size = 0;
+  std::atomic<uint32_t> _head{0}, _tail{0};
+};
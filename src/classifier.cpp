@@ -0,0 +1,142 @@
+#include "classifier.h"
+#include <string.h>
+
+// ---- Reference model: 13 -> conv(24, k3, s2) -> conv(24, k3, s2) -> pool -> dense(2)
+
+#define REF_C1  24
+#define REF_C2  24
+
+static int8_t  refW1[REF_C1 * 3 * MFCC_COEFFS], refW2[REF_C2 * 3 * REF_C1], refDw[CLS_CLASSES * REF_C2];
+static int32_t refB1[REF_C1], refB2[REF_C2], refDb[CLS_CLASSES];
+
+static void fillRandom(int8_t* w, size_t n, uint32_t& s) {
+  for (size_t i = 0; i < n; i++) {
+    s ^= s << 13; s ^= s >> 17; s ^= s << 5;          // xorshift32
+    w[i] = (int8_t)(((int32_t)(s >> 24) - 128) / 2);  // -64..63
+  }
+}
+
+const ClsModel& clsReferenceModel() {
+  static ClsModel m;
+  if (!m.layers) {
+    uint32_t seed = 0x5EED1234;
+    fillRandom(refW1, sizeof(refW1), seed);
+    fillRandom(refW2, sizeof(refW2), seed);
+    fillRandom(refDw, sizeof(refDw), seed);
+    // Shifts chosen so speech-level input rarely saturates int8.
+    m.conv[0] = { MFCC_COEFFS, REF_C1, 3, 2, 7, refW1, refB1 };
+    m.conv[1] = { REF_C1, REF_C2, 3, 2, 8, refW2, refB2 };
+    m.dw = refDw;
+    m.db = refDb;
+    m.layers = 2;
+  }
+  return m;
+}
+
+// ---- SoundModel
+
+size_t SoundModel::arenaBytes(const ClsModel& m, size_t frames) {
+  if (!m.layers || m.layers > CLS_MAX_LAYERS || m.conv[0].in != MFCC_COEFFS) return 0;
+  size_t t = frames, maxAct = frames * MFCC_COEFFS;
+  for (int l = 0; l < m.layers; l++) {
+    const ClsConv& c = m.conv[l];
+    if ((l && c.in != m.conv[l - 1].out) || !c.stride || t < c.k) return 0;
+    t = (t - c.k) / c.stride + 1;
+    if (t * c.out > maxAct) maxAct = t * c.out;
+  }
+  maxAct = (maxAct + 3) & ~(size_t)3;
+  return 2 * maxAct + m.conv[m.layers - 1].out * sizeof(int32_t);
+}
+
+bool SoundModel::begin(const ClsModel& m, uint8_t* arena, size_t arenaLen, size_t frames) {
+  size_t need = arenaBytes(m, frames);
+  if (!need || need > arenaLen || ((uintptr_t)arena & 3)) return false;
+  _m = &m;
+  _frames = frames;
+  _maxAct = (need - m.conv[m.layers - 1].out * sizeof(int32_t)) / 2;
+  _a = (int8_t*)arena;
+  _b = _a + _maxAct;
+  _pool = (int32_t*)(_b + _maxAct);
+  return true;
+}
+
+static inline int8_t sat8(int32_t v) { return v > 127 ? 127 : v < -128 ? -128 : (int8_t)v; }
+
+int SoundModel::run(const int16_t* window, int32_t logits[CLS_CLASSES]) {
+  // Input: remove each coefficient's mean over the window (gain and
+  // channel invariance), then requantize to int8.
+  const int C = MFCC_COEFFS;
+  for (int c = 0; c < C; c++) {
+    int32_t sum = 0;
+    for (size_t t = 0; t < _frames; t++) sum += window[t * C + c];
+    int32_t mean = sum / (int32_t)_frames;
+    for (size_t t = 0; t < _frames; t++) _a[t * C + c] = sat8((window[t * C + c] - mean) >> CLS_IN_SHIFT);
+  }
+
+  int8_t* in = _a;
+  int8_t* out = _b;
+  size_t T = _frames;
+  for (int l = 0; l < _m->layers; l++) {
+    const ClsConv& cv = _m->conv[l];
+    size_t To = (T - cv.k) / cv.stride + 1, span = (size_t)cv.k * cv.in;
+    for (size_t t = 0; t < To; t++) {
+      const int8_t* x = in + t * cv.stride * cv.in;
+      for (int o = 0; o < cv.out; o++) {
+        const int8_t* w = cv.w + o * span;
+        int32_t acc = cv.b[o];
+        for (size_t j = 0; j < span; j++) acc += w[j] * x[j];
+        acc >>= cv.shift;
+        out[t * cv.out + o] = acc < 0 ? 0 : acc > 127 ? 127 : (int8_t)acc;
+      }
+    }
+    int8_t* tmp = in; in = out; out = tmp;
+    T = To;
+  }
+
+  const int Cl = _m->conv[_m->layers - 1].out;
+  for (int c = 0; c < Cl; c++) {
+    int32_t sum = 0;
+    for (size_t t = 0; t < T; t++) sum += in[t * Cl + c];
+    _pool[c] = sum / (int32_t)T;
+  }
+  int best = 0;
+  for (int k = 0; k < CLS_CLASSES; k++) {
+    int32_t acc = _m->db[k];
+    for (int c = 0; c < Cl; c++) acc += _m->dw[k * Cl + c] * _pool[c];
+    logits[k] = acc;
+    if (acc > logits[best]) best = k;
+  }
+  return best;
+}
+
+// ---- FeatureWindows
+
+bool FeatureWindows::push(const int16_t* feat) {
+  memcpy(_hist[_pos], feat, sizeof(_hist[0]));
+  return advance();
+}
+
+bool FeatureWindows::gap() {
+  if (_count) memcpy(_hist[_pos], _hist[(_pos + CLS_FRAMES - 1) % CLS_FRAMES], sizeof(_hist[0]));
+  else memset(_hist[_pos], 0, sizeof(_hist[0]));
+  _dropped.fetch_add(1, std::memory_order_relaxed);
+  return advance();
+}
+
+bool FeatureWindows::advance() {
+  _pos = (_pos + 1) % CLS_FRAMES;
+  if (_count < CLS_FRAMES && ++_count < CLS_FRAMES) return false;
+  if (++_sinceLast < CLS_STRIDE) return false;
+  _sinceLast = 0;
+  if (_ready.load(std::memory_order_acquire)) {    // inference still busy with the last one
+    _dropped.fetch_add(CLS_STRIDE, std::memory_order_relaxed);
+    return false;
+  }
+  // _pos is now the oldest frame.
+  size_t first = CLS_FRAMES - _pos;
+  memcpy(_job, _hist[_pos], first * sizeof(_hist[0]));
+  memcpy(_job + first * MFCC_COEFFS, _hist[0], _pos * sizeof(_hist[0]));
+  _windows.fetch_add(1, std::memory_order_relaxed);
+  _ready.store(true, std::memory_order_release);
+  return true;
+}
@@ -0,0 +1,93 @@
+// Sound classifier stage: MFCC frames in, class logits out.
+//
+// FeatureWindows sits between the audio task and the inference task. The
+// audio task appends one frame per hop to its own circular history. Every
+// CLS_STRIDE frames the last CLS_FRAMES are copied, oldest first, into the
+// second buffer that inference reads. If inference still holds that
+// buffer, the window is dropped and counted. The audio task never waits.
+//
+// SoundModel runs a small int8 1-D CNN (conv/ReLU layers over time, global
+// average pool, dense) on one window. Weights come from a ClsModel of
+// const tables. Activations live in a caller-supplied arena checked once
+// in begin(), as with TFLite Micro; run() allocates nothing.
+//
+// clsReferenceModel() has the intended layer shapes and fixed-seed
+// weights. It exercises scheduling, memory and timing. Its outputs mean
+// nothing until trained tables replace it.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "mfcc.h"
+
+#define CLS_FRAMES      98      // window: ~1 s of 10 ms hops
+#define CLS_STRIDE      25      // a new window every 250 ms
+#define CLS_CLASSES     2       // 0 = background, 1 = target sound
+#define CLS_MAX_LAYERS  4
+#define CLS_IN_SHIFT    3       // mean-removed Q6 features -> int8 Q3 (+-16 log2 units)
+
+// 1-D convolution over time: valid padding, ReLU, accumulator >> shift
+// saturated to int8. Weights are [out][k][in], so each output reads k
+// consecutive input frames as one contiguous run.
+struct ClsConv {
+  uint8_t in, out, k, stride, shift;
+  const int8_t*  w;
+  const int32_t* b;
+};
+
+struct ClsModel {
+  uint8_t        layers;
+  ClsConv        conv[CLS_MAX_LAYERS];
+  const int8_t*  dw;            // dense after the pool: [CLS_CLASSES][last conv out]
+  const int32_t* db;
+};
+
+const ClsModel& clsReferenceModel();
+
+class SoundModel {
+public:
+  // Arena bytes model m needs for `frames` input frames; 0 if the shapes
+  // do not chain.
+  static size_t arenaBytes(const ClsModel& m, size_t frames = CLS_FRAMES);
+
+  bool begin(const ClsModel& m, uint8_t* arena, size_t arenaLen, size_t frames = CLS_FRAMES);
+  // window: frames x MFCC_COEFFS features, Q(MFCC_Q), oldest first.
+  // Returns the arg-max class.
+  int run(const int16_t* window, int32_t logits[CLS_CLASSES]);
+
+private:
+  const ClsModel* _m = nullptr;
+  size_t   _frames = 0, _maxAct = 0;
+  int8_t*  _a = nullptr;        // ping-pong activations
+  int8_t*  _b = nullptr;
+  int32_t* _pool = nullptr;
+};
+
+class FeatureWindows {
+public:
+  // Audio task. One frame; true when a window was just handed over (wake
+  // the inference task).
+  bool push(const int16_t* feat);
+  // Audio task. The extractor skipped a hop: repeat the previous frame so
+  // windows keep their length in time, and count it as dropped.
+  bool gap();
+
+  // Inference task: the ready window or nullptr; done() returns it.
+  const int16_t* take() const { return _ready.load(std::memory_order_acquire) ? _job : nullptr; }
+  void done() { _ready.store(false, std::memory_order_release); }
+
+  uint32_t windows() const { return _windows.load(std::memory_order_relaxed); }
+  // Frames that never reached inference: gaps, plus CLS_STRIDE per
+  // dropped window.
+  uint32_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+private:
+  bool advance();
+
+  int16_t  _hist[CLS_FRAMES][MFCC_COEFFS];
+  int16_t  _job[CLS_FRAMES * MFCC_COEFFS];
+  size_t   _pos = 0, _count = 0;
+  size_t   _sinceLast = CLS_STRIDE - 1;   // first window as soon as the history is full
+  std::atomic<bool>     _ready{false};
+  std::atomic<uint32_t> _windows{0}, _dropped{0};
+};
@@ -0,0 +1,71 @@
+#include "clip_ring.h"
+#include <stdlib.h>
+#include <string.h>
+
+ClipRing::~ClipRing() { free(_buf); }
+
+bool ClipRing::begin(size_t preBytes, size_t postBytes, size_t slack) {
+  if (_buf) return true;
+  _size = preBytes + postBytes + slack;
+  _buf = (uint8_t*)malloc(_size);
+  if (!_buf) return false;
+  _pre = preBytes;
+  _post = postBytes;
+  return true;
+}
+
+bool ClipRing::trigger(uint8_t reason) {
+  if (!_buf || !reason) return false;
+  if (state() != CLIP_RECORDING) {
+    if (state() == CLIP_FROZEN) _missed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  uint8_t none = 0;
+  return _req.compare_exchange_strong(none, reason);
+}
+
+void ClipRing::release() {
+  if (state() == CLIP_FROZEN) _releaseReq.store(true, std::memory_order_release);
+}
+
+void ClipRing::write(const uint8_t* data, size_t n) {
+  if (!_buf) return;
+  uint8_t st = _state.load(std::memory_order_relaxed);
+  if (st == CLIP_FROZEN) {
+    if (!_releaseReq.exchange(false, std::memory_order_acquire)) return;
+    _validFrom = _written;
+    _req.store(0);
+    st = CLIP_RECORDING;
+    _state.store(st, std::memory_order_release);
+  }
+  if (st == CLIP_RECORDING) {
+    uint8_t r = _req.exchange(0);
+    if (r) {
+      _reason = r;
+      _trigAt = _written;
+      _clipStart = _written - _validFrom > _pre ? _written - _pre : _validFrom;
+      st = CLIP_POST;
+      _state.store(st, std::memory_order_release);
+    }
+  }
+  size_t pos = _written % _size, first = n < _size - pos ? n : _size - pos;
+  memcpy(_buf + pos, data, first);
+  if (n > first) memcpy(_buf, data + first, n - first);
+  _written += n;
+  if (st == CLIP_POST && _written >= _trigAt + _post) {
+    _clipEnd = _written;
+    if (_clipEnd - _clipStart > _size) _clipStart = _clipEnd - _size;   // only if slack < one write
+    _clips++;
+    _state.store(CLIP_FROZEN, std::memory_order_release);
+  }
+}
+
+size_t ClipRing::read(size_t off, uint8_t* out, size_t n) const {
+  size_t len = clipLength();
+  if (off >= len) return 0;
+  if (n > len - off) n = len - off;
+  size_t pos = (_clipStart + off) % _size, first = n < _size - pos ? n : _size - pos;
+  memcpy(out, _buf + pos, first);
+  if (n > first) memcpy(out + first, _buf, n - first);
+  return n;
+}
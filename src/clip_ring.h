@@ -0,0 +1,50 @@
+// Pre-trigger ring for event clips.
+//
+// Encoded audio (G.711, 8 KB/s) is written continuously into one ring.
+// When a trigger fires, recording continues for postBytes and then the
+// ring freezes with preBytes of audio before the trigger and postBytes
+// after it in place. Nothing is copied, so the only RAM is the ring itself
+// (pre + post + one period). While frozen the ring ignores writes, so the
+// HTTP side can read the clip without locks. release() resumes recording.
+// The next clip's pre-roll starts at the release point, so it never spans
+// the gap.
+//
+// write() runs on the audio task only. trigger() and release() may be
+// called from any task; the trigger takes effect at the next write.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+enum ClipState : uint8_t { CLIP_RECORDING, CLIP_POST, CLIP_FROZEN };
+
+class ClipRing {
+public:
+  ~ClipRing();
+  bool begin(size_t preBytes, size_t postBytes, size_t slack);
+  void write(const uint8_t* data, size_t n);
+  // False if a clip is already being captured or held.
+  bool trigger(uint8_t reason);
+  void release();
+
+  ClipState state() const { return (ClipState)_state.load(std::memory_order_acquire); }
+  uint8_t reason() const { return _reason; }
+  size_t clipLength() const { return state() == CLIP_FROZEN ? (size_t)(_clipEnd - _clipStart) : 0; }
+  size_t preLength() const { return state() == CLIP_FROZEN ? (size_t)(_trigAt - _clipStart) : 0; }
+  size_t read(size_t off, uint8_t* out, size_t n) const;   // frozen clip only
+  size_t capacity() const { return _size; }
+  uint32_t clips() const { return _clips; }
+  uint32_t missed() const { return _missed.load(std::memory_order_relaxed); }
+
+private:
+  uint8_t* _buf = nullptr;
+  size_t   _size = 0, _pre = 0, _post = 0;
+  uint64_t _written = 0, _validFrom = 0;      // byte counters since begin()
+  uint64_t _trigAt = 0, _clipStart = 0, _clipEnd = 0;
+  uint8_t  _reason = 0;
+  uint32_t _clips = 0;
+  std::atomic<uint8_t>  _state{CLIP_RECORDING};
+  std::atomic<uint8_t>  _req{0};              // pending trigger reason, 0 = none
+  std::atomic<bool>     _releaseReq{false};
+  std::atomic<uint32_t> _missed{0};
+};
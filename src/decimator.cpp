@@ -0,0 +1,85 @@
+#include "decimator.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+Decimator::~Decimator() {
+  free(_h);
+  free(_dl);
+}
+
+// Zeroth-order modified Bessel function, for the Kaiser window.
+static double besselI0(double x) {
+  double sum = 1, term = 1, q = x * x / 4;
+  for (int k = 1; k < 50 && term > 1e-12 * sum; k++) {
+    term *= q / ((double)k * k);
+    sum += term;
+  }
+  return sum;
+}
+
+void Decimator::designFloat(double* h, size_t n, unsigned factor, float cutoff, float beta) {
+  double fc = 0.5 * cutoff / factor;           // cycles per input sample
+  double mid = (n - 1) / 2.0, norm = besselI0(beta), sum = 0;
+  for (size_t k = 0; k < n; k++) {
+    double t = k - mid;
+    double sinc = t == 0 ? 2 * fc : sin(2 * M_PI * fc * t) / (M_PI * t);
+    double r = t / mid;
+    double w = besselI0(beta * sqrt(1 - r * r)) / norm;
+    h[k] = sinc * w;
+    sum += h[k];
+  }
+  for (size_t k = 0; k < n; k++) h[k] /= sum;
+}
+
+bool Decimator::design(unsigned factor, unsigned tapsPerPhase, float cutoff, float beta) {
+  size_t n = (size_t)tapsPerPhase * factor;
+  if (factor < 1 || n < 2) return false;
+  double* h = (double*)malloc(n * sizeof(double));
+  int16_t* q = (int16_t*)malloc(n * sizeof(int16_t));
+  if (!h || !q) { free(h); free(q); return false; }
+  designFloat(h, n, factor, cutoff, beta);
+  for (size_t k = 0; k < n; k++) q[k] = (int16_t)lround(h[k] * 32768.0);
+  bool ok = begin(factor, q, n);
+  free(h);
+  free(q);
+  return ok;
+}
+
+bool Decimator::begin(unsigned factor, const int16_t* taps, size_t n) {
+  if (factor < 1 || n < 1) return false;
+  free(_h);
+  free(_dl);
+  _h = (int16_t*)malloc(n * sizeof(int16_t));
+  _dl = (int32_t*)malloc(2 * n * sizeof(int32_t));
+  if (!_h || !_dl) { free(_h); free(_dl); _h = nullptr; _dl = nullptr; _n = 0; return false; }
+  memcpy(_h, taps, n * sizeof(int16_t));
+  _n = n;
+  _m = factor;
+  reset();
+  return true;
+}
+
+void Decimator::reset() {
+  if (_dl) memset(_dl, 0, 2 * _n * sizeof(int32_t));
+  _pos = 0;
+  _phase = 0;
+}
+
+size_t Decimator::process(const int32_t* in, size_t n, int16_t* out) {
+  size_t produced = 0;
+  for (size_t i = 0; i < n; i++) {
+    _pos = _pos ? _pos - 1 : _n - 1;
+    _dl[_pos] = _dl[_pos + _n] = in[i];
+    if (_phase == 0) {
+      const int32_t* x = _dl + _pos;            // x[0] newest
+      int64_t acc = 0;
+      for (size_t k = 0; k < _n; k++) acc += (int64_t)_h[k] * x[k];
+      // Q15 taps on 24-bit input -> 16-bit output.
+      int32_t y = (int32_t)((acc + (1LL << 22)) >> 23);
+      out[produced++] = y > 32767 ? 32767 : y < -32768 ? -32768 : (int16_t)y;
+    }
+    if (++_phase == _m) _phase = 0;
+  }
+  return produced;
+}
@@ -0,0 +1,47 @@
+// Fixed-point polyphase FIR decimator (e.g. 48 kHz -> 16 or 8 kHz).
+//
+// Input is 24-bit audio in int32_t (the capture ring format), output is
+// int16_t at rate/factor. Taps are Q15. Only every factor-th output is
+// computed, so each input sample costs taps/factor multiply-accumulates.
+// That is the cost of the M-branch polyphase structure. The delay line is
+// stored twice so the tap window is always contiguous. Blocks of any
+// length may be fed; state carries across calls.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#define DECIM_TAPS_PER_PHASE 32      // default length = 32 * factor
+#define DECIM_CUTOFF         0.9f    // -6 dB point, fraction of output Nyquist
+#define DECIM_KAISER_BETA    6.0f    // ~63 dB stopband
+
+class Decimator {
+public:
+  Decimator() {}
+  ~Decimator();
+
+  // Kaiser-windowed sinc low-pass, tapsPerPhase * factor taps, unity DC gain.
+  bool design(unsigned factor, unsigned tapsPerPhase = DECIM_TAPS_PER_PHASE,
+              float cutoff = DECIM_CUTOFF, float beta = DECIM_KAISER_BETA);
+  // Custom Q15 taps.
+  bool begin(unsigned factor, const int16_t* taps, size_t n);
+  void reset();
+
+  // Returns the number of outputs written (at most n / factor + 1).
+  size_t process(const int32_t* in, size_t n, int16_t* out);
+
+  unsigned factor() const { return _m; }
+  size_t taps() const { return _n; }
+  const int16_t* coeffs() const { return _h; }
+
+  // The floating-point prototype design() quantizes (h must hold n values).
+  static void designFloat(double* h, size_t n, unsigned factor, float cutoff, float beta);
+
+private:
+  Decimator(const Decimator&) = delete;
+  Decimator& operator=(const Decimator&) = delete;
+
+  int16_t* _h = nullptr;
+  int32_t* _dl = nullptr;       // 2 * _n, newest sample first
+  size_t   _n = 0, _pos = 0;
+  unsigned _m = 0, _phase = 0;
+};
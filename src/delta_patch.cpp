@@ -0,0 +1,77 @@
+#include "delta_patch.h"
+#include <string.h>
+
+#define DELTA_OP_COPY 0x01
+#define DELTA_OP_ADD  0x02
+
+static uint32_t le32(const uint8_t* p) { return p[0] | (p[1]<<8) | (p[2]<<16) | ((uint32_t)p[3]<<24); }
+
+void DeltaPatcher::begin(ReadFn rd, WriteFn wr, CheckFn check, void* ctx) {
+  _rd = rd; _wr = wr; _check = check; _ctx = ctx;
+  _st = ST_HEADER; _err = DELTA_OK;
+  _have = 0; _need = DELTA_HDR_LEN;
+  _addLeft = 0; _out = 0;
+}
+
+DeltaResult DeltaPatcher::runCopy(uint32_t off, uint32_t len) {
+  if ((uint64_t)off + len > _hdr.srcSize || (uint64_t)_out + len > _hdr.dstSize) return fail(DELTA_ERR_FORMAT);
+  while (len) {
+    size_t n = len < DELTA_COPY_BUF ? len : DELTA_COPY_BUF;
+    if (!_rd(_ctx, off, _copy, n)) return fail(DELTA_ERR_READ);
+    if (!_wr(_ctx, _copy, n)) return fail(DELTA_ERR_WRITE);
+    off += n; len -= n; _out += n;
+  }
+  return DELTA_OK;
+}
+
+DeltaResult DeltaPatcher::feed(const uint8_t* p, size_t len) {
+  while (len) {
+    switch (_st) {
+      case ST_HEADER:
+      case ST_ARGS: {
+        size_t n = _need - _have;
+        if (n > len) n = len;
+        memcpy(_buf + _have, p, n);
+        _have += n; p += n; len -= n;
+        if (_have < _need) break;
+        if (_st == ST_HEADER) {
+          if (memcmp(_buf, "ADLT", 4) != 0 || _buf[4] != DELTA_VERSION) return fail(DELTA_ERR_FORMAT);
+          _hdr.srcSize = le32(_buf + 8);
+          _hdr.dstSize = le32(_buf + 12);
+          memcpy(_hdr.srcSha, _buf + 16, 32);
+          memcpy(_hdr.dstSha, _buf + 48, 32);
+          if (_check && !_check(_ctx, _hdr)) return fail(DELTA_ERR_SOURCE);
+          _st = _hdr.dstSize ? ST_OP : ST_DONE;
+        } else if (_op == DELTA_OP_COPY) {
+          if (runCopy(le32(_buf), le32(_buf + 4)) != DELTA_OK) return _err;
+          _st = _out == _hdr.dstSize ? ST_DONE : ST_OP;
+        } else {
+          _addLeft = le32(_buf);
+          if (!_addLeft || (uint64_t)_out + _addLeft > _hdr.dstSize) return fail(DELTA_ERR_FORMAT);
+          _st = ST_ADD;
+        }
+        break;
+      }
+      case ST_OP:
+        _op = *p++; len--;
+        if (_op == DELTA_OP_COPY)     _need = 8;
+        else if (_op == DELTA_OP_ADD) _need = 4;
+        else return fail(DELTA_ERR_FORMAT);
+        _have = 0;
+        _st = ST_ARGS;
+        break;
+      case ST_ADD: {
+        size_t n = _addLeft < len ? _addLeft : len;
+        if (!_wr(_ctx, p, n)) return fail(DELTA_ERR_WRITE);
+        p += n; len -= n; _addLeft -= n; _out += n;
+        if (!_addLeft) _st = _out == _hdr.dstSize ? ST_DONE : ST_OP;
+        break;
+      }
+      case ST_DONE:
+        return fail(DELTA_ERR_FORMAT);          // trailing garbage
+      case ST_ERROR:
+        return _err;
+    }
+  }
+  return _st == ST_DONE ? DELTA_DONE : DELTA_OK;
+}
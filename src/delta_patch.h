@@ -0,0 +1,55 @@
+// Streaming applier for ADLT delta patches (see tools/mkdelta.py).
+//
+// Header (80 bytes, little-endian):
+//   "ADLT" ver(1) reserved(3) src_size(4) dst_size(4) src_sha256(32) dst_sha256(32)
+// Followed by ops until dst_size bytes have been produced:
+//   0x01 COPY  src_off(4) len(4)        copy len bytes from the running image
+//   0x02 ADD   len(4) bytes[len]        literal bytes
+//
+// The patch can be fed in arbitrarily sized pieces; RAM use is fixed at
+// sizeof(DeltaPatcher) (under 0.5 KB), independent of image size.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#define DELTA_HDR_LEN   80
+#define DELTA_VERSION   1
+#define DELTA_COPY_BUF  256
+
+struct DeltaHeader {
+  uint32_t srcSize, dstSize;
+  uint8_t  srcSha[32], dstSha[32];
+};
+
+enum DeltaResult : uint8_t { DELTA_OK, DELTA_DONE, DELTA_ERR_FORMAT, DELTA_ERR_SOURCE, DELTA_ERR_READ, DELTA_ERR_WRITE };
+
+class DeltaPatcher {
+public:
+  typedef bool (*ReadFn)(void* ctx, uint32_t off, uint8_t* buf, size_t len);
+  typedef bool (*WriteFn)(void* ctx, const uint8_t* buf, size_t len);
+  typedef bool (*CheckFn)(void* ctx, const DeltaHeader& hdr);   // vet the source image
+
+  void begin(ReadFn rd, WriteFn wr, CheckFn check, void* ctx);
+  DeltaResult feed(const uint8_t* data, size_t len);
+
+  const DeltaHeader& header() const { return _hdr; }
+  uint32_t produced() const { return _out; }
+  bool done() const { return _st == ST_DONE; }
+
+private:
+  enum State : uint8_t { ST_HEADER, ST_OP, ST_ARGS, ST_ADD, ST_DONE, ST_ERROR };
+  DeltaResult fail(DeltaResult r) { _st = ST_ERROR; _err = r; return r; }
+  DeltaResult runCopy(uint32_t off, uint32_t len);
+
+  ReadFn      _rd = nullptr;
+  WriteFn     _wr = nullptr;
+  CheckFn     _check = nullptr;
+  void*       _ctx = nullptr;
+  State       _st = ST_HEADER;
+  DeltaResult _err = DELTA_OK;
+  DeltaHeader _hdr = {};
+  uint8_t     _buf[DELTA_HDR_LEN];          // header / op-argument accumulator
+  uint8_t     _have = 0, _need = 0, _op = 0;
+  uint32_t    _addLeft = 0, _out = 0;
+  uint8_t     _copy[DELTA_COPY_BUF];
+};
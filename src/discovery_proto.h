@@ -0,0 +1,54 @@
+// Fleet discovery wire format (UDP, little-endian, fixed size).
+//
+// Query  (8 bytes):  "ANVQ" ver flags nonce(2)
+// Reply (32 bytes):  "ANVR" ver flags nonce(2) mac(6) fw(3) rssi ip(4)
+//                    uptime_s(4) free_heap(4) reserved(2)
+//
+// Query flags bit0 asks units to spread replies over DISC_SPREAD_MS so a
+// large fleet doesn't answer in one burst.
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+#define DISC_VERSION     1
+#define DISC_QUERY_LEN   8
+#define DISC_REPLY_LEN   32
+#define DISC_SPREAD_MS   500
+
+#define DISC_QF_SPREAD   0x01
+#define DISC_RF_AP       0x01   // unit is (also) running its provisioning AP
+#define DISC_RF_RELAY    0x02   // unit is relaying credentials
+
+struct DiscReply {
+  uint8_t  flags;
+  uint16_t nonce;
+  uint8_t  mac[6];
+  uint8_t  fw[3];               // major, minor, patch
+  int8_t   rssi;
+  uint8_t  ip[4];
+  uint32_t uptimeS;
+  uint32_t freeHeap;
+};
+
+static inline bool discParseQuery(const uint8_t* p, size_t len, uint8_t& flags, uint16_t& nonce) {
+  if (len < DISC_QUERY_LEN || memcmp(p, "ANVQ", 4) != 0 || p[4] != DISC_VERSION) return false;
+  flags = p[5];
+  nonce = p[6] | (p[7] << 8);
+  return true;
+}
+
+static inline void discPutLE32(uint8_t* p, uint32_t v) { p[0]=v; p[1]=v>>8; p[2]=v>>16; p[3]=v>>24; }
+
+static inline void discEncodeReply(const DiscReply& r, uint8_t out[DISC_REPLY_LEN]) {
+  memcpy(out, "ANVR", 4);
+  out[4] = DISC_VERSION;
+  out[5] = r.flags;
+  out[6] = r.nonce; out[7] = r.nonce >> 8;
+  memcpy(out + 8, r.mac, 6);
+  memcpy(out + 14, r.fw, 3);
+  out[17] = (uint8_t)r.rssi;
+  memcpy(out + 18, r.ip, 4);
+  discPutLE32(out + 22, r.uptimeS);
+  discPutLE32(out + 26, r.freeHeap);
+  out[30] = out[31] = 0;
+}
@@ -0,0 +1,77 @@
+#include "envelope.h"
+#include <math.h>
+
+#define ENV_DC_MS  1000                 // DC tracking time constant
+
+uint32_t EnvelopeDetector::coef(uint32_t ms) const {
+  // One-pole smoothing per block: 1 - exp(-block / (rate * tau)).
+  double k = 1.0 - exp(-(double)_cfg.block * 1000.0 / ((double)_cfg.rate * (ms ? ms : 1)));
+  uint32_t q = (uint32_t)lround(k * 65536.0);
+  return q > 65535 ? 65535 : q ? q : 1;
+}
+
+bool EnvelopeDetector::begin(const EnvConfig& c) {
+  if (!c.rate || !c.block || c.offLevel > c.onLevel) return false;
+  _cfg = c;
+  _kAttack = coef(c.attackMs);
+  _kRelease = coef(c.releaseMs);
+  _kDc = coef(ENV_DC_MS);
+  _minSamples = (uint32_t)((uint64_t)c.minEventMs * c.rate / 1000);
+  reset();
+  return true;
+}
+
+void EnvelopeDetector::reset() {
+  _env = _dc = 0;
+  _dcValid = _active = false;
+  _peak = 0;
+  _events = 0;
+  _samples = _onset = _lastLen = 0;
+}
+
+EnvEvent EnvelopeDetector::process(const uint16_t* x, size_t n) {
+  if (!n || !_cfg.rate) return ENV_NONE;
+  int32_t dc = _dc >> 8;
+  uint32_t sum = 0, dev = 0;
+  for (size_t i = 0; i < n; i++) {
+    int32_t v = x[i] & 0x0FFF;
+    int32_t d = v - dc;
+    sum += v;
+    dev += d < 0 ? -d : d;
+  }
+  _samples += n;
+
+  // The DC estimate starts at the first block's mean, so the first event
+  // is not a power-up artefact.
+  uint32_t mean8 = (uint32_t)(((uint64_t)sum << 8) / n);
+  if (!_dcValid) {
+    _dc = mean8;
+    _dcValid = true;
+    return ENV_NONE;
+  }
+  // Coefficients are per nominal block; scale for short or long blocks.
+  auto scaled = [&](uint32_t k) -> uint32_t {
+    uint64_t s = (uint64_t)k * n / _cfg.block;
+    return s > 65535 ? 65535 : (uint32_t)s;
+  };
+  _dc = (uint32_t)((int32_t)_dc + (int32_t)(((int64_t)((int32_t)mean8 - (int32_t)_dc) * scaled(_kDc)) >> 16));
+
+  uint32_t target = (uint32_t)(((uint64_t)dev << 16) / n);
+  uint32_t k = scaled(target > _env ? _kAttack : _kRelease);
+  _env = (uint32_t)((int64_t)_env + (((int64_t)target - (int64_t)_env) * k >> 16));
+
+  uint16_t lvl = level();
+  if (!_active) {
+    if (lvl < _cfg.onLevel) return ENV_NONE;
+    _active = true;
+    _onset = _samples - n;
+    _peak = lvl;
+    _events++;
+    return ENV_ONSET;
+  }
+  if (lvl > _peak) _peak = lvl;
+  if (lvl >= _cfg.offLevel || _samples - _onset < _minSamples) return ENV_NONE;
+  _active = false;
+  _lastLen = _samples - _onset;
+  return ENV_RELEASE;
+}
@@ -0,0 +1,54 @@
+// Sound-level envelope and threshold events for an analog microphone
+// module (KY-038 AO) sampled by the ADC.
+//
+// Works on blocks of raw 12-bit samples. Per sample it only adds to the
+// block sum and to the absolute deviation from the running DC estimate
+// (the module idles near mid-scale). Once per block it updates the DC
+// estimate, smooths the block's mean deviation with attack/release
+// coefficients in Q16, and runs a hysteresis comparator with a minimum
+// event length. No floating point after begin().
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+enum EnvEvent : uint8_t { ENV_NONE, ENV_ONSET, ENV_RELEASE };
+
+struct EnvConfig {
+  uint32_t rate;                  // samples per second
+  size_t   block;                 // nominal samples per process() call
+  uint16_t attackMs, releaseMs;
+  uint16_t onLevel, offLevel;     // envelope thresholds, ADC counts of mean deviation
+  uint16_t minEventMs;            // an event stays open at least this long
+};
+
+class EnvelopeDetector {
+public:
+  bool begin(const EnvConfig& c);
+  void reset();
+
+  // x: raw ADC samples; bits 12-15 are ignored (the ESP32 ADC DMA puts the
+  // channel number there). At most one event per call.
+  EnvEvent process(const uint16_t* x, size_t n);
+
+  uint16_t level() const { return _env >> 16; }
+  uint16_t dc() const { return _dc >> 8; }
+  bool     active() const { return _active; }
+  uint16_t peak() const { return _peak; }               // of the current / last event
+  uint32_t events() const { return _events; }
+  uint64_t samples() const { return _samples; }
+  // Length of the last finished event, or of the current one so far.
+  uint32_t eventMs() const { return (uint32_t)((_active ? _samples - _onset : _lastLen) * 1000 / _cfg.rate); }
+
+private:
+  uint32_t coef(uint32_t ms) const;
+
+  EnvConfig _cfg = {};
+  uint32_t  _kAttack = 0, _kRelease = 0, _kDc = 0;    // Q16, per nominal block
+  uint32_t  _minSamples = 0;
+  uint32_t  _env = 0;             // Q16 counts
+  uint32_t  _dc = 0;              // Q8 counts
+  bool      _dcValid = false, _active = false;
+  uint16_t  _peak = 0;
+  uint32_t  _events = 0;
+  uint64_t  _samples = 0, _onset = 0, _lastLen = 0;
+};
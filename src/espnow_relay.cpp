@@ -0,0 +1,177 @@
+#include "espnow_relay.h"
+#include <string.h>
+#ifdef RELAY_MBEDTLS
+#include <mbedtls/ccm.h>
+#endif
+
+static const uint8_t BCAST[6] = {0xFF,0xFF,0xFF,0xFF,0xFF,0xFF};
+#define RELAY_OFFER_PT_LEN (1+32+1+64+1)
+#define RELAY_ACK_GAP_MS   30
+
+static void putLE32(uint8_t* p, uint32_t v) { p[0]=v; p[1]=v>>8; p[2]=v>>16; p[3]=v>>24; }
+static uint32_t getLE32(const uint8_t* p) { return p[0] | (p[1]<<8) | (p[2]<<16) | ((uint32_t)p[3]<<24); }
+
+void CredRelay::setKey(const uint8_t key[RELAY_KEY_LEN]) {
+  memcpy(_key, key, RELAY_KEY_LEN);
+  _haveKey = false;
+  for (int i = 0; i < RELAY_KEY_LEN; i++) if (key[i]) _haveKey = true;  // all-zero = unset
+}
+
+bool CredRelay::startDonor(const RelayCreds& creds, uint32_t now, uint32_t windowMs) {
+  if (!_haveKey || !creds.ssid[0]) return false;
+  _creds = creds;
+  _radio.random((uint8_t*)&_epoch, sizeof(_epoch));
+  if (!_epoch) _epoch = 1;                  // 0 means "no offer accepted" on the requester
+  _role = RELAY_DONOR;
+  _tStart = now; _window = windowMs; _tNext = now;
+  memset(_ackedMac, 0, sizeof(_ackedMac));
+  _stats = RelayStats();
+  return true;
+}
+
+bool CredRelay::startRequester(uint32_t now, CredsCallback cb, void* ctx) {
+  if (!_haveKey) return false;
+  _role = RELAY_REQUESTER;
+  _cb = cb; _cbCtx = ctx;
+  _epoch = 0; _acksLeft = 0;
+  _tStart = now; _window = 0; _tNext = now + RELAY_DWELL_MS;
+  _stats = RelayStats();
+  return true;
+}
+
+void CredRelay::stop() {
+  _role = RELAY_IDLE;
+  memset(&_creds, 0, sizeof(_creds));
+}
+
+bool CredRelay::acked(const uint8_t mac[6]) const {
+  for (uint32_t i = 0; i < _stats.unitsAcked && i < RELAY_MAX_ACKED; i++)
+    if (!memcmp(_ackedMac[i], mac, 6)) return true;
+  return false;
+}
+
+// One CCM pass over the frame: the first 8 bytes are the associated data.
+bool CredRelay::ccm(bool enc, size_t len, const uint8_t* nonce, const uint8_t* ad, const uint8_t* in, uint8_t* out,
+                    uint8_t* tag) {
+#ifdef RELAY_MBEDTLS
+  mbedtls_ccm_context c;
+  mbedtls_ccm_init(&c);
+  int rc = mbedtls_ccm_setkey(&c, MBEDTLS_CIPHER_ID_AES, _key, RELAY_KEY_LEN * 8);
+  if (rc == 0)
+    rc = enc ? mbedtls_ccm_encrypt_and_tag(&c, len, nonce, RELAY_NONCE_LEN, ad, 8, in, out, tag, RELAY_TAG_LEN)
+             : mbedtls_ccm_auth_decrypt(&c, len, nonce, RELAY_NONCE_LEN, ad, 8, in, out, tag, RELAY_TAG_LEN);
+  mbedtls_ccm_free(&c);
+  return rc == 0;
+#else
+  SoftAesCcm c;
+  c.setKey(_key);
+  return enc ? c.encrypt(len, nonce, RELAY_NONCE_LEN, ad, 8, in, out, tag, RELAY_TAG_LEN)
+             : c.decrypt(len, nonce, RELAY_NONCE_LEN, ad, 8, in, out, tag, RELAY_TAG_LEN);
+#endif
+}
+
+bool CredRelay::seal(uint8_t type, const uint8_t* pt, size_t ptLen, uint8_t* out, size_t& outLen) {
+  out[0] = RELAY_MAGIC0; out[1] = RELAY_MAGIC1; out[2] = RELAY_VERSION; out[3] = type;
+  putLE32(out + 4, _epoch);
+  _radio.random(out + 8, RELAY_NONCE_LEN);
+  outLen = RELAY_HDR_LEN + ptLen + RELAY_TAG_LEN;
+  return ccm(true, ptLen, out + 8, out, pt, out + RELAY_HDR_LEN, out + RELAY_HDR_LEN + ptLen);
+}
+
+bool CredRelay::open(const uint8_t* in, size_t inLen, uint8_t* pt, size_t& ptLen) {
+  if (inLen < RELAY_HDR_LEN + 1 + RELAY_TAG_LEN || inLen > RELAY_FRAME_MAX) return false;
+  ptLen = inLen - RELAY_HDR_LEN - RELAY_TAG_LEN;
+  return ccm(false, ptLen, in + 8, in, in + RELAY_HDR_LEN, pt, (uint8_t*)in + RELAY_HDR_LEN + ptLen);
+}
+
+void CredRelay::sendOffer() {
+  uint8_t pt[RELAY_OFFER_PT_LEN] = {0};
+  size_t sl = strnlen(_creds.ssid, 32), pl = strnlen(_creds.pass, 64);
+  pt[0] = sl;      memcpy(pt + 1, _creds.ssid, sl);
+  pt[33] = pl;     memcpy(pt + 34, _creds.pass, pl);
+  pt[98] = _creds.hops;
+  uint8_t frame[RELAY_FRAME_MAX];
+  size_t len;
+  if (seal(RELAY_OFFER, pt, sizeof(pt), frame, len) && _radio.send(BCAST, frame, len)) _stats.offersSent++;
+  memset(pt, 0, sizeof(pt));
+}
+
+void CredRelay::sendAck() {
+  uint8_t pt[1] = { RELAY_ACK_STORED };
+  uint8_t frame[RELAY_FRAME_MAX];
+  size_t len;
+  if (seal(RELAY_ACK, pt, sizeof(pt), frame, len) && _radio.send(BCAST, frame, len)) _stats.acksSent++;
+}
+
+void CredRelay::tick(uint32_t now) {
+  if (_role == RELAY_DONOR) {
+    if (_window && now - _tStart >= _window) { stop(); return; }
+    if ((int32_t)(now - _tNext) >= 0) {
+      sendOffer();
+      uint8_t j; _radio.random(&j, 1);
+      _tNext = now + RELAY_OFFER_MS - 10 + (j % 21);  // +-10 ms jitter avoids lockstep donors
+    }
+  } else if (_role == RELAY_REQUESTER) {
+    if ((int32_t)(now - _tNext) < 0) return;
+    if (_acksLeft) {
+      sendAck();
+      _tNext = now + RELAY_ACK_GAP_MS;
+      if (--_acksLeft == 0) {
+        RelayCreds c = _creds;
+        CredsCallback cb = _cb; void* ctx = _cbCtx;
+        stop();
+        if (cb) cb(c, ctx);
+        memset(&c, 0, sizeof(c));
+      }
+    } else if (!_epoch) {
+      _tNext = now + RELAY_DWELL_MS;
+      if (!_radio.canHop()) return;           // someone is using the portal on this channel
+      uint8_t next = _chan % RELAY_MAX_CHANNEL + 1;
+      if (_radio.setChannel(next)) { _chan = next; _stats.channelHops++; }
+    }
+  }
+}
+
+bool CredRelay::handleOffer(const uint8_t* pt, size_t ptLen, uint32_t now) {
+  if (ptLen != RELAY_OFFER_PT_LEN || pt[0] == 0 || pt[0] > 32 || pt[33] > 64) { _stats.offersBad++; return false; }
+  RelayCreds c = {};
+  memcpy(c.ssid, pt + 1, pt[0]);
+  memcpy(c.pass, pt + 34, pt[33]);
+  c.hops = pt[98];
+  _creds = c;
+  memset(&c, 0, sizeof(c));
+  _acksLeft = RELAY_ACK_REPEAT;
+  _tNext = now;
+  return true;
+}
+
+void CredRelay::handleAck(const uint8_t src[6], const uint8_t* pt, size_t ptLen) {
+  if (ptLen != 1) { _stats.acksBad++; return; }
+  _stats.acksRecv++;
+  if (pt[0] != RELAY_ACK_STORED) return;    // heard, but the unit did not take the credentials
+  if (acked(src) || _stats.unitsAcked >= RELAY_MAX_ACKED) return;
+  memcpy(_ackedMac[_stats.unitsAcked++], src, 6);
+}
+
+void CredRelay::onFrame(const uint8_t src[6], const uint8_t* data, size_t len, uint32_t now) {
+  if (_role == RELAY_IDLE || len < RELAY_HDR_LEN || data[0] != RELAY_MAGIC0 ||
+      data[1] != RELAY_MAGIC1 || data[2] != RELAY_VERSION) return;
+  uint8_t type = data[3];
+  uint32_t epoch = getLE32(data + 4);
+  bool wanted = (_role == RELAY_REQUESTER && type == RELAY_OFFER && !_epoch) ||
+                (_role == RELAY_DONOR && type == RELAY_ACK && epoch == _epoch);
+  if (!wanted) return;
+  uint8_t pt[RELAY_OFFER_PT_LEN];
+  size_t ptLen = 0;
+  if (!open(data, len, pt, ptLen)) {
+    if (type == RELAY_OFFER) _stats.offersBad++; else _stats.acksBad++;
+    return;
+  }
+  if (type == RELAY_OFFER) {
+    _stats.offersRecv++;
+    if (handleOffer(pt, ptLen, now)) _epoch = epoch;   // ACKs carry the donor's epoch
+  } else {
+    handleAck(src, pt, ptLen);
+  }
+  memset(pt, 0, sizeof(pt));
+}
@@ -0,0 +1,114 @@
+// ESP-NOW credential relay for bulk provisioning.
+//
+// A provisioned unit (donor) broadcasts an OFFER frame carrying the Wi-Fi
+// credentials, encrypted and authenticated with AES-128-CCM under a fleet
+// pre-shared key. Unprovisioned units (requesters) still in captive-AP mode
+// hop channels until they hear an OFFER, decrypt it, answer with an
+// authenticated ACK and hand the credentials to the sketch.
+//
+// The protocol is independent of the radio: the sketch plugs in ESP-NOW,
+// a host build plugs in the simulated medium from espnow_relay_sim.h.
+// CCM goes through mbedtls on the device; host builds use soft_crypto.h
+// unless RELAY_USE_MBEDTLS is defined.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(ARDUINO) || defined(RELAY_USE_MBEDTLS)
+#define RELAY_MBEDTLS 1
+#else
+#include "soft_crypto.h"
+#endif
+
+#define RELAY_MAGIC0        'A'
+#define RELAY_MAGIC1        'R'
+#define RELAY_VERSION       1
+#define RELAY_KEY_LEN       16
+#define RELAY_NONCE_LEN     12
+#define RELAY_TAG_LEN       16
+#define RELAY_MAX_ACKED     64     // distinct units remembered per relay window
+#define RELAY_OFFER_MS      100    // donor broadcast period
+#define RELAY_DWELL_MS      220    // requester dwell per channel (> 2 offer periods)
+#define RELAY_ACK_REPEAT    3
+#define RELAY_ACK_STORED    0      // ACK status: credentials stored; anything else is a refusal
+#define RELAY_MAX_CHANNEL   13
+#define RELAY_HDR_LEN       (8 + RELAY_NONCE_LEN)
+#define RELAY_FRAME_MAX     (RELAY_HDR_LEN + 1+32+1+64+1 + RELAY_TAG_LEN)
+
+enum RelayFrameType : uint8_t { RELAY_OFFER = 1, RELAY_ACK = 2 };
+enum RelayRole : uint8_t { RELAY_IDLE, RELAY_DONOR, RELAY_REQUESTER };
+
+// Radio abstraction: broadcast/unicast send and channel control.
+class RelayRadio {
+public:
+  virtual ~RelayRadio() {}
+  virtual bool send(const uint8_t dst[6], const uint8_t* data, size_t len) = 0;
+  virtual bool setChannel(uint8_t ch) = 0;
+  virtual bool canHop() = 0;              // false while the AP has clients, etc.
+  virtual void random(uint8_t* out, size_t len) = 0;
+};
+
+struct RelayCreds {
+  char    ssid[33];
+  char    pass[65];
+  uint8_t hops;                           // further relays the receiver may perform
+};
+
+struct RelayStats {
+  uint32_t offersSent, offersRecv, offersBad;
+  uint32_t acksSent, acksRecv, acksBad;
+  uint32_t unitsAcked;                    // distinct MACs acknowledged this window
+  uint32_t channelHops;                   // requester only
+};
+
+class CredRelay {
+public:
+  typedef void (*CredsCallback)(const RelayCreds& creds, void* ctx);
+
+  explicit CredRelay(RelayRadio& radio) : _radio(radio) {}
+
+  void setKey(const uint8_t key[RELAY_KEY_LEN]);
+  bool hasKey() const { return _haveKey; }
+
+  // Donor: broadcast creds until stop() or windowMs elapses.
+  bool startDonor(const RelayCreds& creds, uint32_t now, uint32_t windowMs);
+  // Requester: hop channels listening for offers; cb fires once on success.
+  bool startRequester(uint32_t now, CredsCallback cb, void* ctx);
+  void stop();
+
+  // Drive timers; call often (every loop()).
+  void tick(uint32_t now);
+  // Feed a received frame.
+  void onFrame(const uint8_t src[6], const uint8_t* data, size_t len, uint32_t now);
+
+  RelayRole role() const { return _role; }
+  uint8_t channel() const { return _chan; }
+  const RelayStats& stats() const { return _stats; }
+  bool acked(const uint8_t mac[6]) const;
+
+private:
+  // Frame: 'A' 'R' ver type | epoch(4, LE) | nonce(12) | ciphertext | tag(16).
+  // The first 8 bytes are authenticated as associated data.
+  bool seal(uint8_t type, const uint8_t* pt, size_t ptLen, uint8_t* out, size_t& outLen);
+  bool open(const uint8_t* in, size_t inLen, uint8_t* pt, size_t& ptLen);
+  void sendOffer();
+  void sendAck();
+  bool handleOffer(const uint8_t* pt, size_t ptLen, uint32_t now);
+  void handleAck(const uint8_t src[6], const uint8_t* pt, size_t ptLen);
+  bool ccm(bool enc, size_t len, const uint8_t* nonce, const uint8_t* ad, const uint8_t* in, uint8_t* out,
+           uint8_t* tag);
+
+  RelayRadio&   _radio;
+  uint8_t       _key[RELAY_KEY_LEN] = {0};
+  bool          _haveKey = false;
+  RelayRole     _role = RELAY_IDLE;
+  RelayCreds    _creds = {};
+  uint32_t      _epoch = 0;               // donor: constant per window; requester: accepted epoch
+  uint32_t      _tStart = 0, _window = 0, _tNext = 0;
+  uint8_t       _chan = 1;
+  uint8_t       _acksLeft = 0;
+  CredsCallback _cb = nullptr;
+  void*         _cbCtx = nullptr;
+  uint8_t       _ackedMac[RELAY_MAX_ACKED][6];
+  RelayStats    _stats = {};
+};
@@ -0,0 +1,84 @@
+// Host-only simulated ESP-NOW medium for exercising CredRelay without radios.
+// Frames sent by one node reach every other node tuned to the same channel
+// after a fixed latency, subject to a configurable loss rate.
+#pragma once
+#ifndef ARDUINO
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "espnow_relay.h"
+
+class RelaySimMedium;
+
+class RelaySimRadio : public RelayRadio {
+public:
+  RelaySimRadio(RelaySimMedium& medium, const uint8_t mac[6], uint8_t channel)
+    : _medium(medium), _chan(channel) { memcpy(this->mac, mac, 6); }
+  bool send(const uint8_t dst[6], const uint8_t* data, size_t len) override;
+  bool setChannel(uint8_t ch) override { _chan = ch; return true; }
+  bool canHop() override { return !busy; }
+  void random(uint8_t* out, size_t len) override { for (size_t i = 0; i < len; i++) out[i] = (uint8_t)rand(); }
+  uint8_t channel() const { return _chan; }
+
+  uint8_t    mac[6];
+  bool       busy = false;                // simulate "AP has clients"
+  CredRelay* relay = nullptr;             // receiver for delivered frames
+private:
+  RelaySimMedium& _medium;
+  uint8_t         _chan;
+};
+
+class RelaySimMedium {
+public:
+  explicit RelaySimMedium(uint32_t latencyMs = 2, uint32_t lossPct = 0, unsigned seed = 1)
+    : _latency(latencyMs), _loss(lossPct) { srand(seed); }
+
+  void attach(RelaySimRadio* r) { _radios.push_back(r); }
+
+  void transmit(RelaySimRadio* from, const uint8_t dst[6], const uint8_t* data, size_t len) {
+    Frame f;
+    memcpy(f.src, from->mac, 6);
+    memcpy(f.dst, dst, 6);
+    f.chan = from->channel();
+    f.due = _now + _latency;
+    f.data.assign(data, data + len);
+    _inflight.push_back(f);
+    sent++;
+  }
+
+  // Advance simulated time by one millisecond, delivering due frames and
+  // ticking every attached relay.
+  void step() {
+    _now++;
+    for (size_t i = 0; i < _inflight.size();) {
+      Frame& f = _inflight[i];
+      if (f.due > _now) { i++; continue; }
+      static const uint8_t bcast[6] = {0xFF,0xFF,0xFF,0xFF,0xFF,0xFF};
+      bool isBcast = !memcmp(f.dst, bcast, 6);
+      for (RelaySimRadio* r : _radios) {
+        if (!memcmp(r->mac, f.src, 6) || r->channel() != f.chan || !r->relay) continue;
+        if (!isBcast && memcmp(r->mac, f.dst, 6)) continue;
+        if ((uint32_t)(rand() % 100) < _loss) { lost++; continue; }
+        r->relay->onFrame(f.src, f.data.data(), f.data.size(), _now);
+        delivered++;
+      }
+      _inflight.erase(_inflight.begin() + i);
+    }
+    for (RelaySimRadio* r : _radios) if (r->relay) r->relay->tick(_now);
+  }
+
+  uint32_t now() const { return _now; }
+  uint32_t sent = 0, delivered = 0, lost = 0;
+
+private:
+  struct Frame { uint8_t src[6], dst[6]; uint8_t chan; uint32_t due; std::vector<uint8_t> data; };
+  std::vector<RelaySimRadio*> _radios;
+  std::vector<Frame>          _inflight;
+  uint32_t _now = 0, _latency, _loss;
+};
+
+inline bool RelaySimRadio::send(const uint8_t dst[6], const uint8_t* data, size_t len) {
+  _medium.transmit(this, dst, data, len);
+  return true;
+}
+#endif  // !ARDUINO
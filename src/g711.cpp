@@ -0,0 +1,157 @@
+#include "g711.h"
+
+#define ULAW_BIAS 0x84
+#define ULAW_CLIP 8159
+
+// Segment (exponent) of a 13-bit A-law magnitude, indexed by magnitude >> 4.
+static const uint8_t kSegA[256] = {
+  0, 0, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+  5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+  6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+  6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+  7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+  7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+  7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+  7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+};
+
+// Segment of a biased 14-bit mu-law magnitude, indexed by magnitude >> 6.
+static const uint8_t kSegU[129] = {
+  0, 1, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+  6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+  7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+  7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+  8,
+};
+
+static const int16_t kAlawToLinear[256] = {
+   -5504,  -5248,  -6016,  -5760,  -4480,  -4224,  -4992,  -4736,  -7552,  -7296,  -8064,  -7808,
+   -6528,  -6272,  -7040,  -6784,  -2752,  -2624,  -3008,  -2880,  -2240,  -2112,  -2496,  -2368,
+   -3776,  -3648,  -4032,  -3904,  -3264,  -3136,  -3520,  -3392, -22016, -20992, -24064, -23040,
+  -17920, -16896, -19968, -18944, -30208, -29184, -32256, -31232, -26112, -25088, -28160, -27136,
+  -11008, -10496, -12032, -11520,  -8960,  -8448,  -9984,  -9472, -15104, -14592, -16128, -15616,
+  -13056, -12544, -14080, -13568,   -344,   -328,   -376,   -360,   -280,   -264,   -312,   -296,
+    -472,   -456,   -504,   -488,   -408,   -392,   -440,   -424,    -88,    -72,   -120,   -104,
+     -24,     -8,    -56,    -40,   -216,   -200,   -248,   -232,   -152,   -136,   -184,   -168,
+   -1376,  -1312,  -1504,  -1440,  -1120,  -1056,  -1248,  -1184,  -1888,  -1824,  -2016,  -1952,
+   -1632,  -1568,  -1760,  -1696,   -688,   -656,   -752,   -720,   -560,   -528,   -624,   -592,
+    -944,   -912,  -1008,   -976,   -816,   -784,   -880,   -848,   5504,   5248,   6016,   5760,
+    4480,   4224,   4992,   4736,   7552,   7296,   8064,   7808,   6528,   6272,   7040,   6784,
+    2752,   2624,   3008,   2880,   2240,   2112,   2496,   2368,   3776,   3648,   4032,   3904,
+    3264,   3136,   3520,   3392,  22016,  20992,  24064,  23040,  17920,  16896,  19968,  18944,
+   30208,  29184,  32256,  31232,  26112,  25088,  28160,  27136,  11008,  10496,  12032,  11520,
+    8960,   8448,   9984,   9472,  15104,  14592,  16128,  15616,  13056,  12544,  14080,  13568,
+     344,    328,    376,    360,    280,    264,    312,    296,    472,    456,    504,    488,
+     408,    392,    440,    424,     88,     72,    120,    104,     24,      8,     56,     40,
+     216,    200,    248,    232,    152,    136,    184,    168,   1376,   1312,   1504,   1440,
+    1120,   1056,   1248,   1184,   1888,   1824,   2016,   1952,   1632,   1568,   1760,   1696,
+     688,    656,    752,    720,    560,    528,    624,    592,    944,    912,   1008,    976,
+     816,    784,    880,    848,
+};
+
+static const int16_t kUlawToLinear[256] = {
+  -32124, -31100, -30076, -29052, -28028, -27004, -25980, -24956, -23932, -22908, -21884, -20860,
+  -19836, -18812, -17788, -16764, -15996, -15484, -14972, -14460, -13948, -13436, -12924, -12412,
+  -11900, -11388, -10876, -10364,  -9852,  -9340,  -8828,  -8316,  -7932,  -7676,  -7420,  -7164,
+   -6908,  -6652,  -6396,  -6140,  -5884,  -5628,  -5372,  -5116,  -4860,  -4604,  -4348,  -4092,
+   -3900,  -3772,  -3644,  -3516,  -3388,  -3260,  -3132,  -3004,  -2876,  -2748,  -2620,  -2492,
+   -2364,  -2236,  -2108,  -1980,  -1884,  -1820,  -1756,  -1692,  -1628,  -1564,  -1500,  -1436,
+   -1372,  -1308,  -1244,  -1180,  -1116,  -1052,   -988,   -924,   -876,   -844,   -812,   -780,
+    -748,   -716,   -684,   -652,   -620,   -588,   -556,   -524,   -492,   -460,   -428,   -396,
+    -372,   -356,   -340,   -324,   -308,   -292,   -276,   -260,   -244,   -228,   -212,   -196,
+    -180,   -164,   -148,   -132,   -120,   -112,   -104,    -96,    -88,    -80,    -72,    -64,
+     -56,    -48,    -40,    -32,    -24,    -16,     -8,      0,  32124,  31100,  30076,  29052,
+   28028,  27004,  25980,  24956,  23932,  22908,  21884,  20860,  19836,  18812,  17788,  16764,
+   15996,  15484,  14972,  14460,  13948,  13436,  12924,  12412,  11900,  11388,  10876,  10364,
+    9852,   9340,   8828,   8316,   7932,   7676,   7420,   7164,   6908,   6652,   6396,   6140,
+    5884,   5628,   5372,   5116,   4860,   4604,   4348,   4092,   3900,   3772,   3644,   3516,
+    3388,   3260,   3132,   3004,   2876,   2748,   2620,   2492,   2364,   2236,   2108,   1980,
+    1884,   1820,   1756,   1692,   1628,   1564,   1500,   1436,   1372,   1308,   1244,   1180,
+    1116,   1052,    988,    924,    876,    844,    812,    780,    748,    716,    684,    652,
+     620,    588,    556,    524,    492,    460,    428,    396,    372,    356,    340,    324,
+     308,    292,    276,    260,    244,    228,    212,    196,    180,    164,    148,    132,
+     120,    112,    104,     96,     88,     80,     72,     64,     56,     48,     40,     32,
+      24,     16,      8,      0,
+};
+
+void g711AlawEncode(const int16_t* pcm, uint8_t* out, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    int p = pcm[i] >> 3;
+    uint8_t mask = 0xD5;
+    if (p < 0) { mask = 0x55; p = -p - 1; }            // 0..4095
+    uint8_t seg = kSegA[p >> 4];
+    out[i] = ((seg << 4) | ((p >> (seg ? seg : 1)) & 0xF)) ^ mask;
+  }
+}
+
+void g711UlawEncode(const int16_t* pcm, uint8_t* out, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    int p = pcm[i] >> 2;
+    uint8_t mask = 0xFF;
+    if (p < 0) { mask = 0x7F; p = -p; }
+    if (p > ULAW_CLIP) p = ULAW_CLIP;
+    p += ULAW_BIAS >> 2;                               // 33..8192
+    uint8_t seg = kSegU[p >> 6];
+    out[i] = (seg > 7 ? 0x7F : (seg << 4) | ((p >> (seg + 1)) & 0xF)) ^ mask;
+  }
+}
+
+void g711AlawDecode(const uint8_t* in, int16_t* pcm, size_t n) {
+  for (size_t i = 0; i < n; i++) pcm[i] = kAlawToLinear[in[i]];
+}
+
+void g711UlawDecode(const uint8_t* in, int16_t* pcm, size_t n) {
+  for (size_t i = 0; i < n; i++) pcm[i] = kUlawToLinear[in[i]];
+}
+
+// ---- Bitwise reference (after the Sun Microsystems public-domain g711.c) ----
+
+static const int16_t kSegAEnd[8] = { 0x1F, 0x3F, 0x7F, 0xFF, 0x1FF, 0x3FF, 0x7FF, 0xFFF };
+static const int16_t kSegUEnd[8] = { 0x3F, 0x7F, 0xFF, 0x1FF, 0x3FF, 0x7FF, 0xFFF, 0x1FFF };
+
+static int segSearch(int val, const int16_t* table) {
+  for (int i = 0; i < 8; i++)
+    if (val <= table[i]) return i;
+  return 8;
+}
+
+uint8_t g711AlawRef(int16_t pcm) {
+  int p = pcm >> 3, mask;
+  if (p >= 0) mask = 0xD5;
+  else { mask = 0x55; p = -p - 1; }
+  int seg = segSearch(p, kSegAEnd);
+  if (seg >= 8) return 0x7F ^ mask;
+  int aval = seg << 4;
+  aval |= seg < 2 ? (p >> 1) & 0xF : (p >> seg) & 0xF;
+  return aval ^ mask;
+}
+
+uint8_t g711UlawRef(int16_t pcm) {
+  int p = pcm >> 2, mask;
+  if (p < 0) { p = -p; mask = 0x7F; }
+  else mask = 0xFF;
+  if (p > ULAW_CLIP) p = ULAW_CLIP;
+  p += ULAW_BIAS >> 2;
+  int seg = segSearch(p, kSegUEnd);
+  if (seg >= 8) return 0x7F ^ mask;
+  return ((seg << 4) | ((p >> (seg + 1)) & 0xF)) ^ mask;
+}
+
+int16_t g711AlawDecodeRef(uint8_t a) {
+  a ^= 0x55;
+  int t = (a & 0xF) << 4;
+  int seg = (a & 0x70) >> 4;
+  switch (seg) {
+    case 0:  t += 8; break;
+    case 1:  t += 0x108; break;
+    default: t += 0x108; t <<= seg - 1;
+  }
+  return (a & 0x80) ? t : -t;
+}
+
+int16_t g711UlawDecodeRef(uint8_t u) {
+  u = ~u;
+  int t = ((u & 0xF) << 3) + ULAW_BIAS;
+  t <<= (u & 0x70) >> 4;
+  return (u & 0x80) ? (ULAW_BIAS - t) : (t - ULAW_BIAS);
+}
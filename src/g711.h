@@ -0,0 +1,29 @@
+// G.711 A-law / mu-law codec (ITU-T G.711), block oriented.
+//
+// The block functions are table driven: one small exponent lookup per
+// sample to encode, one 256-entry table lookup to decode. The *Ref
+// functions are the classic bitwise reference implementation; the block
+// versions are bit-exact with them for every input (tools/audio_bench.cpp
+// "g711" checks all 65536 samples and all 256 codes).
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+enum G711Law : uint8_t { G711_ULAW = 0, G711_ALAW = 8 };   // values are the RTP payload types
+
+void g711AlawEncode(const int16_t* pcm, uint8_t* out, size_t n);
+void g711UlawEncode(const int16_t* pcm, uint8_t* out, size_t n);
+void g711AlawDecode(const uint8_t* in, int16_t* pcm, size_t n);
+void g711UlawDecode(const uint8_t* in, int16_t* pcm, size_t n);
+
+static inline void g711Encode(G711Law law, const int16_t* pcm, uint8_t* out, size_t n) {
+  if (law == G711_ALAW) g711AlawEncode(pcm, out, n); else g711UlawEncode(pcm, out, n);
+}
+static inline void g711Decode(G711Law law, const uint8_t* in, int16_t* pcm, size_t n) {
+  if (law == G711_ALAW) g711AlawDecode(in, pcm, n); else g711UlawDecode(in, pcm, n);
+}
+
+uint8_t g711AlawRef(int16_t pcm);
+uint8_t g711UlawRef(int16_t pcm);
+int16_t g711AlawDecodeRef(uint8_t a);
+int16_t g711UlawDecodeRef(uint8_t u);
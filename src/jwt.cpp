@@ -0,0 +1,285 @@
+#include "jwt.h"
+#include <string.h>
+
+#define JWT_SIG_B64_LEN  43       // 32 bytes, base64url without padding
+#define JWT_HEADER_MAX   96       // encoded header length accepted
+#define JWT_LEEWAY_S     60       // clock skew allowed on exp / nbf
+
+// {"alg":"HS256","typ":"JWT"}
+static const char JWT_HS256_HEADER[] = "eyJhbGciOiJIUzI1NiIsInR5cCI6IkpXVCJ9";
+
+const char* jwtResultName(JwtResult r) {
+  switch (r) {
+    case JWT_OK:          return "ok";
+    case JWT_ERR_NO_KEY:  return "no key";
+    case JWT_ERR_FORMAT:  return "malformed";
+    case JWT_ERR_ALG:     return "unsupported alg";
+    case JWT_ERR_SIG:     return "bad signature";
+    case JWT_ERR_EXPIRED: return "expired";
+    case JWT_ERR_EARLY:   return "not yet valid";
+    case JWT_ERR_CLOCK:   return "clock not set";
+  }
+  return "?";
+}
+
+static int b64urlValue(char c) {
+  if (c >= 'A' && c <= 'Z') return c - 'A';
+  if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+  if (c >= '0' && c <= '9') return c - '0' + 52;
+  if (c == '-') return 62;
+  if (c == '_') return 63;
+  return -1;
+}
+
+// Unpadded base64url; returns the decoded length or -1.
+static int b64urlDecode(const char* in, size_t n, uint8_t* out, size_t outLen) {
+  if (n % 4 == 1 || n / 4 * 3 + (n % 4 ? n % 4 - 1 : 0) > outLen) return -1;
+  uint32_t acc = 0;
+  int bits = 0, o = 0;
+  for (size_t i = 0; i < n; i++) {
+    int v = b64urlValue(in[i]);
+    if (v < 0) return -1;
+    acc = acc << 6 | v;
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      out[o++] = (uint8_t)(acc >> bits);
+    }
+  }
+  return o;
+}
+
+static size_t b64urlEncode(const uint8_t* in, size_t n, char* out) {
+  static const char A[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+  size_t o = 0;
+  uint32_t acc = 0;
+  int bits = 0;
+  for (size_t i = 0; i < n; i++) {
+    acc = acc << 8 | in[i];
+    bits += 8;
+    while (bits >= 6) { bits -= 6; out[o++] = A[(acc >> bits) & 63]; }
+  }
+  if (bits) out[o++] = A[(acc << (6 - bits)) & 63];
+  return o;
+}
+
+// Value of "name": in a flat JSON object; enough for JOSE headers and the
+// registered claims, not a general parser.
+static const char* jsonValue(const char* js, size_t n, const char* name) {
+  size_t nl = strlen(name);
+  for (size_t i = 0; i + nl + 2 < n; i++) {
+    if (js[i] != '"' || memcmp(js + i + 1, name, nl) != 0 || js[i + 1 + nl] != '"') continue;
+    size_t j = i + nl + 2;
+    while (j < n && (js[j] == ' ' || js[j] == '\t')) j++;
+    if (j >= n || js[j] != ':') continue;
+    for (j++; j < n && (js[j] == ' ' || js[j] == '\t'); j++) {}
+    return j < n ? js + j : nullptr;
+  }
+  return nullptr;
+}
+
+static uint32_t jsonUint(const char* js, size_t n, const char* name) {
+  const char* v = jsonValue(js, n, name);
+  uint64_t x = 0;
+  for (; v && v < js + n && *v >= '0' && *v <= '9'; v++) {
+    x = x * 10 + (*v - '0');
+    if (x > 0xFFFFFFFFu) return 0xFFFFFFFFu;
+  }
+  return (uint32_t)x;
+}
+
+static uint32_t fnv1a(const char* p, size_t n) {
+  uint32_t h = 2166136261u;
+  while (n--) h = (h ^ (uint8_t)*p++) * 16777619u;
+  return h ? h : 1;
+}
+
+JwtVerifier::JwtVerifier() {
+  memset(_cache, 0, sizeof(_cache));
+#ifdef JWT_MBEDTLS
+  mbedtls_sha256_init(&_ipad);
+  mbedtls_sha256_init(&_opad);
+#endif
+}
+
+JwtVerifier::~JwtVerifier() {
+  end();
+#ifdef JWT_MBEDTLS
+  mbedtls_sha256_free(&_ipad);
+  mbedtls_sha256_free(&_opad);
+#endif
+}
+
+bool JwtVerifier::begin(const uint8_t* key, size_t len) {
+  if (!key || !len) return false;
+  uint8_t k[32], pad[64];
+  if (len > JWT_KEY_MAX) {                 // RFC 2104: long keys are hashed
+#ifdef JWT_MBEDTLS
+    mbedtls_sha256_context c;
+    mbedtls_sha256_init(&c);
+    mbedtls_sha256_starts(&c, 0);
+    mbedtls_sha256_update(&c, key, len);
+    mbedtls_sha256_finish(&c, k);
+    mbedtls_sha256_free(&c);
+#else
+    SoftSha256 c;
+    c.starts();
+    c.update(key, len);
+    c.finish(k);
+#endif
+    key = k;
+    len = sizeof(k);
+  }
+  for (int pass = 0; pass < 2; pass++) {
+    memset(pad, pass ? 0x5C : 0x36, sizeof(pad));
+    for (size_t i = 0; i < len; i++) pad[i] ^= key[i];
+#ifdef JWT_MBEDTLS
+    mbedtls_sha256_context* c = pass ? &_opad : &_ipad;
+    mbedtls_sha256_starts(c, 0);
+    mbedtls_sha256_update(c, pad, sizeof(pad));
+#else
+    SoftSha256& c = pass ? _opad : _ipad;
+    c.starts();
+    c.update(pad, sizeof(pad));
+#endif
+  }
+  memset(k, 0, sizeof(k));
+  memset(pad, 0, sizeof(pad));
+  flush();
+  _stats = JwtStats();
+  _active = true;
+  return true;
+}
+
+void JwtVerifier::end() {
+  _active = false;
+  flush();
+#ifdef JWT_MBEDTLS
+  mbedtls_sha256_free(&_ipad);
+  mbedtls_sha256_free(&_opad);
+  mbedtls_sha256_init(&_ipad);
+  mbedtls_sha256_init(&_opad);
+#else
+  memset(&_ipad, 0, sizeof(_ipad));
+  memset(&_opad, 0, sizeof(_opad));
+#endif
+}
+
+void JwtVerifier::flush() {
+  memset(_cache, 0, sizeof(_cache));
+}
+
+uint8_t JwtVerifier::cached() const {
+  uint8_t n = 0;
+  for (const Slot& s : _cache) n += s.hash != 0;
+  return n;
+}
+
+void JwtVerifier::hmac(const uint8_t* msg, size_t len, uint8_t out[32]) {
+  uint8_t inner[32];
+#ifdef JWT_MBEDTLS
+  mbedtls_sha256_context c;
+  mbedtls_sha256_init(&c);
+  mbedtls_sha256_clone(&c, &_ipad);
+  mbedtls_sha256_update(&c, msg, len);
+  mbedtls_sha256_finish(&c, inner);
+  mbedtls_sha256_clone(&c, &_opad);
+  mbedtls_sha256_update(&c, inner, sizeof(inner));
+  mbedtls_sha256_finish(&c, out);
+  mbedtls_sha256_free(&c);
+#else
+  SoftSha256 c = _ipad;
+  c.update(msg, len);
+  c.finish(inner);
+  c = _opad;
+  c.update(inner, sizeof(inner));
+  c.finish(out);
+#endif
+}
+
+JwtResult JwtVerifier::check(uint32_t exp, uint32_t nbf, uint32_t now) {
+  if ((exp || nbf) && !now) return JWT_ERR_CLOCK;
+  if (exp && now >= exp + JWT_LEEWAY_S) return JWT_ERR_EXPIRED;
+  if (nbf && now + JWT_LEEWAY_S < nbf) return JWT_ERR_EARLY;
+  return JWT_OK;
+}
+
+JwtResult JwtVerifier::verify(const char* tok, size_t len, uint32_t now) {
+  auto reject = [&](JwtResult r) {
+    _stats.rejected++;
+    if (r == JWT_ERR_SIG) _stats.badSig++;
+    if (r == JWT_ERR_EXPIRED) _stats.expired++;
+    return r;
+  };
+  if (!_active) return reject(JWT_ERR_NO_KEY);
+  if (!tok || !len || len > JWT_MAX_LEN) return reject(JWT_ERR_FORMAT);
+  const char* d1 = (const char*)memchr(tok, '.', len);
+  const char* d2 = d1 ? (const char*)memchr(d1 + 1, '.', tok + len - d1 - 1) : nullptr;
+  if (!d2 || d1 - tok > JWT_HEADER_MAX || tok + len - d2 - 1 != JWT_SIG_B64_LEN) return reject(JWT_ERR_FORMAT);
+  const char* sig = d2 + 1;
+  uint32_t h = fnv1a(sig, JWT_SIG_B64_LEN);
+
+  for (Slot& s : _cache) {
+    if (s.hash != h || s.len != len || memcmp(s.tok, tok, len) != 0) continue;
+    JwtResult r = check(s.exp, s.nbf, now);
+    if (r != JWT_OK) {
+      if (r == JWT_ERR_EXPIRED) s.hash = 0;
+      return reject(r);
+    }
+    s.used = ++_tick;
+    _stats.cacheHits++;
+    return JWT_OK;
+  }
+
+  uint8_t hdr[JWT_HEADER_MAX], mac[32], want[33];
+  int hl = b64urlDecode(tok, d1 - tok, hdr, sizeof(hdr));
+  if (hl <= 0) return reject(JWT_ERR_FORMAT);
+  const char* alg = jsonValue((const char*)hdr, hl, "alg");
+  if (!alg || (const char*)hdr + hl - alg < 7 || memcmp(alg, "\"HS256\"", 7) != 0) return reject(JWT_ERR_ALG);
+  if (b64urlDecode(sig, JWT_SIG_B64_LEN, want, sizeof(want)) != 32) return reject(JWT_ERR_FORMAT);
+
+  hmac((const uint8_t*)tok, d2 - tok, mac);
+  uint8_t diff = 0;
+  for (int i = 0; i < 32; i++) diff |= mac[i] ^ want[i];
+  if (diff) return reject(JWT_ERR_SIG);
+
+  uint8_t claims[JWT_MAX_LEN * 3 / 4];
+  int cl = b64urlDecode(d1 + 1, d2 - d1 - 1, claims, sizeof(claims));
+  if (cl < 0) return reject(JWT_ERR_FORMAT);
+  uint32_t exp = jsonUint((const char*)claims, cl, "exp");
+  uint32_t nbf = jsonUint((const char*)claims, cl, "nbf");
+  JwtResult r = check(exp, nbf, now);
+  if (r != JWT_OK) return reject(r);
+
+  if (len <= JWT_CACHE_TOKEN_MAX) {
+    Slot* victim = &_cache[0];
+    for (Slot& s : _cache) {
+      if (!s.hash) { victim = &s; break; }
+      if (s.used < victim->used) victim = &s;
+    }
+    victim->hash = h;
+    victim->exp = exp;
+    victim->nbf = nbf;
+    victim->used = ++_tick;
+    victim->len = (uint16_t)len;
+    memcpy(victim->tok, tok, len);
+  }
+  _stats.verified++;
+  return JWT_OK;
+}
+
+size_t JwtVerifier::sign(const char* claims, char* out, size_t outLen) {
+  size_t hl = sizeof(JWT_HS256_HEADER) - 1, cl = strlen(claims);
+  size_t total = hl + 1 + (cl * 4 + 2) / 3 + 1 + JWT_SIG_B64_LEN;
+  if (!_active || total + 1 > outLen) return 0;
+  memcpy(out, JWT_HS256_HEADER, hl);
+  size_t n = hl;
+  out[n++] = '.';
+  n += b64urlEncode((const uint8_t*)claims, cl, out + n);
+  uint8_t mac[32];
+  hmac((const uint8_t*)out, n, mac);
+  out[n++] = '.';
+  n += b64urlEncode(mac, sizeof(mac), out + n);
+  out[n] = 0;
+  return n;
+}
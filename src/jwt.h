@@ -0,0 +1,90 @@
+// HS256 JSON Web Token (RFC 7519) verification for the HTTP routes.
+//
+// begin() hashes the key into the HMAC inner and outer pad states once;
+// each verification clones those two states instead of re-keying, so an
+// HMAC costs the message blocks plus one block for the outer hash.
+//
+// Tokens that verified recently sit in a small fixed table, looked up by
+// a hash of their signature segment and confirmed by comparing the whole
+// token. A client repeating its bearer token on every request (the normal
+// case) then costs one memcmp per request. Cached entries still honour
+// exp; flush() or a new key empties the table.
+//
+// Device builds use mbedtls SHA-256 (the SHA peripheral); host builds use
+// soft_crypto.h unless JWT_USE_MBEDTLS is defined.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(ARDUINO) || defined(JWT_USE_MBEDTLS)
+#define JWT_MBEDTLS 1
+#include <mbedtls/sha256.h>
+#else
+#include "soft_crypto.h"
+#endif
+
+#define JWT_MAX_LEN          512    // longer tokens are rejected outright
+#define JWT_KEY_MAX          64     // HMAC block size; longer keys are hashed first
+#define JWT_CACHE_SLOTS      8
+#define JWT_CACHE_TOKEN_MAX  256    // longer tokens are verified on every request
+
+enum JwtResult : uint8_t {
+  JWT_OK, JWT_ERR_NO_KEY, JWT_ERR_FORMAT, JWT_ERR_ALG, JWT_ERR_SIG,
+  JWT_ERR_EXPIRED, JWT_ERR_EARLY, JWT_ERR_CLOCK,
+};
+
+const char* jwtResultName(JwtResult r);
+
+struct JwtStats {
+  uint32_t verified;        // full HMAC verifications that passed
+  uint32_t cacheHits;       // accepted from the cache
+  uint32_t rejected;
+  uint32_t badSig, expired;
+};
+
+class JwtVerifier {
+public:
+  JwtVerifier();
+  ~JwtVerifier();
+
+  bool begin(const uint8_t* key, size_t len);
+  void end();
+  bool active() const { return _active; }
+
+  // now = Unix time in seconds, 0 if the clock is not set. Tokens with an
+  // exp or nbf claim are refused (JWT_ERR_CLOCK) until it is.
+  JwtResult verify(const char* tok, size_t len, uint32_t now);
+
+  // HS256 token over a claims JSON object, NUL-terminated into out.
+  // Returns its length, or 0 if out is too small.
+  size_t sign(const char* claims, char* out, size_t outLen);
+
+  void flush();
+  uint8_t cached() const;
+  const JwtStats& stats() const { return _stats; }
+
+private:
+  JwtVerifier(const JwtVerifier&) = delete;
+  JwtVerifier& operator=(const JwtVerifier&) = delete;
+
+  struct Slot {
+    uint32_t hash;          // of the signature segment; 0 = empty
+    uint32_t exp, nbf;      // 0 = claim absent
+    uint32_t used;          // LRU tick
+    uint16_t len;
+    char     tok[JWT_CACHE_TOKEN_MAX];
+  };
+
+  void hmac(const uint8_t* msg, size_t len, uint8_t out[32]);
+  JwtResult check(uint32_t exp, uint32_t nbf, uint32_t now);
+
+  bool _active = false;
+#ifdef JWT_MBEDTLS
+  mbedtls_sha256_context _ipad, _opad;
+#else
+  SoftSha256 _ipad, _opad;
+#endif
+  Slot     _cache[JWT_CACHE_SLOTS];
+  uint32_t _tick = 0;
+  JwtStats _stats = {};
+};
@@ -0,0 +1,212 @@
+#include "mfcc.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PREEMPH_Q15  31785           // 0.97
+#define FFT_SAFE_PEAK 13572          // 32767 / (1 + sqrt 2)
+
+static float hzToMel(float f) { return 2595.0f * log10f(1 + f / 700); }
+static float melToHz(float m) { return 700 * (powf(10, m / 2595.0f) - 1); }
+
+Mfcc::~Mfcc() {
+  free(_win); free(_cos); free(_sin); free(_rev); free(_melSeg); free(_melW);
+  free(_dct); free(_hist); free(_re); free(_im);
+}
+
+bool Mfcc::begin(uint32_t rate) {
+  if (_win) return _rate == rate;
+  _rate = rate;
+  _frame = rate * MFCC_FRAME_MS / 1000;
+  _hop = rate * MFCC_HOP_MS / 1000;
+  for (_n = 1, _logN = 0; _n < _frame; _n <<= 1) _logN++;
+  _bins = _n / 2 + 1;
+  _win = (int16_t*)malloc(_frame * 2);
+  _cos = (int16_t*)malloc(_n);
+  _sin = (int16_t*)malloc(_n);
+  _rev = (uint16_t*)malloc(_n * 2);
+  _melSeg = (uint8_t*)malloc(_bins);
+  _melW = (uint16_t*)malloc(_bins * 2);
+  _dct = (int16_t*)malloc(MFCC_COEFFS * MFCC_MELS * 2);
+  _hist = (int16_t*)malloc(_frame * 2);
+  _re = (int16_t*)malloc(_n * 2);
+  _im = (int16_t*)malloc(_n * 2);
+  if (!_win || !_cos || !_sin || !_rev || !_melSeg || !_melW || !_dct || !_hist || !_re || !_im) return false;
+
+  for (size_t i = 0; i < _frame; i++)
+    _win[i] = (int16_t)lrintf(32767 * (0.5f - 0.5f * cosf(2 * (float)M_PI * i / (_frame - 1))));
+  for (size_t i = 0; i < _n / 2; i++) {
+    _cos[i] = (int16_t)lrintf(32767 * cosf(2 * (float)M_PI * i / _n));
+    _sin[i] = (int16_t)lrintf(32767 * sinf(2 * (float)M_PI * i / _n));
+  }
+  for (size_t i = 0; i < _n; i++) {
+    uint16_t r = 0;
+    for (int b = 0; b < _logN; b++) if (i & (1 << b)) r |= 1 << (_logN - 1 - b);
+    _rev[i] = r;
+  }
+  // Mel points p[0..MELS+1]; filter j rises over [p[j], p[j+1]] and falls
+  // over [p[j+1], p[j+2]]. A bin in segment i rises into filter i with
+  // weight t and falls out of filter i-1 with weight 1-t.
+  float pts[MFCC_MELS + 2], mMax = hzToMel(rate / 2.0f);
+  for (int i = 0; i < MFCC_MELS + 2; i++) pts[i] = melToHz(mMax * i / (MFCC_MELS + 1));
+  for (size_t k = 0; k < _bins; k++) {
+    float f = (float)k * rate / _n;
+    _melSeg[k] = 255;
+    _melW[k] = 0;
+    for (int i = 0; i <= MFCC_MELS; i++) {
+      if (f >= pts[i] && f < pts[i + 1]) {
+        _melSeg[k] = i;
+        _melW[k] = (uint16_t)lrintf(32767 * (f - pts[i]) / (pts[i + 1] - pts[i]));
+        break;
+      }
+    }
+  }
+  for (int k = 0; k < MFCC_COEFFS; k++)
+    for (int m = 0; m < MFCC_MELS; m++) {
+      float s = k ? sqrtf(2.0f / MFCC_MELS) : sqrtf(1.0f / MFCC_MELS);
+      _dct[k * MFCC_MELS + m] = (int16_t)lrintf(32767 * s * cosf((float)M_PI * k * (m + 0.5f) / MFCC_MELS));
+    }
+  for (int i = 0; i <= 32; i++) _log2Frac[i] = (uint16_t)lrintf(256 * log2f(1 + i / 32.0f));
+  reset();
+  return true;
+}
+
+void Mfcc::reset() {
+  if (_hist) memset(_hist, 0, _frame * 2);
+  _filled = 0;
+  _prev = 0;
+}
+
+int32_t Mfcc::log2Q8(uint64_t v) const {
+  if (!v) return 0;
+  int b = 63 - __builtin_clzll(v);
+  uint32_t frac = b >= 16 ? (uint32_t)(v >> (b - 16)) & 0xFFFF : (uint32_t)(v << (16 - b)) & 0xFFFF;
+  uint32_t i = frac >> 11, r = frac & 0x7FF;
+  return b * 256 + _log2Frac[i] + (((_log2Frac[i + 1] - _log2Frac[i]) * r) >> 11);
+}
+
+// Block floating point: before each stage, the whole block is scaled down
+// just enough that a butterfly (gain up to 1 + sqrt 2 per component) cannot
+// overflow. Quiet frames keep their low bits instead of losing one per
+// stage. Returns the total right shift (true DFT = result << shift).
+int Mfcc::fft(int32_t peak) {
+  for (size_t i = 0; i < _n; i++) {
+    size_t j = _rev[i];
+    if (j > i) {
+      int16_t t = _re[i]; _re[i] = _re[j]; _re[j] = t;
+      t = _im[i]; _im[i] = _im[j]; _im[j] = t;
+    }
+  }
+  int exp = 0;
+  for (size_t size = 2; size <= _n; size <<= 1) {
+    int s = 0;
+    while ((peak >> s) > FFT_SAFE_PEAK) s++;
+    int32_t rnd = s ? 1 << (s - 1) : 0;
+    exp += s;
+    peak = 0;
+    size_t half = size / 2, step = _n / size;
+    for (size_t i = 0; i < _n; i += size) {
+      for (size_t j = 0; j < half; j++) {
+        int32_t wr = _cos[j * step], wi = -_sin[j * step];
+        size_t a = i + j, b = a + half;
+        int32_t br = (_re[b] + rnd) >> s, bi = (_im[b] + rnd) >> s;
+        int32_t ar = (_re[a] + rnd) >> s, ai = (_im[a] + rnd) >> s;
+        int32_t tr = (wr * br - wi * bi + 16384) >> 15;
+        int32_t ti = (wr * bi + wi * br + 16384) >> 15;
+        int32_t v[4] = { ar - tr, ai - ti, ar + tr, ai + ti };
+        _re[b] = v[0]; _im[b] = v[1];
+        _re[a] = v[2]; _im[a] = v[3];
+        for (int k = 0; k < 4; k++) {
+          int32_t m = v[k] < 0 ? -v[k] : v[k];
+          if (m > peak) peak = m;
+        }
+      }
+    }
+  }
+  return exp;
+}
+
+bool Mfcc::push(const int16_t* hop) {
+  // The history keeps raw samples (plus the one before the frame), so
+  // pre-emphasis and window run at full precision on every frame: even a
+  // few-LSB signal reaches the FFT with 14 significant bits.
+  _prev = _hist[_hop - 1];
+  memmove(_hist, _hist + _hop, (_frame - _hop) * 2);
+  memcpy(_hist + _frame - _hop, hop, _hop * 2);
+  if (_filled < _frame) _filled += _hop;
+  return _filled >= _frame;
+}
+
+void Mfcc::compute(int16_t* out) {
+  // Windowed, pre-emphasized sample i in Q15; |v| < 2^31 since
+  // 32768 * (32768 + 31785) < 2^31 and the window is <= 1.
+  auto windowed = [&](size_t i) -> int32_t {
+    int32_t e = _hist[i] * 32768 - PREEMPH_Q15 * (int32_t)(i ? _hist[i - 1] : _prev);
+    return (int32_t)(((int64_t)e * _win[i]) >> 15);
+  };
+  int32_t peak = 0;
+  for (size_t i = 0; i < _frame; i++) {
+    int32_t v = windowed(i);
+    if (v < 0) v = -v;
+    if (v > peak) peak = v;
+  }
+  // Second pass scales to the FFT's safe range.
+  int shift = 0;
+  while ((peak >> shift) > FFT_SAFE_PEAK) shift++;
+  int32_t rnd = shift ? 1 << (shift - 1) : 0;
+  for (size_t i = 0; i < _frame; i++) _re[i] = (int16_t)((windowed(i) + rnd) >> shift);
+  memset(_re + _frame, 0, (_n - _frame) * 2);
+  memset(_im, 0, _n * 2);
+  int exp = fft(peak >> shift);
+
+  uint64_t mel[MFCC_MELS] = {0};
+  for (size_t k = 0; k < _bins; k++) {
+    uint8_t seg = _melSeg[k];
+    if (seg == 255) continue;
+    uint32_t p = (uint32_t)(_re[k] * _re[k]) + (uint32_t)(_im[k] * _im[k]);
+    uint32_t w = _melW[k];
+    if (seg < MFCC_MELS) mel[seg] += (uint64_t)p * w;
+    if (seg > 0) mel[seg - 1] += (uint64_t)p * (32767 - w);
+  }
+  // log2(reference mel) = log2(mel) - 15 (weights) + 2 exp (FFT scaling)
+  //                       + 2 (shift - 15) (input scaling)
+  int32_t offset = (2 * exp + 2 * shift - 30 - 15) * 256;
+  int32_t lm[MFCC_MELS];
+  for (int m = 0; m < MFCC_MELS; m++) lm[m] = log2Q8(mel[m]) + offset;
+
+  for (int k = 0; k < MFCC_COEFFS; k++) {
+    const int16_t* d = _dct + k * MFCC_MELS;
+    int64_t acc = 0;
+    for (int m = 0; m < MFCC_MELS; m++) acc += (int32_t)d[m] * lm[m];
+    int32_t c = (int32_t)(acc >> (15 + 8 - MFCC_Q));
+    out[k] = c > 32767 ? 32767 : c < -32768 ? -32768 : (int16_t)c;
+  }
+}
+
+void Mfcc::reference(const float* frame, float* out) const {
+  float mel[MFCC_MELS] = {0};
+  float pts[MFCC_MELS + 2], mMax = hzToMel(_rate / 2.0f);
+  for (int i = 0; i < MFCC_MELS + 2; i++) pts[i] = melToHz(mMax * i / (MFCC_MELS + 1));
+  for (size_t k = 0; k < _bins; k++) {
+    double re = 0, im = 0;
+    for (size_t i = 0; i < _frame; i++) {
+      double w = 0.5 - 0.5 * cos(2 * M_PI * i / (_frame - 1));
+      re += frame[i] * w * cos(2 * M_PI * k * i / _n);
+      im -= frame[i] * w * sin(2 * M_PI * k * i / _n);
+    }
+    float p = (float)(re * re + im * im), f = (float)k * _rate / _n;
+    for (int i = 0; i <= MFCC_MELS; i++) {
+      if (f >= pts[i] && f < pts[i + 1]) {
+        float t = (f - pts[i]) / (pts[i + 1] - pts[i]);
+        if (i < MFCC_MELS) mel[i] += t * p;
+        if (i > 0) mel[i - 1] += (1 - t) * p;
+        break;
+      }
+    }
+  }
+  for (int k = 0; k < MFCC_COEFFS; k++) {
+    float s = k ? sqrtf(2.0f / MFCC_MELS) : sqrtf(1.0f / MFCC_MELS), acc = 0;
+    for (int m = 0; m < MFCC_MELS; m++) acc += s * cosf((float)M_PI * k * (m + 0.5f) / MFCC_MELS) * log2f(mel[m] + 1e-3f);
+    out[k] = acc;
+  }
+}
@@ -0,0 +1,68 @@
+// Streaming fixed-point MFCC front end.
+//
+// Per hop (10 ms) of int16 audio: pre-emphasis, 25 ms Hann frame, complex
+// radix-2 FFT in Q15 (block floating point: a stage is scaled only when it
+// could overflow), power spectrum, triangular mel filterbank (HTK mel
+// scale, unnormalized), log2 in Q8 via a 33-entry interpolation table, and
+// an orthonormal DCT-II.
+// Every table is built in begin(). process() does no allocation and uses
+// no floating point.
+//
+// Output: MFCC_COEFFS int16 values in Q(MFCC_Q) log2 units. 1.0 is 3.01 dB
+// of mel-band power, with the same definition as reference().
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#define MFCC_MELS     40
+#define MFCC_COEFFS   13
+#define MFCC_Q        6
+#define MFCC_FRAME_MS 25
+#define MFCC_HOP_MS   10
+
+class Mfcc {
+public:
+  ~Mfcc();
+  bool begin(uint32_t rate);
+  void reset();
+
+  // Feed one hop (hopSize() samples). Returns true when out holds a new
+  // feature vector (every hop once the first full frame is buffered).
+  bool process(const int16_t* hop, int16_t* out) { return push(hop) ? (compute(out), true) : false; }
+  // The two halves of process(). A caller short on time can push() a hop
+  // and skip compute() without breaking later frames.
+  bool push(const int16_t* hop);
+  void compute(int16_t* out);
+
+  size_t hopSize() const { return _hop; }
+  size_t frameSize() const { return _frame; }
+  size_t fftSize() const { return _n; }
+
+  // Floating-point reference over one already pre-emphasized frame
+  // (frameSize() samples); out in plain log2 units.
+  void reference(const float* frame, float* out) const;
+
+private:
+  Mfcc& operator=(const Mfcc&) = delete;
+  int fft(int32_t peak);
+  int32_t log2Q8(uint64_t v) const;
+
+  uint32_t _rate = 0;
+  size_t   _frame = 0, _hop = 0, _n = 0, _bins = 0;
+  int      _logN = 0;
+  // Tables
+  int16_t*  _win = nullptr;      // Hann, Q15, _frame
+  int16_t*  _cos = nullptr;      // _n / 2, Q15
+  int16_t*  _sin = nullptr;
+  uint16_t* _rev = nullptr;      // bit reversal, _n
+  uint8_t*  _melSeg = nullptr;   // per bin: mel segment i (255 = none)
+  uint16_t* _melW = nullptr;     // per bin: rising weight into filter i, Q15
+  int16_t*  _dct = nullptr;      // MFCC_COEFFS x MFCC_MELS, Q15
+  uint16_t  _log2Frac[33];       // log2(1 + i/32) in Q8
+  // State / work
+  int16_t*  _hist = nullptr;     // raw samples, _frame
+  int16_t*  _re = nullptr;
+  int16_t*  _im = nullptr;
+  size_t    _filled = 0;
+  int16_t   _prev = 0;             // sample before _hist[0]
+};
@@ -0,0 +1,396 @@
+#include "mqtt.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MQTT_CONNECT     0x10
+#define MQTT_CONNACK     0x20
+#define MQTT_PUBLISH     0x30
+#define MQTT_PUBACK      0x40
+#define MQTT_PINGREQ     0xC0
+#define MQTT_PINGRESP    0xD0
+#define MQTT_DISCONNECT  0xE0
+#define MQTT_CONNECT_MAX 256        // CONNECT with the longest id / will / credentials
+#define MQTT_WAIT_MAX_MS 1000
+
+enum { TOPIC_EVENTS, TOPIC_TELEMETRY, TOPIC_STATUS };
+
+static void copyStr(char* dst, size_t cap, const char* src) {
+  snprintf(dst, cap, "%s", src ? src : "");
+}
+
+static uint8_t* putStr(uint8_t* p, const char* s) {
+  size_t n = strlen(s);
+  *p++ = n >> 8;
+  *p++ = n;
+  memcpy(p, s, n);
+  return p + n;
+}
+
+static size_t putVarint(uint8_t* p, size_t v) {
+  size_t n = 0;
+  do {
+    uint8_t b = v & 0x7F;
+    v >>= 7;
+    p[n++] = b | (v ? 0x80 : 0);
+  } while (v);
+  return n;
+}
+
+bool MqttClient::begin(const MqttConfig& cfg, const MqttBatchConfig batch[MQTT_STREAMS], size_t queueBytes) {
+  end();
+  if (!cfg.host || !cfg.prefix || strlen(cfg.prefix) + sizeof("/telemetry") > MQTT_TOPIC_MAX) return false;
+  size_t maxBatch = 0;
+  for (int s = 0; s < MQTT_STREAMS; s++) {
+    if (batch[s].maxBytes < 8 || batch[s].qos > 1) return false;
+    if (batch[s].maxBytes > maxBatch) maxBatch = batch[s].maxBytes;
+  }
+  if (queueBytes < MQTT_REC_HDR + maxBatch) return false;
+
+  copyStr(_host, sizeof(_host), cfg.host);
+  copyStr(_clientId, sizeof(_clientId), cfg.clientId);
+  copyStr(_user, sizeof(_user), cfg.user);
+  copyStr(_pass, sizeof(_pass), cfg.pass);
+  snprintf(_topic[TOPIC_EVENTS], MQTT_TOPIC_MAX, "%s/events", cfg.prefix);
+  snprintf(_topic[TOPIC_TELEMETRY], MQTT_TOPIC_MAX, "%s/telemetry", cfg.prefix);
+  snprintf(_topic[TOPIC_STATUS], MQTT_TOPIC_MAX, "%s/status", cfg.prefix);
+  _port = cfg.port;
+  _keepalive = cfg.keepaliveS ? cfg.keepaliveS : 60;
+  _connectTimeout = cfg.connectTimeoutMs;
+  _ackTimeout = cfg.ackTimeoutMs;
+  _backoffMin = cfg.backoffMinMs ? cfg.backoffMinMs : 1000;
+  _backoffMax = cfg.backoffMaxMs > _backoffMin ? cfg.backoffMaxMs : _backoffMin;
+  memcpy(_bcfg, batch, sizeof(_bcfg));
+
+  _txCap = MQTT_HDR_RESERVE + (maxBatch > MQTT_CONNECT_MAX ? maxBatch : MQTT_CONNECT_MAX);
+  _tx = (uint8_t*)malloc(_txCap);
+  _queue = (uint8_t*)malloc(queueBytes);
+  bool ok = _tx && _queue;
+  for (int s = 0; s < MQTT_STREAMS && ok; s++) ok = (_batch[s].buf = (char*)malloc(batch[s].maxBytes)) != nullptr;
+  if (!ok) { end(); return false; }
+  _qcap = queueBytes;
+  _qhead = _qused = 0;
+  _stats = MqttStats();
+  _stats.queueCap = queueBytes;
+  _conn = _pingOut = false;
+  _attempt = 0;
+  _retryAt = 0;
+  for (const char* p = _clientId; *p; p++) _rng = _rng * 31 + (uint8_t)*p;
+  return true;
+}
+
+void MqttClient::end() {
+  if (_conn) {
+    // A clean DISCONNECT discards the will, so clear "online" ourselves.
+    memcpy(_tx + MQTT_HDR_RESERVE, "offline", 7);
+    publish(_topic[TOPIC_STATUS], _tx + MQTT_HDR_RESERVE, 7, 0, true);
+    const uint8_t disc[2] = { MQTT_DISCONNECT, 0 };
+    _t.write(disc, sizeof(disc));
+  }
+  if (_conn || _queue) _t.close();
+  _conn = false;
+  lock();
+  free(_queue);
+  _queue = nullptr;
+  _qcap = _qused = 0;
+  for (Batch& b : _batch) { free(b.buf); b = Batch(); }
+  unlock();
+  free(_tx);
+  _tx = nullptr;
+  _txCap = 0;
+}
+
+size_t MqttClient::memoryBytes() const {
+  size_t n = sizeof(*this) + _qcap + _txCap;
+  for (int s = 0; s < MQTT_STREAMS; s++) if (_batch[s].buf) n += _bcfg[s].maxBytes;
+  return n;
+}
+
+MqttStats MqttClient::stats() {
+  lock();
+  MqttStats s = _stats;
+  s.queueBytes = _qused;
+  unlock();
+  return s;
+}
+
+// ---- Batches and queue
+
+bool MqttClient::add(MqttStream s, const char* json, uint32_t nowMs) {
+  size_t n = strlen(json);
+  lock();
+  if (!_queue || s >= MQTT_STREAMS || n + 2 > _bcfg[s].maxBytes) {
+    _stats.rejected++;
+    unlock();
+    return false;
+  }
+  Batch& b = _batch[s];
+  if (b.len && b.len + 1 + n + 1 > _bcfg[s].maxBytes) seal(s);
+  if (!b.len) {
+    b.buf[b.len++] = '[';
+    b.openedMs = nowMs;
+  } else {
+    b.buf[b.len++] = ',';
+  }
+  memcpy(b.buf + b.len, json, n);
+  b.len += n;
+  b.items++;
+  _stats.items++;
+  unlock();
+  return true;
+}
+
+void MqttClient::seal(int s) {
+  Batch& b = _batch[s];
+  if (!b.items) return;
+  b.buf[b.len++] = ']';
+  push(s, b.items, b.buf, b.len);
+  _stats.batches++;
+  b.len = b.items = 0;
+}
+
+void MqttClient::sealDue(uint32_t nowMs, bool all) {
+  for (int s = 0; s < MQTT_STREAMS; s++)
+    if (_batch[s].items && (all || nowMs - _batch[s].openedMs >= _bcfg[s].maxAgeMs)) seal(s);
+}
+
+void MqttClient::ringRead(size_t pos, uint8_t* out, size_t n) const {
+  pos %= _qcap;
+  size_t first = n < _qcap - pos ? n : _qcap - pos;
+  memcpy(out, _queue + pos, first);
+  memcpy(out + first, _queue, n - first);
+}
+
+void MqttClient::ringWrite(size_t pos, const uint8_t* in, size_t n) {
+  pos %= _qcap;
+  size_t first = n < _qcap - pos ? n : _qcap - pos;
+  memcpy(_queue + pos, in, first);
+  memcpy(_queue, in + first, n - first);
+}
+
+// Oldest record out; delivered (published) or dropped to make room.
+void MqttClient::dropHead() {
+  uint8_t h[MQTT_REC_HDR];
+  ringRead(_qhead, h, sizeof(h));
+  size_t len = h[0] | h[1] << 8;
+  _qhead = (_qhead + MQTT_REC_HDR + len) % _qcap;
+  _qused -= MQTT_REC_HDR + len;
+  _qseq++;
+}
+
+bool MqttClient::push(uint8_t stream, uint16_t items, const char* p, uint16_t len) {
+  size_t need = MQTT_REC_HDR + len;
+  while (_qused && _qcap - _qused < need) {
+    uint8_t h[MQTT_REC_HDR];
+    ringRead(_qhead, h, sizeof(h));
+    _stats.droppedBatches++;
+    _stats.droppedItems += h[4] | h[5] << 8;
+    dropHead();
+  }
+  uint8_t h[MQTT_REC_HDR] = { (uint8_t)len, (uint8_t)(len >> 8), stream, 0, (uint8_t)items, (uint8_t)(items >> 8), 0, 0 };
+  ringWrite(_qhead + _qused, h, sizeof(h));
+  ringWrite(_qhead + _qused + MQTT_REC_HDR, (const uint8_t*)p, len);
+  _qused += need;
+  if (_qused > _stats.queueHigh) _stats.queueHigh = _qused;
+  return true;
+}
+
+// ---- Session
+
+bool MqttClient::readExact(uint8_t* p, size_t n, uint32_t timeoutMs) {
+  while (n) {
+    int r = _t.read(p, n, timeoutMs);
+    if (r <= 0) return false;
+    p += r;
+    n -= r;
+  }
+  return true;
+}
+
+// 1 = packet (type in the high nibble), 0 = nothing within timeoutMs,
+// -1 = connection lost. Bodies longer than cap are read and discarded.
+int MqttClient::readPacket(uint8_t* type, uint8_t* body, size_t cap, size_t* len, uint32_t timeoutMs) {
+  uint8_t h;
+  int r = _t.read(&h, 1, timeoutMs);
+  if (r <= 0) return r;
+  size_t rem = 0;
+  for (int i = 0; i < 4; i++) {
+    uint8_t b;
+    if (!readExact(&b, 1, _ackTimeout)) return -1;
+    rem |= (size_t)(b & 0x7F) << (7 * i);
+    if (!(b & 0x80)) break;
+    if (i == 3) return -1;
+  }
+  size_t keep = rem < cap ? rem : cap;
+  if (!readExact(body, keep, _ackTimeout)) return -1;
+  for (size_t left = rem - keep; left;) {
+    uint8_t skip[32];
+    size_t n = left < sizeof(skip) ? left : sizeof(skip);
+    if (!readExact(skip, n, _ackTimeout)) return -1;
+    left -= n;
+  }
+  *type = h & 0xF0;
+  *len = keep;
+  return 1;
+}
+
+uint32_t MqttClient::backoff() {
+  uint32_t base = _backoffMin;
+  for (uint8_t i = 0; i < _attempt && base < _backoffMax; i++) base *= 2;
+  if (base > _backoffMax) base = _backoffMax;
+  if (_attempt < 16) _attempt++;
+  _rng = _rng * 1664525 + 1013904223;
+  uint32_t d = base - base / 4 + (base / 2 ? (_rng >> 8) % (base / 2) : 0);   // +-25 %
+  _stats.lastBackoffMs = d;
+  return d;
+}
+
+void MqttClient::drop(uint32_t nowMs) {
+  _t.close();
+  if (_conn) _stats.disconnects++;
+  _conn = _pingOut = false;
+  _retryAt = nowMs + backoff();
+}
+
+bool MqttClient::connect(uint32_t nowMs) {
+  if (!_t.open(_host, _port, _connectTimeout)) {
+    _stats.connectFails++;
+    _retryAt = nowMs + backoff();
+    return false;
+  }
+  uint8_t* v = _tx + 5;                      // variable header + payload, fixed header before it
+  uint8_t* p = putStr(v, "MQTT");
+  *p++ = 4;                                  // protocol level 3.1.1
+  uint8_t flags = 0x02 | 0x04 | 0x08 | 0x20; // clean session, will at QoS 1, retained
+  if (_user[0]) flags |= 0x80;
+  if (_user[0] && _pass[0]) flags |= 0x40;
+  *p++ = flags;
+  *p++ = _keepalive >> 8;
+  *p++ = _keepalive;
+  p = putStr(p, _clientId);
+  p = putStr(p, _topic[TOPIC_STATUS]);
+  p = putStr(p, "offline");
+  if (flags & 0x80) p = putStr(p, _user);
+  if (flags & 0x40) p = putStr(p, _pass);
+  uint8_t vb[4];
+  size_t vn = putVarint(vb, p - v);
+  uint8_t* start = v - 1 - vn;
+  start[0] = MQTT_CONNECT;
+  memcpy(start + 1, vb, vn);
+
+  uint8_t type = 0, body[4];
+  size_t len = 0;
+  if (!_t.write(start, p - start) || readPacket(&type, body, sizeof(body), &len, _connectTimeout) != 1 ||
+      type != MQTT_CONNACK || len < 2 || body[1] != 0) {
+    _t.close();
+    _stats.connectFails++;
+    _retryAt = nowMs + backoff();
+    return false;
+  }
+  _conn = true;
+  _pingOut = false;
+  _lastTx = nowMs;
+  _attempt = 0;
+  _stats.connects++;
+  memcpy(_tx + MQTT_HDR_RESERVE, "online", 6);
+  if (!publish(_topic[TOPIC_STATUS], _tx + MQTT_HDR_RESERVE, 6, 0, true)) { drop(nowMs); return false; }
+  return true;
+}
+
+// payload must sit at _tx + MQTT_HDR_RESERVE or later; the header is
+// written in front of it so the packet goes out in one write.
+bool MqttClient::publish(const char* topic, uint8_t* payload, size_t len, uint8_t qos, bool retain) {
+  size_t tl = strlen(topic), var = 2 + tl + (qos ? 2 : 0);
+  uint8_t vb[4];
+  size_t vn = putVarint(vb, var + len);
+  uint8_t* p = payload - var - 1 - vn;
+  p[0] = MQTT_PUBLISH | qos << 1 | (retain ? 1 : 0);
+  memcpy(p + 1, vb, vn);
+  uint8_t* q = putStr(p + 1 + vn, topic);
+  uint16_t id = 0;
+  if (qos) {
+    if (!++_pid) _pid = 1;
+    id = _pid;
+    *q++ = id >> 8;
+    *q++ = id;
+  }
+  if (!_t.write(p, payload + len - p)) return false;
+  if (!qos) return true;
+  for (;;) {
+    uint8_t type = 0, body[4];
+    size_t blen = 0;
+    if (readPacket(&type, body, sizeof(body), &blen, _ackTimeout) != 1) return false;
+    if (type == MQTT_PINGRESP) _pingOut = false;
+    if (type == MQTT_PUBACK && blen >= 2 && (uint16_t)(body[0] << 8 | body[1]) == id) return true;
+  }
+}
+
+uint32_t MqttClient::step(uint32_t nowMs) {
+  if (!_queue) return MQTT_WAIT_MAX_MS;
+  uint32_t wait = MQTT_WAIT_MAX_MS;
+  lock();
+  sealDue(nowMs, false);
+  for (int s = 0; s < MQTT_STREAMS; s++) {
+    if (!_batch[s].items) continue;
+    uint32_t age = nowMs - _batch[s].openedMs, due = _bcfg[s].maxAgeMs > age ? _bcfg[s].maxAgeMs - age : 0;
+    if (due < wait) wait = due;
+  }
+  unlock();
+
+  if (!_conn) {
+    if ((int32_t)(nowMs - _retryAt) < 0) {
+      uint32_t retry = _retryAt - nowMs;
+      return retry < wait ? retry : wait;
+    }
+    if (!connect(nowMs)) return 0;
+  }
+
+  // Oldest batch out. It stays queued until published (PUBACKed at QoS 1);
+  // if add() drops it meanwhile to make room, the seq no longer matches.
+  lock();
+  bool have = _qused > 0;
+  uint32_t seq = _qseq;
+  uint8_t h[MQTT_REC_HDR];
+  uint16_t len = 0, items = 0;
+  uint8_t stream = 0;
+  if (have) {
+    ringRead(_qhead, h, sizeof(h));
+    len = h[0] | h[1] << 8;
+    stream = h[2];
+    items = h[4] | h[5] << 8;
+    ringRead(_qhead + MQTT_REC_HDR, _tx + MQTT_HDR_RESERVE, len);
+  }
+  unlock();
+  if (have) {
+    if (!publish(_topic[stream == MQTT_EVENTS ? TOPIC_EVENTS : TOPIC_TELEMETRY], _tx + MQTT_HDR_RESERVE, len,
+                 _bcfg[stream].qos, false)) {
+      drop(nowMs);
+      return 0;
+    }
+    _lastTx = nowMs;
+    lock();
+    if (_qseq == seq && _qused) dropHead();
+    _stats.published++;
+    _stats.publishedItems += items;
+    _stats.pubBytes += len;
+    unlock();
+    return 0;
+  }
+
+  // Idle: keepalive and whatever the broker sends.
+  uint8_t type = 0, body[4];
+  size_t blen = 0;
+  int r = readPacket(&type, body, sizeof(body), &blen, 0);
+  if (r < 0) { drop(nowMs); return 0; }
+  if (r > 0 && type == MQTT_PINGRESP) _pingOut = false;
+  uint32_t kaMs = _keepalive * 1000UL;
+  if (_pingOut && nowMs - _pingSent > kaMs) { drop(nowMs); return 0; }
+  if (!_pingOut && nowMs - _lastTx >= kaMs / 2) {
+    const uint8_t ping[2] = { MQTT_PINGREQ, 0 };
+    if (!_t.write(ping, sizeof(ping))) { drop(nowMs); return 0; }
+    _pingOut = true;
+    _pingSent = _lastTx = nowMs;
+  }
+  uint32_t pingDue = kaMs / 2 - (nowMs - _lastTx);
+  return pingDue < wait ? pingDue : wait;
+}
@@ -0,0 +1,149 @@
+// Minimal MQTT 3.1.1 publisher for events and telemetry.
+//
+// Producers add small JSON objects to one of two streams. Each stream
+// collects them into a JSON array until the batch is full or old enough;
+// the sealed batch then goes into a bounded byte queue and is published as
+// one message to <prefix>/events or <prefix>/telemetry. While the broker
+// is unreachable the queue keeps filling; when it is full the oldest batch
+// is dropped (and counted) to make room. Events go out at QoS 1 and leave
+// the queue only once PUBACKed; telemetry is QoS 0.
+//
+// Connection handling is exponential backoff with jitter between
+// backoffMinMs and backoffMaxMs, a last will of "offline" (retained) on
+// <prefix>/status, and PINGREQ after keepalive/2 of silence.
+//
+// Everything runs on the thread calling step(); add() may be called from
+// other threads if an MqttLock is supplied. The lock is held only for
+// queue operations, never across network I/O.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#define MQTT_TOPIC_MAX     64
+#define MQTT_HDR_RESERVE   (5 + 2 + MQTT_TOPIC_MAX + 2 + 7)   // fixed header + topic + packet id
+#define MQTT_REC_HDR       8                                 // queue record header
+
+enum MqttStream : uint8_t { MQTT_EVENTS, MQTT_TELEMETRY, MQTT_STREAMS };
+
+class MqttTransport {
+public:
+  virtual ~MqttTransport() {}
+  virtual bool open(const char* host, uint16_t port, uint32_t timeoutMs) = 0;
+  virtual void close() = 0;
+  // All of n, or false (connection is then unusable).
+  virtual bool write(const uint8_t* p, size_t n) = 0;
+  // Up to n bytes: > 0 read, 0 nothing within timeoutMs, < 0 closed.
+  virtual int read(uint8_t* p, size_t n, uint32_t timeoutMs) = 0;
+};
+
+class MqttLock {
+public:
+  virtual ~MqttLock() {}
+  virtual void lock() = 0;
+  virtual void unlock() = 0;
+};
+
+struct MqttConfig {
+  const char* host;
+  uint16_t    port;
+  const char* clientId;
+  const char* user;              // nullptr / "" = none
+  const char* pass;
+  const char* prefix;            // topic prefix, e.g. "aniviza/a1b2c3"
+  uint16_t    keepaliveS;
+  uint32_t    connectTimeoutMs;
+  uint32_t    ackTimeoutMs;
+  uint32_t    backoffMinMs, backoffMaxMs;
+};
+
+struct MqttBatchConfig {
+  uint16_t maxBytes;             // payload limit, brackets included
+  uint32_t maxAgeMs;             // seal this long after the first item
+  uint8_t  qos;                  // 0 or 1
+};
+
+struct MqttStats {
+  uint32_t items, rejected;      // add() accepted / refused (too big, not started)
+  uint32_t batches;              // sealed
+  uint32_t published, publishedItems, pubBytes;
+  uint32_t droppedBatches, droppedItems;
+  uint32_t connects, connectFails, disconnects;
+  uint32_t queueBytes, queueHigh, queueCap;
+  uint32_t lastBackoffMs;
+};
+
+class MqttClient {
+public:
+  MqttClient(MqttTransport& t, MqttLock* lock = nullptr) : _t(t), _lock(lock) {}
+  ~MqttClient() { end(); }
+
+  // Copies cfg strings it needs. Allocates the queue, the open batches and
+  // a transmit buffer; memoryBytes() reports the total.
+  bool begin(const MqttConfig& cfg, const MqttBatchConfig batch[MQTT_STREAMS], size_t queueBytes);
+  // If connected, publishes a retained "offline" on <prefix>/status (a
+  // clean DISCONNECT drops the will) and sends DISCONNECT. Then frees.
+  void end();
+
+  bool add(MqttStream s, const char* json, uint32_t nowMs);
+  // Connects / publishes / keeps alive. Returns how long the caller may
+  // sleep before calling again (new items do not need an earlier call
+  // unless they fill a batch).
+  uint32_t step(uint32_t nowMs);
+
+  bool connected() const { return _conn; }
+  bool started() const { return _queue != nullptr; }
+  size_t memoryBytes() const;
+  MqttStats stats();
+
+private:
+  MqttClient(const MqttClient&) = delete;
+  MqttClient& operator=(const MqttClient&) = delete;
+
+  struct Batch {
+    char*    buf = nullptr;
+    uint16_t len = 0, items = 0;
+    uint32_t openedMs = 0;
+  };
+
+  void lock() { if (_lock) _lock->lock(); }
+  void unlock() { if (_lock) _lock->unlock(); }
+
+  // Queue (caller holds the lock)
+  void seal(int s);
+  void sealDue(uint32_t nowMs, bool all);
+  bool push(uint8_t stream, uint16_t items, const char* p, uint16_t len);
+  void dropHead();
+  void ringRead(size_t pos, uint8_t* out, size_t n) const;
+  void ringWrite(size_t pos, const uint8_t* in, size_t n);
+
+  // Session
+  bool connect(uint32_t nowMs);
+  void drop(uint32_t nowMs);
+  bool publish(const char* topic, uint8_t* payload, size_t len, uint8_t qos, bool retain);
+  int  readPacket(uint8_t* type, uint8_t* body, size_t cap, size_t* len, uint32_t timeoutMs);
+  bool readExact(uint8_t* p, size_t n, uint32_t timeoutMs);
+  uint32_t backoff();
+
+  MqttTransport& _t;
+  MqttLock*      _lock;
+  MqttBatchConfig _bcfg[MQTT_STREAMS];
+  Batch          _batch[MQTT_STREAMS];
+  char           _host[64], _clientId[32], _user[32], _pass[64];
+  char           _topic[3][MQTT_TOPIC_MAX];   // events, telemetry, status
+  uint16_t       _port = 0, _keepalive = 0;
+  uint32_t       _connectTimeout = 0, _ackTimeout = 0, _backoffMin = 0, _backoffMax = 0;
+
+  uint8_t*       _queue = nullptr;
+  size_t         _qcap = 0, _qhead = 0, _qused = 0;
+  uint32_t       _qseq = 0;                  // seq of the head record
+  uint8_t*       _tx = nullptr;
+  size_t         _txCap = 0;
+
+  bool           _conn = false;
+  uint32_t       _retryAt = 0, _lastTx = 0, _pingSent = 0;
+  bool           _pingOut = false;
+  uint8_t        _attempt = 0;
+  uint16_t       _pid = 0;
+  uint32_t       _rng = 0x9E3779B9;
+  MqttStats      _stats = {};
+};
@@ -0,0 +1,51 @@
+// RTP (RFC 3550) fixed header, written in place in the 12 bytes reserved
+// in front of a payload that was encoded straight into the packet buffer.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#define RTP_HDR_LEN   12
+#define RTP_VERSION   2
+#define RTP_PT_CN     13        // comfort noise, RFC 3389
+
+class RtpPacketizer {
+public:
+  // ssrc, seq and tsBase should be random per session (RFC 3550 5.1);
+  // tsBase is added to every timestamp passed to finish().
+  void begin(uint8_t pt, uint32_t ssrc, uint16_t seq, uint32_t tsBase = 0) {
+    _pt = pt & 0x7F;
+    _ssrc = ssrc;
+    _seq = seq;
+    _tsBase = tsBase;
+    _marker = true;                       // first packet of the stream
+  }
+  // Next packet follows a gap in the capture timeline (or a talkspurt start).
+  void discontinuity() { _marker = true; }
+
+  // pkt points at the reserved header space; ts is the sampling instant of
+  // the first payload byte. Returns the datagram length. A pt override
+  // (e.g. RTP_PT_CN) sends an out-of-band packet on the same stream and
+  // leaves a pending marker for the next media packet.
+  size_t finish(uint8_t* pkt, uint32_t ts, size_t payloadLen, int pt = -1) {
+    bool media = pt < 0;
+    pkt[0] = RTP_VERSION << 6;
+    pkt[1] = media ? (_marker ? 0x80 : 0) | _pt : pt & 0x7F;
+    pkt[2] = _seq >> 8;  pkt[3] = _seq;
+    ts += _tsBase;
+    pkt[4] = ts >> 24;   pkt[5] = ts >> 16;   pkt[6] = ts >> 8;   pkt[7] = ts;
+    pkt[8] = _ssrc >> 24; pkt[9] = _ssrc >> 16; pkt[10] = _ssrc >> 8; pkt[11] = _ssrc;
+    _seq++;
+    if (media) _marker = false;
+    return RTP_HDR_LEN + payloadLen;
+  }
+
+  uint16_t seq() const { return _seq; }
+  uint32_t ssrc() const { return _ssrc; }
+
+private:
+  uint8_t  _pt = 0;
+  bool     _marker = true;
+  uint16_t _seq = 0;
+  uint32_t _ssrc = 0;
+  uint32_t _tsBase = 0;
+};
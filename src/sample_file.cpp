@@ -0,0 +1,49 @@
+#ifndef ARDUINO
+#include "sample_file.h"
+#include <string.h>
+#include <strings.h>
+
+bool SampleFile::open(const char* path, uint32_t rate) {
+  close();
+  size_t len = strlen(path);
+  _isWav = len > 4 && !strcasecmp(path + len - 4, ".wav");
+  if (_isWav) {
+    if (!_wav.open(path, false)) return false;
+    _rate = _wav.rate();
+    return true;
+  }
+  _txt = fopen(path, "r");
+  _rate = rate;
+  return _txt != nullptr && rate;
+}
+
+void SampleFile::close() {
+  if (_txt) fclose(_txt);
+  _txt = nullptr;
+  _wav.close();
+}
+
+size_t SampleFile::read(uint16_t* out, size_t n) {
+  size_t got = 0;
+  if (_isWav) {
+    int32_t buf[256];
+    while (got < n) {
+      size_t want = n - got < 256 ? n - got : 256;
+      size_t r = _wav.read(buf, want);
+      for (size_t i = 0; i < r; i++) out[got + i] = (uint16_t)(2048 + (buf[i] >> 12));   // 24 -> 12 bit
+      got += r;
+      if (r < want) break;
+    }
+    return got;
+  }
+  while (got < n && _txt) {
+    int c = fgetc(_txt);
+    while (c != EOF && !(c >= '0' && c <= '9')) c = fgetc(_txt);
+    if (c == EOF) break;
+    unsigned v = 0;
+    for (; c >= '0' && c <= '9'; c = fgetc(_txt)) v = v * 10 + (c - '0');
+    out[got++] = v > 4095 ? 4095 : (uint16_t)v;
+  }
+  return got;
+}
+#endif
@@ -0,0 +1,30 @@
+// Host stand-in for the KY-038 ADC stream: replays recorded samples as
+// raw 12-bit ADC values, so the envelope detector can be tuned on Linux.
+// Host builds only.
+//
+// Accepts either a text file of ADC readings (decimal, separated by
+// whitespace or commas, as logged from the serial port) at a given rate,
+// or a PCM WAV file, which is mapped onto 12 bits around mid-scale.
+#pragma once
+#ifndef ARDUINO
+#include <stdio.h>
+#include "wav_source.h"
+
+class SampleFile {
+public:
+  ~SampleFile() { close(); }
+
+  // rate applies to text files; WAV files carry their own.
+  bool open(const char* path, uint32_t rate);
+  void close();
+
+  uint32_t rate() const { return _rate; }
+  size_t read(uint16_t* out, size_t n);
+
+private:
+  FILE*     _txt = nullptr;
+  WavSource _wav;
+  bool      _isWav = false;
+  uint32_t  _rate = 0;
+};
+#endif
@@ -0,0 +1,247 @@
+#ifndef ARDUINO
+#include "soft_crypto.h"
+#include <string.h>
+
+// ---- AES-128 (FIPS 197)
+
+static const uint8_t SBOX[256] = {
+  0x63,0x7c,0x77,0x7b,0xf2,0x6b,0x6f,0xc5,0x30,0x01,0x67,0x2b,0xfe,0xd7,0xab,0x76,
+  0xca,0x82,0xc9,0x7d,0xfa,0x59,0x47,0xf0,0xad,0xd4,0xa2,0xaf,0x9c,0xa4,0x72,0xc0,
+  0xb7,0xfd,0x93,0x26,0x36,0x3f,0xf7,0xcc,0x34,0xa5,0xe5,0xf1,0x71,0xd8,0x31,0x15,
+  0x04,0xc7,0x23,0xc3,0x18,0x96,0x05,0x9a,0x07,0x12,0x80,0xe2,0xeb,0x27,0xb2,0x75,
+  0x09,0x83,0x2c,0x1a,0x1b,0x6e,0x5a,0xa0,0x52,0x3b,0xd6,0xb3,0x29,0xe3,0x2f,0x84,
+  0x53,0xd1,0x00,0xed,0x20,0xfc,0xb1,0x5b,0x6a,0xcb,0xbe,0x39,0x4a,0x4c,0x58,0xcf,
+  0xd0,0xef,0xaa,0xfb,0x43,0x4d,0x33,0x85,0x45,0xf9,0x02,0x7f,0x50,0x3c,0x9f,0xa8,
+  0x51,0xa3,0x40,0x8f,0x92,0x9d,0x38,0xf5,0xbc,0xb6,0xda,0x21,0x10,0xff,0xf3,0xd2,
+  0xcd,0x0c,0x13,0xec,0x5f,0x97,0x44,0x17,0xc4,0xa7,0x7e,0x3d,0x64,0x5d,0x19,0x73,
+  0x60,0x81,0x4f,0xdc,0x22,0x2a,0x90,0x88,0x46,0xee,0xb8,0x14,0xde,0x5e,0x0b,0xdb,
+  0xe0,0x32,0x3a,0x0a,0x49,0x06,0x24,0x5c,0xc2,0xd3,0xac,0x62,0x91,0x95,0xe4,0x79,
+  0xe7,0xc8,0x37,0x6d,0x8d,0xd5,0x4e,0xa9,0x6c,0x56,0xf4,0xea,0x65,0x7a,0xae,0x08,
+  0xba,0x78,0x25,0x2e,0x1c,0xa6,0xb4,0xc6,0xe8,0xdd,0x74,0x1f,0x4b,0xbd,0x8b,0x8a,
+  0x70,0x3e,0xb5,0x66,0x48,0x03,0xf6,0x0e,0x61,0x35,0x57,0xb9,0x86,0xc1,0x1d,0x9e,
+  0xe1,0xf8,0x98,0x11,0x69,0xd9,0x8e,0x94,0x9b,0x1e,0x87,0xe9,0xce,0x55,0x28,0xdf,
+  0x8c,0xa1,0x89,0x0d,0xbf,0xe6,0x42,0x68,0x41,0x99,0x2d,0x0f,0xb0,0x54,0xbb,0x16,
+};
+
+static inline uint8_t xtime(uint8_t x) { return (uint8_t)((x << 1) ^ ((x >> 7) * 0x1b)); }
+
+void SoftAes128::setKey(const uint8_t key[16]) {
+  memcpy(_rk, key, 16);
+  uint8_t rcon = 1;
+  for (int i = 16; i < 176; i += 4) {
+    uint8_t t[4] = { _rk[i - 4], _rk[i - 3], _rk[i - 2], _rk[i - 1] };
+    if (i % 16 == 0) {
+      uint8_t u = t[0];
+      t[0] = SBOX[t[1]] ^ rcon; t[1] = SBOX[t[2]]; t[2] = SBOX[t[3]]; t[3] = SBOX[u];
+      rcon = xtime(rcon);
+    }
+    for (int j = 0; j < 4; j++) _rk[i + j] = _rk[i - 16 + j] ^ t[j];
+  }
+}
+
+void SoftAes128::encrypt(const uint8_t in[16], uint8_t out[16]) const {
+  uint8_t s[16];
+  for (int i = 0; i < 16; i++) s[i] = in[i] ^ _rk[i];
+  for (int r = 1; r <= 10; r++) {
+    uint8_t t[16];
+    for (int i = 0; i < 16; i++) t[i] = SBOX[s[(i + 4 * (i % 4)) % 16]];   // SubBytes + ShiftRows
+    if (r < 10) {
+      for (int c = 0; c < 4; c++) {                                        // MixColumns
+        uint8_t* p = t + 4 * c;
+        uint8_t a = p[0] ^ p[1] ^ p[2] ^ p[3], p0 = p[0];
+        p[0] ^= a ^ xtime(p[0] ^ p[1]);
+        p[1] ^= a ^ xtime(p[1] ^ p[2]);
+        p[2] ^= a ^ xtime(p[2] ^ p[3]);
+        p[3] ^= a ^ xtime(p[3] ^ p0);
+      }
+    }
+    for (int i = 0; i < 16; i++) s[i] = t[i] ^ _rk[16 * r + i];
+  }
+  memcpy(out, s, 16);
+}
+
+// ---- AES-128-CCM (RFC 3610)
+
+// CBC-MAC over B0 | len(ad) ad | pt, each part zero-padded to a block.
+void SoftAesCcm::mac(size_t tagLen, size_t len, const uint8_t* nonce, size_t nonceLen, const uint8_t* ad,
+                     size_t adLen, const uint8_t* pt, uint8_t t[16]) const {
+  size_t L = 15 - nonceLen;
+  uint8_t b[16];
+  b[0] = (uint8_t)((adLen ? 0x40 : 0) | ((tagLen - 2) / 2) << 3 | (L - 1));
+  memcpy(b + 1, nonce, nonceLen);
+  for (size_t i = 0; i < L; i++) b[15 - i] = (uint8_t)(i < sizeof(size_t) ? len >> (8 * i) : 0);
+  _aes.encrypt(b, t);
+  if (adLen) {
+    uint8_t blk[16] = { (uint8_t)(adLen >> 8), (uint8_t)adLen };
+    size_t k = 2;
+    for (size_t i = 0; i < adLen; i++) {
+      blk[k++] = ad[i];
+      if (k == 16 || i + 1 == adLen) {
+        for (size_t j = 0; j < 16; j++) t[j] ^= j < k ? blk[j] : 0;
+        _aes.encrypt(t, t);
+        k = 0;
+      }
+    }
+  }
+  for (size_t off = 0; off < len; off += 16) {
+    size_t n = len - off < 16 ? len - off : 16;
+    for (size_t j = 0; j < n; j++) t[j] ^= pt[off + j];
+    _aes.encrypt(t, t);
+  }
+}
+
+// Counter blocks A1.. for the payload; s0 = E(A0) masks the tag.
+void SoftAesCcm::ctr(size_t len, const uint8_t* nonce, size_t nonceLen, const uint8_t* in, uint8_t* out,
+                     uint8_t s0[16]) const {
+  uint8_t a[16] = { (uint8_t)(14 - nonceLen) }, ks[16];
+  memcpy(a + 1, nonce, nonceLen);
+  _aes.encrypt(a, s0);
+  for (size_t off = 0; off < len; off += 16) {
+    for (int i = 15; i > (int)nonceLen && !++a[i]; i--) {}
+    _aes.encrypt(a, ks);
+    size_t n = len - off < 16 ? len - off : 16;
+    for (size_t j = 0; j < n; j++) out[off + j] = in[off + j] ^ ks[j];
+  }
+}
+
+static bool ccmArgsOk(size_t nonceLen, size_t adLen, size_t tagLen) {
+  return nonceLen >= 7 && nonceLen <= 13 && adLen < 0xFF00 && tagLen >= 4 && tagLen <= 16 && !(tagLen & 1);
+}
+
+bool SoftAesCcm::encrypt(size_t len, const uint8_t* nonce, size_t nonceLen, const uint8_t* ad, size_t adLen,
+                         const uint8_t* in, uint8_t* out, uint8_t* tag, size_t tagLen) const {
+  if (!ccmArgsOk(nonceLen, adLen, tagLen)) return false;
+  uint8_t t[16], s0[16];
+  mac(tagLen, len, nonce, nonceLen, ad, adLen, in, t);
+  ctr(len, nonce, nonceLen, in, out, s0);
+  for (size_t j = 0; j < tagLen; j++) tag[j] = t[j] ^ s0[j];
+  return true;
+}
+
+bool SoftAesCcm::decrypt(size_t len, const uint8_t* nonce, size_t nonceLen, const uint8_t* ad, size_t adLen,
+                         const uint8_t* in, uint8_t* out, const uint8_t* tag, size_t tagLen) const {
+  if (!ccmArgsOk(nonceLen, adLen, tagLen)) return false;
+  uint8_t t[16], s0[16];
+  ctr(len, nonce, nonceLen, in, out, s0);
+  mac(tagLen, len, nonce, nonceLen, ad, adLen, out, t);
+  uint8_t diff = 0;
+  for (size_t j = 0; j < tagLen; j++) diff |= tag[j] ^ t[j] ^ s0[j];
+  if (diff) memset(out, 0, len);
+  return !diff;
+}
+
+// ---- SHA-1 (FIPS 180-4)
+
+static inline uint32_t rol(uint32_t x, int n) { return (x << n) | (x >> (32 - n)); }
+
+void SoftSha1::starts() {
+  _h[0] = 0x67452301; _h[1] = 0xEFCDAB89; _h[2] = 0x98BADCFE; _h[3] = 0x10325476; _h[4] = 0xC3D2E1F0;
+  _len = 0;
+  _n = 0;
+}
+
+void SoftSha1::block(const uint8_t* p) {
+  uint32_t w[80];
+  for (int i = 0; i < 16; i++) w[i] = (uint32_t)p[4 * i] << 24 | p[4 * i + 1] << 16 | p[4 * i + 2] << 8 | p[4 * i + 3];
+  for (int i = 16; i < 80; i++) w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+  uint32_t a = _h[0], b = _h[1], c = _h[2], d = _h[3], e = _h[4];
+  for (int i = 0; i < 80; i++) {
+    uint32_t f, k;
+    if (i < 20)      { f = (b & c) | (~b & d);          k = 0x5A827999; }
+    else if (i < 40) { f = b ^ c ^ d;                   k = 0x6ED9EBA1; }
+    else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+    else             { f = b ^ c ^ d;                   k = 0xCA62C1D6; }
+    uint32_t t = rol(a, 5) + f + e + k + w[i];
+    e = d; d = c; c = rol(b, 30); b = a; a = t;
+  }
+  _h[0] += a; _h[1] += b; _h[2] += c; _h[3] += d; _h[4] += e;
+}
+
+void SoftSha1::update(const uint8_t* p, size_t n) {
+  _len += n;
+  if (_n) {
+    size_t k = 64 - _n < n ? 64 - _n : n;
+    memcpy(_buf + _n, p, k);
+    _n += k; p += k; n -= k;
+    if (_n < 64) return;
+    block(_buf);
+    _n = 0;
+  }
+  for (; n >= 64; p += 64, n -= 64) block(p);
+  memcpy(_buf, p, n);
+  _n = n;
+}
+
+void SoftSha1::finish(uint8_t out[20]) {
+  uint64_t bits = _len * 8;
+  uint8_t pad[72] = { 0x80 };
+  size_t padLen = (_n < 56 ? 56 : 120) - _n;
+  for (int i = 0; i < 8; i++) pad[padLen + i] = (uint8_t)(bits >> (56 - 8 * i));
+  update(pad, padLen + 8);
+  for (int i = 0; i < 20; i++) out[i] = (uint8_t)(_h[i / 4] >> (24 - 8 * (i % 4)));
+}
+
+// ---- SHA-256 (FIPS 180-4)
+
+static const uint32_t K256[64] = {
+  0x428a2f98,0x71374491,0xb5c0fbcf,0xe9b5dba5,0x3956c25b,0x59f111f1,0x923f82a4,0xab1c5ed5,
+  0xd807aa98,0x12835b01,0x243185be,0x550c7dc3,0x72be5d74,0x80deb1fe,0x9bdc06a7,0xc19bf174,
+  0xe49b69c1,0xefbe4786,0x0fc19dc6,0x240ca1cc,0x2de92c6f,0x4a7484aa,0x5cb0a9dc,0x76f988da,
+  0x983e5152,0xa831c66d,0xb00327c8,0xbf597fc7,0xc6e00bf3,0xd5a79147,0x06ca6351,0x14292967,
+  0x27b70a85,0x2e1b2138,0x4d2c6dfc,0x53380d13,0x650a7354,0x766a0abb,0x81c2c92e,0x92722c85,
+  0xa2bfe8a1,0xa81a664b,0xc24b8b70,0xc76c51a3,0xd192e819,0xd6990624,0xf40e3585,0x106aa070,
+  0x19a4c116,0x1e376c08,0x2748774c,0x34b0bcb5,0x391c0cb3,0x4ed8aa4a,0x5b9cca4f,0x682e6ff3,
+  0x748f82ee,0x78a5636f,0x84c87814,0x8cc70208,0x90befffa,0xa4506ceb,0xbef9a3f7,0xc67178f2,
+};
+
+static inline uint32_t ror(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+void SoftSha256::starts() {
+  static const uint32_t H0[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                  0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+  memcpy(_h, H0, sizeof(_h));
+  _len = 0;
+  _n = 0;
+}
+
+void SoftSha256::block(const uint8_t* p) {
+  uint32_t w[64];
+  for (int i = 0; i < 16; i++) w[i] = (uint32_t)p[4 * i] << 24 | p[4 * i + 1] << 16 | p[4 * i + 2] << 8 | p[4 * i + 3];
+  for (int i = 16; i < 64; i++) {
+    uint32_t s0 = ror(w[i - 15], 7) ^ ror(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    uint32_t s1 = ror(w[i - 2], 17) ^ ror(w[i - 2], 19) ^ (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+  uint32_t a = _h[0], b = _h[1], c = _h[2], d = _h[3], e = _h[4], f = _h[5], g = _h[6], h = _h[7];
+  for (int i = 0; i < 64; i++) {
+    uint32_t t1 = h + (ror(e, 6) ^ ror(e, 11) ^ ror(e, 25)) + ((e & f) ^ (~e & g)) + K256[i] + w[i];
+    uint32_t t2 = (ror(a, 2) ^ ror(a, 13) ^ ror(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    h = g; g = f; f = e; e = d + t1; d = c; c = b; b = a; a = t1 + t2;
+  }
+  _h[0] += a; _h[1] += b; _h[2] += c; _h[3] += d; _h[4] += e; _h[5] += f; _h[6] += g; _h[7] += h;
+}
+
+void SoftSha256::update(const uint8_t* p, size_t n) {
+  _len += n;
+  if (_n) {
+    size_t k = 64 - _n < n ? 64 - _n : n;
+    memcpy(_buf + _n, p, k);
+    _n += k; p += k; n -= k;
+    if (_n < 64) return;
+    block(_buf);
+    _n = 0;
+  }
+  for (; n >= 64; p += 64, n -= 64) block(p);
+  memcpy(_buf, p, n);
+  _n = n;
+}
+
+void SoftSha256::finish(uint8_t out[32]) {
+  uint64_t bits = _len * 8;
+  uint8_t pad[72] = { 0x80 };
+  size_t padLen = (_n < 56 ? 56 : 120) - _n;
+  for (int i = 0; i < 8; i++) pad[padLen + i] = (uint8_t)(bits >> (56 - 8 * i));
+  update(pad, padLen + 8);
+  for (int i = 0; i < 32; i++) out[i] = (uint8_t)(_h[i / 4] >> (24 - 8 * (i % 4)));
+}
+#endif
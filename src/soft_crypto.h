@@ -0,0 +1,70 @@
+// Small software AES-128 (encryption only), AES-128-CCM, SHA-1 and SHA-256 for host builds of
+// code that uses the ESP32 crypto peripherals through mbedtls on the
+// device. Not constant-time: host tools and tests only.
+#pragma once
+#ifndef ARDUINO
+#include <stdint.h>
+#include <stddef.h>
+
+class SoftAes128 {
+public:
+  void setKey(const uint8_t key[16]);
+  void encrypt(const uint8_t in[16], uint8_t out[16]) const;
+
+private:
+  uint8_t _rk[176];
+};
+
+// AES-128-CCM (RFC 3610), nonce 7..13 bytes, tag 4..16 bytes (even),
+// associated data below 0xFF00 bytes. Same argument order as mbedtls_ccm.
+class SoftAesCcm {
+public:
+  void setKey(const uint8_t key[16]) { _aes.setKey(key); }
+  bool encrypt(size_t len, const uint8_t* nonce, size_t nonceLen, const uint8_t* ad, size_t adLen,
+               const uint8_t* in, uint8_t* out, uint8_t* tag, size_t tagLen) const;
+  // False (and out zeroed) if the tag does not match.
+  bool decrypt(size_t len, const uint8_t* nonce, size_t nonceLen, const uint8_t* ad, size_t adLen,
+               const uint8_t* in, uint8_t* out, const uint8_t* tag, size_t tagLen) const;
+
+private:
+  void mac(size_t tagLen, size_t len, const uint8_t* nonce, size_t nonceLen, const uint8_t* ad,
+           size_t adLen, const uint8_t* pt, uint8_t t[16]) const;
+  void ctr(size_t len, const uint8_t* nonce, size_t nonceLen, const uint8_t* in, uint8_t* out,
+           uint8_t s0[16]) const;
+
+  SoftAes128 _aes;
+};
+
+// Plain struct so a partially hashed state (e.g. HMAC ipad/opad) can be
+// copied.
+class SoftSha1 {
+public:
+  void starts();
+  void update(const uint8_t* p, size_t n);
+  void finish(uint8_t out[20]);
+
+private:
+  void block(const uint8_t* p);
+
+  uint32_t _h[5];
+  uint64_t _len;
+  uint8_t  _buf[64];
+  size_t   _n;
+};
+
+// Same shape as SoftSha1.
+class SoftSha256 {
+public:
+  void starts();
+  void update(const uint8_t* p, size_t n);
+  void finish(uint8_t out[32]);
+
+private:
+  void block(const uint8_t* p);
+
+  uint32_t _h[8];
+  uint64_t _len;
+  uint8_t  _buf[64];
+  size_t   _n;
+};
+#endif
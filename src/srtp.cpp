@@ -0,0 +1,222 @@
+#include "srtp.h"
+#include <string.h>
+
+#define SRTP_LABEL_ENC   0
+#define SRTP_LABEL_AUTH  1
+#define SRTP_LABEL_SALT  2
+
+static uint32_t rdBE32(const uint8_t* p) { return (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3]; }
+
+// RTP header length including CSRCs and extension; 0 if malformed.
+static size_t rtpHeaderLen(const uint8_t* p, size_t len) {
+  if (len < 12 || (p[0] >> 6) != 2) return 0;
+  size_t hl = 12 + 4 * (p[0] & 0x0F);
+  if (p[0] & 0x10) {
+    if (hl + 4 > len) return 0;
+    hl += 4 + 4 * (size_t)(p[hl + 2] << 8 | p[hl + 3]);
+  }
+  return hl <= len ? hl : 0;
+}
+
+SrtpSession::SrtpSession() {
+#ifdef SRTP_MBEDTLS
+  mbedtls_aes_init(&_aes);
+  mbedtls_md_init(&_hmac);
+#endif
+}
+
+SrtpSession::~SrtpSession() {
+  end();
+#ifdef SRTP_MBEDTLS
+  mbedtls_aes_free(&_aes);
+  mbedtls_md_free(&_hmac);
+#endif
+}
+
+bool SrtpSession::setKeys() {
+#ifdef SRTP_MBEDTLS
+  if (!_mdReady && mbedtls_md_setup(&_hmac, mbedtls_md_info_from_type(MBEDTLS_MD_SHA1), 1) != 0) return false;
+  _mdReady = true;
+  if (mbedtls_aes_setkey_enc(&_aes, _key, 128) != 0) return false;
+  if (mbedtls_md_hmac_starts(&_hmac, _auth, SRTP_AUTH_KEY_LEN) != 0) return false;
+#else
+  _aes.setKey(_key);
+  uint8_t pad[64];
+  memset(pad, 0x36, sizeof(pad));
+  for (int i = 0; i < SRTP_AUTH_KEY_LEN; i++) pad[i] ^= _auth[i];
+  _ipad.starts();
+  _ipad.update(pad, 64);
+  memset(pad, 0x5C, sizeof(pad));
+  for (int i = 0; i < SRTP_AUTH_KEY_LEN; i++) pad[i] ^= _auth[i];
+  _opad.starts();
+  _opad.update(pad, 64);
+#endif
+  return true;
+}
+
+bool SrtpSession::begin(const uint8_t master[SRTP_MASTER_LEN]) {
+  // Key derivation (RFC 3711 4.3, kdr 0): session key for label L is the
+  // AES-CM keystream under the master key with IV = (salt ^ L << 48) << 16.
+  memcpy(_key, master, SRTP_KEY_LEN);
+  memset(_auth, 0, sizeof(_auth));
+  if (!setKeys()) return false;
+  uint8_t key[SRTP_KEY_LEN], salt[SRTP_SALT_LEN], auth[SRTP_AUTH_KEY_LEN];
+  const uint8_t* msalt = master + SRTP_KEY_LEN;
+  struct { uint8_t label; uint8_t* out; size_t len; } d[] = {
+    { SRTP_LABEL_ENC, key, sizeof(key) }, { SRTP_LABEL_AUTH, auth, sizeof(auth) }, { SRTP_LABEL_SALT, salt, sizeof(salt) },
+  };
+  for (auto& k : d) {
+    memcpy(_salt, msalt, SRTP_SALT_LEN);
+    _salt[7] ^= k.label;
+    memset(k.out, 0, k.len);
+    ctr(0, 0, k.out, k.out, k.len);
+  }
+  bool ok = beginSession(key, salt, auth);
+  memset(key, 0, sizeof(key));
+  memset(auth, 0, sizeof(auth));
+  return ok;
+}
+
+bool SrtpSession::beginSession(const uint8_t key[SRTP_KEY_LEN], const uint8_t salt[SRTP_SALT_LEN],
+                               const uint8_t auth[SRTP_AUTH_KEY_LEN]) {
+  memcpy(_key, key, SRTP_KEY_LEN);
+  memcpy(_salt, salt, SRTP_SALT_LEN);
+  memcpy(_auth, auth, SRTP_AUTH_KEY_LEN);
+  _active = setKeys();
+  _txStarted = _rxStarted = _preValid = false;
+  _txRoc = _rxRoc = 0;
+  _rxMax = _rxMask = 0;
+  _stats = SrtpStats();
+  return _active;
+}
+
+void SrtpSession::end() {
+  _active = _preValid = false;
+  memset(_key, 0, sizeof(_key));
+  memset(_auth, 0, sizeof(_auth));
+  memset(_pre, 0, sizeof(_pre));
+}
+
+// AES-CM: IV = (salt << 16) ^ (ssrc << 64) ^ (index << 16); the low 16
+// bits count blocks within the packet.
+void SrtpSession::ctr(uint32_t ssrc, uint64_t index, const uint8_t* in, uint8_t* out, size_t len) {
+  uint8_t iv[16] = {0};
+  memcpy(iv, _salt, SRTP_SALT_LEN);
+  for (int i = 0; i < 4; i++) iv[4 + i] ^= (uint8_t)(ssrc >> (24 - 8 * i));
+  for (int i = 0; i < 6; i++) iv[8 + i] ^= (uint8_t)(index >> (40 - 8 * i));
+#ifdef SRTP_MBEDTLS
+  size_t off = 0;
+  uint8_t block[16];
+  mbedtls_aes_crypt_ctr(&_aes, len, &off, iv, block, in, out);    // one call: the peripheral stays claimed
+#else
+  uint8_t ks[16];
+  for (size_t pos = 0; pos < len; pos += 16) {
+    _aes.encrypt(iv, ks);
+    size_t n = len - pos < 16 ? len - pos : 16;
+    for (size_t i = 0; i < n; i++) out[pos + i] = in[pos + i] ^ ks[i];
+    for (int i = 15; i >= 0 && !++iv[i]; i--) {}
+  }
+#endif
+}
+
+void SrtpSession::keystream(uint32_t ssrc, uint64_t index, uint8_t* out, size_t len) {
+  memset(out, 0, len);
+  ctr(ssrc, index, out, out, len);
+}
+
+void SrtpSession::tag(const uint8_t* pkt, size_t len, uint32_t roc, uint8_t out[20]) {
+  uint8_t r[4] = { (uint8_t)(roc >> 24), (uint8_t)(roc >> 16), (uint8_t)(roc >> 8), (uint8_t)roc };
+#ifdef SRTP_MBEDTLS
+  mbedtls_md_hmac_reset(&_hmac);
+  mbedtls_md_hmac_update(&_hmac, pkt, len);
+  mbedtls_md_hmac_update(&_hmac, r, 4);
+  mbedtls_md_hmac_finish(&_hmac, out);
+#else
+  uint8_t inner[20];
+  SoftSha1 h = _ipad;
+  h.update(pkt, len);
+  h.update(r, 4);
+  h.finish(inner);
+  h = _opad;
+  h.update(inner, 20);
+  h.finish(out);
+#endif
+}
+
+void SrtpSession::precompute(uint32_t ssrc, uint16_t seq, size_t len) {
+  if (!_active) return;
+  uint32_t roc = _txRoc + (_txStarted && seq < _txSeq && _txSeq - seq > 0x8000);
+  _preSsrc = ssrc;
+  _preIndex = (uint64_t)roc << 16 | seq;
+  _preLen = len < SRTP_KS_MAX ? len : SRTP_KS_MAX;
+  keystream(ssrc, _preIndex, _pre, _preLen);
+  _preValid = true;
+}
+
+size_t SrtpSession::protect(uint8_t* pkt, size_t len) {
+  size_t hl = rtpHeaderLen(pkt, len);
+  if (!_active || !hl) return 0;
+  uint16_t seq = pkt[2] << 8 | pkt[3];
+  uint32_t ssrc = rdBE32(pkt + 8);
+  if (_txStarted && seq < _txSeq && _txSeq - seq > 0x8000) _txRoc++;   // sequence wrapped
+  _txStarted = true;
+  _txSeq = seq;
+  uint64_t index = (uint64_t)_txRoc << 16 | seq;
+
+  uint8_t* p = pkt + hl;
+  size_t n = len - hl;
+  if (_preValid && _preSsrc == ssrc && _preIndex == index && _preLen >= n) {
+    for (size_t i = 0; i < n; i++) p[i] ^= _pre[i];
+    _stats.preHits++;
+  } else {
+    ctr(ssrc, index, p, p, n);
+    _stats.preMisses++;
+  }
+  _preValid = false;
+
+  uint8_t t[20];
+  tag(pkt, len, _txRoc, t);
+  memcpy(pkt + len, t, SRTP_TAG_LEN);
+  _stats.protectedPkts++;
+  return len + SRTP_TAG_LEN;
+}
+
+SrtpResult SrtpSession::unprotect(uint8_t* pkt, size_t len, size_t* rtpLen) {
+  size_t hl = rtpHeaderLen(pkt, len);
+  if (!_active || !hl || len < hl + SRTP_TAG_LEN) return SRTP_ERR_HEADER;
+  size_t n = len - SRTP_TAG_LEN;
+  uint16_t seq = pkt[2] << 8 | pkt[3];
+
+  // Packet index estimate (RFC 3711 3.3.1 / appendix A).
+  uint32_t v = _rxRoc;
+  if (_rxStarted) {
+    if (_rxSeq < 32768) { if (seq > _rxSeq && seq - _rxSeq > 32768) v = _rxRoc - 1; }
+    else if (_rxSeq - 32768 > seq) v = _rxRoc + 1;
+  }
+  uint64_t index = (uint64_t)v << 16 | seq;
+  uint64_t back = 0;
+  if (_rxStarted && index <= _rxMax) {
+    back = _rxMax - index;
+    if (back >= SRTP_REPLAY_WINDOW || (_rxMask >> back) & 1) { _stats.replayed++; return SRTP_ERR_REPLAY; }
+  }
+
+  uint8_t t[20], diff = 0;
+  tag(pkt, n, v, t);
+  for (int i = 0; i < SRTP_TAG_LEN; i++) diff |= t[i] ^ pkt[n + i];
+  if (diff) { _stats.authFail++; return SRTP_ERR_AUTH; }
+
+  ctr(rdBE32(pkt + 8), index, pkt + hl, pkt + hl, n - hl);
+  if (!_rxStarted || index > _rxMax) {
+    uint64_t shift = _rxStarted ? index - _rxMax : SRTP_REPLAY_WINDOW;
+    _rxMask = (shift >= SRTP_REPLAY_WINDOW ? 0 : _rxMask << shift) | 1;
+    _rxMax = index;
+    _rxRoc = v;
+    _rxSeq = seq;
+    _rxStarted = true;
+  } else {
+    _rxMask |= (uint64_t)1 << back;
+  }
+  *rtpLen = n;
+  _stats.unprotectedPkts++;
+  return SRTP_OK;
+}
@@ -0,0 +1,110 @@
+// SRTP (RFC 3711) with the default suite AES_CM_128_HMAC_SHA1_80: AES-128
+// counter mode for the payload, HMAC-SHA1 over header + payload + ROC with
+// an 80-bit tag, key derivation rate 0.
+//
+// On the device the crypto goes through mbedtls, whose AES and SHA are
+// the ESP32 peripherals. Host builds use soft_crypto.h unless
+// SRTP_USE_MBEDTLS is defined.
+//
+// A packet's keystream depends only on SSRC and packet index, not on the
+// payload. The sender computes the next packet's keystream while the
+// payload is still being captured (precompute()). protect() then only
+// XORs and authenticates.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(ARDUINO) || defined(SRTP_USE_MBEDTLS)
+#define SRTP_MBEDTLS 1
+#include <mbedtls/aes.h>
+#include <mbedtls/md.h>
+#else
+#include "soft_crypto.h"
+#endif
+
+#define SRTP_KEY_LEN       16
+#define SRTP_SALT_LEN      14
+#define SRTP_MASTER_LEN    (SRTP_KEY_LEN + SRTP_SALT_LEN)   // key || salt, as in SDP a=crypto inline:
+#define SRTP_AUTH_KEY_LEN  20
+#define SRTP_TAG_LEN       10
+#define SRTP_KS_MAX        256     // payload bytes of keystream precomputed per packet
+#define SRTP_REPLAY_WINDOW 64
+
+enum SrtpResult : uint8_t { SRTP_OK, SRTP_ERR_HEADER, SRTP_ERR_AUTH, SRTP_ERR_REPLAY };
+
+struct SrtpStats {
+  uint32_t protectedPkts, unprotectedPkts;
+  uint32_t preHits, preMisses;    // protect() found / did not find its keystream ready
+  uint32_t authFail, replayed;
+};
+
+class SrtpSession {
+public:
+  SrtpSession();
+  ~SrtpSession();
+
+  // Derives the session keys from a master key || salt.
+  bool begin(const uint8_t master[SRTP_MASTER_LEN]);
+  // Uses session keys directly (test vectors).
+  bool beginSession(const uint8_t key[SRTP_KEY_LEN], const uint8_t salt[SRTP_SALT_LEN],
+                    const uint8_t auth[SRTP_AUTH_KEY_LEN]);
+  void end();
+  bool active() const { return _active; }
+
+  // Sender. Computes the keystream for the packet with this SSRC and
+  // sequence number (up to len payload bytes) ahead of time.
+  void precompute(uint32_t ssrc, uint16_t seq, size_t len);
+  // Sender. Encrypts the payload in place and appends the tag, so the
+  // buffer needs SRTP_TAG_LEN bytes free after the packet. Returns the
+  // new length, or 0 if the RTP header is malformed.
+  size_t protect(uint8_t* pkt, size_t len);
+
+  // Receiver. Checks the tag and the replay window, then decrypts in place.
+  // On success *rtpLen is the plain RTP length (tag removed).
+  SrtpResult unprotect(uint8_t* pkt, size_t len, size_t* rtpLen);
+
+  // out = AES-CM keystream for (ssrc, index), starting at block 0.
+  void keystream(uint32_t ssrc, uint64_t index, uint8_t* out, size_t len);
+
+  const uint8_t* sessionKey() const { return _key; }
+  const uint8_t* sessionSalt() const { return _salt; }
+  const uint8_t* authKey() const { return _auth; }
+  const SrtpStats& stats() const { return _stats; }
+
+private:
+  SrtpSession(const SrtpSession&) = delete;
+  SrtpSession& operator=(const SrtpSession&) = delete;
+
+  void ctr(uint32_t ssrc, uint64_t index, const uint8_t* in, uint8_t* out, size_t len);
+  void tag(const uint8_t* pkt, size_t len, uint32_t roc, uint8_t out[20]);
+  bool setKeys();
+
+  bool     _active = false;
+  uint8_t  _key[SRTP_KEY_LEN], _salt[SRTP_SALT_LEN], _auth[SRTP_AUTH_KEY_LEN];
+#ifdef SRTP_MBEDTLS
+  mbedtls_aes_context  _aes;
+  mbedtls_md_context_t _hmac;
+  bool                 _mdReady = false;
+#else
+  SoftAes128 _aes;
+  SoftSha1   _ipad, _opad;          // HMAC states after the padded key block
+#endif
+
+  // Sender
+  bool     _txStarted = false;
+  uint16_t _txSeq = 0;
+  uint32_t _txRoc = 0;
+  bool     _preValid = false;
+  uint32_t _preSsrc = 0;
+  uint64_t _preIndex = 0;
+  size_t   _preLen = 0;
+  uint8_t  _pre[SRTP_KS_MAX];
+
+  // Receiver
+  bool     _rxStarted = false;
+  uint16_t _rxSeq = 0;
+  uint32_t _rxRoc = 0;
+  uint64_t _rxMax = 0, _rxMask = 0;
+
+  SrtpStats _stats = {};
+};
@@ -0,0 +1,56 @@
+#include "vad.h"
+
+// dB -> Q8 log2 units: dB / 3.0103 * 256.
+#define DB_TO_Q8(db) ((db) * 85)
+
+int32_t Vad::log2Q8(uint32_t v) {
+  if (!v) return 0;
+  int b = 31 - __builtin_clz(v);
+  uint32_t frac = b >= 8 ? (v >> (b - 8)) & 0xFF : (v << (8 - b)) & 0xFF;
+  return b * 256 + frac;                 // linear between powers of two
+}
+
+void Vad::begin(uint16_t hangoverFrames, int onDb, int lowDb, uint16_t zcrQ10) {
+  _on = DB_TO_Q8(onDb);
+  _low = DB_TO_Q8(lowDb);
+  _zcrMin = zcrQ10;
+  _hangFrames = hangoverFrames;
+  _hang = 0;
+  _floor = -1;
+  _active = false;
+  _stats = {};
+}
+
+bool Vad::process(const int16_t* pcm, size_t n) {
+  if (!n) return _active;
+  uint64_t sum = 0;
+  uint32_t zc = 0;
+  for (size_t i = 0; i < n; i++) {
+    int32_t s = pcm[i];
+    sum += (uint32_t)(s * s);
+    if (i && ((pcm[i - 1] ^ s) < 0)) zc++;
+  }
+  _e = log2Q8((uint32_t)(sum / n) + 1);
+  _zcr = n > 1 ? (zc << 10) / (n - 1) : 0;
+  if (_floor < 0) _floor = _e;
+
+  bool voice = _e > _floor + _on || (_e > _floor + _low && _zcr > _zcrMin);
+  if (_e < _floor) _floor += (_e - _floor) / 8 - 1;   // fast down
+  else if (_e > _floor) _floor += VAD_FLOOR_RISE;     // slow up, even during speech
+
+  bool was = _active;
+  if (voice) { _hang = _hangFrames; _active = true; }
+  else if (_hang) _hang--;
+  else _active = false;
+
+  _stats.frames++;
+  if (_active) _stats.active++;
+  if (_active && !was) _stats.onsets++;
+  return _active;
+}
+
+uint8_t Vad::noiseDbov() const {
+  // 0 dBov is a full-scale square wave: mean square 2^30 (log2 30).
+  int32_t below = ((30 * 256 - _floor) * 771) >> 16;  // Q8 log2 -> dB
+  return below < 0 ? 0 : below > 127 ? 127 : (uint8_t)below;
+}
@@ -0,0 +1,44 @@
+// Fixed-point energy / zero-crossing voice activity detector.
+//
+// Per frame: mean-square energy as log2 in Q8 (1.0 = 256 = 3.01 dB) and the
+// zero-crossing rate. A frame is voice-like when its energy is onDb above
+// an adaptive noise floor, or lowDb above it with a high zero-crossing
+// rate (unvoiced fricatives are quiet but noisy). Activity is held for a
+// hangover so word endings and short pauses are not clipped. The floor
+// follows quiet frames down quickly and rises slowly, so a steady new
+// background (a fan) is absorbed within seconds.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#define VAD_ON_DB        9      // energy above floor for a voiced frame
+#define VAD_LOW_DB       4      // ... for a high-ZCR (unvoiced) frame
+#define VAD_ZCR_Q10      300    // zero crossings per sample, Q10 (~0.3)
+#define VAD_FLOOR_RISE   1      // Q8 log2 per frame (~1.2 dB/s at 10 ms frames)
+
+struct VadStats {
+  uint32_t frames, active, onsets;
+};
+
+class Vad {
+public:
+  void begin(uint16_t hangoverFrames, int onDb = VAD_ON_DB, int lowDb = VAD_LOW_DB, uint16_t zcrQ10 = VAD_ZCR_Q10);
+  // Returns true while voice is active (including hangover).
+  bool process(const int16_t* pcm, size_t n);
+
+  bool active() const { return _active; }
+  int32_t energyQ8() const { return _e; }
+  int32_t floorQ8() const { return _floor; }
+  uint16_t zcrQ10() const { return _zcr; }
+  // Noise floor as an RFC 3389 comfort-noise level (-dBov, 0..127).
+  uint8_t noiseDbov() const;
+  const VadStats& stats() const { return _stats; }
+
+  static int32_t log2Q8(uint32_t v);
+
+private:
+  int32_t  _on = 0, _low = 0, _e = 0, _floor = -1;
+  uint16_t _zcrMin = 0, _zcr = 0, _hangFrames = 0, _hang = 0;
+  bool     _active = false;
+  VadStats _stats = {};
+};
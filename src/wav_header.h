@@ -0,0 +1,33 @@
+// Minimal RIFF/WAVE header for mono PCM or G.711 (A-law = 6, mu-law = 7).
+// Non-PCM formats get the 18-byte fmt chunk and the fact chunk they
+// require. For live streams pass WAV_STREAM_LEN; players read to EOF.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define WAV_FMT_PCM      1
+#define WAV_FMT_ALAW     6
+#define WAV_FMT_MULAW    7
+#define WAV_HDR_MAX      58
+#define WAV_STREAM_LEN   0x7FFFF000UL
+
+static inline void wavPut16(uint8_t* p, uint16_t v) { p[0] = v; p[1] = v >> 8; }
+static inline void wavPut32(uint8_t* p, uint32_t v) { p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24; }
+
+// Writes the header into out (WAV_HDR_MAX bytes) and returns its length.
+static inline size_t wavHeader(uint8_t* out, uint16_t format, uint32_t rate, uint16_t bits, uint32_t dataBytes) {
+  bool pcm = format == WAV_FMT_PCM;
+  size_t fmtLen = pcm ? 16 : 18, hdr = 12 + 8 + fmtLen + (pcm ? 0 : 12) + 8;
+  uint16_t block = bits / 8;
+  uint8_t* p = out;
+  memcpy(p, "RIFF", 4); wavPut32(p + 4, dataBytes + hdr - 8); memcpy(p + 8, "WAVE", 4); p += 12;
+  memcpy(p, "fmt ", 4); wavPut32(p + 4, fmtLen);
+  wavPut16(p + 8, format); wavPut16(p + 10, 1); wavPut32(p + 12, rate); wavPut32(p + 16, rate * block);
+  wavPut16(p + 20, block); wavPut16(p + 22, bits);
+  if (!pcm) wavPut16(p + 24, 0);                     // cbSize
+  p += 8 + fmtLen;
+  if (!pcm) { memcpy(p, "fact", 4); wavPut32(p + 4, 4); wavPut32(p + 8, dataBytes / block); p += 12; }
+  memcpy(p, "data", 4); wavPut32(p + 4, dataBytes);
+  return hdr;
+}
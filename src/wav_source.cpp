@@ -0,0 +1,93 @@
+#ifndef ARDUINO
+#include "wav_source.h"
+#include <string.h>
+#include <thread>
+
+static uint32_t rdLE(const uint8_t* p, int n) {
+  uint32_t v = 0;
+  for (int i = n - 1; i >= 0; i--) v = (v << 8) | p[i];
+  return v;
+}
+
+bool WavSource::open(const char* path, bool realtime, bool loop) {
+  close();
+  _f = fopen(path, "rb");
+  if (!_f) return false;
+  uint8_t h[12];
+  if (fread(h, 1, 12, _f) != 12 || memcmp(h, "RIFF", 4) || memcmp(h + 8, "WAVE", 4)) { close(); return false; }
+  bool haveFmt = false;
+  for (;;) {
+    uint8_t ch[8];
+    if (fread(ch, 1, 8, _f) != 8) { close(); return false; }
+    uint32_t len = rdLE(ch + 4, 4);
+    if (!memcmp(ch, "fmt ", 4)) {
+      uint8_t fmt[40] = {0};
+      size_t n = len < sizeof(fmt) ? len : sizeof(fmt);
+      if (fread(fmt, 1, n, _f) != n) { close(); return false; }
+      if (len > n) fseek(_f, len - n, SEEK_CUR);
+      uint16_t tag = rdLE(fmt, 2);
+      if (tag == 0xFFFE && len >= 26) tag = rdLE(fmt + 24, 2);   // WAVE_FORMAT_EXTENSIBLE subformat
+      _channels = rdLE(fmt + 2, 2);
+      _rate = rdLE(fmt + 4, 4);
+      _bits = rdLE(fmt + 14, 2);
+      if (tag != 1 || !_channels || (_bits != 16 && _bits != 24 && _bits != 32)) { close(); return false; }
+      _frameBytes = _channels * (_bits / 8);
+      haveFmt = true;
+    } else if (!memcmp(ch, "data", 4)) {
+      if (!haveFmt) { close(); return false; }
+      _dataOff = ftell(_f);
+      _dataLen = len - len % _frameBytes;
+      break;
+    } else {
+      fseek(_f, len + (len & 1), SEEK_CUR);
+    }
+  }
+  _realtime = realtime;
+  _loop = loop;
+  _pos = 0;
+  _delivered = 0;
+  _t0 = std::chrono::steady_clock::now();
+  return true;
+}
+
+void WavSource::close() {
+  if (_f) fclose(_f);
+  _f = nullptr;
+}
+
+size_t WavSource::read(int32_t* out, size_t frames) {
+  if (!_f) return 0;
+  uint8_t buf[512];
+  size_t perChunk = sizeof(buf) / _frameBytes, done = 0;
+  while (done < frames) {
+    if (_pos >= _dataLen) {
+      if (!_loop || !_dataLen) break;
+      fseek(_f, _dataOff, SEEK_SET);
+      _pos = 0;
+    }
+    size_t want = frames - done;
+    if (want > perChunk) want = perChunk;
+    size_t left = (_dataLen - _pos) / _frameBytes;
+    if (want > left) want = left;
+    size_t got = fread(buf, _frameBytes, want, _f);
+    if (!got) break;
+    for (size_t i = 0; i < got; i++) {
+      const uint8_t* p = buf + i * _frameBytes;
+      int32_t s;
+      if (_bits == 16)      s = (int32_t)(int16_t)rdLE(p, 2) << 8;
+      else if (_bits == 24) s = (int32_t)(rdLE(p, 3) << 8) >> 8;
+      else                  s = (int32_t)rdLE(p, 4) >> 8;
+      out[done + i] = s;
+    }
+    done += got;
+    _pos += got * _frameBytes;
+  }
+  _delivered += done;
+  if (_realtime && done && _rate) {
+    // Hand samples over no earlier than the microphone would have produced them.
+    auto due = _t0 + std::chrono::microseconds(_delivered * 1000000ULL / _rate);
+    std::this_thread::sleep_until(due);
+  }
+  return done;
+}
+#endif
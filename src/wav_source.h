@@ -0,0 +1,36 @@
+// Host stand-in for the I2S microphone: streams a PCM WAV file as 24-bit
+// mono samples at the file's real-time rate, so the audio pipeline can be
+// developed and benchmarked on Linux. Host builds only.
+#pragma once
+#ifndef ARDUINO
+#include <stdio.h>
+#include <chrono>
+#include "audio_source.h"
+
+class WavSource : public AudioSource {
+public:
+  ~WavSource() { close(); }
+
+  // Accepts 16/24/32-bit integer PCM, any channel count (channel 0 is used).
+  // realtime=false reads as fast as possible (benchmarks); loop rewinds at EOF.
+  bool open(const char* path, bool realtime = true, bool loop = false);
+  void close();
+
+  uint32_t rate() const override { return _rate; }
+  size_t read(int32_t* out, size_t frames) override;
+
+  uint16_t channels() const { return _channels; }
+  uint16_t bits() const { return _bits; }
+  uint32_t totalFrames() const { return _dataLen / _frameBytes; }
+
+private:
+  FILE*    _f = nullptr;
+  bool     _realtime = true, _loop = false;
+  uint32_t _rate = 0;
+  uint16_t _channels = 0, _bits = 0, _frameBytes = 0;
+  long     _dataOff = 0;
+  uint32_t _dataLen = 0, _pos = 0;      // bytes
+  uint64_t _delivered = 0;              // frames, for pacing
+  std::chrono::steady_clock::time_point _t0;
+};
+#endif
@@ -0,0 +1,243 @@
+// ----------- Provisioning AP: station admission -----------
+// The open AP attracts every phone that auto-joins open networks. Each one
+// holds a DHCP lease and lwIP PCBs, and the AP only takes AP_MAX_STATIONS.
+// We track what every station does and deauthenticate:
+//   - stations that only ever hit OS connectivity probes, once they have
+//     been around AP_NONINTERACTIVE_MS and the AP is nearly full;
+//   - any station idle for AP_IDLE_MS.
+// An evicted MAC that rejoins within AP_EVICT_BAN_MS while the AP is
+// nearly full is dropped again right away. Limits are at the top of
+// AP-Provision.ino.
+
+struct StaEntry {
+  bool      used;
+  uint8_t   mac[6];
+  uint16_t  aid;
+  uint32_t  ip;                 // 0 until DHCP assigns one
+  uint32_t  tJoin, tLast;       // millis
+  uint32_t  requests, probes;   // all HTTP requests / OS connectivity probes
+  uint32_t  tFirstReq;          // ms after join, 0 = none yet
+  uint32_t  tFirstProbe, tFirstApi, tFirstPage;  // same, per request kind
+  bool      interactive;        // has requested a real portal page
+};
+
+// Portal detection latency (join -> first request of each kind), to
+// compare the RFC 8908 API path against the probe/redirect path.
+struct StaLatency { uint32_t n; uint32_t sumMs, maxMs; };
+enum { LAT_API, LAT_PROBE, LAT_PAGE, LAT_KINDS };
+StaLatency staLat[LAT_KINDS];
+
+struct StaBan { uint8_t mac[6]; uint32_t t; };
+
+StaEntry     staTab[AP_MAX_STATIONS + 2];  // slack for join/leave races
+StaBan       staBans[AP_BANNED_SLOTS];
+uint32_t     staEvicted = 0, staRejected = 0, staJoins = 0;
+portMUX_TYPE staMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Connectivity-check URLs used by Android, iOS/macOS, Windows, Kindle, ...
+static const char* const STA_PROBE_PATHS[] = {
+  "/generate_204", "/gen_204", "/hotspot-detect.html", "/library/test/success.html",
+  "/connecttest.txt", "/ncsi.txt", "/redirect", "/success.txt", "/canonical.html",
+  "/check_network_status.txt", "/kindle-wifi/wifistub.html",
+};
+
+bool staIsProbe(const String& uri) {
+  for (const char* p : STA_PROBE_PATHS) if (uri == p) return true;
+  return false;
+}
+
+int staFind(const uint8_t mac[6]) {
+  for (int i = 0; i < (int)(sizeof(staTab) / sizeof(staTab[0])); i++)
+    if (staTab[i].used && !memcmp(staTab[i].mac, mac, 6)) return i;
+  return -1;
+}
+
+// The station list and the ban table are shared with the Wi-Fi event
+// task; these helpers take staMux themselves.
+int staCount() {
+  int n = 0;
+  portENTER_CRITICAL(&staMux);
+  for (const StaEntry& e : staTab) n += e.used;
+  portEXIT_CRITICAL(&staMux);
+  return n;
+}
+
+bool staCrowded() { return staCount() >= AP_MAX_STATIONS - 1; }
+
+void staBan(const uint8_t mac[6]) {
+  uint32_t t = millis() | 1;
+  portENTER_CRITICAL(&staMux);
+  int slot = 0;
+  for (int i = 1; i < AP_BANNED_SLOTS; i++) if (staBans[i].t < staBans[slot].t) slot = i;  // oldest
+  memcpy(staBans[slot].mac, mac, 6);
+  staBans[slot].t = t;
+  portEXIT_CRITICAL(&staMux);
+}
+
+bool staBanned(const uint8_t mac[6]) {
+  uint32_t now = millis();
+  bool hit = false;
+  portENTER_CRITICAL(&staMux);
+  for (const StaBan& b : staBans)
+    if (b.t && !memcmp(b.mac, mac, 6) && now - b.t < AP_EVICT_BAN_MS) hit = true;
+  portEXIT_CRITICAL(&staMux);
+  return hit;
+}
+
+// Wi-Fi event task.
+void stationOnJoin(const uint8_t mac[6], uint16_t aid) {
+  if (staBanned(mac) && staCrowded()) {
+    staRejected++;
+    esp_wifi_deauth_sta(aid);
+    LOGI("AP: rejected recently evicted " MACSTR, MAC2STR(mac));
+    return;
+  }
+  portENTER_CRITICAL(&staMux);
+  int i = staFind(mac);
+  for (int j = 0; i < 0 && j < (int)(sizeof(staTab) / sizeof(staTab[0])); j++) if (!staTab[j].used) i = j;
+  if (i >= 0) {
+    staTab[i] = StaEntry();
+    staTab[i].used = true;
+    memcpy(staTab[i].mac, mac, 6);
+    staTab[i].aid = aid;
+    staTab[i].tJoin = staTab[i].tLast = millis();
+  }
+  staJoins++;
+  portEXIT_CRITICAL(&staMux);
+}
+
+void stationOnLeave(const uint8_t mac[6]) {
+  portENTER_CRITICAL(&staMux);
+  int i = staFind(mac);
+  if (i >= 0) staTab[i].used = false;
+  portEXIT_CRITICAL(&staMux);
+}
+
+// Pick up DHCP-assigned addresses so HTTP requests can be attributed.
+void stationRefreshIPs() {
+  wifi_sta_list_t wl;
+  if (esp_wifi_ap_get_sta_list(&wl) != ESP_OK) return;
+#if ESP_IDF_VERSION_MAJOR >= 5
+  wifi_sta_mac_ip_list_t il;
+  if (esp_wifi_ap_get_sta_list_with_ip(&wl, &il) != ESP_OK) return;
+#else
+  esp_netif_sta_list_t il;
+  if (esp_netif_get_sta_list(&wl, &il) != ESP_OK) return;
+#endif
+  portENTER_CRITICAL(&staMux);
+  for (int k = 0; k < il.num; k++) {
+    int i = staFind(il.sta[k].mac);
+    if (i >= 0) staTab[i].ip = il.sta[k].ip.addr;
+  }
+  portEXIT_CRITICAL(&staMux);
+}
+
+// HTTPS requests reach WebServer from the TLS relay on this unit's own
+// address; tlsPeerIP() maps them back to the station.
+uint32_t stationRequestIP() {
+  WiFiClient c = server.client();
+  uint32_t ip = c.remoteIP();
+  if (ip == (uint32_t)c.localIP()) ip = tlsPeerIP(c.remotePort());
+  return ip;
+}
+
+void stationNoteRequest(const String& uri) {
+  if (!inAP) return;
+  uint32_t ip = stationRequestIP();
+  if (!ip) return;
+  bool api = uri == CAPPORT_API_PATH;
+  bool probe = !api && staIsProbe(uri);
+  portENTER_CRITICAL(&staMux);
+  for (StaEntry& e : staTab) {
+    if (!e.used || e.ip != ip) continue;
+    e.requests++;
+    e.tLast = millis();
+    uint32_t since = max(1UL, (unsigned long)(e.tLast - e.tJoin));
+    if (!e.tFirstReq) e.tFirstReq = since;
+    uint32_t& first = api ? e.tFirstApi : probe ? e.tFirstProbe : e.tFirstPage;
+    if (!first) {
+      first = since;
+      StaLatency& l = staLat[api ? LAT_API : probe ? LAT_PROBE : LAT_PAGE];
+      l.n++; l.sumMs += since; l.maxMs = max(l.maxMs, since);
+    }
+    if (probe) e.probes++;
+    else if (!api) e.interactive = true;
+    break;
+  }
+  portEXIT_CRITICAL(&staMux);
+}
+
+// Sees every request first and never claims it, so the real route still runs.
+class StationTap : public RequestHandler {
+public:
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+  bool canHandle(HTTPMethod, const String& uri) override { stationNoteRequest(uri); return false; }
+#else
+  bool canHandle(HTTPMethod, String uri) override { stationNoteRequest(uri); return false; }
+#endif
+};
+
+void stationsBindTap() {
+  static StationTap tap;
+  static bool added = false;
+  if (!added) { server.addHandler(&tap); added = true; }
+}
+
+void stationsLoop() {
+  static uint32_t tCheck = 0;
+  uint32_t now = millis();
+  if (!inAP || now - tCheck < 1000) return;
+  tCheck = now;
+  stationRefreshIPs();
+
+  bool crowded = staCrowded();
+  for (StaEntry& e : staTab) {
+    // The Wi-Fi event task joins/leaves entries: decide and free the slot
+    // under the lock, and deauthenticate after it.
+    const char* why = nullptr;
+    StaEntry gone;
+    portENTER_CRITICAL(&staMux);
+    uint32_t t = millis();                  // not `now`: a join may have stamped a later time
+    if (e.used) {
+      if (t - e.tLast >= AP_IDLE_MS) why = "idle";
+      else if (crowded && !e.interactive && t - e.tJoin >= AP_NONINTERACTIVE_MS) why = "non-interactive";
+      if (why) { gone = e; e.used = false; }
+    }
+    portEXIT_CRITICAL(&staMux);
+    if (!why) continue;
+    LOGI("AP: evicting " MACSTR " (%s, %u req, %u probes)", MAC2STR(gone.mac), why, gone.requests, gone.probes);
+    staBan(gone.mac);
+    esp_wifi_deauth_sta(gone.aid);
+    staEvicted++;
+  }
+}
+
+String stationsJSON() {
+  String j = "{\"max\":" + String(AP_MAX_STATIONS) + ",\"joins\":" + String(staJoins) +
+             ",\"evicted\":" + String(staEvicted) + ",\"rejected\":" + String(staRejected) + ",\"stations\":[";
+  uint32_t now = millis();
+  bool first = true;
+  char mac[18];
+  for (const StaEntry& e : staTab) {
+    if (!e.used) continue;
+    snprintf(mac, sizeof(mac), MACSTR, MAC2STR(e.mac));
+    if (!first) j += ",";
+    first = false;
+    j += "{\"mac\":\"" + String(mac) + "\",\"ip\":\"" + IPAddress(e.ip).toString() + "\"";
+    j += ",\"connected_s\":" + String((now - e.tJoin) / 1000) + ",\"idle_s\":" + String((now - e.tLast) / 1000);
+    j += ",\"requests\":" + String(e.requests) + ",\"probes\":" + String(e.probes);
+    j += ",\"first_request_ms\":" + String(e.tFirstReq) + ",\"first_api_ms\":" + String(e.tFirstApi) +
+         ",\"first_probe_ms\":" + String(e.tFirstProbe) + ",\"first_page_ms\":" + String(e.tFirstPage);
+    j += ",\"interactive\":" + String(e.interactive ? "true" : "false") + "}";
+  }
+  j += "],\"detect_latency\":{";
+  static const char* const names[LAT_KINDS] = { "api", "probe", "page" };
+  for (int k = 0; k < LAT_KINDS; k++) {
+    const StaLatency& l = staLat[k];
+    if (k) j += ",";
+    j += "\"" + String(names[k]) + "\":{\"n\":" + String(l.n) + ",\"avg_ms\":" + String(l.n ? l.sumMs / l.n : 0) +
+         ",\"max_ms\":" + String(l.maxMs) + "}";
+  }
+  j += "}}";
+  return j;
+}
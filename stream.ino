@@ -0,0 +1,156 @@
+// ----------- Live audio over HTTP (/stream) -----------
+// GET /stream[?format=g711|pcm] answers with a chunked, endless WAV:
+// G.711 at 8 kHz (the law RTP uses), or 16-bit PCM at AUDIO_OUT_RATE.
+// Any HTTP client or `ffplay http://<device>/stream` can play it.
+//
+// Each block is produced once by the audio task and pushed into every
+// listener's own ByteFifo. If a listener's FIFO is full, that block is
+// dropped for that listener only. Capture and the other listeners are
+// unaffected. streamLoop() drains the FIFOs into the sockets with
+// non-blocking sends, framing HTTP chunks around data read in place.
+//
+// The handler takes the socket from WebServer (server.detachClient()), so
+// WebServer drops the request at once and goes on to the next one while
+// the listener's socket stays open here.
+
+struct StreamSlot {
+  WiFiClient client;
+  ByteFifo   fifo;
+  std::atomic<bool>     live{false};
+  std::atomic<uint32_t> dropped{0};     // blocks, producer side
+  uint8_t    format;
+  char       hdr[8];                    // chunk-size line being sent
+  uint8_t    hdrLen, hdrOff, tailOff;   // tailOff: CRLF progress, 2 = none pending
+  size_t     chunkLeft;
+  uint32_t   sent, tStart;
+};
+
+StreamSlot        streams[STREAM_MAX_LISTENERS];
+SemaphoreHandle_t streamLock = nullptr;
+uint32_t          streamRejected = 0;
+
+// Audio task: does any listener want this format?
+bool streamWants(uint8_t format) {
+  for (auto& s : streams)
+    if (s.live.load(std::memory_order_acquire) && s.format == format) return true;
+  return false;
+}
+
+// Audio task: fan one block out. Never blocks.
+void streamFeed(uint8_t format, const uint8_t* data, size_t n) {
+  if (!streamLock || xSemaphoreTake(streamLock, 0) != pdTRUE) return;
+  for (auto& s : streams) {
+    if (!s.live.load(std::memory_order_acquire) || s.format != format) continue;
+    if (!s.fifo.push(data, n)) s.dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+  xSemaphoreGive(streamLock);
+}
+
+void streamClose(int i, const char* why) {
+  StreamSlot& s = streams[i];
+  xSemaphoreTake(streamLock, portMAX_DELAY);
+  s.live.store(false, std::memory_order_release);
+  xSemaphoreGive(streamLock);
+  LOGI("Stream: %s left (%s) after %lu s, %lu KB sent, %lu blocks dropped", s.client.remoteIP().toString().c_str(), why,
+       (unsigned long)((millis() - s.tStart) / 1000), (unsigned long)(s.sent / 1024), (unsigned long)s.dropped.load());
+  s.client.stop();
+  s.client = WiFiClient();
+}
+
+void streamHandle() {
+  if (!jwtAuthorize()) return;
+  if (!streamLock) streamLock = xSemaphoreCreateMutex();
+  uint8_t format = server.arg("format") == "pcm" ? STREAM_FMT_PCM : STREAM_FMT_G711;
+  StreamSlot* slot = nullptr;
+  for (auto& s : streams) if (!s.live && !slot) slot = &s;
+  if (!audioRunning() || !slot || !slot->fifo.begin(STREAM_FIFO_BYTES)) {
+    streamRejected++;
+    server.send(503, "text/plain", audioRunning() ? "Too many listeners" : "Audio capture is off");
+    return;
+  }
+  WiFiClient c = server.detachClient();
+  uint8_t wav[WAV_HDR_MAX];
+  size_t wl = format == STREAM_FMT_PCM
+    ? wavHeader(wav, WAV_FMT_PCM, AUDIO_OUT_RATE, 16, WAV_STREAM_LEN)
+    : wavHeader(wav, AUDIO_G711_LAW == G711_ALAW ? WAV_FMT_ALAW : WAV_FMT_MULAW, G711_RATE, 8, WAV_STREAM_LEN);
+  c.print("HTTP/1.1 200 OK\r\nContent-Type: audio/wav\r\nTransfer-Encoding: chunked\r\n"
+          "Cache-Control: no-store\r\nConnection: close\r\n\r\n");
+  c.printf("%X\r\n", (unsigned)wl);
+  c.write(wav, wl);
+  c.print("\r\n");
+  c.setNoDelay(true);
+
+  slot->client = c;
+  slot->format = format;
+  slot->hdrLen = slot->hdrOff = 0;
+  slot->tailOff = 2;
+  slot->chunkLeft = 0;
+  slot->sent = 0;
+  slot->dropped = 0;
+  slot->tStart = millis();
+  slot->live.store(true, std::memory_order_release);   // fifo was reset by begin()
+  LOGI("Stream: %s joined (%s)", c.remoteIP().toString().c_str(), format == STREAM_FMT_PCM ? "pcm" : "g711");
+}
+
+// Non-blocking send; returns bytes sent, 0 if the socket is full, -1 if dead.
+int streamSend(int fd, const void* p, size_t n) {
+  int r = send(fd, p, n, MSG_DONTWAIT);
+  if (r >= 0) return r;
+  return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+}
+
+// Moves as much as the socket takes; false when the listener is gone.
+bool streamPump(int i) {
+  StreamSlot& s = streams[i];
+  int fd = s.client.fd();
+  for (;;) {
+    int r;
+    if (s.hdrOff < s.hdrLen) {
+      if ((r = streamSend(fd, s.hdr + s.hdrOff, s.hdrLen - s.hdrOff)) <= 0) return r == 0;
+      s.hdrOff += r;
+    } else if (s.chunkLeft) {
+      const uint8_t* p;
+      size_t n = s.fifo.peek(&p);
+      if (n > s.chunkLeft) n = s.chunkLeft;
+      if ((r = streamSend(fd, p, n)) <= 0) return r == 0;
+      s.fifo.consume(r);
+      s.chunkLeft -= r;
+      s.sent += r;
+    } else if (s.tailOff < 2) {
+      if ((r = streamSend(fd, "\r\n" + s.tailOff, 2 - s.tailOff)) <= 0) return r == 0;
+      s.tailOff += r;
+    } else {
+      const uint8_t* p;
+      size_t n = s.fifo.peek(&p);        // contiguous, so the chunk can be sent in place
+      if (!n) return true;
+      s.chunkLeft = n < STREAM_CHUNK ? n : STREAM_CHUNK;
+      s.hdrLen = snprintf(s.hdr, sizeof(s.hdr), "%X\r\n", (unsigned)s.chunkLeft);
+      s.hdrOff = 0;
+      s.tailOff = 0;
+    }
+  }
+}
+
+void streamLoop() {
+  for (int i = 0; i < STREAM_MAX_LISTENERS; i++) {
+    if (!streams[i].live) continue;
+    if (!streams[i].client.connected()) streamClose(i, "closed");
+    else if (!streamPump(i)) streamClose(i, "send error");
+  }
+}
+
+String streamStatsLine() {
+  String l = "Stream: ";
+  int n = 0;
+  for (auto& s : streams) {
+    if (!s.live) continue;
+    char b[96];
+    snprintf(b, sizeof(b), "%s%s %s %luKB q=%u dropped=%lu", n++ ? ", " : "", s.client.remoteIP().toString().c_str(),
+             s.format == STREAM_FMT_PCM ? "pcm" : "g711", (unsigned long)(s.sent / 1024), (unsigned)s.fifo.used(),
+             (unsigned long)s.dropped.load());
+    l += b;
+  }
+  if (!n) l += "no listeners";
+  l += " (rejected " + String(streamRejected) + ")";
+  return l;
+}
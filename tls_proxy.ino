@@ -0,0 +1,425 @@
+// ----------- TLS front end (HTTPS on 443) -----------
+// Terminates TLS and relays plaintext to the WebServer on port 80 of the
+// same interface address, so every portal/API route is also served over
+// HTTPS without a second set of handlers.
+//
+// ECDSA P-256 keeps the full handshake short on the ESP32 (an RSA-2048
+// private-key operation alone takes seconds). WebServer closes the
+// connection after each response, so every API call is a fresh TLS
+// connection: session tickets (and an ID cache for clients without
+// ticket support) turn those into abbreviated handshakes with no
+// public-key operations at all.
+//
+// Each connection runs in its own task, up to TLS_MAX_CONN at once, so a
+// slow full handshake does not hold up a phone's resumed API calls. A slot
+// is taken before accept(); further clients wait in the listen backlog.
+// The slot also records the client's address and the port the relay
+// connects to WebServer from, so handlers can tell which station an
+// HTTPS request came from (tlsPeerIP()).
+//
+// Key and self-signed certificate are generated once and kept in NVS
+// namespace "tls". `tls` on the console prints handshake statistics.
+// tools/tls_bench.cpp times the same configuration on a host.
+
+#define TLS_PORT             443
+#define TLS_MAX_CONN         2       // concurrent connections, TLS_TASK_STACK + ~20 KB heap each
+#define TLS_TASK_STACK       10240
+#define TLS_ACCEPT_STACK     3072
+#define TLS_IDLE_MS          10000
+#define TLS_TICKET_LIFETIME  86400   // seconds
+#define TLS_CACHE_ENTRIES    4
+
+struct TlsStats {
+  uint32_t full, resumed, failed, refused;
+  uint64_t fullUs, resumedUs;         // handshake time totals
+  uint32_t bytesIn, bytesOut;
+};
+
+struct TlsConn {
+  bool         busy;
+  int          fd;
+  TaskHandle_t task;                  // set by the connection task itself
+  bool         resumed;               // set by the wrapped ticket/cache lookups
+  uint32_t     peer;                  // client IPv4 address, as IPAddress holds it
+  uint16_t     backendPort;           // our end of the WebServer connection, 0 = none
+};
+
+TlsStats          tlsStats = {};
+TlsConn           tlsConns[TLS_MAX_CONN] = {};
+portMUX_TYPE      tlsMux = portMUX_INITIALIZER_UNLOCKED;
+SemaphoreHandle_t tlsRngLock = nullptr, tlsSessLock = nullptr;
+bool              tlsStarted = false;
+
+mbedtls_entropy_context  tlsEntropy;
+mbedtls_ctr_drbg_context tlsDrbg;
+mbedtls_ssl_config       tlsConf;
+mbedtls_x509_crt         tlsCert;
+mbedtls_pk_context       tlsKey;
+#if defined(MBEDTLS_SSL_TICKET_C)
+mbedtls_ssl_ticket_context tlsTicket;
+#endif
+#if defined(MBEDTLS_SSL_CACHE_C)
+mbedtls_ssl_cache_context  tlsCache;
+#endif
+
+static const int tlsSuites[] = {
+  MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256,
+  MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_CBC_SHA256,
+  0
+};
+
+// Connection tasks share one DRBG, ticket key and session cache. mbedTLS
+// only locks those itself when built with MBEDTLS_THREADING_C, so each
+// is used under a lock here.
+int tlsRandom(void* p, unsigned char* out, size_t len) {
+  xSemaphoreTake(tlsRngLock, portMAX_DELAY);
+  int rc = mbedtls_ctr_drbg_random(p, out, len);
+  xSemaphoreGive(tlsRngLock);
+  return rc;
+}
+
+// The calling connection's slot, for the session callbacks; -1 if none.
+int tlsCurrent() {
+  TaskHandle_t me = xTaskGetCurrentTaskHandle();
+  for (int i = 0; i < TLS_MAX_CONN; i++) if (tlsConns[i].busy && tlsConns[i].task == me) return i;
+  return -1;
+}
+
+void tlsMarkResumed() {
+  int i = tlsCurrent();
+  if (i >= 0) tlsConns[i].resumed = true;
+}
+
+#if defined(MBEDTLS_SSL_TICKET_C)
+int tlsTicketWrite(void* p, const mbedtls_ssl_session* s, unsigned char* start, const unsigned char* end,
+                   size_t* tlen, uint32_t* lifetime) {
+  xSemaphoreTake(tlsSessLock, portMAX_DELAY);
+  int rc = mbedtls_ssl_ticket_write(p, s, start, end, tlen, lifetime);
+  xSemaphoreGive(tlsSessLock);
+  return rc;
+}
+
+int tlsTicketParse(void* p, mbedtls_ssl_session* s, unsigned char* buf, size_t len) {
+  xSemaphoreTake(tlsSessLock, portMAX_DELAY);
+  int rc = mbedtls_ssl_ticket_parse(p, s, buf, len);
+  xSemaphoreGive(tlsSessLock);
+  if (rc == 0) tlsMarkResumed();
+  return rc;
+}
+#endif
+
+#if defined(MBEDTLS_SSL_CACHE_C)
+#if MBEDTLS_VERSION_MAJOR >= 3
+int tlsCacheGet(void* p, unsigned char const* id, size_t idLen, mbedtls_ssl_session* s) {
+  xSemaphoreTake(tlsSessLock, portMAX_DELAY);
+  int rc = mbedtls_ssl_cache_get(p, id, idLen, s);
+#else
+int tlsCacheGet(void* p, mbedtls_ssl_session* s) {
+  xSemaphoreTake(tlsSessLock, portMAX_DELAY);
+  int rc = mbedtls_ssl_cache_get(p, s);
+#endif
+  xSemaphoreGive(tlsSessLock);
+  if (rc == 0) tlsMarkResumed();
+  return rc;
+}
+
+#if MBEDTLS_VERSION_MAJOR >= 3
+int tlsCacheSet(void* p, unsigned char const* id, size_t idLen, const mbedtls_ssl_session* s) {
+  xSemaphoreTake(tlsSessLock, portMAX_DELAY);
+  int rc = mbedtls_ssl_cache_set(p, id, idLen, s);
+#else
+int tlsCacheSet(void* p, const mbedtls_ssl_session* s) {
+  xSemaphoreTake(tlsSessLock, portMAX_DELAY);
+  int rc = mbedtls_ssl_cache_set(p, s);
+#endif
+  xSemaphoreGive(tlsSessLock);
+  return rc;
+}
+#endif
+
+// WebServer side: the client behind a relayed request, found by the port
+// the relay connected from. 0 if no live connection uses that port.
+uint32_t tlsPeerIP(uint16_t backendPort) {
+  uint32_t ip = 0;
+  portENTER_CRITICAL(&tlsMux);
+  for (const TlsConn& c : tlsConns) if (c.busy && backendPort && c.backendPort == backendPort) ip = c.peer;
+  portEXIT_CRITICAL(&tlsMux);
+  return ip;
+}
+
+// Load the DER key/cert from NVS, or create and store a fresh pair.
+bool tlsLoadOrCreateIdentity() {
+  uint8_t keyDer[256], crtDer[768];
+  prefs.begin("tls", true);
+  size_t kl = prefs.getBytesLength("key") <= sizeof(keyDer) ? prefs.getBytes("key", keyDer, sizeof(keyDer)) : 0;
+  size_t cl = prefs.getBytesLength("crt") <= sizeof(crtDer) ? prefs.getBytes("crt", crtDer, sizeof(crtDer)) : 0;
+  prefs.end();
+
+  if (kl && cl) {
+#if MBEDTLS_VERSION_MAJOR >= 3
+    int rc = mbedtls_pk_parse_key(&tlsKey, keyDer, kl, nullptr, 0, mbedtls_ctr_drbg_random, &tlsDrbg);
+#else
+    int rc = mbedtls_pk_parse_key(&tlsKey, keyDer, kl, nullptr, 0);
+#endif
+    if (rc == 0) rc = mbedtls_x509_crt_parse_der(&tlsCert, crtDer, cl);
+    memset(keyDer, 0, sizeof(keyDer));
+    if (rc == 0) return true;
+    LOGW("TLS: stored identity unusable (-0x%04x); regenerating", -rc);
+    mbedtls_pk_free(&tlsKey); mbedtls_pk_init(&tlsKey);
+    mbedtls_x509_crt_free(&tlsCert); mbedtls_x509_crt_init(&tlsCert);
+  }
+
+#if defined(MBEDTLS_X509_CRT_WRITE_C)
+  uint32_t t0 = millis();
+  int rc = mbedtls_pk_setup(&tlsKey, mbedtls_pk_info_from_type(MBEDTLS_PK_ECKEY));
+  if (rc == 0) rc = mbedtls_ecp_gen_key(MBEDTLS_ECP_DP_SECP256R1, mbedtls_pk_ec(tlsKey), mbedtls_ctr_drbg_random, &tlsDrbg);
+  if (rc) { LOGE("TLS: key generation failed (-0x%04x)", -rc); return false; }
+
+  mbedtls_x509write_cert crt;
+  mbedtls_x509write_crt_init(&crt);
+  mbedtls_mpi serial;
+  mbedtls_mpi_init(&serial);
+  uint64_t mac = ESP.getEfuseMac();
+  mbedtls_mpi_lset(&serial, (mbedtls_mpi_sint)(mac & 0x7FFFFFFF) | 1);
+  String subj = "CN=aniviza-" + String((uint32_t)(mac >> 24) & 0xFFFFFF, HEX) + ",O=Aniviza";
+  mbedtls_x509write_crt_set_version(&crt, MBEDTLS_X509_CRT_VERSION_3);
+  mbedtls_x509write_crt_set_md_alg(&crt, MBEDTLS_MD_SHA256);
+  mbedtls_x509write_crt_set_subject_key(&crt, &tlsKey);
+  mbedtls_x509write_crt_set_issuer_key(&crt, &tlsKey);
+  mbedtls_x509write_crt_set_subject_name(&crt, subj.c_str());
+  mbedtls_x509write_crt_set_issuer_name(&crt, subj.c_str());
+  mbedtls_x509write_crt_set_serial(&crt, &serial);
+  mbedtls_x509write_crt_set_validity(&crt, "20240101000000", "20491231235959");
+  mbedtls_x509write_crt_set_basic_constraints(&crt, 0, -1);
+  // mbedtls writes DER at the *end* of the buffer.
+  int cn = mbedtls_x509write_crt_der(&crt, crtDer, sizeof(crtDer), mbedtls_ctr_drbg_random, &tlsDrbg);
+  int kn = mbedtls_pk_write_key_der(&tlsKey, keyDer, sizeof(keyDer));
+  mbedtls_x509write_crt_free(&crt);
+  mbedtls_mpi_free(&serial);
+  if (cn <= 0 || kn <= 0) { LOGE("TLS: certificate encoding failed (%d/%d)", cn, kn); return false; }
+  if (mbedtls_x509_crt_parse_der(&tlsCert, crtDer + sizeof(crtDer) - cn, cn) != 0) return false;
+
+  prefs.begin("tls", false);
+  prefs.putBytes("key", keyDer + sizeof(keyDer) - kn, kn);
+  prefs.putBytes("crt", crtDer + sizeof(crtDer) - cn, cn);
+  prefs.end();
+  memset(keyDer, 0, sizeof(keyDer));
+  LOGI("TLS: generated ECDSA P-256 identity '%s' in %lums", subj.c_str(), millis() - t0);
+  return true;
+#else
+  LOGE("TLS: no stored identity and this mbedTLS build cannot write certificates");
+  return false;
+#endif
+}
+
+bool tlsSetup() {
+  tlsRngLock = xSemaphoreCreateMutex();
+  tlsSessLock = xSemaphoreCreateMutex();
+  if (!tlsRngLock || !tlsSessLock) return false;
+  mbedtls_entropy_init(&tlsEntropy);
+  mbedtls_ctr_drbg_init(&tlsDrbg);
+  mbedtls_ssl_config_init(&tlsConf);
+  mbedtls_x509_crt_init(&tlsCert);
+  mbedtls_pk_init(&tlsKey);
+  const char* pers = "aniviza-tls";
+  if (mbedtls_ctr_drbg_seed(&tlsDrbg, mbedtls_entropy_func, &tlsEntropy, (const unsigned char*)pers, strlen(pers))) return false;
+  if (!tlsLoadOrCreateIdentity()) return false;
+
+  if (mbedtls_ssl_config_defaults(&tlsConf, MBEDTLS_SSL_IS_SERVER, MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT)) return false;
+  mbedtls_ssl_conf_rng(&tlsConf, tlsRandom, &tlsDrbg);
+  mbedtls_ssl_conf_ciphersuites(&tlsConf, tlsSuites);
+#if MBEDTLS_VERSION_MAJOR >= 3
+  static const uint16_t groups[] = { MBEDTLS_SSL_IANA_TLS_GROUP_SECP256R1, MBEDTLS_SSL_IANA_TLS_GROUP_NONE };
+  mbedtls_ssl_conf_groups(&tlsConf, groups);
+#else
+  static const mbedtls_ecp_group_id curves[] = { MBEDTLS_ECP_DP_SECP256R1, MBEDTLS_ECP_DP_NONE };
+  mbedtls_ssl_conf_curves(&tlsConf, curves);
+#endif
+  if (mbedtls_ssl_conf_own_cert(&tlsConf, &tlsCert, &tlsKey)) return false;
+#if defined(MBEDTLS_SSL_TICKET_C)
+  mbedtls_ssl_ticket_init(&tlsTicket);
+  if (mbedtls_ssl_ticket_setup(&tlsTicket, tlsRandom, &tlsDrbg, MBEDTLS_CIPHER_AES_128_GCM, TLS_TICKET_LIFETIME) == 0)
+    mbedtls_ssl_conf_session_tickets_cb(&tlsConf, tlsTicketWrite, tlsTicketParse, &tlsTicket);
+#endif
+#if defined(MBEDTLS_SSL_CACHE_C)
+  mbedtls_ssl_cache_init(&tlsCache);
+  mbedtls_ssl_cache_set_max_entries(&tlsCache, TLS_CACHE_ENTRIES);
+  mbedtls_ssl_cache_set_timeout(&tlsCache, TLS_TICKET_LIFETIME);
+  mbedtls_ssl_conf_session_cache(&tlsConf, &tlsCache, tlsCacheGet, tlsCacheSet);
+#endif
+  return true;
+}
+
+// Pump bytes between the TLS session and the plaintext backend socket.
+void tlsRelay(mbedtls_ssl_context* ssl, int cfd, int bfd, uint32_t& in, uint32_t& out) {
+  uint8_t buf[1024];
+  uint32_t tIdle = millis();
+  while (millis() - tIdle < TLS_IDLE_MS) {
+    bool moved = false;
+    int n = mbedtls_ssl_read(ssl, buf, sizeof(buf));
+    if (n > 0) {
+      if (send(bfd, buf, n, 0) != n) return;
+      in += n; moved = true;
+    } else if (n != MBEDTLS_ERR_SSL_WANT_READ && n != MBEDTLS_ERR_SSL_WANT_WRITE) {
+      return;                                   // close_notify, reset, ...
+    }
+    n = recv(bfd, buf, sizeof(buf), MSG_DONTWAIT);
+    if (n > 0) {
+      for (int off = 0; off < n;) {
+        int w = mbedtls_ssl_write(ssl, buf + off, n - off);
+        if (w > 0) off += w;
+        else if (w != MBEDTLS_ERR_SSL_WANT_WRITE && w != MBEDTLS_ERR_SSL_WANT_READ) return;
+      }
+      out += n; moved = true;
+    } else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+      return;                                   // WebServer closed: response complete
+    }
+    if (moved) tIdle = millis();
+    else {
+      fd_set rd; FD_ZERO(&rd); FD_SET(cfd, &rd); FD_SET(bfd, &rd);
+      struct timeval tv = { 0, 50000 };
+      select(max(cfd, bfd) + 1, &rd, nullptr, nullptr, &tv);
+    }
+  }
+}
+
+void tlsServe(int slot) {
+  TlsConn& c = tlsConns[slot];
+  int cfd = c.fd;
+  mbedtls_ssl_context ssl;
+  mbedtls_ssl_init(&ssl);
+  mbedtls_net_context net;
+  net.fd = cfd;
+  if (mbedtls_ssl_setup(&ssl, &tlsConf) != 0) { mbedtls_ssl_free(&ssl); return; }
+  mbedtls_ssl_set_bio(&ssl, &net, mbedtls_net_send, mbedtls_net_recv, nullptr);
+
+  struct timeval tv = { 5, 0 };
+  setsockopt(cfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  int64_t t0 = esp_timer_get_time();
+  int rc;
+  while ((rc = mbedtls_ssl_handshake(&ssl)) != 0) {
+    if (rc != MBEDTLS_ERR_SSL_WANT_READ && rc != MBEDTLS_ERR_SSL_WANT_WRITE) break;
+  }
+  uint32_t us = (uint32_t)(esp_timer_get_time() - t0);
+  portENTER_CRITICAL(&tlsMux);
+  if (rc != 0)          tlsStats.failed++;
+  else if (c.resumed) { tlsStats.resumed++; tlsStats.resumedUs += us; }
+  else                { tlsStats.full++;    tlsStats.fullUs += us; }
+  portEXIT_CRITICAL(&tlsMux);
+  if (rc != 0) {
+    LOGD("TLS handshake failed: -0x%04x", -rc);
+  } else {
+    LOGD("TLS %s handshake %luus (%s) from %s", c.resumed ? "resumed" : "full", (unsigned long)us,
+         mbedtls_ssl_get_ciphersuite(&ssl), IPAddress(c.peer).toString().c_str());
+
+    // Relay to WebServer on the address the client reached us at.
+    struct sockaddr_in local; socklen_t sl = sizeof(local);
+    getsockname(cfd, (struct sockaddr*)&local, &sl);
+    local.sin_port = htons(80);
+    int bfd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (bfd >= 0 && connect(bfd, (struct sockaddr*)&local, sizeof(local)) == 0) {
+      struct sockaddr_in own; socklen_t ol = sizeof(own);
+      getsockname(bfd, (struct sockaddr*)&own, &ol);
+      portENTER_CRITICAL(&tlsMux);
+      c.backendPort = ntohs(own.sin_port);
+      portEXIT_CRITICAL(&tlsMux);
+      fcntl(cfd, F_SETFL, fcntl(cfd, F_GETFL, 0) | O_NONBLOCK);
+      uint32_t in = 0, out = 0;
+      tlsRelay(&ssl, cfd, bfd, in, out);
+      mbedtls_ssl_close_notify(&ssl);
+      portENTER_CRITICAL(&tlsMux);
+      c.backendPort = 0;
+      tlsStats.bytesIn += in;
+      tlsStats.bytesOut += out;
+      portEXIT_CRITICAL(&tlsMux);
+    }
+    if (bfd >= 0) close(bfd);
+  }
+  mbedtls_ssl_free(&ssl);
+}
+
+void tlsConnTask(void* arg) {
+  int slot = (int)(intptr_t)arg;
+  TlsConn& c = tlsConns[slot];
+  c.task = xTaskGetCurrentTaskHandle();
+  tlsServe(slot);
+  close(c.fd);
+  portENTER_CRITICAL(&tlsMux);
+  c.task = nullptr;
+  c.busy = false;
+  portEXIT_CRITICAL(&tlsMux);
+  vTaskDelete(nullptr);
+}
+
+// Index of a free slot, now marked busy; -1 if all are taken.
+int tlsClaimSlot() {
+  int slot = -1;
+  portENTER_CRITICAL(&tlsMux);
+  for (int i = 0; i < TLS_MAX_CONN && slot < 0; i++) {
+    if (tlsConns[i].busy) continue;
+    tlsConns[i] = TlsConn();
+    tlsConns[i].busy = true;
+    slot = i;
+  }
+  portEXIT_CRITICAL(&tlsMux);
+  return slot;
+}
+
+void tlsTask(void*) {
+  int lfd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  struct sockaddr_in a = {};
+  a.sin_family = AF_INET;
+  a.sin_port = htons(TLS_PORT);
+  a.sin_addr.s_addr = htonl(INADDR_ANY);
+  int one = 1;
+  setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  if (lfd < 0 || bind(lfd, (struct sockaddr*)&a, sizeof(a)) != 0 || listen(lfd, 4) != 0) {
+    LOGE("TLS: cannot listen on %d", TLS_PORT);
+    vTaskDelete(nullptr);
+    return;
+  }
+  LOGI("HTTPS front end listening on %d (%d connections at once)", TLS_PORT, TLS_MAX_CONN);
+  for (;;) {
+    int slot = tlsClaimSlot();
+    if (slot < 0) { vTaskDelay(pdMS_TO_TICKS(20)); continue; }
+    TlsConn& c = tlsConns[slot];
+    struct sockaddr_in peer = {};
+    socklen_t pl = sizeof(peer);
+    int cfd = accept(lfd, (struct sockaddr*)&peer, &pl);
+    if (cfd < 0) {
+      portENTER_CRITICAL(&tlsMux);
+      c.busy = false;
+      portEXIT_CRITICAL(&tlsMux);
+      vTaskDelay(pdMS_TO_TICKS(100));
+      continue;
+    }
+    c.fd = cfd;
+    c.peer = peer.sin_addr.s_addr;
+    if (xTaskCreatePinnedToCore(tlsConnTask, "tls-conn", TLS_TASK_STACK, (void*)(intptr_t)slot, 1, nullptr, 0) != pdPASS) {
+      LOGW("TLS: no memory for a connection task; dropping %s", IPAddress(c.peer).toString().c_str());
+      close(cfd);
+      portENTER_CRITICAL(&tlsMux);
+      tlsStats.refused++;
+      c.busy = false;
+      portEXIT_CRITICAL(&tlsMux);
+    }
+  }
+}
+
+void tlsBegin() {
+  if (tlsStarted) return;
+  tlsStarted = true;
+  if (!tlsSetup()) { LOGE("TLS setup failed; HTTPS disabled"); return; }
+  xTaskCreatePinnedToCore(tlsTask, "tls", TLS_ACCEPT_STACK, nullptr, 1, nullptr, 0);
+}
+
+String tlsStatsLine() {
+  int active = 0;
+  for (const TlsConn& c : tlsConns) active += c.busy;
+  char b[192];
+  snprintf(b, sizeof(b), "TLS: full=%u (avg %lums) resumed=%u (avg %lums) failed=%u refused=%u in=%u out=%u conns=%d/%d",
+           tlsStats.full, tlsStats.full ? (unsigned long)(tlsStats.fullUs / tlsStats.full / 1000) : 0UL,
+           tlsStats.resumed, tlsStats.resumed ? (unsigned long)(tlsStats.resumedUs / tlsStats.resumed / 1000) : 0UL,
+           tlsStats.failed, tlsStats.refused, tlsStats.bytesIn, tlsStats.bytesOut, active, TLS_MAX_CONN);
+  return String(b);
+}
@@ -0,0 +1,566 @@
+// Host harness for the audio pipeline in src/: runs the same code the
+// device runs, fed from a WAV file instead of the I2S microphone.
+//
+// Build:  g++ -O2 -std=c++17 -pthread -I. tools/audio_bench.cpp src/wav_source.cpp src/g711.cpp src/decimator.cpp src/vad.cpp src/mfcc.cpp src/classifier.cpp src/envelope.cpp src/sample_file.cpp src/srtp.cpp src/soft_crypto.cpp -o audio_bench
+// Usage:  audio_bench capture <file.wav> [period_frames] [ring_periods]
+//           Streams the file at real-time rate through AudioRing on a
+//           capture thread and drains it on a consumer thread; reports
+//           periods, overruns and period arrival jitter.
+//         audio_bench g711
+//           Checks the table-driven codec bit-exact against the reference
+//           for all inputs, then benchmarks both in samples per second.
+//         audio_bench decim [factor] [taps_per_phase]
+//           Passband ripple and alias rejection of the quantized taps,
+//           fixed-point vs floating-point reference SNR, and throughput.
+//         audio_bench vad <file.wav> <labels.txt>
+//           Runs the VAD on the 8 kHz branch (48 kHz files are decimated
+//           like on the device) and scores it per 10 ms frame against
+//           speech regions in labels.txt (Audacity format: start end [text]).
+//         audio_bench mfcc <file.wav>
+//           Fixed-point MFCC (16 kHz; 48 kHz input is decimated) against
+//           the floating-point reference: per-coefficient error and
+//           time per frame.
+//         audio_bench classify <file.wav> [extra_us]
+//           Real-time capture -> MFCC -> double-buffered feature windows
+//           -> reference model on its own thread; reports inference
+//           latency, dropped frames and duty cycle. extra_us adds busy
+//           time per inference to model a slower core or larger model.
+//         audio_bench ky038 <samples.txt|file.wav> [rate] [on] [off]
+//           Replays recorded KY-038 ADC samples (text at `rate`, default
+//           20000, or WAV) through the envelope detector; prints events
+//           and cost per sample.
+//         audio_bench srtp
+//           RFC 3711 AES-CM and key-derivation vectors, a reference
+//           protected packet, replay/tamper rejection, and packets per
+//           second with and without a precomputed keystream.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "src/audio_source.h"
+#include "src/wav_source.h"
+#include "src/g711.h"
+#include "src/decimator.h"
+#include "src/vad.h"
+#include "src/mfcc.h"
+#include "src/classifier.h"
+#include "src/envelope.h"
+#include "src/sample_file.h"
+#include "src/srtp.h"
+#include <math.h>
+
+typedef std::chrono::steady_clock Clock;
+
+static double usSince(Clock::time_point t0) {
+  return std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+}
+
+static int cmdCapture(int argc, char** argv) {
+  if (argc < 1) { fprintf(stderr, "capture: need a WAV file\n"); return 2; }
+  size_t period = argc > 1 ? atoi(argv[1]) : 480;
+  size_t periods = argc > 2 ? atoi(argv[2]) : 8;
+  WavSource src;
+  if (!src.open(argv[0], true)) { fprintf(stderr, "cannot open %s as PCM WAV\n", argv[0]); return 1; }
+  AudioRing ring;
+  if (!ring.begin(period, periods)) { fprintf(stderr, "bad ring geometry\n"); return 2; }
+  printf("%s: %u Hz, %u ch, %u-bit, %u frames; period %zu, ring %zu\n", argv[0], src.rate(),
+         src.channels(), src.bits(), src.totalFrames(), period, periods);
+
+  std::atomic<bool> done{false};
+  std::vector<int32_t> scratch(period);
+  std::thread cap([&] {
+    uint32_t clock = 0;
+    while (audioPump(src, ring, scratch.data(), clock) == period) {}
+    done = true;
+  });
+
+  double expectUs = 1e6 * period / src.rate(), maxJit = 0, sumJit = 0;
+  uint32_t got = 0, gaps = 0, nextFrame = 0;
+  auto t0 = Clock::now();
+  double last = 0;
+  while (!done || ring.level()) {
+    uint32_t start;
+    const int32_t* p = ring.peek(&start);
+    if (!p) { std::this_thread::sleep_for(std::chrono::microseconds(200)); continue; }
+    double now = usSince(t0);
+    if (got) {
+      double j = now - last - expectUs;
+      if (j < 0) j = -j;
+      sumJit += j;
+      if (j > maxJit) maxJit = j;
+    }
+    if (start != nextFrame) gaps++;
+    nextFrame = start + period;
+    last = now;
+    got++;
+    ring.release();
+  }
+  cap.join();
+  printf("periods %u, overruns %u, clock gaps %u, arrival jitter avg %.0f us max %.0f us (period %.0f us)\n",
+         got, ring.overruns(), gaps, got > 1 ? sumJit / (got - 1) : 0.0, maxJit, expectUs);
+  return 0;
+}
+
+// Time fn over `rounds` passes of a block; returns samples per second.
+template <typename Fn> static double rate(size_t block, int rounds, Fn fn) {
+  auto t0 = Clock::now();
+  for (int r = 0; r < rounds; r++) fn();
+  return (double)block * rounds / (usSince(t0) / 1e6);
+}
+
+static int cmdG711() {
+  std::vector<int16_t> pcm(65536), back(65536);
+  std::vector<uint8_t> enc(65536), codes(256);
+  for (int i = 0; i < 65536; i++) pcm[i] = (int16_t)(i - 32768);
+  for (int i = 0; i < 256; i++) codes[i] = i;
+  int bad = 0;
+  g711AlawEncode(pcm.data(), enc.data(), pcm.size());
+  for (int i = 0; i < 65536; i++) bad += enc[i] != g711AlawRef(pcm[i]);
+  g711UlawEncode(pcm.data(), enc.data(), pcm.size());
+  for (int i = 0; i < 65536; i++) bad += enc[i] != g711UlawRef(pcm[i]);
+  g711AlawDecode(codes.data(), back.data(), 256);
+  for (int i = 0; i < 256; i++) bad += back[i] != g711AlawDecodeRef(i);
+  g711UlawDecode(codes.data(), back.data(), 256);
+  for (int i = 0; i < 256; i++) bad += back[i] != g711UlawDecodeRef(i);
+  printf("bit-exact check: %s (%d mismatches)\n", bad ? "FAIL" : "ok", bad);
+
+  // Speech-like input: random walk, mostly in the lower segments.
+  const size_t N = 4096;
+  std::vector<int16_t> in(N), out(N);
+  std::vector<uint8_t> bytes(N);
+  uint32_t seed = 1, acc = 0;
+  for (size_t i = 0; i < N; i++) {
+    seed = seed * 1664525 + 1013904223;
+    acc = acc * 7 / 8 + (seed >> 20);
+    in[i] = (int16_t)((int)acc - 2048) * 4;
+  }
+  const int R = 5000;
+  volatile uint32_t sink = 0;
+  double aRef = rate(N, R, [&] { for (size_t i = 0; i < N; i++) bytes[i] = g711AlawRef(in[i]); sink += bytes[N / 2]; });
+  double aTab = rate(N, R, [&] { g711AlawEncode(in.data(), bytes.data(), N); sink += bytes[N / 2]; });
+  double uRef = rate(N, R, [&] { for (size_t i = 0; i < N; i++) bytes[i] = g711UlawRef(in[i]); sink += bytes[N / 2]; });
+  double uTab = rate(N, R, [&] { g711UlawEncode(in.data(), bytes.data(), N); sink += bytes[N / 2]; });
+  double adRef = rate(N, R, [&] { for (size_t i = 0; i < N; i++) out[i] = g711AlawDecodeRef(bytes[i]); sink += out[N / 2]; });
+  double adTab = rate(N, R, [&] { g711AlawDecode(bytes.data(), out.data(), N); sink += out[N / 2]; });
+  double udRef = rate(N, R, [&] { for (size_t i = 0; i < N; i++) out[i] = g711UlawDecodeRef(bytes[i]); sink += out[N / 2]; });
+  double udTab = rate(N, R, [&] { g711UlawDecode(bytes.data(), out.data(), N); sink += out[N / 2]; });
+  printf("A-law encode: ref %6.1f Msps  table %6.1f Msps\n", aRef / 1e6, aTab / 1e6);
+  printf("mu-law encode: ref %6.1f Msps  table %6.1f Msps\n", uRef / 1e6, uTab / 1e6);
+  printf("A-law decode: ref %6.1f Msps  table %6.1f Msps\n", adRef / 1e6, adTab / 1e6);
+  printf("mu-law decode: ref %6.1f Msps  table %6.1f Msps\n", udRef / 1e6, udTab / 1e6);
+  return bad ? 1 : 0;
+}
+
+// |H(f)| in dB for taps h (scale: value of unity gain), f in cycles/sample.
+static double gainDb(const int16_t* h, size_t n, double scale, double f) {
+  double re = 0, im = 0;
+  for (size_t k = 0; k < n; k++) { re += h[k] * cos(2 * M_PI * f * k); im -= h[k] * sin(2 * M_PI * f * k); }
+  return 20 * log10(sqrt(re * re + im * im) / scale + 1e-12);
+}
+
+static int cmdDecim(int argc, char** argv) {
+  unsigned m = argc > 0 ? atoi(argv[0]) : 3, tpp = argc > 1 ? atoi(argv[1]) : DECIM_TAPS_PER_PHASE;
+  const double fsIn = 48000, fsOut = fsIn / m, band = 0.8 * fsOut / 2;   // reported passband
+  Decimator d;
+  if (!d.design(m, tpp)) { fprintf(stderr, "design failed\n"); return 2; }
+  size_t n = d.taps();
+  printf("48000 -> %.0f Hz, %zu taps (Q15), cutoff %.2f x Nyquist, Kaiser beta %.1f\n",
+         fsOut, n, DECIM_CUTOFF, DECIM_KAISER_BETA);
+
+  // Passband ripple over 0..band, and worst gain over everything that folds
+  // back into 0..band after decimation.
+  double pMin = 1e9, pMax = -1e9, alias = -1e9;
+  for (double f = 0; f <= band; f += 10) {
+    double g = gainDb(d.coeffs(), n, 32768, f / fsIn);
+    pMin = fmin(pMin, g); pMax = fmax(pMax, g);
+  }
+  for (double f = fsOut - band; f <= fsIn / 2; f += 10) {
+    double fold = fmod(f, fsOut);
+    if (fold > fsOut / 2) fold = fsOut - fold;
+    if (fold <= band) alias = fmax(alias, gainDb(d.coeffs(), n, 32768, f / fsIn));
+  }
+  printf("passband 0-%.0f Hz: ripple %.3f dB (%.3f..%.3f), alias rejection %.1f dB\n",
+         band, pMax - pMin, pMin, pMax, -alias);
+
+  // Fixed point vs. double-precision filter on the same 24-bit input.
+  const size_t N = 48000;
+  std::vector<int32_t> in(N);
+  uint32_t seed = 7;
+  for (size_t i = 0; i < N; i++) {
+    seed = seed * 1664525 + 1013904223;
+    double t = i / fsIn;
+    double v = 0.3 * sin(2 * M_PI * 440 * t) + 0.2 * sin(2 * M_PI * 2500 * t) + 0.1 * ((int32_t)seed / 2147483648.0);
+    in[i] = (int32_t)lrint(v * (1 << 23));
+  }
+  std::vector<double> hf(n);
+  Decimator::designFloat(hf.data(), n, m, DECIM_CUTOFF, DECIM_KAISER_BETA);
+  std::vector<int16_t> out(N / m + 1);
+  size_t got = 0;
+  for (size_t i = 0; i < N; i += 480) got += d.process(in.data() + i, std::min<size_t>(480, N - i), out.data() + got);
+  double sig = 0, err = 0;
+  for (size_t j = 0; j < got; j++) {
+    double ref = 0;
+    for (size_t k = 0; k < n && k <= j * m; k++) ref += hf[k] * in[j * m - k];
+    ref /= 256.0;                               // 24-bit -> 16-bit scale
+    sig += ref * ref;
+    err += (out[j] - ref) * (out[j] - ref);
+  }
+  printf("fixed vs float reference: SNR %.1f dB over %zu outputs\n", 10 * log10(sig / (err + 1e-12)), got);
+
+  d.reset();
+  double sps = rate(N, 50, [&] {
+    size_t o = 0;
+    for (size_t i = 0; i < N; i += 480) o += d.process(in.data() + i, 480, out.data() + o);
+  });
+  printf("throughput: %.1f Msps in (%.2f%% of one host core at 48 kHz)\n", sps / 1e6, 100 * fsIn / sps);
+  return 0;
+}
+
+static int cmdVad(int argc, char** argv) {
+  if (argc < 2) { fprintf(stderr, "vad: need <file.wav> <labels.txt>\n"); return 2; }
+  WavSource src;
+  if (!src.open(argv[0], false)) { fprintf(stderr, "cannot open %s as PCM WAV\n", argv[0]); return 1; }
+  if (src.rate() != 48000 && src.rate() != 8000) { fprintf(stderr, "need 48 or 8 kHz input\n"); return 1; }
+  std::vector<std::pair<double, double>> speech;
+  FILE* lf = fopen(argv[1], "r");
+  if (!lf) { fprintf(stderr, "cannot open %s\n", argv[1]); return 1; }
+  char line[256];
+  while (fgets(line, sizeof(line), lf)) {
+    double a, b;
+    if (sscanf(line, "%lf %lf", &a, &b) == 2) speech.push_back({a, b});
+  }
+  fclose(lf);
+
+  // Same chain as audio.ino: 48k -> 16k -> 8k, 10 ms frames.
+  Decimator d16, d8;
+  d16.design(3);
+  d8.design(2);
+  const size_t P = 480, P8 = 80;
+  std::vector<int32_t> in(P), wide(P / 3);
+  std::vector<int16_t> pcm16(P / 3), pcm8(P8);
+  Vad vad;
+  vad.begin(30);
+  uint32_t tp = 0, fn = 0, fp = 0, tn = 0;
+  double vadUs = 0;
+  for (uint32_t frame = 0;; frame++) {
+    if (src.rate() == 48000) {
+      if (src.read(in.data(), P) != P) break;
+      d16.process(in.data(), P, pcm16.data());
+      for (size_t i = 0; i < P / 3; i++) wide[i] = (int32_t)pcm16[i] << 8;
+      d8.process(wide.data(), P / 3, pcm8.data());
+    } else {
+      if (src.read(in.data(), P8) != P8) break;
+      for (size_t i = 0; i < P8; i++) pcm8[i] = in[i] >> 8;
+    }
+    auto t0 = Clock::now();
+    bool act = vad.process(pcm8.data(), P8);
+    vadUs += usSince(t0);
+    double mid = frame * 0.01 + 0.005;
+    bool truth = false;
+    for (auto& r : speech) truth |= mid >= r.first && mid < r.second;
+    if (truth) act ? tp++ : fn++;
+    else act ? fp++ : tn++;
+  }
+  const VadStats& st = vad.stats();
+  printf("%u frames (%u speech): detected %.1f%% of speech, false alarms %.1f%% of silence\n",
+         st.frames, tp + fn, tp + fn ? 100.0 * tp / (tp + fn) : 0.0, fp + tn ? 100.0 * fp / (fp + tn) : 0.0);
+  printf("talkspurts %u, packets suppressed %.1f%%, final floor -%u dBov, %.2f us/frame\n",
+         st.onsets, 100.0 * (st.frames - st.active) / (st.frames ? st.frames : 1), vad.noiseDbov(),
+         st.frames ? vadUs / st.frames : 0.0);
+  return 0;
+}
+
+static int cmdMfcc(int argc, char** argv) {
+  if (argc < 1) { fprintf(stderr, "mfcc: need <file.wav>\n"); return 2; }
+  WavSource src;
+  if (!src.open(argv[0], false)) { fprintf(stderr, "cannot open %s as PCM WAV\n", argv[0]); return 1; }
+  if (src.rate() != 48000 && src.rate() != 16000) { fprintf(stderr, "need 48 or 16 kHz input\n"); return 1; }
+  Mfcc mf;
+  if (!mf.begin(16000)) { fprintf(stderr, "mfcc init failed\n"); return 2; }
+  Decimator d16;
+  d16.design(3);
+  size_t hop = mf.hopSize(), fl = mf.frameSize();
+  std::vector<int32_t> in(hop * 3);
+  std::vector<int16_t> pcm(hop);
+  std::vector<float> hist(fl, 0.0f);
+  float prev = 0;
+  int16_t fx[MFCC_COEFFS];
+  float ref[MFCC_COEFFS];
+  double sq[MFCC_COEFFS] = {0}, mx[MFCC_COEFFS] = {0}, var[MFCC_COEFFS] = {0}, mean[MFCC_COEFFS] = {0};
+  uint32_t frames = 0;
+  double us = 0;
+  for (;;) {
+    if (src.rate() == 48000) {
+      if (src.read(in.data(), hop * 3) != hop * 3) break;
+      d16.process(in.data(), hop * 3, pcm.data());
+    } else {
+      if (src.read(in.data(), hop) != hop) break;
+      for (size_t i = 0; i < hop; i++) pcm[i] = in[i] >> 8;
+    }
+    memmove(hist.data(), hist.data() + hop, (fl - hop) * sizeof(float));
+    for (size_t i = 0; i < hop; i++) { hist[fl - hop + i] = pcm[i] - 0.97f * prev; prev = pcm[i]; }
+    auto t0 = Clock::now();
+    bool ready = mf.process(pcm.data(), fx);
+    us += usSince(t0);
+    if (!ready) continue;
+    mf.reference(hist.data(), ref);
+    for (int k = 0; k < MFCC_COEFFS; k++) {
+      double e = fx[k] / (double)(1 << MFCC_Q) - ref[k];
+      sq[k] += e * e;
+      mx[k] = fmax(mx[k], fabs(e));
+      mean[k] += ref[k];
+      var[k] += ref[k] * ref[k];
+    }
+    frames++;
+  }
+  if (!frames) { fprintf(stderr, "file too short\n"); return 1; }
+  printf("%u frames, frame %zu / hop %zu / FFT %zu at 16 kHz, %d mels, %d coeffs (Q%d)\n", frames, fl, hop,
+         mf.fftSize(), MFCC_MELS, MFCC_COEFFS, MFCC_Q);
+  printf(" c   ref std   rms err   max err  (log2 units; 1 = 3 dB)\n");
+  for (int k = 0; k < MFCC_COEFFS; k++) {
+    double m = mean[k] / frames, sd = sqrt(fmax(0.0, var[k] / frames - m * m));
+    printf("%2d  %8.3f  %8.4f  %8.4f\n", k, sd, sqrt(sq[k] / frames), mx[k]);
+  }
+  printf("fixed-point: %.1f us/frame on this host\n", us / frames);
+  return 0;
+}
+
+static int cmdClassify(int argc, char** argv) {
+  if (argc < 1) { fprintf(stderr, "classify: need <file.wav>\n"); return 2; }
+  double extraUs = argc > 1 ? atof(argv[1]) : 0;
+  WavSource src;
+  if (!src.open(argv[0], true)) { fprintf(stderr, "cannot open %s as PCM WAV\n", argv[0]); return 1; }
+  if (src.rate() != 48000 && src.rate() != 16000) { fprintf(stderr, "need 48 or 16 kHz input\n"); return 1; }
+  const size_t decim = src.rate() / 16000, period = 160 * decim;
+  const size_t periods = 8;
+
+  static uint8_t arena[4096];
+  SoundModel model;
+  if (!model.begin(clsReferenceModel(), arena, sizeof(arena))) { fprintf(stderr, "arena too small\n"); return 2; }
+  static FeatureWindows win;
+  Mfcc mf;
+  Decimator d16;
+  AudioRing ring;
+  if (!mf.begin(16000) || !d16.design(3) || !ring.begin(period, periods)) { fprintf(stderr, "init failed\n"); return 2; }
+  printf("%s: %u frames at %u Hz; window %d frames, stride %d, arena %zu of %zu bytes, extra load %.0f us\n",
+         argv[0], src.totalFrames(), src.rate(), CLS_FRAMES, CLS_STRIDE, SoundModel::arenaBytes(clsReferenceModel()),
+         sizeof(arena), extraUs);
+
+  // Same threads as the device: capture -> ring -> MFCC (audio task), and
+  // inference on its own thread (the other core).
+  std::atomic<bool> done{false}, stop{false};
+  std::vector<int32_t> scratch(period);
+  std::thread cap([&] {
+    uint32_t clock = 0;
+    while (audioPump(src, ring, scratch.data(), clock) == period) {}
+    done = true;
+  });
+  double busyUs = 0, maxUs = 0;
+  uint32_t runs = 0, hits[CLS_CLASSES] = {0};
+  std::string timeline;
+  std::thread inf([&] {
+    while (!stop || win.take()) {
+      const int16_t* w = win.take();
+      if (!w) { std::this_thread::sleep_for(std::chrono::microseconds(200)); continue; }
+      auto t0 = Clock::now();
+      int32_t logits[CLS_CLASSES];
+      int c = model.run(w, logits);
+      while (usSince(t0) < extraUs) {}
+      double us = usSince(t0);
+      win.done();
+      busyUs += us;
+      maxUs = std::max(maxUs, us);
+      runs++;
+      hits[c]++;
+      timeline += (char)('0' + c);
+    }
+  });
+
+  auto t0 = Clock::now();
+  std::vector<int16_t> pcm(160);
+  int16_t feat[MFCC_COEFFS];
+  uint32_t skipped = 0;
+  while (!done || ring.level()) {
+    const int32_t* p = ring.peek();
+    if (!p) { std::this_thread::sleep_for(std::chrono::microseconds(200)); continue; }
+    if (decim > 1) d16.process(p, period, pcm.data());
+    else for (size_t i = 0; i < period; i++) pcm[i] = p[i] >> 8;
+    bool full = ring.level() > periods / 2;
+    ring.release();
+    if (!mf.push(pcm.data())) continue;
+    if (full) { skipped++; win.gap(); continue; }
+    mf.compute(feat);
+    win.push(feat);
+  }
+  stop = true;
+  inf.join();
+  cap.join();
+  double wallUs = usSince(t0);
+
+  printf("windows %u handed over, %u inferences, latency avg %.0f us max %.0f us\n", win.windows(), runs,
+         runs ? busyUs / runs : 0.0, maxUs);
+  printf("frames dropped %u (MFCC skipped %u, ring overruns %u), inference duty %.1f%% of one core\n",
+         win.dropped(), skipped, ring.overruns(), 100 * busyUs / wallUs);
+  printf("classes:");
+  for (int k = 0; k < CLS_CLASSES; k++) printf(" %d=%u", k, hits[k]);
+  printf("  (reference weights: timing only)\n%s\n", timeline.c_str());
+  return 0;
+}
+
+static int cmdKy038(int argc, char** argv) {
+  if (argc < 1) { fprintf(stderr, "ky038: need <samples.txt|file.wav>\n"); return 2; }
+  SampleFile src;
+  if (!src.open(argv[0], argc > 1 ? atoi(argv[1]) : 20000)) { fprintf(stderr, "cannot open %s\n", argv[0]); return 1; }
+  // Same settings as sensor.ino: 50 ms blocks.
+  EnvConfig cfg = { src.rate(), src.rate() / 20, 10, 300, 60, 40, 200 };
+  if (argc > 2) cfg.onLevel = atoi(argv[2]);
+  if (argc > 3) cfg.offLevel = atoi(argv[3]);
+  EnvelopeDetector env;
+  if (!env.begin(cfg)) { fprintf(stderr, "bad detector settings\n"); return 2; }
+  printf("%s: %u Hz, %zu-sample blocks, on %u / off %u counts\n", argv[0], cfg.rate, cfg.block, cfg.onLevel, cfg.offLevel);
+  std::vector<uint16_t> buf(cfg.block);
+  double us = 0;
+  uint16_t maxLvl = 0;
+  for (;;) {
+    size_t n = src.read(buf.data(), cfg.block);
+    if (!n) break;
+    auto t0 = Clock::now();
+    EnvEvent e = env.process(buf.data(), n);
+    us += usSince(t0);
+    maxLvl = std::max(maxLvl, env.level());
+    double t = (double)env.samples() / cfg.rate;
+    if (e == ENV_ONSET) printf("%8.2f s  onset   level %u (dc %u)\n", t, env.level(), env.dc());
+    if (e == ENV_RELEASE) printf("%8.2f s  release after %u ms, peak %u\n", t, env.eventMs(), env.peak());
+    if (n < cfg.block) break;
+  }
+  if (env.active()) printf("(event still open, %u ms)\n", env.eventMs());
+  double secs = (double)env.samples() / cfg.rate;
+  printf("%u events in %.1f s, max level %u, final dc %u; %.2f ns/sample = %.4f%% of one host core\n",
+         env.events(), secs, maxLvl, env.dc(), env.samples() ? 1000 * us / env.samples() : 0.0,
+         secs > 0 ? 100 * us / 1e6 / secs : 0.0);
+  return 0;
+}
+
+static size_t unhex(const char* h, uint8_t* out) {
+  size_t n = 0;
+  for (; h[0] && h[1]; h += 2) {
+    unsigned v;
+    sscanf(h, "%2x", &v);
+    out[n++] = (uint8_t)v;
+  }
+  return n;
+}
+
+static bool check(const char* what, const uint8_t* got, const char* hex) {
+  uint8_t want[128];
+  size_t n = unhex(hex, want);
+  bool ok = !memcmp(got, want, n);
+  printf("  %-34s %s\n", what, ok ? "ok" : "MISMATCH");
+  return ok;
+}
+
+static int cmdSrtp() {
+  bool ok = true;
+  uint8_t key[16], salt[14], auth[20] = {0};
+  std::vector<uint8_t> ks(0xFF02 * 16);
+  printf("RFC 3711 B.2 AES-CM keystream:\n");
+  unhex("2B7E151628AED2A6ABF7158809CF4F3C", key);
+  unhex("F0F1F2F3F4F5F6F7F8F9FAFBFCFD", salt);
+  SrtpSession s;
+  s.beginSession(key, salt, auth);
+  s.keystream(0, 0, ks.data(), ks.size());
+  ok &= check("blocks 0-2", ks.data(), "E03EAD0935C95E80E166B16DD92B4EB4D23513162B02D0F72A43A2FE4A5F97AB"
+                                 "41E95B3BB0A2E8DD477901E4FCA894C0");
+  ok &= check("blocks FEFF-FF01", ks.data() + 0xFEFF * 16, "EC8CDF7398607CB0F2D21675EA9EA1E4362B7C3C6773516318A077D7FC5073AE"
+                                                    "6A2CC3787889374FBEB4C81B17BA6C44");
+
+  printf("RFC 3711 B.3 key derivation:\n");
+  uint8_t master[SRTP_MASTER_LEN];
+  unhex("E1F97A0D3E018BE0D64FA32C06DE41390EC675AD498AFEEBB6960B3AABE6", master);
+  s.begin(master);
+  ok &= check("cipher key", s.sessionKey(), "C61E7A93744F39EE10734AFE3FF7A087");
+  ok &= check("cipher salt", s.sessionSalt(), "30CBBC08863D8C85D49DB34A9AE1");
+  ok &= check("auth key", s.authKey(), "CEBE321F6FF7716B6FD4AB49AF256A156D38BAA4");
+
+  printf("libsrtp reference packet (B.3 master key):\n");
+  uint8_t pkt[64];
+  size_t len = unhex("800F1234DECAFBADCAFEBABEABABABABABABABABABABABABABABABAB", pkt);
+  s.precompute(0xCAFEBABE, 0x1234, 16);
+  len = s.protect(pkt, len);
+  ok &= check("SRTP packet", pkt, "800F1234DECAFBADCAFEBABE4E55DC4CE79978D88CA4D215949D2402B78D6ACC99EA179B8DBB");
+  SrtpSession rx;
+  rx.begin(master);
+  size_t plain = 0;
+  uint8_t copy[64];
+  memcpy(copy, pkt, len);
+  bool rt = rx.unprotect(pkt, len, &plain) == SRTP_OK && plain == 28 && pkt[12] == 0xAB && pkt[27] == 0xAB;
+  bool rp = rx.unprotect(copy, len, &plain) == SRTP_ERR_REPLAY;
+  copy[20] ^= 1;
+  rx.beginSession(rx.sessionKey(), rx.sessionSalt(), rx.authKey());
+  bool af = rx.unprotect(copy, len, &plain) == SRTP_ERR_AUTH;
+  printf("  %-34s %s\n  %-34s %s\n  %-34s %s\n", "round trip", rt ? "ok" : "FAILED", "replay rejected",
+         rp ? "ok" : "FAILED", "tampered packet rejected", af ? "ok" : "FAILED");
+  ok &= rt && rp && af;
+
+  // Throughput for 20 ms G.711 packets (12 + 160 bytes) on one stream.
+  const size_t P = 160, N = 20000;
+  static uint8_t pk[12 + P + SRTP_TAG_LEN];
+  s.begin(master);
+  rx.begin(master);
+  memset(pk, 0x55, sizeof(pk));
+  pk[0] = 0x80; pk[1] = 8;
+  memset(pk + 8, 0, 4);      // SSRC 0, as passed to precompute()
+  auto setSeq = [&](uint32_t i) { pk[2] = i >> 8; pk[3] = i; };
+  for (uint32_t i = 0; i < 1000; i++) s.protect(pk, 12 + P);   // warm up
+  s.begin(master);
+  uint32_t seq = 0;
+  double pPre = rate(1, N, [&] { s.precompute(0, seq++, P); });
+  seq = 0;
+  s.begin(master);
+  double pBoth = rate(1, N, [&] { setSeq(seq); s.precompute(0, seq++, P); s.protect(pk, 12 + P); });
+  double usProt = 1e6 / pBoth - 1e6 / pPre;
+  if (s.stats().preHits != N) printf("  precompute missed %u times\n", (unsigned)s.stats().preMisses);
+  SrtpSession cold;
+  cold.begin(master);
+  seq = 0;
+  double pCold = rate(1, N, [&] { setSeq(seq++); cold.protect(pk, 12 + P); });
+  seq = 0;
+  double pRx = rate(1, N, [&] {
+    setSeq(seq++);
+    size_t l = cold.protect(pk, 12 + P), o;
+    rx.unprotect(pk, l, &o);
+  });
+  printf("%zu-byte payloads (software AES/SHA-1 on this host):\n", P);
+  printf("  protect, keystream precomputed    %9.0f pkt/s  (%.2f us on the send path)\n", 1e6 / usProt, usProt);
+  printf("  precompute alone                  %9.0f pkt/s  (%.2f us, off the send path)\n", pPre, 1e6 / pPre);
+  printf("  protect, keystream inline         %9.0f pkt/s  (%.2f us)\n", pCold, 1e6 / pCold);
+  printf("  protect + unprotect               %9.0f pkt/s\n", pRx);
+  printf("  one 50 pkt/s stream               %9.3f%% of one core\n", 100.0 * 50 / pBoth);
+  printf("%s\n", ok ? "all vectors match" : "VECTOR MISMATCH");
+  return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+  if (argc >= 2 && !strcmp(argv[1], "capture")) return cmdCapture(argc - 2, argv + 2);
+  if (argc >= 2 && !strcmp(argv[1], "g711")) return cmdG711();
+  if (argc >= 2 && !strcmp(argv[1], "decim")) return cmdDecim(argc - 2, argv + 2);
+  if (argc >= 2 && !strcmp(argv[1], "vad")) return cmdVad(argc - 2, argv + 2);
+  if (argc >= 2 && !strcmp(argv[1], "mfcc")) return cmdMfcc(argc - 2, argv + 2);
+  if (argc >= 2 && !strcmp(argv[1], "classify")) return cmdClassify(argc - 2, argv + 2);
+  if (argc >= 2 && !strcmp(argv[1], "ky038")) return cmdKy038(argc - 2, argv + 2);
+  if (argc >= 2 && !strcmp(argv[1], "srtp")) return cmdSrtp();
+  fprintf(stderr, "usage: audio_bench capture <file.wav> [period_frames] [ring_periods]\n"
+                  "       audio_bench g711\n"
+                  "       audio_bench decim [factor] [taps_per_phase]\n"
+                  "       audio_bench vad <file.wav> <labels.txt>\n"
+                  "       audio_bench mfcc <file.wav>\n"
+                  "       audio_bench classify <file.wav> [extra_us]\n"
+                  "       audio_bench ky038 <samples.txt|file.wav> [rate] [on] [off]\n"
+                  "       audio_bench srtp\n");
+  return 2;
+}
@@ -0,0 +1,199 @@
+// Host harness for src/delta_patch.*: applies tools/mkdelta.py output
+// through the same DeltaPatcher the /update/delta route uses.
+//
+// Build:  g++ -O2 -std=c++17 -I. tools/delta_bench.cpp src/delta_patch.cpp src/soft_crypto.cpp -o delta_bench
+// Usage:  delta_bench [old.bin new.bin] [rounds]
+//           Without images, builds a 256 KB pseudo-firmware and an edited
+//           copy (inserts, deletes, patched bytes, a moved block). Runs
+//           mkdelta.py (python3 on PATH, run from the repo root), then
+//           feeds the patch in random chunk sizes `rounds` times (default
+//           200) and compares the output byte for byte and by SHA-256.
+//           Every truncation point must stop short of DELTA_DONE, and
+//           every corrupted patch must fail or end in a hash mismatch,
+//           as the device would see it. Exits 1 if any check fails.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "src/delta_patch.h"
+#include "src/soft_crypto.h"
+
+typedef std::vector<uint8_t> Bytes;
+typedef std::chrono::steady_clock Clock;
+
+struct Target {
+  const Bytes* src;
+  uint8_t      srcSha[32], dstSha[32];        // dstSha: from the patch header
+  Bytes        out;
+  size_t       cap;
+  bool         outOfRange = false;
+};
+
+static bool rd(void* ctx, uint32_t off, uint8_t* buf, size_t len) {
+  Target* t = (Target*)ctx;
+  if ((uint64_t)off + len > t->src->size()) { t->outOfRange = true; return false; }
+  memcpy(buf, t->src->data() + off, len);
+  return true;
+}
+
+static bool wr(void* ctx, const uint8_t* buf, size_t len) {
+  Target* t = (Target*)ctx;
+  if (t->out.size() + len > t->cap) { t->outOfRange = true; return false; }
+  t->out.insert(t->out.end(), buf, buf + len);
+  return true;
+}
+
+// As the device does: the patch must be for the image that is running.
+static bool check(void* ctx, const DeltaHeader& h) {
+  Target* t = (Target*)ctx;
+  t->cap = h.dstSize;
+  memcpy(t->dstSha, h.dstSha, 32);
+  return h.srcSize == t->src->size() && !memcmp(h.srcSha, t->srcSha, 32);
+}
+
+static void sha256(const Bytes& b, uint8_t out[32]) {
+  SoftSha256 s;
+  s.starts();
+  s.update(b.data(), b.size());
+  s.finish(out);
+}
+
+static bool readFile(const char* path, Bytes& b) {
+  FILE* f = fopen(path, "rb");
+  if (!f) return false;
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) b.insert(b.end(), buf, buf + n);
+  fclose(f);
+  return true;
+}
+
+static bool writeFile(const char* path, const Bytes& b) {
+  FILE* f = fopen(path, "wb");
+  if (!f) return false;
+  bool ok = fwrite(b.data(), 1, b.size(), f) == b.size();
+  return fclose(f) == 0 && ok;
+}
+
+// Code-like old image, and a new one with the edits a rebuild makes.
+static void synth(Bytes& old, Bytes& neu, std::mt19937& rng) {
+  old.resize(256 * 1024);
+  for (size_t i = 0; i < old.size(); i += 4) {
+    uint32_t w = rng() % 5 ? (0x40000000u | (rng() & 0xFFFF)) : rng();   // repetitive, like code
+    memcpy(&old[i], &w, 4);
+  }
+  neu = old;
+  for (int e = 0; e < 40; e++) {
+    size_t at = rng() % neu.size();
+    switch (rng() % 3) {
+      case 0: for (int k = 0; k < 8 && at + k < neu.size(); k++) neu[at + k] = (uint8_t)rng(); break;
+      case 1: { Bytes ins(rng() % 300 + 1); for (auto& b : ins) b = (uint8_t)rng(); neu.insert(neu.begin() + at, ins.begin(), ins.end()); break; }
+      case 2: neu.erase(neu.begin() + at, neu.begin() + std::min(neu.size(), at + rng() % 200 + 1)); break;
+    }
+  }
+  Bytes blk(neu.begin() + 1000, neu.begin() + 5000);             // a function moved to the end
+  neu.erase(neu.begin() + 1000, neu.begin() + 5000);
+  neu.insert(neu.end(), blk.begin(), blk.end());
+}
+
+// Feeds the patch in random pieces; returns the last result.
+static DeltaResult apply(const Bytes& patch, size_t len, Target& t, std::mt19937& rng, size_t maxChunk) {
+  DeltaPatcher p;
+  p.begin(rd, wr, check, &t);
+  t.out.clear();
+  t.cap = 0;
+  t.outOfRange = false;
+  DeltaResult r = DELTA_OK;
+  for (size_t off = 0; off < len && (r == DELTA_OK || r == DELTA_DONE);) {
+    size_t n = std::min(len - off, (size_t)(rng() % maxChunk + 1));
+    r = p.feed(patch.data() + off, n);
+    off += n;
+  }
+  return r;
+}
+
+int main(int argc, char** argv) {
+  std::mt19937 rng(1);
+  Bytes old, neu;
+  int rounds = 200;
+  if (argc >= 3) {
+    if (!readFile(argv[1], old) || !readFile(argv[2], neu)) { fprintf(stderr, "cannot read images\n"); return 2; }
+    if (argc > 3) rounds = atoi(argv[3]);
+  } else {
+    if (argc == 2) rounds = atoi(argv[1]);
+    synth(old, neu, rng);
+  }
+  if (!writeFile("/tmp/delta_bench_old.bin", old) || !writeFile("/tmp/delta_bench_new.bin", neu)) return 2;
+  if (system("python3 tools/mkdelta.py /tmp/delta_bench_old.bin /tmp/delta_bench_new.bin /tmp/delta_bench.adlt") != 0) {
+    fprintf(stderr, "mkdelta.py failed\n");
+    return 2;
+  }
+  Bytes patch;
+  if (!readFile("/tmp/delta_bench.adlt", patch)) return 2;
+
+  uint8_t got[32];
+  Target t;
+  t.src = &old;
+  sha256(old, t.srcSha);
+  bool pass = true;
+
+  // Whole patch, chunk sizes from 1 byte up to a TCP segment or two.
+  int good = 0;
+  auto t0 = Clock::now();
+  for (int r = 0; r < rounds; r++) {
+    size_t maxChunk = r % 4 == 0 ? 1 + rng() % 16 : 1 + rng() % 2920;
+    DeltaResult res = apply(patch, patch.size(), t, rng, maxChunk);
+    if (res == DELTA_DONE && t.out == neu && !t.outOfRange) good++;
+  }
+  double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count() / std::max(1, rounds);
+  printf("  %-38s %d/%d %s\n", "random chunking, byte-exact", good, rounds, good == rounds ? "ok" : "FAILED");
+  pass &= good == rounds;
+
+  // Truncated: no prefix may claim to be complete.
+  int early = 0, checked = 0;
+  for (size_t len = 0; len < patch.size(); len += len < 200 ? 1 : 1 + rng() % 997, checked++) {
+    if (apply(patch, len, t, rng, 512) == DELTA_DONE) early++;
+  }
+  printf("  %-38s %d prefixes, %d DONE %s\n", "truncated patch", checked, early, early ? "FAILED" : "ok");
+  pass &= !early;
+
+  // Corrupt: flip one byte (header, ops and literals alike). The patcher
+  // must reject it, or the result must fail the check the device makes
+  // against the header's dst_sha256. Flips in the reserved bytes are
+  // harmless and must still give the right image.
+  int missed = 0, rejected = 0, hashCaught = 0, harmless = 0, wild = 0;
+  const int CORRUPT_ROUNDS = 2000;
+  for (int r = 0; r < CORRUPT_ROUNDS; r++) {
+    Bytes bad = patch;
+    size_t at = r < DELTA_HDR_LEN ? r : rng() % bad.size();
+    bad[at] ^= (uint8_t)(1 + rng() % 255);
+    DeltaResult res = apply(bad, bad.size(), t, rng, 1 + rng() % 1460);
+    wild += t.outOfRange;
+    if (res != DELTA_DONE) { rejected++; continue; }
+    sha256(t.out, got);
+    if (memcmp(got, t.dstSha, 32)) hashCaught++;
+    else if (t.out == neu) harmless++;
+    else missed++;
+  }
+  printf("  %-38s %d rejected, %d by hash, %d harmless, %d missed %s\n", "corrupt patch (1 byte flipped)",
+         rejected, hashCaught, harmless, missed, missed ? "FAILED" : "ok");
+  printf("  %-38s %d %s\n", "reads/writes out of range", wild, wild ? "FAILED" : "ok");
+  pass &= !missed && !wild;
+
+  // A patch for some other source image is refused at the header.
+  Bytes other = old;
+  other[0] ^= 1;
+  Target o;
+  o.src = &other;
+  sha256(other, o.srcSha);
+  DeltaResult res = apply(patch, patch.size(), o, rng, 4096);
+  printf("  %-38s %s\n", "wrong source image", res == DELTA_ERR_SOURCE ? "ok" : "FAILED");
+  pass &= res == DELTA_ERR_SOURCE;
+
+  printf("Delta: %zu -> %zu bytes via a %zu-byte patch (%.1f%%), %.2f ms per apply\n", old.size(), neu.size(),
+         patch.size(), 100.0 * patch.size() / neu.size(), ms);
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
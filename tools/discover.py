@@ -0,0 +1,50 @@
+#!/usr/bin/env python3
+"""Inventory Aniviza units on the LAN with one UDP discovery query.
+
+Usage: discover.py [--multicast] [--timeout 1.5] [--bcast 255.255.255.255]
+Wire format: see src/discovery_proto.h.
+"""
+import argparse, os, socket, struct, time
+
+PORT = 48555
+GROUP = "239.255.48.55"
+QF_SPREAD = 0x01
+REPLY = struct.Struct("<4sBBH6s3sb4sII2x")
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("--multicast", action="store_true", help="query %s instead of broadcast" % GROUP)
+    ap.add_argument("--bcast", default="255.255.255.255")
+    ap.add_argument("--timeout", type=float, default=1.5, help="seconds to collect replies")
+    args = ap.parse_args()
+
+    nonce = struct.unpack("<H", os.urandom(2))[0]
+    query = b"ANVQ" + bytes([1, QF_SPREAD]) + struct.pack("<H", nonce)
+    s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    s.setsockopt(socket.SOL_SOCKET, socket.SO_BROADCAST, 1)
+    s.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 1)
+    s.sendto(query, (GROUP if args.multicast else args.bcast, PORT))
+
+    seen = {}
+    deadline = time.time() + args.timeout
+    while (left := deadline - time.time()) > 0:
+        s.settimeout(left)
+        try:
+            data, peer = s.recvfrom(64)
+        except socket.timeout:
+            break
+        if len(data) < REPLY.size:
+            continue
+        magic, ver, flags, rn, mac, fw, rssi, ip, up, heap = REPLY.unpack_from(data)
+        if magic != b"ANVR" or rn != nonce:
+            continue
+        seen[mac] = (socket.inet_ntoa(ip), fw, rssi, up, heap, flags)
+
+    print("%-17s  %-15s  %-7s  %5s  %9s  %7s  %s" % ("MAC", "IP", "FW", "RSSI", "UPTIME_S", "HEAP", "FLAGS"))
+    for mac, (ip, fw, rssi, up, heap, flags) in sorted(seen.items(), key=lambda kv: kv[1][0]):
+        f = ",".join(n for b, n in ((1, "ap"), (2, "relay")) if flags & b) or "-"
+        print("%-17s  %-15s  %-7s  %5d  %9d  %7d  %s" % (mac.hex(":"), ip, "%d.%d.%d" % tuple(fw), rssi, up, heap, f))
+    print("%d unit(s)" % len(seen))
+
+if __name__ == "__main__":
+    main()
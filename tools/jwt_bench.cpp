@@ -0,0 +1,174 @@
+// Host harness for src/jwt.*: the same verifier the HTTP routes use, with
+// the software SHA-256 from src/soft_crypto.*.
+//
+// Build:  g++ -O2 -std=c++17 -I. tools/jwt_bench.cpp src/jwt.cpp src/soft_crypto.cpp -o jwt_bench
+// Usage:  jwt_bench [tokens]
+//           Checks the RFC 7515 A.1 HS256 example and the reject paths
+//           (tampered payload, alg none, expiry, missing clock), then
+//           measures per second: the HMAC keyed from scratch per token
+//           and from precomputed pad states, a full verification that
+//           misses the cache, and verification through the cache.
+//           `tokens` distinct clients (default 4) take turns; more than
+//           JWT_CACHE_SLOTS of them shows the cache thrashing.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "src/jwt.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double usSince(Clock::time_point t0) {
+  return std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+}
+
+template <typename Fn> static double rate(int rounds, Fn fn) {
+  auto t0 = Clock::now();
+  for (int r = 0; r < rounds; r++) fn(r);
+  return rounds / (usSince(t0) / 1e6);
+}
+
+static bool expect(const char* what, JwtResult got, JwtResult want) {
+  bool ok = got == want;
+  printf("  %-38s %-16s %s\n", what, jwtResultName(got), ok ? "ok" : "FAILED");
+  return ok;
+}
+
+// RFC 7515 A.1: JWK "k" of the HS256 example, base64url.
+static const char RFC7515_KEY[] =
+  "AyM1SysPpbyDfgZld3umj1qzKObwVMkoqQ-EstJQLr_T-1qS0gZH75aKtMN3Yj0iPS4hcgUuTwjAzZr1Z9CAow";
+static const char RFC7515_TOKEN[] =
+  "eyJ0eXAiOiJKV1QiLA0KICJhbGciOiJIUzI1NiJ9"
+  ".eyJpc3MiOiJqb2UiLA0KICJleHAiOjEzMDA4MTkzODAsDQogImh0dHA6Ly9leGFtcGxlLmNvbS9pc19yb290Ijp0cnVlfQ"
+  ".dBjftJeZ4CVP-mB92K27uhbUJU1p1r_wW1gFWFOEjXk";
+static const uint32_t RFC7515_EXP = 1300819380;
+
+static std::vector<uint8_t> b64url(const char* s) {
+  std::vector<uint8_t> out;
+  uint32_t acc = 0;
+  int bits = 0;
+  for (; *s; s++) {
+    const char* A = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+    acc = acc << 6 | (uint32_t)(strchr(A, *s) - A);
+    bits += 6;
+    if (bits >= 8) { bits -= 8; out.push_back((uint8_t)(acc >> bits)); }
+  }
+  return out;
+}
+
+// HMAC-SHA256 keyed from scratch on every call: what verification costs
+// without the saved pad states.
+static void hmacFromScratch(const uint8_t* key, size_t klen, const uint8_t* msg, size_t len, uint8_t out[32]) {
+  uint8_t pad[64], inner[32];
+  SoftSha256 h;
+  memset(pad, 0x36, sizeof(pad));
+  for (size_t i = 0; i < klen; i++) pad[i] ^= key[i];
+  h.starts();
+  h.update(pad, 64);
+  h.update(msg, len);
+  h.finish(inner);
+  memset(pad, 0x5C, sizeof(pad));
+  for (size_t i = 0; i < klen; i++) pad[i] ^= key[i];
+  h.starts();
+  h.update(pad, 64);
+  h.update(inner, 32);
+  h.finish(out);
+}
+
+int main(int argc, char** argv) {
+  int clients = argc > 1 ? atoi(argv[1]) : 4;
+  if (clients < 1) clients = 1;
+  bool ok = true;
+  JwtVerifier v;
+
+  printf("RFC 7515 A.1 (HS256, exp %u):\n", RFC7515_EXP);
+  std::vector<uint8_t> key = b64url(RFC7515_KEY);
+  v.begin(key.data(), key.size());
+  size_t tl = strlen(RFC7515_TOKEN);
+  ok &= expect("before exp", v.verify(RFC7515_TOKEN, tl, RFC7515_EXP - 100), JWT_OK);
+  ok &= expect("again (cache)", v.verify(RFC7515_TOKEN, tl, RFC7515_EXP - 99), JWT_OK);
+  ok &= expect("after exp", v.verify(RFC7515_TOKEN, tl, RFC7515_EXP + 3600), JWT_ERR_EXPIRED);
+  ok &= expect("clock not set", v.verify(RFC7515_TOKEN, tl, 0), JWT_ERR_CLOCK);
+  std::string bad = RFC7515_TOKEN;
+  bad[45] ^= 1;                                   // flip a payload character
+  ok &= expect("tampered payload", v.verify(bad.c_str(), bad.size(), RFC7515_EXP - 100), JWT_ERR_SIG);
+  ok &= expect("cache hits / full verifications", v.stats().cacheHits == 1 && v.stats().verified == 1 ? JWT_OK : JWT_ERR_FORMAT, JWT_OK);
+
+  printf("sign / verify (device key):\n");
+  const char* secret = "correct horse battery staple 2024";
+  v.begin((const uint8_t*)secret, strlen(secret));
+  char tok[JWT_MAX_LEN + 1];
+  size_t n = v.sign("{\"sub\":\"app\",\"role\":\"viewer\",\"exp\":2000000000}", tok, sizeof(tok));
+  ok &= expect("own token", v.verify(tok, n, 1700000000), JWT_OK);
+  // {"alg":"none"} header, same claims and signature
+  std::string none = std::string("eyJhbGciOiJub25lIn0") + strchr(tok, '.');
+  ok &= expect("alg none", v.verify(none.c_str(), none.size(), 1700000000), JWT_ERR_ALG);
+  std::string trunc(tok, n - 1);
+  ok &= expect("truncated signature", v.verify(trunc.c_str(), trunc.size(), 1700000000), JWT_ERR_FORMAT);
+  JwtVerifier other;
+  other.begin((const uint8_t*)"another key entirely", 20);
+  ok &= expect("other key", other.verify(tok, n, 1700000000), JWT_ERR_SIG);
+  printf("  token length %zu\n", n);
+
+  // Throughput. Each client has its own token; requests rotate through them.
+  std::vector<std::string> toks;
+  for (int i = 0; i < clients; i++) {
+    char claims[128];
+    snprintf(claims, sizeof(claims), "{\"sub\":\"client-%04d\",\"role\":\"viewer\",\"iat\":1700000000,\"exp\":2000000000}", i);
+    size_t l = v.sign(claims, tok, sizeof(tok));
+    toks.push_back(std::string(tok, l));
+  }
+  const int N = 200000;
+  uint8_t mac[32];
+  volatile uint8_t sink = 0;
+  double pScratch = rate(N, [&](int r) {
+    const std::string& t = toks[r % clients];
+    hmacFromScratch((const uint8_t*)secret, strlen(secret), (const uint8_t*)t.data(), t.rfind('.'), mac);
+    sink ^= mac[0];
+  });
+  SoftSha256 ipad, opad;
+  {
+    uint8_t pad[64];
+    memset(pad, 0x36, sizeof(pad));
+    for (size_t i = 0; i < strlen(secret); i++) pad[i] ^= secret[i];
+    ipad.starts();
+    ipad.update(pad, 64);
+    memset(pad, 0x5C, sizeof(pad));
+    for (size_t i = 0; i < strlen(secret); i++) pad[i] ^= secret[i];
+    opad.starts();
+    opad.update(pad, 64);
+  }
+  double pPads = rate(N, [&](int r) {
+    const std::string& t = toks[r % clients];
+    uint8_t inner[32];
+    SoftSha256 h = ipad;
+    h.update((const uint8_t*)t.data(), t.rfind('.'));
+    h.finish(inner);
+    h = opad;
+    h.update(inner, 32);
+    h.finish(mac);
+    sink ^= mac[0];
+  });
+  double pFull = rate(N, [&](int r) {
+    v.flush();
+    const std::string& t = toks[r % clients];
+    if (v.verify(t.data(), t.size(), 1700000000) != JWT_OK) sink ^= 1;
+  });
+  v.begin((const uint8_t*)secret, strlen(secret));
+  double pMixed = rate(N, [&](int r) {
+    const std::string& t = toks[r % clients];
+    if (v.verify(t.data(), t.size(), 1700000000) != JWT_OK) sink ^= 1;
+  });
+  const JwtStats& st = v.stats();
+  printf("%d client token(s), %zu bytes each, software SHA-256 on this host:\n", clients, toks[0].size());
+  printf("  HMAC keyed per token (no pad states)  %9.0f /s  (%.2f us)\n", pScratch, 1e6 / pScratch);
+  printf("  HMAC from precomputed pad states      %9.0f /s  (%.2f us)\n", pPads, 1e6 / pPads);
+  printf("  full verify, cache miss               %9.0f /s  (%.2f us)\n", pFull, 1e6 / pFull);
+  printf("  verify with cache                     %9.0f /s  (%.2f us)  hits %u / %d, cache %u of %d slots\n",
+         pMixed, 1e6 / pMixed, (unsigned)st.cacheHits, N, v.cached(), JWT_CACHE_SLOTS);
+  printf("  verifier state                        %9zu bytes\n", sizeof(JwtVerifier));
+  printf("%s\n", ok ? "all checks pass" : "CHECK FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""Build the portal UI asset image for the 'assets' flash partition.
+
+Usage: mkassets.py [assets_dir] [out.bin] [partition_size]
+       (defaults: assets, assets.bin, 0x60000 as in partitions.csv)
+
+Every file except *.html is renamed to carry the first 8 hex digits of
+its SHA-256 (app.css -> app.3f9a1c2e.css), and references to the old name
+in the other files are rewritten, so the device can serve those with
+"immutable" caching and a UI update never meets a stale cache. HTML pages
+keep their names and are revalidated by ETag. See src/asset_store.h for
+the image layout; the image is parsed back and checked before it is
+written.
+
+Flash without touching the firmware:
+    parttool.py --port /dev/ttyUSB0 write_partition --partition-name assets --input assets.bin
+or over the network:
+    curl -X PUT --data-binary @assets.bin \\
+         -H 'Content-Type: application/octet-stream' http://<ip>/update/assets
+"""
+import hashlib, os, struct, sys
+
+HDR_LEN, ENTRY_LEN, PATH_MAX, TYPE_MAX = 48, 96, 48, 32
+VERSION, IMMUTABLE = 1, 0x01
+TYPES = {
+    ".html": "text/html", ".css": "text/css", ".js": "application/javascript",
+    ".json": "application/json", ".svg": "image/svg+xml", ".png": "image/png",
+    ".ico": "image/x-icon", ".txt": "text/plain", ".woff2": "font/woff2",
+}
+TEXT = (".html", ".css", ".js", ".json", ".svg", ".txt")
+
+
+def collect(root):
+    files = {}
+    for dirpath, _, names in os.walk(root):
+        for n in sorted(names):
+            full = os.path.join(dirpath, n)
+            rel = os.path.relpath(full, root).replace(os.sep, "/")
+            files[rel] = open(full, "rb").read()
+    return files
+
+
+def hashed_name(rel, data):
+    base, ext = os.path.splitext(rel)
+    return "%s.%s%s" % (base, hashlib.sha256(data).hexdigest()[:8], ext)
+
+
+def rename(files):
+    """Hash-name the static files. Assets may reference each other (CSS
+    pulling in a font), so rewrite until the names stop changing."""
+    static = [r for r in files if not r.endswith(".html")]
+    names = {}
+    for _ in range(len(static) + 1):
+        out = {}
+        for rel, data in files.items():
+            if os.path.splitext(rel)[1] in TEXT:
+                for old, new in names.items():
+                    data = data.replace(old.encode(), new.encode())
+            out[rel] = data
+        new_names = {r: hashed_name(r, out[r]) for r in static}
+        if new_names == names:
+            return {(names.get(r, r)): d for r, d in out.items()}, names
+        names = new_names
+    sys.exit("asset references form a cycle; cannot hash-name them")
+
+
+def build(files):
+    entries = []
+    for rel in sorted(files, key=lambda r: ("/" + r).encode()):
+        path = "/" + rel
+        ext = os.path.splitext(rel)[1]
+        if len(path.encode()) >= PATH_MAX:
+            sys.exit("path too long (max %d): %s" % (PATH_MAX - 1, path))
+        flags = 0 if ext == ".html" else IMMUTABLE
+        etag = struct.unpack("<I", hashlib.sha256(files[rel]).digest()[:4])[0]
+        entries.append((path, TYPES.get(ext, "application/octet-stream"), files[rel], flags, etag))
+
+    off = HDR_LEN + ENTRY_LEN * len(entries)
+    table, data = bytearray(), bytearray()
+    for path, typ, body, flags, etag in entries:
+        table += path.encode().ljust(PATH_MAX, b"\0") + typ.encode().ljust(TYPE_MAX, b"\0")
+        table += struct.pack("<IIII", off + len(data), len(body), flags, etag)
+        data += body
+        data += b"\0" * (-len(data) % 4)          # keep files word-aligned in flash
+    body = bytes(table + data)
+    hdr = b"AAST" + bytes([VERSION, 0, 0, 0]) + struct.pack("<II", len(entries), HDR_LEN + len(body))
+    hdr += hashlib.sha256(body).digest()
+    return hdr + body, entries
+
+
+def check(img, files):
+    assert img[:4] == b"AAST" and img[4] == VERSION
+    count, size = struct.unpack_from("<II", img, 8)
+    assert size == len(img) and img[16:48] == hashlib.sha256(img[HDR_LEN:]).digest()
+    prev = b""
+    for i in range(count):
+        e = img[HDR_LEN + i * ENTRY_LEN:HDR_LEN + (i + 1) * ENTRY_LEN]
+        path = e[:PATH_MAX].rstrip(b"\0")
+        assert path > prev, "entries not sorted"
+        prev = path
+        off, ln = struct.unpack_from("<II", e, 80)
+        assert img[off:off + ln] == files[path.decode()[1:]]
+
+
+def main():
+    root = sys.argv[1] if len(sys.argv) > 1 else "assets"
+    out = sys.argv[2] if len(sys.argv) > 2 else "assets.bin"
+    cap = int(sys.argv[3], 0) if len(sys.argv) > 3 else 0x60000
+    files, names = rename(collect(root))
+    img, entries = build(files)
+    check(img, files)
+    if len(img) > cap:
+        sys.exit("image is %d bytes; partition holds %d" % (len(img), cap))
+    open(out, "wb").write(img)
+    for path, typ, body, flags, _ in entries:
+        print("  %-40s %6d  %s%s" % (path, len(body), typ, ", immutable" if flags & IMMUTABLE else ""))
+    print("%s: %d files, %d bytes (%.0f%% of the %d-byte partition), id %s"
+          % (out, len(entries), len(img), 100.0 * len(img) / cap, cap, img[16:20][::-1].hex()))
+
+
+if __name__ == "__main__":
+    main()
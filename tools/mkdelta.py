@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+"""Build an ADLT delta patch between two firmware images.
+
+Usage: mkdelta.py old.bin new.bin out.adlt
+
+The patch reconstructs new.bin from the image currently running on the
+device (old.bin) using COPY ranges of old.bin plus literal ADD bytes; see
+src/delta_patch.h for the format. The patch is re-applied here and
+compared against new.bin before it is written.
+
+Upload with:  curl -X PUT --data-binary @out.adlt \\
+                   -H 'Content-Type: application/octet-stream' http://<ip>/update/delta
+"""
+import hashlib, struct, sys
+
+BLOCK = 16          # minimum match length worth a COPY (op costs 9 bytes)
+OP_COPY, OP_ADD = 1, 2
+
+
+def index_blocks(old):
+    idx = {}
+    for i in range(len(old) - BLOCK + 1):
+        idx.setdefault(old[i:i + BLOCK], i)
+    return idx
+
+
+def diff(old, new):
+    idx = index_blocks(old)
+    ops, lit_start, i, n = [], 0, 0, len(new)
+    next_src = None                 # where the previous COPY ended in old
+    while i <= n - BLOCK:
+        key = new[i:i + BLOCK]
+        # Prefer continuing the previous copy: code after a small edit usually
+        # lines up with where the last match stopped.
+        if next_src is not None and old[next_src:next_src + BLOCK] == key:
+            j = next_src
+        else:
+            j = idx.get(key)
+        if j is None:
+            i += 1
+            continue
+        k = BLOCK
+        while i + k < n and j + k < len(old) and new[i + k] == old[j + k]:
+            k += 1
+        while i > lit_start and j > 0 and new[i - 1] == old[j - 1]:   # grow back into pending literal
+            i -= 1; j -= 1; k += 1
+        if i > lit_start:
+            ops.append((OP_ADD, new[lit_start:i]))
+        ops.append((OP_COPY, j, k))
+        i += k
+        lit_start = i
+        next_src = j + k
+    if lit_start < n:
+        ops.append((OP_ADD, new[lit_start:]))
+    return ops
+
+
+def encode(old, new, ops):
+    out = bytearray(b"ADLT" + bytes([1, 0, 0, 0]))
+    out += struct.pack("<II", len(old), len(new))
+    out += hashlib.sha256(old).digest() + hashlib.sha256(new).digest()
+    for op in ops:
+        if op[0] == OP_COPY:
+            out += struct.pack("<BII", OP_COPY, op[1], op[2])
+        else:
+            out += struct.pack("<BI", OP_ADD, len(op[1])) + op[1]
+    return bytes(out)
+
+
+def apply(old, patch):
+    assert patch[:4] == b"ADLT" and patch[4] == 1
+    src_size, dst_size = struct.unpack_from("<II", patch, 8)
+    assert src_size == len(old) and patch[16:48] == hashlib.sha256(old).digest()
+    out, p = bytearray(), 80
+    while len(out) < dst_size:
+        op = patch[p]
+        if op == OP_COPY:
+            off, ln = struct.unpack_from("<II", patch, p + 1)
+            out += old[off:off + ln]
+            p += 9
+        elif op == OP_ADD:
+            (ln,) = struct.unpack_from("<I", patch, p + 1)
+            out += patch[p + 5:p + 5 + ln]
+            p += 5 + ln
+        else:
+            raise ValueError("bad op %d at %d" % (op, p))
+    assert p == len(patch), "trailing bytes"
+    assert hashlib.sha256(out).digest() == patch[48:80]
+    return bytes(out)
+
+
+def main():
+    if len(sys.argv) != 4:
+        sys.exit(__doc__)
+    old = open(sys.argv[1], "rb").read()
+    new = open(sys.argv[2], "rb").read()
+    ops = diff(old, new)
+    patch = encode(old, new, ops)
+    if apply(old, patch) != new:
+        sys.exit("internal error: patch does not reproduce new image")
+    open(sys.argv[3], "wb").write(patch)
+    copies = sum(1 for o in ops if o[0] == OP_COPY)
+    literal = sum(len(o[1]) for o in ops if o[0] == OP_ADD)
+    print("%s: %d bytes (%.1f%% of %d), %d copies, %d literal bytes"
+          % (sys.argv[3], len(patch), 100.0 * len(patch) / max(1, len(new)), len(new), copies, literal))
+
+
+if __name__ == "__main__":
+    main()
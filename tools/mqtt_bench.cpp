@@ -0,0 +1,355 @@
+// Host harness for src/mqtt.*: the device's publisher over POSIX sockets.
+//
+// Build:  g++ -O2 -std=c++17 -pthread -I. tools/mqtt_bench.cpp src/mqtt.cpp -o mqtt_bench
+// Usage:  mqtt_bench                 runs against a built-in loopback broker
+//         mqtt_bench <host> [port]   runs against a real broker (e.g. mosquitto)
+//
+//   1. Throughput: events (QoS 1) offered at a fixed rate, sent one per
+//      publish and then batched; publishes, items and bytes per second of
+//      client busy time, and whether every item arrived.
+//   2. Outage (built-in broker only): the broker goes away for a while
+//      under steady load; reconnect attempts and backoff, offline queue
+//      high-water, batches dropped, and whether what arrived is the
+//      newest data in order.
+//   3. Memory held by the client.
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "src/mqtt.h"
+
+typedef std::chrono::steady_clock Clock;
+static const Clock::time_point T0 = Clock::now();
+
+static uint32_t nowMs() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - T0).count();
+}
+
+class SocketTransport : public MqttTransport {
+public:
+  bool open(const char* host, uint16_t port, uint32_t timeoutMs) override {
+    close();
+    char ps[8];
+    snprintf(ps, sizeof(ps), "%u", port);
+    addrinfo hints = {}, *ai = nullptr;
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, ps, &hints, &ai) != 0) return false;
+    _fd = socket(AF_INET, SOCK_STREAM, 0);
+    fcntl(_fd, F_SETFL, O_NONBLOCK);
+    int rc = ::connect(_fd, ai->ai_addr, ai->ai_addrlen);
+    freeaddrinfo(ai);
+    if (rc != 0) {
+      pollfd p = { _fd, POLLOUT, 0 };
+      int err = 0;
+      socklen_t el = sizeof(err);
+      if (poll(&p, 1, timeoutMs) != 1 || getsockopt(_fd, SOL_SOCKET, SO_ERROR, &err, &el) != 0 || err) {
+        close();
+        return false;
+      }
+    }
+    int one = 1;
+    setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return true;
+  }
+  void close() override {
+    if (_fd >= 0) ::close(_fd);
+    _fd = -1;
+  }
+  bool write(const uint8_t* p, size_t n) override {
+    while (n) {
+      pollfd pf = { _fd, POLLOUT, 0 };
+      if (_fd < 0 || poll(&pf, 1, 2000) != 1) return false;
+      ssize_t w = send(_fd, p, n, MSG_NOSIGNAL);
+      if (w <= 0) return false;
+      p += w;
+      n -= w;
+    }
+    return true;
+  }
+  int read(uint8_t* p, size_t n, uint32_t timeoutMs) override {
+    if (_fd < 0) return -1;
+    pollfd pf = { _fd, POLLIN, 0 };
+    int r = poll(&pf, 1, timeoutMs);
+    if (r == 0) return 0;
+    ssize_t got = r > 0 ? recv(_fd, p, n, 0) : -1;
+    return got > 0 ? (int)got : -1;
+  }
+
+private:
+  int _fd = -1;
+};
+
+class StdLock : public MqttLock {
+public:
+  void lock() override { _m.lock(); }
+  void unlock() override { _m.unlock(); }
+
+private:
+  std::mutex _m;
+};
+
+// Just enough of a broker: CONNACK, PUBACK, PINGRESP; records what it gets.
+class LoopBroker {
+public:
+  std::atomic<bool> up{true};
+  std::atomic<uint32_t> connects{0}, publishes{0}, items{0}, bytes{0};
+  std::mutex seqLock;
+  std::vector<int> seqs;               // "n" of every event received, in order
+
+  bool start(uint16_t port) {
+    _port = port;
+    if (!listenSock()) return false;
+    _th = std::thread([this] { run(); });
+    return true;
+  }
+  void stop() {
+    _quit = true;
+    up = false;
+    if (_th.joinable()) _th.join();
+  }
+
+private:
+  bool listenSock() {
+    _lfd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(_lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in a = {};
+    a.sin_family = AF_INET;
+    a.sin_port = htons(_port);
+    a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(_lfd, (sockaddr*)&a, sizeof(a)) != 0 || listen(_lfd, 4) != 0) { ::close(_lfd); _lfd = -1; return false; }
+    return true;
+  }
+  bool readN(int fd, uint8_t* p, size_t n) {
+    while (n) {
+      pollfd pf = { fd, POLLIN, 0 };
+      if (!up || poll(&pf, 1, 50) < 0) return false;
+      if (!(pf.revents & (POLLIN | POLLHUP))) continue;
+      ssize_t r = recv(fd, p, n, 0);
+      if (r <= 0) return false;
+      p += r;
+      n -= r;
+    }
+    return true;
+  }
+  void serve(int fd) {
+    std::vector<uint8_t> body;
+    for (;;) {
+      uint8_t h;
+      if (!readN(fd, &h, 1)) return;
+      size_t rem = 0;
+      for (int i = 0; i < 4; i++) {
+        uint8_t b;
+        if (!readN(fd, &b, 1)) return;
+        rem |= (size_t)(b & 0x7F) << (7 * i);
+        if (!(b & 0x80)) break;
+      }
+      body.resize(rem);
+      if (rem && !readN(fd, body.data(), rem)) return;
+      uint8_t type = h & 0xF0;
+      if (type == 0x10) {
+        const uint8_t ack[4] = { 0x20, 2, 0, 0 };
+        send(fd, ack, 4, MSG_NOSIGNAL);
+        connects++;
+      } else if (type == 0x30) {
+        int qos = (h >> 1) & 3;
+        size_t tl = body[0] << 8 | body[1], off = 2 + tl;
+        std::string topic((const char*)body.data() + 2, tl);
+        if (qos) {
+          const uint8_t ack[4] = { 0x40, 2, body[off], body[off + 1] };
+          off += 2;
+          send(fd, ack, 4, MSG_NOSIGNAL);
+        }
+        if (topic.size() > 7 && topic.compare(topic.size() - 7, 7, "/status") == 0) continue;
+        publishes++;
+        bytes += rem - off;
+        std::lock_guard<std::mutex> g(seqLock);
+        for (size_t i = off; i < rem; i++) {
+          if (body[i] != '{') continue;
+          items++;
+          if (!memcmp(&body[i], "{\"n\":", 5)) seqs.push_back(atoi((const char*)&body[i + 5]));
+        }
+      } else if (type == 0xC0) {
+        const uint8_t resp[2] = { 0xD0, 0 };
+        send(fd, resp, 2, MSG_NOSIGNAL);
+      } else if (type == 0xE0) {
+        return;
+      }
+    }
+  }
+  void run() {
+    while (!_quit) {
+      if (!up) {
+        if (_lfd >= 0) { ::close(_lfd); _lfd = -1; }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        continue;
+      }
+      if (_lfd < 0 && !listenSock()) { std::this_thread::sleep_for(std::chrono::milliseconds(10)); continue; }
+      pollfd pf = { _lfd, POLLIN, 0 };
+      if (poll(&pf, 1, 50) != 1) continue;
+      int fd = accept(_lfd, nullptr, nullptr);
+      if (fd < 0) continue;
+      serve(fd);
+      ::close(fd);
+    }
+    if (_lfd >= 0) ::close(_lfd);
+  }
+
+  uint16_t _port = 0;
+  int _lfd = -1;
+  std::atomic<bool> _quit{false};
+  std::thread _th;
+};
+
+struct Run {
+  MqttStats st;
+  double secs;       // until everything offered was delivered or dropped
+  double busySecs;   // inside step(): encoding, socket I/O, waiting for PUBACKs
+  size_t mem;
+};
+
+// Offers `rate` events/s for `secs` seconds (plus 1 telemetry sample/s) and
+// keeps stepping until the queue drains. outage = {from, to} seconds.
+static Run drive(const MqttConfig& cfg, const MqttBatchConfig* bc, size_t queue, int rate, double secs,
+                 LoopBroker* broker, double downFrom = -1, double downTo = -1) {
+  SocketTransport t;
+  StdLock lk;
+  MqttClient c(t, &lk);
+  Run res = {};
+  if (!c.begin(cfg, bc, queue)) { fprintf(stderr, "begin failed\n"); return res; }
+  std::atomic<bool> producing{true};
+  uint32_t start = nowMs();
+  std::thread prod([&] {
+    char js[96];
+    int n = 0;
+    for (;;) {
+      double t = (nowMs() - start) / 1000.0;
+      if (t >= secs) break;
+      if (broker && downFrom >= 0) broker->up = !(t >= downFrom && t < downTo);
+      while (n < (int)(t * rate)) {
+        snprintf(js, sizeof(js), "{\"n\":%d,\"t\":%u,\"ev\":\"sound\",\"lvl\":%d,\"ms\":%d}", n, nowMs(), 60 + n % 40, 200 + n % 300);
+        c.add(MQTT_EVENTS, js, nowMs());
+        n++;
+      }
+      if ((nowMs() - start) / 1000 != (nowMs() - start - 1) / 1000) {
+        snprintf(js, sizeof(js), "{\"t\":%u,\"heap\":%d,\"rssi\":-%d,\"ovr\":0}", nowMs(), 180000 - n % 977, 50 + n % 20);
+        c.add(MQTT_TELEMETRY, js, nowMs());
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (broker) broker->up = true;
+    producing = false;
+  });
+  uint32_t idleSince = 0;
+  double busyUs = 0;
+  for (;;) {
+    auto t0 = Clock::now();
+    uint32_t w = c.step(nowMs());
+    busyUs += std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+    MqttStats s = c.stats();
+    if (!producing && s.queueBytes == 0 && s.items == s.publishedItems + s.droppedItems) {
+      if (!idleSince) idleSince = nowMs();
+      if (nowMs() - idleSince > 200) break;       // let the broker count the last publish
+    }
+    if (!producing && nowMs() - start > (secs + 30) * 1000) break;
+    std::this_thread::sleep_for(std::chrono::milliseconds(w < 5 ? w : 5));
+  }
+  prod.join();
+  res.secs = (nowMs() - start - 200) / 1000.0;
+  res.busySecs = busyUs / 1e6;
+  res.st = c.stats();
+  res.mem = c.memoryBytes();
+  c.end();
+  return res;
+}
+
+int main(int argc, char** argv) {
+  const char* host = argc > 1 ? argv[1] : "127.0.0.1";
+  uint16_t port = argc > 2 ? atoi(argv[2]) : (argc > 1 ? 1883 : 18830);
+  LoopBroker broker;
+  LoopBroker* bk = nullptr;
+  if (argc < 2) {
+    if (!broker.start(port)) { fprintf(stderr, "cannot listen on %u\n", port); return 1; }
+    bk = &broker;
+  }
+  MqttConfig cfg = {};
+  cfg.host = host;
+  cfg.port = port;
+  cfg.clientId = "mqtt-bench";
+  cfg.prefix = "aniviza/bench";
+  cfg.keepaliveS = 30;
+  cfg.connectTimeoutMs = 2000;
+  cfg.ackTimeoutMs = 2000;
+  cfg.backoffMinMs = 250;
+  cfg.backoffMaxMs = 4000;
+  const size_t QUEUE = 8192;
+  bool ok = true;
+
+  printf("1. throughput, QoS 1 events at 2000/s for 3 s%s:\n", bk ? " (loopback broker)" : "");
+  for (int batched = 0; batched < 2; batched++) {
+    MqttBatchConfig bc[MQTT_STREAMS] = { { (uint16_t)(batched ? 1024 : 80), batched ? 250u : 0u, 1 },
+                                         { 1024, 1000, 0 } };
+    if (bk) { broker.publishes = broker.items = broker.bytes = 0; std::lock_guard<std::mutex> g(broker.seqLock); broker.seqs.clear(); }
+    Run r = drive(cfg, bc, QUEUE, 2000, 3.0, bk);
+    const MqttStats& s = r.st;
+    printf("  %-9s %u items in %u publishes (%.1f each), done after %.2f s, client busy %.2f s"
+           " -> %.0f pub/s, %.0f items/s, %.0f kB/s capacity, dropped=%u",
+           batched ? "batched" : "unbatched", s.items, s.published, s.published ? (double)s.publishedItems / s.published : 0,
+           r.secs, r.busySecs, s.published / r.busySecs, s.publishedItems / r.busySecs, s.pubBytes / r.busySecs / 1024,
+           s.droppedItems);
+    if (bk) {
+      bool all = broker.items == s.items - s.droppedItems;
+      printf(" broker got %u %s", (unsigned)broker.items, all ? "ok" : "MISMATCH");
+      ok &= all;
+    }
+    printf("\n");
+  }
+
+  if (bk) {
+    printf("2. outage: 200 events/s for 12 s, broker down from 2 s to 8 s, %u-byte queue:\n", (unsigned)QUEUE);
+    MqttBatchConfig bc[MQTT_STREAMS] = { { 1024, 250, 1 }, { 1024, 5000, 0 } };
+    broker.connects = 0;
+    { std::lock_guard<std::mutex> g(broker.seqLock); broker.seqs.clear(); }
+    Run r = drive(cfg, bc, QUEUE, 200, 12.0, bk, 2.0, 8.0);
+    const MqttStats& s = r.st;
+    std::vector<int> seqs;
+    { std::lock_guard<std::mutex> g(broker.seqLock); seqs = broker.seqs; }
+    bool ordered = true;
+    int gaps = 0;
+    for (size_t i = 1; i < seqs.size(); i++) {
+      if (seqs[i] <= seqs[i - 1]) ordered = false;
+      if (seqs[i] != seqs[i - 1] + 1) gaps++;
+    }
+    printf("  connects=%u failed attempts=%u disconnects=%u last backoff=%ums\n", s.connects, s.connectFails,
+           s.disconnects, s.lastBackoffMs);
+    printf("  events offered=%u delivered=%zu dropped=%u (%u batches), queue high-water %u / %u bytes\n",
+           s.items, seqs.size(), s.droppedItems, s.droppedBatches, s.queueHigh, s.queueCap);
+    printf("  delivered in order: %s, gaps in sequence: %d (dropped oldest batches)\n", ordered ? "yes" : "NO", gaps);
+    ok &= ordered && s.connects >= 2 && s.droppedItems > 0;
+  }
+
+  MqttBatchConfig bc[MQTT_STREAMS] = { { 1024, 250, 1 }, { 1024, 5000, 0 } };
+  SocketTransport t;
+  MqttClient c(t);
+  c.begin(cfg, bc, QUEUE);
+  printf("3. memory: %zu bytes (queue %u, batches 2 x 1024, tx buffer, object %zu)\n", c.memoryBytes(),
+         (unsigned)QUEUE, sizeof(MqttClient));
+  c.end();
+  if (bk) broker.stop();
+  printf("%s\n", ok ? "all checks pass" : "CHECK FAILED");
+  return ok ? 0 : 1;
+}
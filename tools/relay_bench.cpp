@@ -0,0 +1,145 @@
+// Host harness for src/espnow_relay.*: one donor and N requesters on the
+// simulated medium from src/espnow_relay_sim.h, with frame loss.
+//
+// Build:  g++ -O2 -std=c++17 -I. tools/relay_bench.cpp src/espnow_relay.cpp src/soft_crypto.cpp -o relay_bench
+// Usage:  relay_bench [requesters] [loss%] [seed]
+//           Checks the soft AES-CCM against RFC 3610 packet vector #1,
+//           then starts a donor on channel 6 and `requesters` units
+//           (default 8) hopping from channel 1, with `loss%` (default 20)
+//           of frames dropped per receiver. One extra unit holds the
+//           wrong fleet key and must never accept an offer. Prints the
+//           time each unit took to get the credentials and whether the
+//           donor saw its ACK; exits 1 if a unit got no or wrong
+//           credentials, or the wrong-key unit got any.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "src/espnow_relay_sim.h"
+
+#define SIM_LIMIT_MS 30000
+
+struct Unit {
+  RelaySimRadio* radio;
+  CredRelay*     relay;
+  bool           got = false;
+  uint32_t       tGot = 0;
+  RelayCreds     creds = {};
+  RelaySimMedium* medium;
+};
+
+static void onCreds(const RelayCreds& c, void* ctx) {
+  Unit* u = (Unit*)ctx;
+  u->got = true;
+  u->tGot = u->medium->now();
+  u->creds = c;
+}
+
+static bool hexEq(const uint8_t* p, const char* hex) {
+  for (size_t i = 0; hex[2 * i]; i++) {
+    unsigned v;
+    sscanf(hex + 2 * i, "%2x", &v);
+    if (p[i] != v) return false;
+  }
+  return true;
+}
+
+#ifndef RELAY_MBEDTLS
+// RFC 3610 packet vector #1: 13-byte nonce, 8 bytes AD, 23 bytes, 8-byte tag.
+static bool ccmVectors() {
+  uint8_t key[16], nonce[13] = {0x00,0x00,0x00,0x03,0x02,0x01,0x00,0xA0,0xA1,0xA2,0xA3,0xA4,0xA5};
+  uint8_t ad[8], pt[23], ct[23], tag[8], back[23];
+  for (int i = 0; i < 16; i++) key[i] = 0xC0 + i;
+  for (int i = 0; i < 8; i++) ad[i] = i;
+  for (int i = 0; i < 23; i++) pt[i] = 8 + i;
+  SoftAesCcm c;
+  c.setKey(key);
+  bool ok = c.encrypt(sizeof(pt), nonce, 13, ad, 8, pt, ct, tag, 8) &&
+            hexEq(ct, "588C979A61C663D2F066D0C2C0F989806D5F6B61DAC384") && hexEq(tag, "17E8D12CFDF926E0");
+  printf("  %-38s %s\n", "RFC 3610 #1 encrypt", ok ? "ok" : "FAILED");
+  bool dec = c.decrypt(sizeof(ct), nonce, 13, ad, 8, ct, back, tag, 8) && !memcmp(back, pt, sizeof(pt));
+  printf("  %-38s %s\n", "RFC 3610 #1 decrypt", dec ? "ok" : "FAILED");
+  ct[5] ^= 1;
+  bool rej = !c.decrypt(sizeof(ct), nonce, 13, ad, 8, ct, back, tag, 8);
+  printf("  %-38s %s\n", "tampered ciphertext rejected", rej ? "ok" : "FAILED");
+  return ok && dec && rej;
+}
+#endif
+
+int main(int argc, char** argv) {
+  int n = argc > 1 ? atoi(argv[1]) : 8;
+  uint32_t loss = argc > 2 ? (uint32_t)atoi(argv[2]) : 20;
+  unsigned seed = argc > 3 ? (unsigned)atoi(argv[3]) : 1;
+  bool pass = true;
+
+#ifndef RELAY_MBEDTLS
+  printf("AES-CCM (soft_crypto):\n");
+  pass &= ccmVectors();
+#endif
+
+  RelaySimMedium medium(2, loss, seed);
+  uint8_t key[RELAY_KEY_LEN], wrongKey[RELAY_KEY_LEN];
+  for (int i = 0; i < RELAY_KEY_LEN; i++) { key[i] = (uint8_t)(0x11 * (i + 1)); wrongKey[i] = key[i] ^ 0x5A; }
+
+  const uint8_t donorMac[6] = {0x24,0x0A,0xC4,0x00,0x00,0x01};
+  RelaySimRadio donorRadio(medium, donorMac, 6);
+  CredRelay donor(donorRadio);
+  donorRadio.relay = &donor;
+  medium.attach(&donorRadio);
+  donor.setKey(key);
+  RelayCreds creds = {};
+  strcpy(creds.ssid, "FleetNet");
+  strcpy(creds.pass, "correct horse battery");
+  creds.hops = 1;
+
+  std::vector<Unit> units(n + 1);
+  for (int i = 0; i <= n; i++) {
+    uint8_t mac[6] = {0x24,0x0A,0xC4,0x01,(uint8_t)(i >> 8),(uint8_t)i};
+    units[i].medium = &medium;
+    units[i].radio = new RelaySimRadio(medium, mac, 1);
+    units[i].relay = new CredRelay(*units[i].radio);
+    units[i].radio->relay = units[i].relay;
+    medium.attach(units[i].radio);
+    units[i].relay->setKey(i == n ? wrongKey : key);
+    units[i].relay->startRequester(medium.now(), onCreds, &units[i]);
+  }
+  donor.startDonor(creds, medium.now(), SIM_LIMIT_MS);
+
+  int got = 0;
+  while (medium.now() < SIM_LIMIT_MS) {
+    medium.step();
+    got = 0;
+    for (int i = 0; i < n; i++) got += units[i].got;
+    if (got == n) break;
+  }
+  for (int t = 0; t < 100; t++) medium.step();    // let the last ACK repeats land
+
+  printf("Relay: %d requesters + 1 with the wrong key, %u%% loss, seed %u\n", n, (unsigned)loss, seed);
+  uint32_t worst = 0;
+  for (int i = 0; i <= n; i++) {
+    Unit& u = units[i];
+    bool right = u.got && !strcmp(u.creds.ssid, creds.ssid) && !strcmp(u.creds.pass, creds.pass) &&
+                 u.creds.hops == creds.hops;
+    bool acked = donor.acked(u.radio->mac);
+    const RelayStats& s = u.relay->stats();
+    // A unit whose three ACKs were all lost still joins; the donor just
+    // does not count it, so `acked` is reported but not required.
+    bool ok = i == n ? !u.got && !acked && s.offersBad > 0 : right;
+    if (i < n && u.got && u.tGot > worst) worst = u.tGot;
+    printf("  unit %2d%s %-8s %6lu ms  hops=%-3lu offers ok/bad=%lu/%lu acks=%lu  %s %s\n", i,
+           i == n ? "*" : " ", u.got ? "joined" : "waiting", (unsigned long)(u.got ? u.tGot : medium.now()),
+           (unsigned long)s.channelHops, (unsigned long)s.offersRecv, (unsigned long)s.offersBad,
+           (unsigned long)s.acksSent, acked ? "acked" : "-", ok ? "ok" : "FAILED");
+    pass &= ok;
+  }
+  const RelayStats& d = donor.stats();
+  printf("Donor: offers=%lu acks ok/bad=%lu/%lu units=%lu; %d/%d joined by %lu ms\n",
+         (unsigned long)d.offersSent, (unsigned long)d.acksRecv, (unsigned long)d.acksBad,
+         (unsigned long)d.unitsAcked, got, n, (unsigned long)worst);
+  printf("Medium: sent=%lu delivered=%lu lost=%lu\n", (unsigned long)medium.sent,
+         (unsigned long)medium.delivered, (unsigned long)medium.lost);
+
+  for (auto& u : units) { delete u.relay; delete u.radio; }
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
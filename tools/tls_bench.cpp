@@ -0,0 +1,273 @@
+// Host benchmark for the TLS front end (tls_proxy.ino): the same mbedTLS
+// server configuration, driven in memory against an mbedTLS client.
+//
+// Build:  g++ -O2 -std=c++17 tools/tls_bench.cpp -lmbedtls -lmbedx509 -lmbedcrypto -o tls_bench
+//         (mbedTLS 2.28 as on the ESP32 core, e.g. Debian/Ubuntu libmbedtls-dev)
+// Usage:  tls_bench [rounds]
+//           For an ECDSA P-256 and an RSA-2048 identity (ECDHE P-256 key
+//           exchange, AES-128-GCM either way), runs `rounds` (default 50)
+//           handshakes of each kind: full, resumed from a session ticket,
+//           and resumed from the server's session-ID cache. Prints the
+//           server's CPU time per handshake next to the client's, and
+//           the bytes on the wire. The ESP32 pays the server column many
+//           times over, and more so for RSA, whose private-key operation
+//           it cannot offload. Exits 1 if a resumption did not resume.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <deque>
+#include <mbedtls/ssl.h>
+#include <mbedtls/ssl_ticket.h>
+#include <mbedtls/ssl_cache.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/pk.h>
+#include <mbedtls/ecp.h>
+#include <mbedtls/rsa.h>
+#include <mbedtls/x509_crt.h>
+
+typedef std::chrono::steady_clock Clock;
+
+#define TICKET_LIFETIME 86400
+#define CACHE_ENTRIES   4           // as TLS_CACHE_ENTRIES
+
+static mbedtls_entropy_context  entropy;
+static mbedtls_ctr_drbg_context drbg;
+static bool resumed = false;        // set by the wrapped ticket/cache lookups, as on the device
+
+static double usSince(Clock::time_point t0) {
+  return std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+}
+
+// ---- In-memory transport: one byte queue per direction.
+
+struct Pipe { std::deque<unsigned char> q; size_t total = 0; };
+struct Endpoint { Pipe* out; Pipe* in; };
+
+static int bioSend(void* ctx, const unsigned char* buf, size_t len) {
+  Pipe* p = ((Endpoint*)ctx)->out;
+  p->q.insert(p->q.end(), buf, buf + len);
+  p->total += len;
+  return (int)len;
+}
+
+static int bioRecv(void* ctx, unsigned char* buf, size_t len) {
+  Pipe* p = ((Endpoint*)ctx)->in;
+  if (p->q.empty()) return MBEDTLS_ERR_SSL_WANT_READ;
+  size_t n = len < p->q.size() ? len : p->q.size();
+  for (size_t i = 0; i < n; i++) { buf[i] = p->q.front(); p->q.pop_front(); }
+  return (int)n;
+}
+
+// ---- Server identity, generated like tlsLoadOrCreateIdentity().
+
+struct Identity {
+  const char*        name;
+  mbedtls_pk_context key;
+  mbedtls_x509_crt   crt;
+  int                suites[2];
+  double             genMs;
+  int                crtLen;
+};
+
+static bool makeIdentity(Identity& id, bool rsa) {
+  mbedtls_pk_init(&id.key);
+  mbedtls_x509_crt_init(&id.crt);
+  auto t0 = Clock::now();
+  int rc = mbedtls_pk_setup(&id.key, mbedtls_pk_info_from_type(rsa ? MBEDTLS_PK_RSA : MBEDTLS_PK_ECKEY));
+  if (rc == 0)
+    rc = rsa ? mbedtls_rsa_gen_key(mbedtls_pk_rsa(id.key), mbedtls_ctr_drbg_random, &drbg, 2048, 65537)
+             : mbedtls_ecp_gen_key(MBEDTLS_ECP_DP_SECP256R1, mbedtls_pk_ec(id.key), mbedtls_ctr_drbg_random, &drbg);
+  if (rc) { fprintf(stderr, "key generation failed: -0x%04x\n", -rc); return false; }
+  id.genMs = usSince(t0) / 1000;
+
+  mbedtls_x509write_cert w;
+  mbedtls_x509write_crt_init(&w);
+  mbedtls_mpi serial;
+  mbedtls_mpi_init(&serial);
+  mbedtls_mpi_lset(&serial, 1);
+  mbedtls_x509write_crt_set_version(&w, MBEDTLS_X509_CRT_VERSION_3);
+  mbedtls_x509write_crt_set_md_alg(&w, MBEDTLS_MD_SHA256);
+  mbedtls_x509write_crt_set_subject_key(&w, &id.key);
+  mbedtls_x509write_crt_set_issuer_key(&w, &id.key);
+  mbedtls_x509write_crt_set_subject_name(&w, "CN=aniviza-bench,O=Aniviza");
+  mbedtls_x509write_crt_set_issuer_name(&w, "CN=aniviza-bench,O=Aniviza");
+  mbedtls_x509write_crt_set_serial(&w, &serial);
+  mbedtls_x509write_crt_set_validity(&w, "20240101000000", "20491231235959");
+  mbedtls_x509write_crt_set_basic_constraints(&w, 0, -1);
+  unsigned char der[2048];
+  int n = mbedtls_x509write_crt_der(&w, der, sizeof(der), mbedtls_ctr_drbg_random, &drbg);
+  mbedtls_x509write_crt_free(&w);
+  mbedtls_mpi_free(&serial);
+  if (n <= 0 || mbedtls_x509_crt_parse_der(&id.crt, der + sizeof(der) - n, n) != 0) {
+    fprintf(stderr, "certificate encoding failed (%d)\n", n);
+    return false;
+  }
+  id.crtLen = n;
+  id.name = rsa ? "RSA-2048" : "ECDSA P-256";
+  id.suites[0] = rsa ? MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256 : MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256;
+  id.suites[1] = 0;
+  return true;
+}
+
+// ---- Server configuration as in tlsSetup().
+
+static int ticketParse(void* p, mbedtls_ssl_session* s, unsigned char* buf, size_t len) {
+  int rc = mbedtls_ssl_ticket_parse(p, s, buf, len);
+  if (rc == 0) resumed = true;
+  return rc;
+}
+
+static int cacheGet(void* p, mbedtls_ssl_session* s) {
+  int rc = mbedtls_ssl_cache_get(p, s);
+  if (rc == 0) resumed = true;
+  return rc;
+}
+
+static const mbedtls_ecp_group_id curves[] = { MBEDTLS_ECP_DP_SECP256R1, MBEDTLS_ECP_DP_NONE };
+
+struct Server {
+  mbedtls_ssl_config         conf;
+  mbedtls_ssl_ticket_context ticket;
+  mbedtls_ssl_cache_context  cache;
+};
+
+static bool serverSetup(Server& s, Identity& id) {
+  mbedtls_ssl_config_init(&s.conf);
+  mbedtls_ssl_ticket_init(&s.ticket);
+  mbedtls_ssl_cache_init(&s.cache);
+  if (mbedtls_ssl_config_defaults(&s.conf, MBEDTLS_SSL_IS_SERVER, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                  MBEDTLS_SSL_PRESET_DEFAULT)) return false;
+  mbedtls_ssl_conf_rng(&s.conf, mbedtls_ctr_drbg_random, &drbg);
+  mbedtls_ssl_conf_ciphersuites(&s.conf, id.suites);
+  mbedtls_ssl_conf_curves(&s.conf, curves);
+  if (mbedtls_ssl_conf_own_cert(&s.conf, &id.crt, &id.key)) return false;
+  if (mbedtls_ssl_ticket_setup(&s.ticket, mbedtls_ctr_drbg_random, &drbg, MBEDTLS_CIPHER_AES_128_GCM, TICKET_LIFETIME))
+    return false;
+  mbedtls_ssl_conf_session_tickets_cb(&s.conf, mbedtls_ssl_ticket_write, ticketParse, &s.ticket);
+  mbedtls_ssl_cache_set_max_entries(&s.cache, CACHE_ENTRIES);
+  mbedtls_ssl_cache_set_timeout(&s.cache, TICKET_LIFETIME);
+  mbedtls_ssl_conf_session_cache(&s.conf, &s.cache, cacheGet, mbedtls_ssl_cache_set);
+  return true;
+}
+
+static void serverFree(Server& s) {
+  mbedtls_ssl_cache_free(&s.cache);
+  mbedtls_ssl_ticket_free(&s.ticket);
+  mbedtls_ssl_config_free(&s.conf);
+}
+
+// The client does not verify the self-signed certificate: what is timed
+// here is the server's side, and a phone's verification cost is its own.
+static bool clientSetup(mbedtls_ssl_config& conf, bool tickets) {
+  mbedtls_ssl_config_init(&conf);
+  if (mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                  MBEDTLS_SSL_PRESET_DEFAULT)) return false;
+  mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, &drbg);
+  mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_NONE);
+  mbedtls_ssl_conf_session_tickets(&conf, tickets ? MBEDTLS_SSL_SESSION_TICKETS_ENABLED
+                                                  : MBEDTLS_SSL_SESSION_TICKETS_DISABLED);
+  return true;
+}
+
+// ---- One connection: fresh contexts on both sides, as every API call is.
+
+struct Result { double srvUs, cliUs; size_t bytes; bool ok, resumed; };
+
+static Result connectOnce(Server& srv, mbedtls_ssl_config& cliConf, mbedtls_ssl_session* sess) {
+  Result r = {};
+  Pipe c2s, s2c;
+  Endpoint ce = { &c2s, &s2c }, se = { &s2c, &c2s };
+  mbedtls_ssl_context cli, ssl;
+  mbedtls_ssl_init(&cli);
+  mbedtls_ssl_init(&ssl);
+  if (mbedtls_ssl_setup(&cli, &cliConf) || mbedtls_ssl_setup(&ssl, &srv.conf)) return r;
+  mbedtls_ssl_set_bio(&cli, &ce, bioSend, bioRecv, nullptr);
+  mbedtls_ssl_set_bio(&ssl, &se, bioSend, bioRecv, nullptr);
+  if (sess && mbedtls_ssl_set_session(&cli, sess)) return r;
+  resumed = false;
+
+  for (int i = 0; i < 100 && !r.ok; i++) {
+    auto t0 = Clock::now();
+    int rc = mbedtls_ssl_handshake(&cli);
+    r.cliUs += usSince(t0);
+    if (rc && rc != MBEDTLS_ERR_SSL_WANT_READ && rc != MBEDTLS_ERR_SSL_WANT_WRITE) break;
+    t0 = Clock::now();
+    int rs = mbedtls_ssl_handshake(&ssl);
+    r.srvUs += usSince(t0);
+    if (rs && rs != MBEDTLS_ERR_SSL_WANT_READ && rs != MBEDTLS_ERR_SSL_WANT_WRITE) break;
+    r.ok = rc == 0 && rs == 0;
+  }
+  r.resumed = resumed;
+  r.bytes = c2s.total + s2c.total;
+  if (r.ok && sess) {                         // keep the newest ticket for the next round
+    mbedtls_ssl_session_free(sess);
+    mbedtls_ssl_session_init(sess);
+    mbedtls_ssl_get_session(&cli, sess);
+  }
+  mbedtls_ssl_free(&cli);
+  mbedtls_ssl_free(&ssl);
+  return r;
+}
+
+enum Kind { FULL, TICKET, CACHE };
+
+static bool run(Server& srv, Kind kind, int rounds) {
+  static const char* const names[] = { "full", "ticket", "session ID" };
+  mbedtls_ssl_config cliConf;
+  if (!clientSetup(cliConf, kind != CACHE)) return false;
+  mbedtls_ssl_session sess;
+  mbedtls_ssl_session_init(&sess);
+  mbedtls_ssl_session* use = nullptr;
+  if (kind != FULL) {                         // a full handshake first establishes the session
+    Result r = connectOnce(srv, cliConf, &sess);
+    if (!r.ok) { mbedtls_ssl_config_free(&cliConf); return false; }
+    use = &sess;
+  }
+  double srvUs = 0, cliUs = 0, maxUs = 0;
+  size_t bytes = 0;
+  int ok = 0, wrong = 0;
+  for (int i = 0; i < rounds; i++) {
+    Result r = connectOnce(srv, cliConf, use);
+    if (!r.ok) continue;
+    ok++;
+    wrong += r.resumed != (kind != FULL);
+    srvUs += r.srvUs; cliUs += r.cliUs; bytes += r.bytes;
+    if (r.srvUs > maxUs) maxUs = r.srvUs;
+  }
+  mbedtls_ssl_session_free(&sess);
+  mbedtls_ssl_config_free(&cliConf);
+  bool pass = ok == rounds && !wrong;
+  printf("  %-11s server %8.0f us (max %8.0f)  client %8.0f us  %5zu bytes  %d/%d %s\n", names[kind],
+         ok ? srvUs / ok : 0, maxUs, ok ? cliUs / ok : 0, ok ? bytes / ok : 0, ok - wrong, rounds,
+         pass ? "ok" : "FAILED");
+  return pass;
+}
+
+int main(int argc, char** argv) {
+  int rounds = argc > 1 ? atoi(argv[1]) : 50;
+  mbedtls_entropy_init(&entropy);
+  mbedtls_ctr_drbg_init(&drbg);
+  const char* pers = "tls-bench";
+  if (mbedtls_ctr_drbg_seed(&drbg, mbedtls_entropy_func, &entropy, (const unsigned char*)pers, strlen(pers))) return 2;
+
+  bool pass = true;
+  for (int rsa = 0; rsa < 2; rsa++) {
+    Identity id;
+    if (!makeIdentity(id, rsa)) return 2;
+    Server srv;
+    if (!serverSetup(srv, id)) { fprintf(stderr, "server setup failed\n"); return 2; }
+    printf("%s (key generated in %.0f ms, certificate %d bytes):\n", id.name, id.genMs, id.crtLen);
+    pass &= run(srv, FULL, rounds);
+    pass &= run(srv, TICKET, rounds);
+    pass &= run(srv, CACHE, rounds);
+    serverFree(srv);
+    mbedtls_x509_crt_free(&id.crt);
+    mbedtls_pk_free(&id.key);
+  }
+  mbedtls_ctr_drbg_free(&drbg);
+  mbedtls_entropy_free(&entropy);
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}